@@ -8,6 +8,8 @@
 #include <mousetrap.hpp>
 #include <app/layer.hpp>
 
+#include <span>
+
 namespace mousetrap
 {
     /// \brief generate 1-pixel rasterized line between two texels
@@ -39,5 +41,36 @@ namespace mousetrap
     [[nodiscard]] Image flip_image_horizontally(const Image&);
     [[nodiscard]] Image flip_image_vertically(const Image&);
 
+    /// \brief per-pixel flags, stored row-major with one byte per pixel
+    class PixelMask
+    {
+        public:
+            PixelMask(Vector2ui size = {0, 0});
+
+            Vector2ui get_size() const;
+
+            bool get(size_t x, size_t y) const;
+            void set(size_t x, size_t y, bool);
+
+            std::span<const uint8_t> get_row(size_t y) const;
+            std::span<uint8_t> get_row(size_t y);
+
+            uint8_t* data();
+            const uint8_t* data() const;
+
+            /// \brief number of set pixels
+            size_t count() const;
+
+        private:
+            Vector2ui _size;
+            std::vector<uint8_t> _data;
+    };
+
+    /// \brief scanline flood fill on the frames pixel buffer, marks all pixels 8-connected to origin whose color distance is below eps
+    PixelMask generate_bucket_fill_mask(Vector2i origin, const Layer::Frame* frame, float eps = 1.f/(pow(2, 8)), bool respect_alpha = true);
+
+    /// \brief flood fill every frame of the layer from the same origin, frames are processed in parallel
+    std::vector<PixelMask> generate_bucket_fill_masks(Vector2i origin, const Layer* layer, float eps = 1.f/(pow(2, 8)), bool respect_alpha = true);
+
     std::vector<Vector2i> generate_bucket_fill_points(Vector2i origin, const Layer::Frame* frame, float eps = 1.f/(pow(2, 8)), bool respect_alpha = true);
 }
\ No newline at end of file
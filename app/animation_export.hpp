@@ -0,0 +1,136 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/26/23
+//
+
+#pragma once
+
+#include <mousetrap.hpp>
+#include <app/project_file.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace mousetrap
+{
+    enum class AnimationFormat
+    {
+        GIF,    // quantized to at most 256 colors per frame, alpha is either 0 or 1
+        APNG    // lossless
+    };
+
+    /// \brief deduce format from file extension, `.gif` or `.png` / `.apng`
+    /// \returns false if extension is not recognized
+    bool animation_format_from_path(const std::string& path, AnimationFormat& out);
+
+    /// \brief image of the animation, shown for one or more frames of the project
+    struct AnimationFrame
+    {
+        size_t frame_i;     // first frame of the project this image is shown for
+        size_t n_frames;    // number of frames of the project this image is shown for
+    };
+
+    /// \brief frames that have to be composited: a frame where no visible layer has a keyframe looks like the one before, so it only extends the duration of the previous image
+    /// \param layer_is: layers to merge, all layers if empty
+    std::vector<AnimationFrame> get_animation_frames(const ProjectSnapshot&, const std::set<size_t>& layer_is);
+
+    /// \brief encodes images on worker threads and writes them to disk in order as soon as they are done, only a few frames are held in memory at any time
+    class AnimationEncoder
+    {
+        public:
+            /// \param n_threads: number of frames encoded at the same time, number of cores if 0
+            AnimationEncoder(AnimationFormat, size_t n_threads = 0);
+
+            /// \brief cancels if finish was not called
+            ~AnimationEncoder();
+
+            AnimationEncoder(const AnimationEncoder&) = delete;
+            AnimationEncoder& operator=(const AnimationEncoder&) = delete;
+
+            /// \brief create file and write header, all frames have to be of the given size
+            /// \param fps: frames of the project per second, c.f. ProjectState::get_fps
+            bool open(const std::string& path, Vector2ui size, float fps);
+
+            /// \brief queue image for encoding. Blocks while get_can_push is false
+            /// \param n_frames: number of frames of the project the image is shown for
+            void push_frame(Image&&, size_t n_frames = 1);
+
+            /// \brief called on a worker thread right before the frame is encoded, has to return an image of the animation size
+            using FrameSource = std::function<Image()>;
+
+            /// \brief queue frame that is only created on the worker, e.g. composited from a snapshot. Blocks while get_can_push is false
+            void push_frame(FrameSource, size_t n_frames = 1);
+
+            /// \brief number of frames queued or being encoded is below the limit, push_frame will not block
+            bool get_can_push() const;
+
+            /// \brief number of frames pushed but not yet written
+            size_t get_n_in_flight() const;
+
+            /// \brief wait for all frames to be written, write trailer and close file
+            /// \returns false if any frame could not be written or the encoder was cancelled
+            bool finish();
+
+            /// \brief workers stop after their current frame, the incomplete file is deleted
+            void cancel();
+            bool get_is_cancelled() const;
+
+        private:
+            AnimationFormat _format;
+            std::string _path;
+            std::ofstream _file;
+            Vector2ui _size = {0, 0};
+            float _fps = 0;
+
+            struct PendingFrame
+            {
+                size_t index;
+                Image image;
+                size_t n_frames;
+                FrameSource source; // creates image if set
+            };
+
+            void queue(Image&&, FrameSource, size_t n_frames);
+
+            struct EncodedFrame
+            {
+                std::string data;           // GIF: image descriptor, color table and image data; APNG: zlib stream of filtered rows
+                int transparent_index = -1; // GIF only
+                size_t n_frames;
+            };
+
+            mutable std::mutex _mutex;
+            std::condition_variable _queue_condition;   // frame was pushed or encoder stopped
+            std::condition_variable _written_condition; // frame was written
+            std::deque<PendingFrame> _pending;
+            std::map<size_t, EncodedFrame> _encoded;    // by index, waiting for earlier frames to be written
+
+            size_t _max_n_in_flight;
+            size_t _n_pushed = 0;
+            size_t _n_written = 0;
+            std::atomic<bool> _cancelled = false;
+            std::atomic<bool> _failed = false;
+            bool _should_exit = false;
+
+            // held while writing, so frames are appended in order
+            std::mutex _write_mutex;
+            size_t _n_frames_written = 0;   // frames of the project, for durations
+            uint32_t _sequence_number = 0;  // APNG only
+            std::streampos _n_frames_position = 0; // APNG only, frame count in acTL is written once all frames are known
+
+            void write_header();
+            void write_frame(const EncodedFrame&, size_t index);
+            void write_trailer();
+            void write_encoded_frames();
+
+            std::vector<std::thread> _workers;
+            void run();
+            void stop();
+    };
+}
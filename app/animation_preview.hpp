@@ -46,7 +46,7 @@ namespace mousetrap
 
         protected:
             void on_layer_frame_selection_changed() override;
-            void on_layer_image_updated() override;
+            void on_layer_image_updated(const signals::CellInvalidation&) override;
             void on_layer_count_changed() override;
             void on_layer_properties_changed() override;
             void on_playback_toggled() override;
@@ -56,6 +56,8 @@ namespace mousetrap
             void on_image_flip_changed() override;
 
         private:
+            void update_layer_textures();
+
             // render: layers
 
             GLArea _layer_area;
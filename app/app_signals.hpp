@@ -6,6 +6,8 @@
 
 #include <mousetrap.hpp>
 
+#include <map>
+
 namespace mousetrap::signals
 {
     #define DECLARE_APP_SIGNAL_COMPONENT(camel_case_name, snake_case_name) \
@@ -53,11 +55,151 @@ namespace mousetrap::signals
     DECLARE_APP_SIGNAL_COMPONENT(ImageFlipChanged, image_flip_changed)
 
     DECLARE_APP_SIGNAL_COMPONENT(LayerResolutionChanged, layer_resolution_changed)
-    DECLARE_APP_SIGNAL_COMPONENT(LayerImageUpdated, layer_image_updated)
     DECLARE_APP_SIGNAL_COMPONENT(LayerCountChanged, layer_count_changed)
     DECLARE_APP_SIGNAL_COMPONENT(LayerPropertiesChanged, layer_properties_changed)
     DECLARE_APP_SIGNAL_COMPONENT(ActiveToolChanged, active_tool_changed)
 
+    /// \brief cells whose pixels changed, collected over one frame so each listener updates every cell at most once per frame
+    class CellInvalidation
+    {
+        public:
+            /// \brief changed rectangle of a cell in cell coordinates, bottom_right is exclusive
+            struct Region
+            {
+                Vector2i top_left;
+                Vector2i bottom_right;
+                bool is_whole_cell = false; // corners are not meaningful if set
+            };
+
+            /// \brief mark rectangle of cell {layer_i, frame_i}, regions of the same cell are merged into their bounding box
+            void add(Vector2ui cell, Vector2i top_left, Vector2i size)
+            {
+                add(cell, Region{top_left, top_left + size, false});
+            }
+
+            /// \brief mark whole cell
+            void add(Vector2ui cell)
+            {
+                add(cell, Region{{0, 0}, {0, 0}, true});
+            }
+
+            /// \brief mark every cell, for operations that touch the whole project
+            void add_all()
+            {
+                _all = true;
+                _cells.clear();
+            }
+
+            void add(const CellInvalidation& other)
+            {
+                if (other._all)
+                    add_all();
+                else
+                    for (auto& pair : other._cells)
+                        add({pair.first.first, pair.first.second}, pair.second);
+            }
+
+            bool get_is_all() const
+            {
+                return _all;
+            }
+
+            bool empty() const
+            {
+                return not _all and _cells.empty();
+            }
+
+            bool contains(Vector2ui cell) const
+            {
+                return _all or _cells.find({cell.x, cell.y}) != _cells.end();
+            }
+
+            bool contains_layer(size_t layer_i) const
+            {
+                if (_all)
+                    return true;
+
+                auto it = _cells.lower_bound({layer_i, 0});
+                return it != _cells.end() and it->first.first == layer_i;
+            }
+
+            bool contains_frame(size_t frame_i) const
+            {
+                if (_all)
+                    return true;
+
+                for (auto& pair : _cells)
+                    if (pair.first.second == frame_i)
+                        return true;
+
+                return false;
+            }
+
+            /// \brief {layer_i, frame_i} -> region, empty if get_is_all
+            const std::map<std::pair<size_t, size_t>, Region>& get_cells() const
+            {
+                return _cells;
+            }
+
+            void clear()
+            {
+                _all = false;
+                _cells.clear();
+            }
+
+        private:
+            bool _all = false;
+            std::map<std::pair<size_t, size_t>, Region> _cells;
+
+            // whole cells are flagged instead of using sentinel extents, so merging never does arithmetic on them
+            void add(Vector2ui cell, const Region& in)
+            {
+                if (_all)
+                    return;
+
+                auto it = _cells.find({cell.x, cell.y});
+                if (it == _cells.end())
+                {
+                    _cells.insert({{cell.x, cell.y}, in});
+                    return;
+                }
+
+                auto& region = it->second;
+                if (region.is_whole_cell)
+                    return;
+
+                if (in.is_whole_cell)
+                {
+                    region = in;
+                    return;
+                }
+
+                region.top_left = {std::min(region.top_left.x, in.top_left.x), std::min(region.top_left.y, in.top_left.y)};
+                region.bottom_right = {std::max(region.bottom_right.x, in.bottom_right.x), std::max(region.bottom_right.y, in.bottom_right.y)};
+            }
+    };
+
+    struct LayerImageUpdated
+    {
+        public:
+            void signal_layer_image_updated(const CellInvalidation& cells)
+            {
+                if (!_blocked)
+                    on_layer_image_updated(cells);
+            }
+
+            void set_layer_image_updated_blocked(bool b)
+            {
+                _blocked = b;
+            }
+
+        protected:
+            virtual void on_layer_image_updated(const CellInvalidation&) {}
+
+        private:
+            bool _blocked = false;
+    };
+
     DECLARE_APP_SIGNAL_COMPONENT(CursorPositionChanged, cursor_position_changed)
     DECLARE_APP_SIGNAL_COMPONENT(SavePathChanged, save_path_changed)
 };
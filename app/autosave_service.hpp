@@ -0,0 +1,65 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/22/23
+//
+
+#pragma once
+
+#include <mousetrap.hpp>
+#include <app/project_file.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace mousetrap
+{
+    /// \brief writes backups of the project on a worker thread, the main thread only hands over snapshots
+    class AutosaveService
+    {
+        public:
+            /// \param directory: backups are written to `directory/backup_<time>.mtp`
+            /// \param n_backups: number of backups kept, older ones are deleted
+            AutosaveService(const std::string& directory, size_t n_backups);
+
+            /// \brief finishes the backup being written, queued snapshots are dropped
+            ~AutosaveService();
+
+            AutosaveService(const AutosaveService&) = delete;
+            AutosaveService& operator=(const AutosaveService&) = delete;
+
+            const std::string& get_directory() const;
+
+            void set_n_backups(size_t);
+            size_t get_n_backups() const;
+
+            /// \brief write snapshot, unless nothing changed since the last backup. Replaces a snapshot that is still waiting to be written
+            void queue_backup(ProjectSnapshot);
+
+            /// \brief is a backup being written or waiting
+            bool get_is_busy() const;
+
+            /// \brief paths of all backups in the directory, newest first
+            std::vector<std::string> get_backups() const;
+
+        private:
+            std::string _directory;
+            std::atomic<size_t> _n_backups;
+
+            mutable std::mutex _mutex;
+            std::condition_variable _condition;
+            std::optional<ProjectSnapshot> _queued;
+            bool _is_writing = false;
+            bool _should_exit = false;
+
+            // only accessed by the worker
+            ProjectFile _file; // last backup, unchanged cells are copied from it without re-encoding
+            std::optional<ProjectSnapshot> _last_written; // without pixels
+            void run();
+            void write_backup(const ProjectSnapshot&);
+            void remove_old_backups();
+
+            std::thread _worker;
+    };
+}
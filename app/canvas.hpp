@@ -12,6 +12,8 @@
 #include "include/msaa_texture.hpp"
 #include <app/color_picker.hpp>
 
+#include <array>
+
 /*
  Symmetry:
     x pos, y pos
@@ -69,6 +71,7 @@ namespace mousetrap
         DECLARE_GLOBAL_ACTION(canvas, move_float_left)
 
         DECLARE_GLOBAL_ACTION(canvas, apply_bucket_fill);
+        DECLARE_GLOBAL_ACTION(canvas, toggle_bucket_fill_all_frames);
         DECLARE_GLOBAL_ACTION(canvas, apply_color_select);
         DECLARE_GLOBAL_ACTION(canvas, apply_gradient);
         DECLARE_GLOBAL_ACTION(canvas, apply_marquee_neighborhood_select);
@@ -114,7 +117,7 @@ namespace mousetrap
             void on_onionskin_visibility_toggled() override;
             void on_onionskin_layer_count_changed() override;
 
-            void on_layer_image_updated() override;
+            void on_layer_image_updated(const signals::CellInvalidation&) override;
             void on_layer_count_changed() override;
             void on_layer_properties_changed() override;
             void on_layer_resolution_changed() override;
@@ -172,13 +175,87 @@ namespace mousetrap
 
             void draw(const DrawData&);
 
+            // compositor
+
+            /// \brief render stage of one sublayer, all passes draw into the same GLArea in the order they were added to the canvas
+            class RenderPass
+            {
+                friend class Canvas;
+
+                public:
+                    RenderPass() = default;
+
+                    template<typename Function_t, typename Data_t>
+                    void connect_signal_realize(Function_t f, Data_t data)
+                    {
+                        _realize_f = [f, data](RenderPass* pass){ f(pass, data); };
+                    }
+
+                    template<typename Function_t, typename Data_t>
+                    void connect_signal_resize(Function_t f, Data_t data)
+                    {
+                        _resize_f = [f, data](RenderPass* pass, int w, int h){ f(pass, w, h, data); };
+                    }
+
+                    /// \brief replaces rendering of the render tasks, if offscreen targets are used, bind_as_rendertarget has to be called before drawing the result
+                    template<typename Function_t, typename Data_t>
+                    void connect_signal_render(Function_t f, Data_t data)
+                    {
+                        _render_f = [f, data](RenderPass* pass, GdkGLContext* context){ return f(pass, context, data); };
+                    }
+
+                    template<typename Function_t, typename Data_t>
+                    void add_tick_callback(Function_t f, Data_t data)
+                    {
+                        _tick_f = [f, data](FrameClock clock){ return f(clock, data); };
+                    }
+
+                    void add_render_task(Shape*, Shader* = nullptr, GLTransform* = nullptr);
+                    void add_render_task(RenderTask);
+                    void clear_render_tasks();
+
+                    /// \brief request redraw of the shared area
+                    void queue_render();
+                    void make_current();
+                    bool get_is_realized() const;
+
+                    /// \brief bind framebuffer and viewport of the shared area
+                    void bind_as_rendertarget() const;
+
+                private:
+                    GLArea* _target = nullptr;
+                    bool _is_realized = false;
+
+                    GLint _target_framebuffer = 0;
+                    std::array<GLint, 4> _target_viewport = {0, 0, 1, 1};
+
+                    std::vector<RenderTask> _render_tasks;
+
+                    std::function<void(RenderPass*)> _realize_f;
+                    std::function<void(RenderPass*, int, int)> _resize_f;
+                    std::function<bool(RenderPass*, GdkGLContext*)> _render_f;
+                    std::function<bool(FrameClock)> _tick_f;
+
+                    void realize();
+                    void resize(int w, int h);
+                    void render(GdkGLContext*);
+            };
+
+            GLArea _render_area;
+            std::vector<RenderPass*> _render_passes;
+            void add_render_pass(RenderPass*);
+
+            static void on_render_area_realize(Widget*, Canvas* instance);
+            static void on_render_area_resize(GLArea*, int w, int h, Canvas* instance);
+            static bool on_render_area_render(GLArea*, GdkGLContext*, Canvas* instance);
+
             // layers
 
             class TransparencyTilingLayer
             {
                 public:
                     TransparencyTilingLayer(Canvas* owner);
-                    operator Widget*();
+                    operator RenderPass*();
 
                     void set_scale(float);
                     void set_offset(Vector2f);
@@ -189,13 +266,13 @@ namespace mousetrap
                 private:
                     Canvas* _owner;
 
-                    GLArea _area;
+                    RenderPass _area;
                     Shape* _shape = nullptr;
                     Shader* _shader = nullptr;
 
                     Vector2f* _canvas_size = new Vector2f(1, 1);
-                    static void on_area_realize(Widget* widget, TransparencyTilingLayer* instance);
-                    static void on_area_resize(GLArea*, int w, int h, TransparencyTilingLayer* instance);
+                    static void on_area_realize(RenderPass*, TransparencyTilingLayer* instance);
+                    static void on_area_resize(RenderPass*, int w, int h, TransparencyTilingLayer* instance);
 
                     bool _visible = true;
 
@@ -210,7 +287,7 @@ namespace mousetrap
             {
                 public:
                     LayerLayer(Canvas* owner);
-                    operator Widget*();
+                    operator RenderPass*();
 
                     void on_layer_image_updated();
                     void on_layer_count_changed();
@@ -227,7 +304,7 @@ namespace mousetrap
                 private:
                     Canvas* _owner;
 
-                    GLArea _area;
+                    RenderPass _area;
                     std::vector<Shape*> _layer_shapes;
 
                     Shader* _post_fx_shader = nullptr;
@@ -250,8 +327,8 @@ namespace mousetrap
                     ApplyScope _image_flip_apply_scope = active_state->get_image_flip_apply_scope();
 
                     Vector2f* _canvas_size = new Vector2f{1, 1};
-                    static void on_area_realize(Widget* widget, LayerLayer* instance);
-                    static void on_area_resize(GLArea*, int w, int h, LayerLayer* instance);
+                    static void on_area_realize(RenderPass*, LayerLayer* instance);
+                    static void on_area_resize(RenderPass*, int w, int h, LayerLayer* instance);
 
                     void queue_render_tasks();
 
@@ -266,7 +343,7 @@ namespace mousetrap
             {
                 public:
                     OnionskinLayer(Canvas* owner);
-                    operator Widget*();
+                    operator RenderPass*();
 
                     void on_layer_image_updated();
                     void on_layer_count_changed();
@@ -283,13 +360,13 @@ namespace mousetrap
                 private:
                     Canvas* _owner;
 
-                    GLArea _area;
+                    RenderPass _area;
                     Shader* _onionskin_shader = nullptr;
                     std::vector<Shape*> _frame_shapes;
 
                     Vector2f* _canvas_size = new Vector2f{1, 1};
-                    static void on_area_realize(Widget* widget, OnionskinLayer* instance);
-                    static void on_area_resize(GLArea*, int w, int h, OnionskinLayer* instance);
+                    static void on_area_realize(RenderPass*, OnionskinLayer* instance);
+                    static void on_area_resize(RenderPass*, int w, int h, OnionskinLayer* instance);
 
                     float _scale = 1;
                     Vector2f _offset = {0, 0};
@@ -302,7 +379,7 @@ namespace mousetrap
             {
                 public:
                     GridLayer(Canvas*);
-                    operator Widget*();
+                    operator RenderPass*();
 
                     void on_layer_resolution_changed();
 
@@ -313,13 +390,14 @@ namespace mousetrap
                 private:
                     Canvas* _owner;
 
-                    GLArea _area;
-                    std::vector<Shape*> _h_shapes;
-                    std::vector<Shape*> _v_shapes;
+                    RenderPass _area;
+
+                    // all horizontal and vertical grid lines, rendered in one draw call
+                    ShapeBatch* _grid = nullptr;
 
                     Vector2f* _canvas_size = new Vector2f{1, 1};
-                    static void on_area_realize(Widget* widget, GridLayer* instance);
-                    static void on_area_resize(GLArea*, int w, int h, GridLayer* instance);
+                    static void on_area_realize(RenderPass*, GridLayer* instance);
+                    static void on_area_resize(RenderPass*, int w, int h, GridLayer* instance);
 
                     float _scale = 1;
                     Vector2f _offset = {0, 0};
@@ -334,7 +412,7 @@ namespace mousetrap
             {
                 public:
                     SymmetryRulerLayer(Canvas*);
-                    operator Widget*();
+                    operator RenderPass*();
 
                     void on_layer_resolution_changed();
 
@@ -353,11 +431,11 @@ namespace mousetrap
                 private:
                     Canvas* _owner;
 
-                    GLArea _area;
+                    RenderPass _area;
 
                     Vector2f* _canvas_size = new Vector2f{1, 1};
-                    static void on_area_realize(Widget* widget, SymmetryRulerLayer* instance);
-                    static void on_area_resize(GLArea*, int w, int h, SymmetryRulerLayer* instance);
+                    static void on_area_realize(RenderPass*, SymmetryRulerLayer* instance);
+                    static void on_area_resize(RenderPass*, int w, int h, SymmetryRulerLayer* instance);
 
                     float _scale = 1;
                     Vector2f _offset = {0, 0};
@@ -392,7 +470,7 @@ namespace mousetrap
             {
                 public:
                     BrushShapeLayer(Canvas*);
-                    operator Widget*();
+                    operator RenderPass*();
 
                     void set_brush_outline_visible(bool);
                     void set_outline_color(RGBA);
@@ -410,7 +488,7 @@ namespace mousetrap
                 private:
                     Canvas* _owner;
 
-                    GLArea _area;
+                    RenderPass _area;
 
                     Shape* _brush_shape = nullptr;
                     Texture* _brush_texture = nullptr;
@@ -422,9 +500,9 @@ namespace mousetrap
                     RenderTask* _render_shape_task = nullptr;
 
                     Vector2f* _canvas_size = new Vector2f(1, 1);
-                    static void on_area_realize(Widget* widget, BrushShapeLayer* instance);
-                    static void on_area_resize(GLArea*, int w, int h, BrushShapeLayer* instance);
-                    static bool on_area_render(GLArea*, GdkGLContext*, BrushShapeLayer* instance);
+                    static void on_area_realize(RenderPass*, BrushShapeLayer* instance);
+                    static void on_area_resize(RenderPass*, int w, int h, BrushShapeLayer* instance);
+                    static bool on_area_render(RenderPass*, GdkGLContext*, BrushShapeLayer* instance);
 
                     float _scale = 1;
                     Vector2f _offset = {0, 0};
@@ -442,7 +520,7 @@ namespace mousetrap
             {
                 public:
                     GradientLayer(Canvas*);
-                    operator Widget*();
+                    operator RenderPass*();
 
                     void on_layer_resolution_changed();
                     void set_scale(float);
@@ -470,7 +548,7 @@ namespace mousetrap
 
                 private:
                     Canvas* _owner;
-                    GLArea _area;
+                    RenderPass _area;
 
                     float _scale;
                     Vector2f _offset;
@@ -495,9 +573,9 @@ namespace mousetrap
 
                     void reformat();
 
-                    static void on_area_realize(Widget* widget, GradientLayer* instance);
-                    static void on_area_resize(GLArea*, int w, int h, GradientLayer* instance);
-                    static bool on_area_render(GLArea*, GdkGLContext*, GradientLayer* instance);
+                    static void on_area_realize(RenderPass*, GradientLayer* instance);
+                    static void on_area_resize(RenderPass*, int w, int h, GradientLayer* instance);
+                    static bool on_area_render(RenderPass*, GdkGLContext*, GradientLayer* instance);
             };
 
             GradientLayer* _gradient_layer = new GradientLayer(this);
@@ -506,7 +584,7 @@ namespace mousetrap
             {
                 public:
                     WireframeLayer(Canvas*);
-                    operator Widget*();
+                    operator RenderPass*();
 
                     void on_layer_resolution_changed();
 
@@ -527,7 +605,7 @@ namespace mousetrap
 
                 private:
                     Canvas* _owner;
-                    GLArea _area;
+                    RenderPass _area;
 
                     Vector2i _a = {0, 0};
                     Vector2i _b = active_state->get_layer_resolution();
@@ -543,9 +621,9 @@ namespace mousetrap
                     void update_highlighting();
 
                     Vector2f _canvas_size = {1, 1};
-                    static void on_area_realize(Widget* widget, WireframeLayer* instance);
-                    static void on_area_resize(GLArea*, int w, int h, WireframeLayer* instance);
-                    static bool on_area_render(GLArea*, GdkGLContext*, WireframeLayer* instance);
+                    static void on_area_realize(RenderPass*, WireframeLayer* instance);
+                    static void on_area_resize(RenderPass*, int w, int h, WireframeLayer* instance);
+                    static bool on_area_render(RenderPass*, GdkGLContext*, WireframeLayer* instance);
 
                     MultisampledRenderTexture _render_texture;
                     Shape* _render_texture_shape = nullptr;
@@ -557,18 +635,14 @@ namespace mousetrap
                     struct LineToolShape
                     {
                         Shape* origin_anchor_shape = nullptr;
-                        Shape* origin_anchor_inner_outline = nullptr;
-                        Shape* origin_anchor_outer_outline = nullptr;
-
                         Shape* line_shape = nullptr;
-                        Shape* line_outline = nullptr;
-
                         Shape* destination_anchor_shape = nullptr;
-                        Shape* destination_anchor_inner_outline = nullptr;
-                        Shape* destination_anchor_outer_outline = nullptr;
                     };
 
                     LineToolShape _line_tool_shape;
+
+                    // outlines of anchors and line, rendered in one draw call
+                    ShapeBatch* _line_tool_outline = nullptr;
                     std::vector<RenderTask> _line_tool_render_tasks;
 
                     // MODE: RECTANGLE / CIRCLE
@@ -576,8 +650,6 @@ namespace mousetrap
                     struct RectangleToolShape
                     {
                         Shape* rectangle_shape = nullptr;
-                        Shape* rectangle_inner_outline = nullptr;
-                        Shape* rectangle_outer_outline = nullptr;
 
                         Shape* top_left_anchor_shape = nullptr;
                         Shape* top_left_anchor_inner_outline = nullptr;
@@ -615,11 +687,13 @@ namespace mousetrap
                         Shape* center_cross_outline = nullptr;
 
                         Shape* circle = nullptr;
-                        Shape* circle_inner_outline = nullptr;
-                        Shape* circle_outer_outline = nullptr;
                     };
 
                     RectangleToolShape _rectangle_tool_shape;
+
+                    // inner and outer outline of rectangle and circle, one draw call each
+                    ShapeBatch* _rectangle_tool_outline = nullptr;
+                    ShapeBatch* _circle_tool_outline = nullptr;
                     std::vector<RenderTask> _rectangle_tool_render_tasks;
                     std::vector<RenderTask> _circle_tool_render_tasks;
             };
@@ -630,7 +704,7 @@ namespace mousetrap
             {
                 public:
                     SelectionLayer(Canvas*);
-                    operator Widget*();
+                    operator RenderPass*();
 
                     void set_scale(float);
                     void set_offset(Vector2f);
@@ -643,7 +717,7 @@ namespace mousetrap
 
                 private:
                     Canvas* _owner;
-                    GLArea _area;
+                    RenderPass _area;
 
                     static inline int* _outline_shader_right_flag = new int(1);
                     static inline int* _outline_shader_top_flag = new int(2);
@@ -657,11 +731,11 @@ namespace mousetrap
                     Vector2f* _canvas_size = new Vector2f(1, 1);
                     Shader* _outline_shader;
 
-                    Shape* _outline_left_to_right = nullptr;
-                    Shape* _outline_top_to_bottom = nullptr;
-                    Shape* _outline_right_to_left = nullptr;
-                    Shape* _outline_bottom_to_top = nullptr;
-                    Shape* _outline_outline = nullptr;
+                    ShapeBatch* _outline_left_to_right = nullptr;
+                    ShapeBatch* _outline_top_to_bottom = nullptr;
+                    ShapeBatch* _outline_right_to_left = nullptr;
+                    ShapeBatch* _outline_bottom_to_top = nullptr;
+                    ShapeBatch* _outline_outline = nullptr;
 
                     Vector2f _outline_top_initial_position;
                     Vector2f _outline_right_initial_position;
@@ -675,8 +749,8 @@ namespace mousetrap
                     Vector2f _offset = {0, 0};
                     void reformat();
 
-                    static void on_realize(Widget*, SelectionLayer* instance);
-                    static void on_resize(GLArea*, int, int, SelectionLayer* instance);
+                    static void on_realize(RenderPass*, SelectionLayer* instance);
+                    static void on_resize(RenderPass*, int, int, SelectionLayer* instance);
             };
 
             SelectionLayer* _selection_layer = new SelectionLayer(this);
@@ -689,15 +763,15 @@ namespace mousetrap
 
                     void set_scale(float);
                     void set_offset(Vector2f);
+                    void set_canvas_size(Vector2f);
 
                 private:
                     Canvas* _owner;
-                    GLArea _proxy;
+                    Box _proxy = Box(GTK_ORIENTATION_HORIZONTAL);
 
                     float _scale = 1;
                     Vector2f _offset = {0, 0};
                     Vector2f _canvas_size = {1, 1};
-                    static void on_area_resize(GLArea*, int, int, UserInputLayer*);
 
                     bool should_trigger(const std::string& trigger, guint keyval);
                     bool _scroll_scale_active = false;
@@ -712,11 +786,14 @@ namespace mousetrap
 
                     bool _mouse_button_pressed = false;
                     Vector2i _previous_cursor_pos = {0, 0};
-                    Vector2iSet _stroke_points;
+
+                    // one entry per layer pixel, set once the current stroke touched it
+                    std::vector<bool> _stroke_mask;
 
                     ClickEventController _click_controller;
                     static void on_click_pressed(ClickEventController*, size_t n, double x, double y, UserInputLayer* instance);
                     static void on_click_released(ClickEventController*, size_t n, double x, double y, UserInputLayer* instance);
+                    static void on_click_cancelled(ClickEventController*, UserInputLayer* instance);
 
                     MotionEventController _motion_controller;
                     static void on_motion_enter(MotionEventController*, double x, double y, UserInputLayer* instance);
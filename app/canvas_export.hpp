@@ -4,56 +4,82 @@
 
 #pragma once
 
-#include <app/app_component.hpp>
-#include <app/app_signals.hpp>
+#include <mousetrap.hpp>
 
+#include <array>
 #include <set>
 
 namespace mousetrap
 {
-    /// @note GTK does not allow a non-realized surface to have a render context, so we need to keep a dummy widget
-    ///       realized so we can use it's surface for custom rendering. Canvas export stays on screen at all times but
-    ///       is hidden by setting its opacity to 0 at all times
-
-    class CanvasExport : public AppComponent,
-        public signals::LayerImageUpdated,
-        public signals::LayerCountChanged,
-        public signals::LayerPropertiesChanged,
-        public signals::LayerResolutionChanged
+    /// @brief composites layers offscreen into a framebuffer of its own GL context, no widget has to be realized
+    /// @note the context shares textures with all other contexts of the display, so layer textures can be used directly
+    class CanvasExport
     {
         public:
+            /// @brief has to be called after OpenGL was initialized
             CanvasExport();
-            operator Widget*() override;
+            ~CanvasExport();
+
+            CanvasExport(const CanvasExport&) = delete;
+            CanvasExport& operator=(const CanvasExport&) = delete;
 
             /// @brief merge layer textures respecting state properties
             Image merge_layers(const std::set<size_t>& layer_is, size_t frame_i);
 
-            /// @brief merge arbitrary textures/shapes
-            Image merge(const std::vector<RenderTask>& tasks);
+            /// @brief merge layer textures of all frames in one pass, one image per frame
+            std::vector<Image> merge_layers(const std::set<size_t>& layer_is);
+
+            /// @brief uniforms of resources/shaders/project_post_fx.frag, c.f. Canvas::LayerLayer
+            struct PostFX
+            {
+                std::array<float, 7> color_offset = {0, 0, 0, 0, 0, 0, 0};
+                bool apply_color_offset = false;
+
+                bool flip_horizontally = false;
+                bool flip_vertically = false;
+                bool apply_flip = false;
+            };
 
-        protected:
-            void on_layer_image_updated() override;
-            void on_layer_count_changed() override;
-            void on_layer_properties_changed() override;
-            void on_layer_resolution_changed() override;
+            /// @brief render textures through the same shader the canvas previews color offset and flip with, one pass each
+            /// @returns one new texture of the same size per input, owned by the caller. Empty if no GL context is available
+            std::vector<Texture*> apply_post_fx(const std::vector<const Texture*>&, const PostFX&);
+
+            /// @brief read texture into image, top row first
+            Image download(const Texture&);
 
         private:
-            size_t _frame_i = 0;
-            void set_frame(size_t);
+            GdkGLContext* _context = nullptr;
+            GdkGLContext* _context_before = nullptr;
+            bool make_current();
+            void restore_context();
+
+            RenderTexture* _render_texture = nullptr;
+            Vector2ui _size = {0, 0};
+            void resize(Vector2ui);
 
-            mutable GLArea _area;
+            // one per merged layer, vertex arrays are not shared between contexts so they are owned by this one
             std::vector<Shape*> _shapes;
-            Vector2i _canvas_size;
+            std::vector<RenderTask> get_render_tasks(const std::set<size_t>& layer_is, size_t frame_i);
+            void render(const std::vector<RenderTask>&);
+
+            // frame i is read back into buffer i % n_pixel_buffers while the following frames are rendered
+            static constexpr size_t n_pixel_buffers = 3;
+            GLNativeHandle _pixel_buffers[n_pixel_buffers] = {0, 0, 0};
+            GLsync _pixel_buffer_fences[n_pixel_buffers] = {nullptr, nullptr, nullptr};
 
-            AspectFrame _frame;
-            Box _box = Box(GTK_ORIENTATION_VERTICAL);
+            void start_download(size_t buffer_i);
+            Image finish_download(size_t buffer_i);
 
-            static void on_area_realize(Widget*, CanvasExport*);
-            static void on_area_resize(GLArea*, int w, int h, CanvasExport*);
-            static gboolean on_area_render(GLArea*, GdkGLContext*, CanvasExport*);
+            // renders straight into the returned textures, render tasks reference the uniforms by pointer
+            Shader* _post_fx_shader = nullptr;
+            Shape* _post_fx_shape = nullptr;
+            GLNativeHandle _post_fx_framebuffer = 0;
 
-            std::vector<RenderTask> _render_tasks;
-            void queue_render_tasks();
+            std::array<float, 7> _post_fx_color_offset = {0, 0, 0, 0, 0, 0, 0};
+            int _post_fx_apply_color_offset = 0;
+            int _post_fx_flip_horizontally = 0;
+            int _post_fx_flip_vertically = 0;
+            int _post_fx_apply_flip = 0;
     };
 
     namespace state
@@ -0,0 +1,85 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/24/23
+//
+
+#pragma once
+
+#include <mousetrap.hpp>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace mousetrap
+{
+    /// \brief offset hue, saturation and value, then red, green, blue and alpha of RGBA8 pixels, c.f. ProjectState::set_color_offset
+    /// \note gives the same result as converting each pixel to HSVA and back, but works on blocks of pixels without branches
+    void apply_color_offset_rgba8(uint8_t* pixels, size_t n_pixels, const std::array<float, 7>& offset);
+
+    /// \brief invert rgb of RGBA8 pixels, alpha is left unchanged
+    void invert_rgba8(uint8_t* pixels, size_t n_pixels);
+
+    /// \brief transforms the pixels of many images on worker threads, the input images are not modified
+    class ColorTransformJob
+    {
+        public:
+            /// \brief transform row of RGBA8 pixels in place, called from multiple threads at once
+            using RowTransform = std::function<void(uint8_t* pixels, size_t n_pixels)>;
+
+            struct Cell
+            {
+                std::shared_ptr<const Image> image;
+                Vector2i region_top_left; // only pixels inside region are transformed, in image coordinates
+                Vector2ui region_size;
+            };
+
+            /// \brief starts transforming immediately
+            ColorTransformJob(std::vector<Cell>, RowTransform);
+
+            /// \brief cancels and waits for all workers
+            ~ColorTransformJob();
+
+            ColorTransformJob(const ColorTransformJob&) = delete;
+            ColorTransformJob& operator=(const ColorTransformJob&) = delete;
+
+            /// \brief workers stop after their current rows, results are discarded
+            void cancel();
+            bool get_is_cancelled() const;
+
+            /// \brief all workers finished, either because all cells are transformed or the job was cancelled
+            bool get_is_done() const;
+
+            /// \returns fraction of rows transformed, in [0, 1]
+            float get_progress() const;
+
+            size_t get_n_cells() const;
+
+            /// \brief RGBA8 result for cell i, only valid once done and not cancelled
+            Image& get_result(size_t cell_i);
+
+        private:
+            std::vector<Cell> _cells;
+            RowTransform _transform;
+
+            // copied from the input by the first worker that reaches a band of the cell
+            std::vector<Image> _results;
+            std::unique_ptr<std::once_flag[]> _results_prepared;
+            void prepare_result(size_t cell_i);
+
+            // rows are transformed in bands, so single large cells are spread across threads too
+            static constexpr size_t band_height = 32;
+            std::vector<std::pair<size_t, size_t>> _bands; // cell index, first row
+
+            size_t _n_rows = 0;
+            std::atomic<size_t> _n_rows_done = 0;
+            std::atomic<size_t> _next_band = 0;
+            std::atomic<size_t> _n_active_workers = 0;
+            std::atomic<bool> _cancelled = false;
+
+            std::vector<std::thread> _workers;
+            void run();
+    };
+}
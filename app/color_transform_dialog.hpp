@@ -113,6 +113,12 @@ namespace mousetrap
 
             void reset();
 
+            // shown while the transform runs on worker threads
+            LevelBar _progress_bar = LevelBar(0, 1);
+            bool _transform_cancelled = false;
+            void set_transform_running(bool);
+            static gboolean on_progress_timeout(ColorTransformDialog* instance);
+
             Box _button_box = Box(GTK_ORIENTATION_HORIZONTAL);
             SeparatorLine _button_box_spacer;
     };
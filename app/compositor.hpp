@@ -0,0 +1,26 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/23/23
+//
+
+#pragma once
+
+#include <mousetrap.hpp>
+#include <app/project_file.hpp>
+
+#include <set>
+
+namespace mousetrap
+{
+    /// \brief composite layers of a frame on the CPU, bottom to top. Respects visibility, opacity, blend mode and keyframes like the canvas does
+    /// \note needs no GL context and may run on any thread, rows are spread across a worker pool shared by all callers
+    Image composite_frame(const ProjectSnapshot&, const std::set<size_t>& layer_is, size_t frame_i);
+    Image composite_frame(const ProjectSnapshot&, size_t frame_i);
+
+    /// \brief composite layers of all frames, one image per frame. Each cell is decoded only once, even if it is held for multiple frames
+    std::vector<Image> composite_frames(const ProjectSnapshot&, const std::set<size_t>& layer_is);
+    std::vector<Image> composite_frames(const ProjectSnapshot&);
+
+    /// \brief blend row of RGBA32F pixels onto another, with the same equations set_current_blend_mode uses on the GPU
+    /// \param source: straight alpha, layer opacity already applied
+    void blend_row(float* destination, const float* source, size_t n_pixels, BlendMode);
+}
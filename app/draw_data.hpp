@@ -5,19 +5,54 @@
 #pragma once
 
 #include <mousetrap.hpp>
-#include <set>
+#include <vector>
 
 namespace mousetrap
 {
-    namespace detail
+    /// \brief batch of pixels to be written into a cell, stored as a flat buffer of packed coordinates and RGBA8 colors
+    class DrawData
     {
-        struct DrawDataSort
-        {
-            bool operator()(const std::pair <Vector2i, HSVA>& a, const std::pair <Vector2i, HSVA>& b) const noexcept
+        public:
+            struct Entry
             {
-                return (a.first.x == b.first.x) ? a.first.y < b.first.y : a.first.x < b.first.x;
-            }
-        };
-    }
-    using DrawData = std::set<std::pair<Vector2i, HSVA>, detail::DrawDataSort>;
+                /// \brief row-major key, y in the upper 32 bits, x in the lower
+                uint64_t position;
+
+                /// \brief color bytes in the same layout as a RGBA8 image
+                uint32_t color;
+
+                Vector2i get_position() const;
+                RGBA get_color() const;
+            };
+
+            DrawData() = default;
+
+            /// \brief add pixel to batch. If the position is already present, its color is replaced, so later pixels are painted over earlier ones. Positions with negative components are ignored
+            void insert(Vector2i position, RGBA color);
+
+            void reserve(size_t n);
+            void clear();
+
+            /// \brief number of unique positions
+            size_t size() const;
+            bool empty() const;
+
+            /// \brief entries sorted row-major without duplicates
+            const std::vector<Entry>& get_entries() const;
+
+            std::vector<Entry>::const_iterator begin() const;
+            std::vector<Entry>::const_iterator end() const;
+
+            static uint64_t pack_position(Vector2i);
+            static Vector2i unpack_position(uint64_t);
+
+            static uint32_t pack_color(RGBA);
+            static RGBA unpack_color(uint32_t);
+
+        private:
+            void normalize() const;
+
+            mutable std::vector<Entry> _entries;
+            mutable bool _is_normalized = true;
+    };
 }
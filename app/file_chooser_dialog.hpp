@@ -10,6 +10,7 @@
 #include <app/project_state.hpp>
 #include <app/app_component.hpp>
 #include <app/shortcut_information.hpp>
+#include <app/image_decode_service.hpp>
 
 namespace mousetrap
 {
@@ -17,6 +18,7 @@ namespace mousetrap
     {
         public:
             FilePreview();
+            ~FilePreview();
 
             operator Widget*() override;
             void update_from(FileDescriptor*);
@@ -30,7 +32,10 @@ namespace mousetrap
             Box _main = Box(GTK_ORIENTATION_VERTICAL);
             ScrolledWindow _window;
 
-            GtkImage* _icon_image;
+            GtkImage* _icon_image = nullptr;
+
+            // decoded off the main thread, replaced when another file is selected
+            ImageDecodeService::RequestID _preview_request = 0;
 
             Box _icon_image_box = Box(GTK_ORIENTATION_HORIZONTAL);
             Label _file_name_label;
@@ -10,6 +10,7 @@
 #include <app/add_shortcut_action.hpp>
 #include <app/tooltip.hpp>
 #include <app/app_signals.hpp>
+#include <app/thumbnail_atlas.hpp>
 
 namespace mousetrap
 {
@@ -67,7 +68,7 @@ namespace mousetrap
             void on_layer_frame_selection_changed() override;
             void on_onionskin_visibility_toggled() override;
             void on_onionskin_layer_count_changed() override;
-            void on_layer_image_updated() override;
+            void on_layer_image_updated(const signals::CellInvalidation&) override;
             void on_layer_count_changed() override;
             void on_layer_properties_changed() override;
             void on_playback_toggled() override;
@@ -75,96 +76,88 @@ namespace mousetrap
             void on_playback_fps_changed() override;
 
         private:
-            class FramePreview
+            size_t _preview_size = state::settings_file->get_value_as<int>("frame_view", "frame_preview_size");
+
+            /// \brief all cells of the project in one render area, only cells scrolled into view are drawn and their previews are kept in a shared atlas
+            class CellGrid
             {
                 public:
-                    FramePreview(FrameView* owner);
-                    ~FramePreview();
+                    CellGrid(FrameView* owner);
+                    ~CellGrid();
+
                     operator Widget*();
 
-                    void set_texture(const Texture*);
-                    void set_is_inbetween(bool);
                     void set_preview_size(size_t);
-                    void set_opacity(float);
-                    void set_visible(bool);
-                    void set_selected(bool);
-                    void set_resolution(Vector2ui);
+                    void set_selection(size_t layer_i, size_t frame_i);
 
-                private:
-                    FrameView* _owner;
-                    size_t _layer_i;
-                    size_t _frame_i;
+                    /// \brief previews are re-rendered once they are visible
+                    void invalidate(const signals::CellInvalidation&);
+                    void invalidate_all();
 
-                    AspectFrame _aspect_frame;
-                    GLArea _area;
+                    /// \brief layers or frames were added, removed or reordered
+                    void on_cells_changed();
 
-                    static inline Shader* _transparency_tiling_shader = nullptr;
-                    Vector2f _canvas_size = Vector2f(1, 1);
-
-                    const Texture* _texture = nullptr;
-                    Shape* _transparency_tiling_shape = nullptr;
-                    Shape* _layer_shape = nullptr;
-                    Shape* _negative_overlay = nullptr;
-
-                    static void on_realize(Widget*, FramePreview*);
-                    static void on_resize(GLArea*, int w, int h, FramePreview*);
-
-                    bool _is_inbetween;
-                    ImageDisplay _inbetween_indicator = ImageDisplay(get_resource_path() + "icons/inbetween_indicator.png");
-                    Overlay _inbetween_label_overlay;
-            };
-
-            size_t _preview_size = state::settings_file->get_value_as<int>("frame_view", "frame_preview_size");
+                    /// \brief geometry is uploaded again before the next render
+                    void queue_render();
 
-            class FrameColumn
-            {
-                public:
-                    FrameColumn(FrameView*, size_t frame_i);
+                private:
+                    FrameView* _owner;
 
-                    operator Widget*();
+                    Vector2ui _cell_size = {1, 1};
+                    const float _cell_spacing = state::margin_unit / 2;
 
-                    void select_layer(size_t i);
-                    void set_layer_visible(size_t i, bool);
-                    void set_layer_opacity(size_t i, float);
-                    void set_is_inbetween(size_t i, bool);
-                    void set_preview_size(size_t);
+                    size_t _selected_layer_i = 0;
+                    size_t _selected_frame_i = 0;
 
-                    void set_n_layers(size_t);
-                    void set_frame(size_t i);
-                    void set_resolution(Vector2ui);
+                    GLArea _area;
+                    Vector2f* _canvas_size = new Vector2f(1, 1);
 
-                private:
-                    FrameView* _owner;
+                    ThumbnailAtlas* _atlas = nullptr; // state::thumbnail_atlas once realized
+                    Texture* _inbetween_indicator_texture = nullptr;
+                    static inline Shader* _transparency_tiling_shader = nullptr;
 
-                    size_t _frame_i;
-                    ListView _list_view = ListView(GTK_ORIENTATION_VERTICAL, GTK_SELECTION_SINGLE);
-                    static void on_selection_changed(SelectionModel*, size_t i, size_t n_items, FrameColumn* instance);
-
-                    class PreviewElement
-                    {
-                        public:
-                            PreviewElement(FrameView* owner);
-                            operator Widget*();
-
-                            void set_layer_frame_index(size_t layer_i, size_t frame_i);
-                            void set_preview_size(size_t);
-                            void set_opacity(float);
-                            void set_visible(bool);
-                            void set_is_inbetween(bool);
-                            void set_selected(bool);
-                            void set_resolution(Vector2ui);
-
-                        private:
-                            FramePreview _preview;
-                            ListView _wrapper;
-                            Frame _frame;
-                            Label _frame_label;
-                            Label _layer_label;
-                            SeparatorLine _layer_label_spacer;
-                            Box _wrapper_box;
-                    };
-
-                    std::deque<PreviewElement> _preview_elements;
+                    ShapeBatch* _background_batch = nullptr;
+                    ShapeBatch* _preview_batch = nullptr;
+                    ShapeBatch* _inbetween_batch = nullptr;
+                    ShapeBatch* _inbetween_indicator_batch = nullptr;
+                    ShapeBatch* _selection_batch = nullptr;
+                    std::vector<RenderTask> _render_tasks;
+
+                    bool _batches_outdated = true;
+                    size_t _batches_layout_revision = 0; // atlas layout the preview batch was built for
+
+                    Adjustment _h_adjustment = Adjustment(0, 0, 1, 1, 1);
+                    Adjustment _v_adjustment = Adjustment(0, 0, 1, 1, 1);
+                    Scrollbar _h_scrollbar = Scrollbar(GTK_ORIENTATION_HORIZONTAL);
+                    Scrollbar _v_scrollbar = Scrollbar(GTK_ORIENTATION_VERTICAL);
+
+                    // index labels, only as many exist as rows and columns fit into the area
+                    Fixed _frame_label_fixed;
+                    Fixed _layer_label_fixed;
+                    std::deque<Label> _frame_labels;
+                    std::deque<Label> _layer_labels;
+
+                    ClickEventController _click_controller;
+                    ScrollEventController _scroll_controller;
+
+                    Box _frame_label_box = Box(GTK_ORIENTATION_HORIZONTAL);
+                    SeparatorLine _frame_label_corner;
+                    Box _area_box = Box(GTK_ORIENTATION_HORIZONTAL);
+                    Box _main = Box(GTK_ORIENTATION_VERTICAL);
+
+                    Vector2f get_stride() const;
+                    /// \brief first and one-past-last visible frame (x) and row (y), rows are counted from the top
+                    std::pair<Vector2ui, Vector2ui> get_visible_range() const;
+                    void update_adjustments();
+                    void update_labels();
+                    void scroll_to_selection();
+                    void update_batches(std::pair<Vector2ui, Vector2ui> visible_range);
+
+                    static void on_realize(Widget*, CellGrid*);
+                    static void on_resize(GLArea*, int w, int h, CellGrid*);
+                    static gboolean on_render(GLArea*, GdkGLContext*, CellGrid*);
+                    static void on_click_pressed(ClickEventController*, size_t n, double x, double y, CellGrid*);
+                    static void on_scroll(ScrollEventController*, double x, double y, CellGrid*);
             };
 
             class ControlBar
@@ -256,14 +249,7 @@ namespace mousetrap
             size_t _selected_frame_i = 0;
             void set_selection(size_t layer_i, size_t frame_i);
 
-            std::deque<FrameColumn> _frame_columns;
-
-            ListView _frame_column_list_view = ListView(GTK_ORIENTATION_HORIZONTAL, GTK_SELECTION_SINGLE);
-
-            Box _frame_colum_list_view_window_box = Box(GTK_ORIENTATION_VERTICAL);
-            SeparatorLine _frame_colum_list_view_window_spacer;
-
-            ScrolledWindow _frame_column_list_view_window;
+            CellGrid _cell_grid = CellGrid(this);
 
             Box _main = Box(GTK_ORIENTATION_VERTICAL);
     };
@@ -0,0 +1,88 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/25/23
+//
+
+#pragma once
+
+#include <mousetrap.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace mousetrap
+{
+    /// \brief decodes image files on worker threads, results are delivered on the main loop
+    class ImageDecodeService
+    {
+        public:
+            /// \param n_threads: maximum number of files decoded at the same time, number of cores if 0
+            ImageDecodeService(size_t n_threads = 0);
+
+            /// \brief drops queued and undelivered requests, waits for files that are being decoded
+            ~ImageDecodeService();
+
+            ImageDecodeService(const ImageDecodeService&) = delete;
+            ImageDecodeService& operator=(const ImageDecodeService&) = delete;
+
+            using RequestID = size_t;
+
+            /// \brief called on the main thread, image is empty if the file could not be decoded
+            using OnDecoded = std::function<void(Image&&)>;
+
+            /// \brief decode file on a worker thread, has to be called from the main thread
+            /// \param scale_to_width: scale to this width keeping the aspect ratio, original size if 0
+            RequestID queue(const std::string& path, OnDecoded, size_t scale_to_width = 0);
+
+            /// \brief callback of request will not be invoked, does nothing if it was already delivered
+            void cancel(RequestID);
+            void cancel_all();
+
+            /// \brief number of requests not yet delivered
+            size_t get_n_pending() const;
+
+            /// \brief decode file on the calling thread, for when no service is running. Same arguments as queue
+            /// \returns empty image if the file could not be decoded
+            static Image decode(const std::string& path, size_t scale_to_width = 0);
+
+        private:
+            struct Request
+            {
+                RequestID id;
+                std::string path;
+                size_t scale_to_width;
+            };
+
+            struct Result
+            {
+                RequestID id;
+                Image image;
+            };
+
+            mutable std::mutex _mutex;
+            std::condition_variable _condition;
+            std::deque<Request> _queued;
+            std::deque<Result> _decoded;
+            bool _should_exit = false;
+
+            // only accessed by the main thread, callbacks never leave it
+            RequestID _next_id = 1;
+            std::map<RequestID, OnDecoded> _callbacks;
+
+            // idle source that delivers results, 0 if none is scheduled
+            guint _dispatch_source = 0;
+            static constexpr size_t max_n_delivered_per_dispatch = 16;
+            static gboolean on_dispatch(ImageDecodeService* instance);
+
+            std::vector<std::thread> _workers;
+            void run();
+    };
+
+    namespace state
+    {
+        inline ImageDecodeService* image_decode_service = nullptr;
+    }
+}
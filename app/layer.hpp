@@ -6,6 +6,10 @@
 #pragma once
 
 #include <mousetrap.hpp>
+#include <app/draw_data.hpp>
+
+#include <functional>
+#include <memory>
 
 namespace mousetrap
 {
@@ -30,13 +34,35 @@ namespace mousetrap
                     RGBA get_pixel(size_t x, size_t y) const;
                     void set_pixel(size_t x, size_t y, RGBA);
 
+                    /// \brief write batch into the image row by row, out of bounds pixels are skipped
+                    void draw(const DrawData&);
+
                     void overwrite_image(const Image&);
+                    void overwrite_image(Image&&);
+
+                    /// \brief mutable access marks the whole frame for re-upload on the next update_texture
+                    Image* get_image();
+                    const Image* get_image() const;
+
+                    /// \brief read rectangle of the image as row-major RGBA8 pixels, in image coordinates, no bounds checking
+                    void read_region(Vector2i top_left, Vector2ui size, uint32_t* out) const;
+
+                    /// \brief overwrite rectangle of the image with row-major RGBA8 pixels, in image coordinates, no bounds checking
+                    void write_region(Vector2i top_left, Vector2ui size, const uint32_t* pixels);
+
+                    /// \brief replace pixels with those of other, respecting the offset of both frames
+                    void copy_from(const Frame&);
+
+                    /// \brief exchange image data and offset with other frame, textures need to be updated afterwards
+                    void swap_image(Frame&);
                     void set_size(Vector2ui);
                     Vector2ui get_size() const;
 
                     Vector2ui get_image_size() const;
 
                     const Texture* get_texture() const;
+
+                    /// \brief upload pixels changed since the last call, only the dirty region is transferred if possible
                     void update_texture();
 
                     bool get_is_keyframe() const;
@@ -45,13 +71,74 @@ namespace mousetrap
                     void set_offset(Vector2i);
                     Vector2i get_offset() const;
 
+                    /// \brief has to be safe to call from any thread
+                    using ImageLoader = std::function<Image()>;
+
+                    /// \brief defer creating the image until its pixels or texture are first accessed
+                    /// \param image_size: reported by get_image_size until the image is loaded
+                    void set_image_loader(ImageLoader, Vector2ui image_size);
+                    bool get_is_loaded() const;
+
+                    /// \brief run the image loader now, has to happen on the main thread before the frame is read from other threads
+                    void load() const;
+
+                    /// \brief changes whenever pixels, image size or offset change. Frames with the same revision have identical content
+                    size_t get_revision() const;
+
+                    /// \brief returns pixels of the texture, top row first. Only ever called on the main thread
+                    using TextureReadback = std::function<Image(const Texture&)>;
+
+                    /// \brief replace texture with one of the same size rendered on the GPU, takes ownership
+                    /// \note the image is only updated from the texture once its pixels are accessed next
+                    void overwrite_texture(Texture*, TextureReadback);
+
+                    /// \brief true while the texture is newer than the image, accessing pixels will download them
+                    bool get_is_read_back_pending() const;
+
+                    /// \brief immutable state of a frame, may be read from any thread
+                    struct Snapshot
+                    {
+                        std::shared_ptr<const Image> image; // nullptr if not yet loaded
+                        ImageLoader loader;                 // set if not yet loaded
+                        Vector2ui image_size;
+                        Vector2i offset;
+                        bool is_keyframe;
+                        size_t revision;
+                    };
+
+                    /// \brief constant time, pixels are shared with the frame until it is modified next
+                    /// \note if the texture was overwritten since the pixels were last accessed, it is read back first
+                    Snapshot snapshot() const;
+
                 private:
-                    Image* _image = nullptr;
+                    // shared with copies and snapshots, copied before the first write
+                    std::shared_ptr<Image> _image;
+                    void detach_image();
+
                     Texture* _texture = nullptr;
                     bool _is_keyframe = true;
 
+                    ImageLoader _image_loader;
+                    Vector2ui _unloaded_image_size = {0, 0};
+                    void ensure_loaded() const;
+
+                    // set while the texture is newer than the image, c.f. overwrite_texture
+                    TextureReadback _texture_read_back;
+                    void read_back_texture() const;
+
+                    size_t _revision = _next_revision++;
+                    static inline size_t _next_revision = 1;
+
                     Vector2i _offset = {0, 0};
                     Vector2ui _size = {0, 0};
+
+                    // bounding box of pixels written since last update_texture, in image coordinates
+                    Vector2i _dirty_top_left = {0, 0};
+                    Vector2i _dirty_bottom_right = {0, 0};
+                    bool _texture_needs_full_update = false;
+
+                    void mark_dirty(Vector2i top_left, Vector2i bottom_right);
+                    void mark_all_dirty();
             };
 
             Layer(const std::string& name, Vector2ui size, size_t n_frames);
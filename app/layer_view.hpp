@@ -10,6 +10,7 @@
 #include <app/add_shortcut_action.hpp>
 #include <app/tooltip.hpp>
 #include <app/app_signals.hpp>
+#include <app/thumbnail_atlas.hpp>
 
 namespace mousetrap
 {
@@ -47,12 +48,13 @@ namespace mousetrap
 
         protected:
             void on_layer_frame_selection_changed() override;
-            void on_layer_image_updated() override;
+            void on_layer_image_updated(const signals::CellInvalidation&) override;
             void on_layer_count_changed() override;
             void on_layer_properties_changed() override;
             void on_layer_resolution_changed() override;
             
         private:
+            /// \brief preview of the current frame of the layer, sampled from the shared thumbnail atlas. Only rows the list view has bound are realized and rendered
             class LayerPreview
             {
                 public:
@@ -61,28 +63,31 @@ namespace mousetrap
 
                     operator Widget*();
 
-                    void set_texture(const Texture*);
+                    /// \brief re-sample the layers current frame on the next render
+                    void queue_render();
+
                     void set_preview_size(size_t);
                     void set_opacity(float);
                     void set_visible(bool);
                     void set_locked(bool);
                     void set_resolution(Vector2ui);
 
-                    void queue_render();
-
                 private:
                     size_t _layer_i;
+                    float _opacity = 1;
 
                     GLArea _area;
+                    Vector2f _canvas_size = Vector2f(1, 1);
+                    Rectangle _texture_region = {{0, 0}, {1, 1}};
 
                     static inline Shader* _transparency_tiling_shader = nullptr;
-                    Vector2f _canvas_size = Vector2f(1, 1);
-                    
                     Shape* _transparency_tiling_shape = nullptr;
                     Shape* _layer_shape = nullptr;
+                    std::vector<RenderTask> _render_tasks;
 
                     static void on_realize(Widget*, LayerPreview*);
                     static void on_resize(GLArea*, int w, int h, LayerPreview*);
+                    static gboolean on_render(GLArea*, GdkGLContext*, LayerPreview*);
             };
 
             class LayerRow
@@ -93,7 +98,7 @@ namespace mousetrap
 
                     void set_all_signals_blocked(bool);
 
-                    void set_texture(const Texture*);
+                    void update_preview();
                     void set_opacity(float);
                     void set_visible(bool);
                     void set_locked(bool);
@@ -197,11 +202,13 @@ namespace mousetrap
             // layout
 
             std::deque<LayerRow> _layer_rows;
-            ListView _layer_rows_list_view = ListView(GTK_ORIENTATION_VERTICAL, GTK_SELECTION_MULTIPLE);
 
+            // list view scrolls itself, so only rows in view are bound and have their preview realized
+            ListView _layer_rows_list_view = ListView(GTK_ORIENTATION_VERTICAL, GTK_SELECTION_MULTIPLE);
             ScrolledWindow _layer_rows_scrolled_window;
-            Box _layer_rows_scrolled_window_box = Box(GTK_ORIENTATION_VERTICAL);
-            SeparatorLine _layer_rows_scrolled_window_spacer;
+
+            Vector2ui get_preview_tile_size() const;
+            void update_atlas_requirements();
 
             Box _main = Box(GTK_ORIENTATION_VERTICAL);
 
@@ -22,7 +22,7 @@ namespace mousetrap
         protected:
             void on_cursor_position_changed() override;
             void on_save_path_changed() override;
-            void on_layer_image_updated() override;
+            void on_layer_image_updated(const signals::CellInvalidation&) override;
             void on_layer_frame_selection_changed() override;
             void on_layer_resolution_changed() override;
 
@@ -0,0 +1,34 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/23/23
+//
+
+#pragma once
+
+#include <mousetrap.hpp>
+#include <app/project_file.hpp>
+#include <app/animation_export.hpp>
+#include <app/spritesheet_packer.hpp>
+
+#include <set>
+
+namespace mousetrap
+{
+    /// \brief write merged layers of each frame to `<prefix>_<frame index>.png`, needs no GL context
+    /// \param layer_is: layers to merge, all layers if empty
+    bool export_frames(const ProjectSnapshot&, const std::set<size_t>& layer_is, const std::string& prefix);
+
+    /// \brief write merged layers of all frames into a single png, left to right then top to bottom
+    /// \param n_columns: frames per row, all frames in one row if 0
+    bool export_spritesheet(const ProjectSnapshot&, const std::set<size_t>& layer_is, const std::string& path, size_t n_columns = 0);
+
+    /// \brief write merged layers of all frames into a single png, trimmed to their non-transparent pixels, identical frames and inbetweens are stored once.
+    /// Layout, offsets and durations are written to the same path with extension `.json`
+    /// \param padding: transparent pixels between sprites
+    bool export_packed_spritesheet(const ProjectSnapshot&, const std::set<size_t>& layer_is, const std::string& path, size_t padding = 0);
+
+    /// \brief write merged layers as an animated GIF or PNG. Frame n + 1 is composited while frame n is encoded, frames without any keyframe extend the duration of the previous one
+    bool export_animation(const ProjectSnapshot&, const std::set<size_t>& layer_is, const std::string& path, AnimationFormat);
+
+    /// \brief write layout of the spritesheet export_spritesheet would produce, as well as fps and layer properties, to a key file
+    bool export_metadata(const ProjectSnapshot&, const std::string& path, size_t n_columns = 0);
+}
@@ -0,0 +1,127 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/22/23
+//
+
+#pragma once
+
+#include <mousetrap.hpp>
+#include <app/layer.hpp>
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace mousetrap
+{
+    /// \brief immutable state of all layers, pixels are shared with the project until cells are modified. May be read from any thread
+    struct ProjectSnapshot
+    {
+        ProjectSnapshot() = default;
+
+        /// \brief constant time per cell, has to be called on the main thread
+        ProjectSnapshot(const std::deque<Layer*>&, Vector2ui layer_resolution, float fps);
+
+        struct LayerSnapshot
+        {
+            std::string name;
+            bool is_visible;
+            bool is_locked;
+            float opacity;
+            BlendMode blend_mode;
+            std::vector<Layer::Frame::Snapshot> frames;
+        };
+
+        Vector2ui layer_resolution = {0, 0};
+        float fps = 0;
+        std::vector<LayerSnapshot> layers;
+    };
+
+    /// \brief binary project file: header, compressed cell tiles, then an index of all layers and frames
+    /// \note the index is always rewritten, tiles of cells that did not change since the last save are reused
+    class ProjectFile
+    {
+        public:
+            /// \brief width and height of a tile, in px
+            static constexpr size_t tile_size = 64;
+
+            ProjectFile();
+            ~ProjectFile();
+
+            ProjectFile(const ProjectFile&) = delete;
+            ProjectFile& operator=(const ProjectFile&) = delete;
+
+            /// \brief map file and read its index, cell images are not decoded
+            /// \returns false if the file could not be read or is not a valid project file
+            bool open(const std::string& path);
+            void close();
+
+            bool get_is_open() const;
+            const std::string& get_path() const;
+
+            Vector2ui get_layer_resolution() const;
+            size_t get_n_layers() const;
+            size_t get_n_frames() const;
+            float get_fps() const;
+
+            /// \brief create layer of the open file, frame images are decoded from the mapped file on first access
+            /// \returns nullptr if no file is open or layer_i is out of bounds
+            Layer* create_layer(size_t layer_i);
+
+            /// \brief state of the open file without creating any layers, cells are decoded by the loaders of the frame snapshots. Needs no GL context
+            /// \note frames have revision 0, so saving the snapshot encodes all cells again
+            ProjectSnapshot get_snapshot() const;
+
+            /// \brief write project. If path is the open file, only tiles of cells that changed since the last save or open are written
+            /// \note the file at path stays open afterwards. Does not touch any layer, so it may run on any thread as long as the file is only used by that thread
+            bool save(const std::string& path, const ProjectSnapshot&);
+
+        private:
+            struct TileEntry
+            {
+                uint64_t offset;
+                uint32_t size; // compressed size in bytes, 0 for fully transparent tiles
+            };
+
+            struct CellEntry
+            {
+                Vector2i offset;
+                Vector2ui image_size;
+                bool is_keyframe;
+                size_t revision; // Layer::Frame revision the tiles were written from
+                std::vector<TileEntry> tiles;
+            };
+
+            struct LayerEntry
+            {
+                std::string name;
+                bool is_visible;
+                bool is_locked;
+                float opacity;
+                BlendMode blend_mode;
+                std::vector<CellEntry> cells;
+            };
+
+            using Mapping = boost::iostreams::mapped_file_source;
+
+            std::string _path;
+            std::shared_ptr<Mapping> _mapping;
+
+            Vector2ui _layer_resolution = {0, 0};
+            size_t _n_frames = 0;
+            float _fps = 0;
+            std::vector<LayerEntry> _layers;
+
+            // tiles already in the open file, by frame revision
+            std::unordered_map<size_t, const CellEntry*> _written_cells;
+            uint64_t _n_live_bytes = 0; // bytes referenced by the index, the rest of the file is left over from earlier saves
+
+            void index_written_cells();
+            // writes chunks and index, entries and live bytes describe the written file on success
+            bool write(const std::string& path, const ProjectSnapshot&, bool append, std::vector<LayerEntry>& entries, uint64_t& n_live_bytes) const;
+
+            static std::vector<TileEntry> encode_cell(const Layer::Frame::Snapshot&, std::ostream&, uint64_t& position);
+            static Image decode_cell(const Mapping&, const CellEntry&);
+    };
+}
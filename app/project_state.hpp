@@ -19,6 +19,14 @@
 #include <app/apply_scope.hpp>
 #include <app/selection.hpp>
 #include <app/draw_data.hpp>
+#include <app/app_signals.hpp>
+#include <app/undo_history.hpp>
+#include <app/project_file.hpp>
+#include <app/autosave_service.hpp>
+#include <app/color_transform.hpp>
+#include <app/canvas_export.hpp>
+#include <app/animation_export.hpp>
+#include <app/image_decode_service.hpp>
 
 namespace mousetrap
 {
@@ -44,12 +52,28 @@ namespace mousetrap
         public:
             ProjectState(Vector2i layer_resolution);
 
+            /// \brief removes main loop sources that call into the state
+            ~ProjectState();
+
             void set_cursor_position(Vector2i);
             Vector2i get_cursor_position() const;
 
             void set_save_path(const std::string&);
+            /// \brief file the project was last saved to or loaded from, empty for a new project
             const std::string& get_save_path() const;
 
+            /// \brief write project, saving to the file it was loaded from or last saved to only writes cells that changed since
+            bool save_to_file(const std::string& path);
+
+            /// \brief replace project with the one stored at path, cell images are decoded once first displayed
+            bool load_from_file(const std::string& path);
+
+            /// \brief write visible layers as animated GIF or PNG, format from extension. Frames are composited and encoded on worker threads, the main loop only queues them
+            /// \returns false if export could not be started
+            bool export_animation(const std::string& path);
+            bool get_animation_export_active() const;
+            void cancel_animation_export();
+
             const Brush* get_current_brush() const;
             void set_current_brush(size_t);
             size_t get_current_brush_index() const;
@@ -60,6 +84,10 @@ namespace mousetrap
             void set_bucket_fill_eps(float);
             float get_bucket_fill_eps() const;
 
+            /// \brief should bucket fill apply to every frame of the current layer
+            void set_bucket_fill_all_frames(bool);
+            bool get_bucket_fill_all_frames() const;
+
             void remove_brush(size_t);
             void add_brush(Brush);
             void load_default_brushes();
@@ -148,6 +176,11 @@ namespace mousetrap
             void color_invert(ApplyScope);
             void color_to_grayscale(ApplyScope);
 
+            /// \brief color transforms run on worker threads, results are applied once all cells are done
+            bool get_color_transform_active() const;
+            float get_color_transform_progress() const;
+            void cancel_color_transform();
+
             void set_image_flip(bool flip_horizontally, bool flip_vertically);
             using flip_state = struct {bool flip_horizontally, flip_vertically;};
             flip_state get_image_flip() const;
@@ -172,6 +205,7 @@ namespace mousetrap
             void set_palette_editing_enabled(bool b);
 
             void add_selection(const Vector2iSet&);
+            void add_selection(const Selection&);
             void move_selection(Vector2i offset_px);
             const Selection& get_selection() const;
             void select_all();
@@ -194,6 +228,17 @@ namespace mousetrap
             void set_fps(float);
             float get_fps() const;
 
+            /// \brief changes until the matching end_undo_transaction are undone in one step, may be nested
+            void begin_undo_transaction();
+            void end_undo_transaction();
+
+            /// \brief all changes of one brush stroke are undone in one step. Open strokes are also ended on undo, redo and tool change, as the release may never arrive
+            void begin_stroke();
+            void end_stroke();
+
+            void undo();
+            void redo();
+
         private:
             HSVA _primary_color = RGBA(1, 1, 1, 1).operator HSVA();
             HSVA _secondary_color = RGBA(0, 0, 0, 1).operator HSVA();
@@ -215,6 +260,7 @@ namespace mousetrap
             size_t _brush_size = 1;
             float _brush_opacity = 1;
             float _bucket_fill_eps = 1 / 255.f;
+            bool _bucket_fill_all_frames = false;
 
             Selection _selection;
             SelectionMode _selection_mode = SelectionMode::REPLACE;
@@ -239,11 +285,45 @@ namespace mousetrap
             std::array<float, 7> _color_offset = {0, 0, 0, 0, 0, 0, 0};
             ApplyScope _color_offset_apply_scope = ApplyScope::EVERYWHERE;
 
+            /// \brief cells an apply scope covers, empty for SELECTION
+            std::vector<CellPosition> get_cell_positions(ApplyScope) const;
+
+            // color offset and flip are committed through the shader that previews them, false if no GL context is available.
+            // Color offsets of the whole project use start_color_transform instead, which runs off the main thread and can be cancelled
+            bool apply_post_fx(ApplyScope, const CanvasExport::PostFX&);
+
+            // cells whose revision changed while the job was running are not overwritten
+            std::unique_ptr<ColorTransformJob> _color_transform_job;
+            std::vector<std::pair<CellPosition, size_t>> _color_transform_cells; // position, revision at start
+            void start_color_transform(ApplyScope, bool whole_image, ColorTransformJob::RowTransform);
+            void finish_color_transform();
+            guint _color_transform_timeout_id = 0;
+            static gboolean on_color_transform_timeout(ProjectState* instance);
+
+            // frames are only queued while the encoder has room for them, so at most a few are in memory
+            std::unique_ptr<AnimationEncoder> _animation_encoder;
+            std::shared_ptr<const ProjectSnapshot> _animation_snapshot; // state at start, encoder workers composite all frames from it
+            std::vector<AnimationFrame> _animation_frames;
+            size_t _n_animation_frames_pushed = 0;
+            std::string _animation_export_path;
+            void finish_animation_export();
+            guint _animation_export_timeout_id = 0;
+            static gboolean on_animation_export_timeout(ProjectState* instance);
+
             flip_state _image_flip;
             ApplyScope _image_flip_apply_scope = ApplyScope::EVERYWHERE;
 
             Vector2i _cursor_position = {0, 0};
-            std::string _save_path = get_resource_path() + "/backups";
+            std::string _save_path = ""; // empty until the project was saved to or loaded from a file
+            ProjectFile _project_file;
+
+            // backups are written on a worker thread, the timeout only takes a snapshot
+            AutosaveService _autosave = AutosaveService(get_resource_path() + "backup", 0);
+            guint _autosave_timeout_id = 0;
+            static gboolean on_autosave_timeout(ProjectState* instance);
+
+            // files decoded into frames, callbacks capture this so they are cancelled on destruction
+            std::vector<ImageDecodeService::RequestID> _decode_requests;
 
             void signal_brush_selection_changed();
             void signal_brush_set_updated();
@@ -256,7 +336,23 @@ namespace mousetrap
             void signal_onionskin_visibility_toggled();
             void signal_onionskin_layer_count_changed();
             void signal_layer_frame_selection_changed();
+            /// \brief all cells changed
             void signal_layer_image_updated();
+            void signal_layer_image_updated(CellPosition);
+            void signal_layer_image_updated(CellPosition, Vector2i top_left, Vector2i size);
+
+            // pixel history, cleared whenever cell indices or the resolution change
+            UndoHistory _undo_history = UndoHistory(0);
+            bool _stroke_open = false;
+            void record_undo(CellPosition);
+            void record_undo(CellPosition, Vector2i top_left, Vector2i size);
+
+            // image updates are collected and delivered once per frame of the main window
+            signals::CellInvalidation _pending_cell_invalidation;
+            guint _cell_invalidation_tick_id = 0; // 0 if no flush is queued
+            void queue_cell_invalidation_flush();
+            void flush_cell_invalidation();
+            static gboolean on_cell_invalidation_tick(GtkWidget*, GdkFrameClock*, ProjectState* instance);
             void signal_layer_count_changed();
             void signal_layer_properties_changed();
             void signal_active_tool_changed();
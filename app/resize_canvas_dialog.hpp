@@ -32,7 +32,7 @@ namespace mousetrap
         protected:
             void on_layer_resolution_changed() override;
             void on_layer_frame_selection_changed() override;
-            void on_layer_image_updated() override;
+            void on_layer_image_updated(const signals::CellInvalidation&) override;
             void on_layer_count_changed() override;
             void on_layer_properties_changed() override;
 
@@ -26,11 +26,12 @@ namespace mousetrap
 
         DECLARE_GLOBAL_ACTION(save_file, export_as_image);
         DECLARE_GLOBAL_ACTION(save_file, export_as_spritesheet);
+        DECLARE_GLOBAL_ACTION(save_file, export_as_animation);
         DECLARE_GLOBAL_ACTION(save_file, export_metadata);
 
         DECLARE_GLOBAL_ACTION(save_file, import_from_image);
     }
 
-    KeyFile export_state_to_file();
-    void import_state_from_file(KeyFile& in);
+    /// \brief save and load the active state, using its save path
+    void initialize_save_file_actions();
 }
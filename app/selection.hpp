@@ -6,6 +6,7 @@
 
 #include <mousetrap.hpp>
 #include <app/app_signals.hpp>
+#include <app/algorithms.hpp>
 
 namespace mousetrap
 {
@@ -16,14 +17,25 @@ namespace mousetrap
 
             /// @brief create from set of points
             void create_from(const Vector2iSet&);
+
+            /// @brief create from all set pixels of mask, mask pixel (0, 0) is at position (0, 0)
+            void create_from(const PixelMask&);
             void create_from_rectangle(Vector2i top_left, Vector2i size);
 
             bool at(Vector2i) const;
+
+            /// @brief translate selection, constant time
             void apply_offset(Vector2i);
+            Vector2i get_offset() const;
+
+            /// @brief select every unselected pixel inside [min, max), deselect everything else
             void invert(int x_min, int y_min, int x_max, int y_max);
 
             void subtract(const Vector2iSet&);
+            void subtract(const Selection&);
+
             void add(const Vector2iSet&);
+            void add(const Selection&);
 
             size_t size() const;
 
@@ -34,18 +46,26 @@ namespace mousetrap
                 std::vector<std::pair<Vector2f, Vector2f>> top_to_bottom;
                 std::vector<std::pair<Vector2f, Vector2f>> bottom_to_top;
             };
+
+            /// @brief outline, coordinates are relative to get_offset()
             const OutlineVertices& get_outline_vertices() const;
 
         private:
             void generate_outline_vertices();
+
+            /// @brief apply pending offset to the rows, so two selections can be combined row by row
+            void bake_offset();
+            void trim();
+
             OutlineVertices _outline_vertices;
 
-            // y -> {(x_min, x_max), ...}
-            Vector2iSet _data;
-            int _x_min = 0;
-            int _x_max = 0;
-            int _y_min = 0;
-            int _y_max = 0;
+            // half-open [first, second) x-ranges, sorted, non-overlapping and non-adjacent
+            using Row = std::vector<std::pair<int64_t, int64_t>>;
+
+            // _rows[i] holds the ranges of y = _y_min + i, all coordinates relative to _offset
+            std::vector<Row> _rows;
+            int64_t _y_min = 0;
+            Vector2i _offset = {0, 0};
     };
 
 }
@@ -0,0 +1,68 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/27/23
+//
+
+#pragma once
+
+#include <mousetrap.hpp>
+
+#include <unordered_map>
+
+namespace mousetrap
+{
+    /// \brief frames trimmed to their non-transparent pixels, identical ones stored once and packed into a single image
+    struct PackedSpritesheet
+    {
+        /// \brief unique trimmed frame, in sheet coordinates
+        struct Sprite
+        {
+            Vector2ui position;
+            Vector2ui size;
+        };
+
+        /// \brief input frame, drawn by placing its sprite at offset in a frame of frame_size
+        struct Frame
+        {
+            int sprite_i;       // -1 if the frame is fully transparent
+            Vector2ui offset;   // trimmed pixels left and above the sprite
+        };
+
+        Image image;
+        Vector2ui frame_size = {0, 0};
+        std::vector<Sprite> sprites;
+        std::vector<Frame> frames;
+    };
+
+    /// \brief smallest rectangle containing all pixels with alpha > 0, size is 0 if image is fully transparent
+    /// \param top_left: set to top left of the rectangle
+    Vector2ui get_alpha_bounds(const Image&, Vector2ui& top_left);
+
+    /// \brief trims frames as they are added and keeps identical ones only once, then packs the unique sprites with MaxRects
+    class SpritesheetPacker
+    {
+        public:
+            /// \param padding: transparent pixels between sprites, so filtering in the shipped game does not sample neighbors
+            SpritesheetPacker(Vector2ui frame_size, size_t padding = 0);
+
+            /// \brief trim and hash frame, only its sprite is kept
+            /// \returns index of the frame
+            size_t add_frame(const Image&);
+
+            size_t get_n_frames() const;
+            size_t get_n_sprites() const;
+
+            /// \brief place sprites, tries sheet widths from the widest sprite up and keeps the layout with the smallest area
+            PackedSpritesheet pack() const;
+
+        private:
+            Vector2ui _frame_size;
+            size_t _padding;
+
+            std::vector<Image> _sprites;
+            std::vector<PackedSpritesheet::Frame> _frames;
+            std::unordered_multimap<size_t, size_t> _sprite_hashes; // hash of pixels to sprite index, pixels are compared on collision
+
+            // positions of sprites in a sheet of the given width, height is as small as possible. False if a sprite does not fit
+            bool place(size_t width, std::vector<Vector2ui>& positions, Vector2ui& sheet_size) const;
+    };
+}
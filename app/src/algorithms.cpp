@@ -1,6 +1,11 @@
 #include <app/algorithms.hpp>
 #include <app/config_files.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
 namespace mousetrap
 {
     /// \brief generate 1-pixel rasterized line between two texels
@@ -462,97 +467,153 @@ namespace mousetrap
 
     Image rotate_image_counter_clockwise(const Image& in)
     {
-        size_t width_in = in.get_size().x;
-        size_t height_in = in.get_size().y;
-
-        auto out = Image();
-        out.create(height_in, width_in, RGBA(0, 0, 0, 0));
-
-        if (width_in == 0 or height_in == 0)
-            return out;
+        return in.as_rotated_counterclockwise();
+    }
 
-        for (size_t y = 0; y < height_in; y++)
-            for(int x = 0; x < width_in; x++)
-                out.set_pixel(y, x, in.get_pixel(width_in - 1 - x, y));
+    Image rotate_image_clockwise(const Image& in)
+    {
+        return in.as_rotated_clockwise();
+    }
 
-        return out;
+    Image flip_image_horizontally(const Image& in)
+    {
+        return in.as_flipped(true, false);
     }
 
-    Image rotate_image_clockwise(const Image& in)
+    Image flip_image_vertically(const Image& in)
     {
-        size_t width_in = in.get_size().x;
-        size_t height_in = in.get_size().y;
+        return in.as_flipped(false, true);
+    }
 
-        auto out = Image();
-        out.create(height_in, width_in, RGBA(0, 0, 0, 0));
+    PixelMask::PixelMask(Vector2ui size)
+        : _size(size), _data(size.x * size.y, 0)
+    {}
 
-        if (width_in == 0 or height_in == 0)
-            return out;
+    Vector2ui PixelMask::get_size() const
+    {
+        return _size;
+    }
 
-        for (size_t x = 0; x < width_in; x++)
-            for(int y = 0; y < height_in; y++)
-                out.set_pixel(y, x, in.get_pixel(x, height_in - 1 - y));
+    bool PixelMask::get(size_t x, size_t y) const
+    {
+        return _data[y * _size.x + x] != 0;
+    }
 
-        return out;
+    void PixelMask::set(size_t x, size_t y, bool value)
+    {
+        _data[y * _size.x + x] = value ? 1 : 0;
     }
 
-    Image flip_image_horizontally(const Image& in)
+    std::span<const uint8_t> PixelMask::get_row(size_t y) const
     {
-        size_t width = in.get_size().x;
-        size_t height = in.get_size().y;
+        return std::span<const uint8_t>(_data.data() + y * _size.x, _size.x);
+    }
 
-        auto out = Image();
-        out.create(width, height, RGBA(0, 0, 0, 0));
+    std::span<uint8_t> PixelMask::get_row(size_t y)
+    {
+        return std::span<uint8_t>(_data.data() + y * _size.x, _size.x);
+    }
 
-        if (width == 0 or height == 0)
-            return out;
+    uint8_t* PixelMask::data()
+    {
+        return _data.data();
+    }
 
-        for (size_t x = 0; x < width; ++x)
-            for (size_t y = 0; y < height; ++y)
-                out.set_pixel(x, y, in.get_pixel(width - 1 - x, y));
+    const uint8_t* PixelMask::data() const
+    {
+        return _data.data();
+    }
 
-        return out;
+    size_t PixelMask::count() const
+    {
+        return std::count(_data.begin(), _data.end(), 1);
     }
 
-    Image flip_image_vertically(const Image& in)
+    namespace detail
     {
-        size_t width = in.get_size().x;
-        size_t height = in.get_size().y;
+        // read frame pixel as packed rgba8, pixels outside the image are transparent
+        struct FrameReader
+        {
+            FrameReader(const Layer::Frame* frame)
+                : frame(frame), image(frame->get_image()), offset(frame->get_offset())
+            {
+                is_rgba8 = image->get_format() == ImageFormat::RGBA8;
+            }
 
-        auto out = Image();
-        out.create(width, height, RGBA(0, 0, 0, 0));
+            uint32_t operator()(int64_t x, int64_t y) const
+            {
+                auto image_x = x + offset.x;
+                auto image_y = y + offset.y;
+
+                if (image_x < 0 or image_y < 0 or image_x >= image->get_size().x or image_y >= image->get_size().y)
+                    return 0;
+
+                if (is_rgba8)
+                {
+                    uint32_t out;
+                    std::memcpy(&out, image->get_row(image_y).data() + image_x * 4, 4);
+                    return out;
+                }
+
+                auto color = image->get_pixel(image_x, image_y);
+                uint8_t bytes[4] = {
+                    uint8_t(glm::clamp<float>(color.r, 0, 1) * 255.f + 0.5f),
+                    uint8_t(glm::clamp<float>(color.g, 0, 1) * 255.f + 0.5f),
+                    uint8_t(glm::clamp<float>(color.b, 0, 1) * 255.f + 0.5f),
+                    uint8_t(glm::clamp<float>(color.a, 0, 1) * 255.f + 0.5f)
+                };
 
-        for (size_t x = 0; x < width; ++x)
-            for (size_t y = 0; y < height; ++y)
-                out.set_pixel(x, y, in.get_pixel(x, height - 1 - y));
+                uint32_t out;
+                std::memcpy(&out, bytes, 4);
+                return out;
+            }
 
-        return out;
+            const Layer::Frame* frame;
+            const Image* image;
+            Vector2i offset;
+            bool is_rgba8;
+        };
+
+        HSVA unpack_hsva(uint32_t packed)
+        {
+            uint8_t bytes[4];
+            std::memcpy(bytes, &packed, 4);
+            return RGBA(bytes[0] / 255.f, bytes[1] / 255.f, bytes[2] / 255.f, bytes[3] / 255.f).operator HSVA();
+        }
     }
 
-    std::vector<Vector2i> generate_bucket_fill_points(Vector2i origin, const Layer::Frame* frame, float eps, bool respect_alpha)
+    PixelMask generate_bucket_fill_mask(Vector2i origin, const Layer::Frame* frame, float eps, bool respect_alpha)
     {
-        auto size = frame->get_size();
+        const auto size = Vector2i(frame->get_size().x, frame->get_size().y);
+        auto out = PixelMask(frame->get_size());
+
         if (origin.x < 0 or origin.y < 0 or origin.x >= size.x or origin.y >= size.y)
-            return {};
+            return out;
+
+        const auto read = detail::FrameReader(frame);
+        const uint32_t origin_packed = read(origin.x, origin.y);
+        const auto origin_color = detail::unpack_hsva(origin_packed);
 
-        size_t n_tested = 0;
+        // distance is only evaluated once per distinct color in a row, neighbouring pixels are usually identical
+        uint32_t last_packed = origin_packed;
+        bool last_result = true;
 
-        const auto origin_color = frame->get_pixel(origin.x, origin.y).operator HSVA();
-        auto dist = [&](Vector2i coord) -> float
+        auto accept = [&](uint32_t packed) -> bool
         {
-            if (coord.x == origin.x and coord.y == origin.y)
-                return 0;
+            if (packed == origin_packed)
+                return true;
 
-            n_tested += 1;
+            if (packed == last_packed)
+                return last_result;
 
-            auto color = frame->get_pixel(coord.x, coord.y).operator HSVA();
+            auto color = detail::unpack_hsva(packed);
+            float distance;
 
             if (origin_color.a == 0)
-                return color.a;
-
-            if (respect_alpha)
+                distance = color.a;
+            else if (respect_alpha)
             {
-                return (
+                distance = (
                     abs(color.h - origin_color.h) +
                     abs(color.s - origin_color.s) +
                     abs(color.v - origin_color.v) +
@@ -561,55 +622,132 @@ namespace mousetrap
             }
             else
             {
-                return (
+                distance = (
                     abs(color.h - origin_color.h) +
                     abs(color.s - origin_color.s) +
                     abs(color.v - origin_color.v)
                 ) / 3.f;
             }
+
+            last_packed = packed;
+            last_result = distance < eps;
+            return last_result;
+        };
+
+        enum : uint8_t { UNTESTED = 0, FILLED = 1, REJECTED = 2 };
+        std::vector<uint8_t> state(size.x * size.y, UNTESTED);
+
+        auto test = [&](int64_t x, int64_t y) -> bool
+        {
+            auto& s = state[y * size.x + x];
+            if (s == UNTESTED)
+                s = accept(read(x, y)) ? FILLED : REJECTED;
+
+            return s == FILLED;
         };
 
-        Vector2iSet points = {};
-        Vector2iSet tested = {};
+        // span seeds, each is a pixel known to be fillable but whose span has not been expanded yet
+        std::vector<Vector2i> seeds = {origin};
+        state[origin.y * size.x + origin.x] = FILLED;
+
+        auto* mask_data = out.data();
+
+        while (not seeds.empty())
+        {
+            auto seed = seeds.back();
+            seeds.pop_back();
+
+            const int64_t y = seed.y;
+            auto* row = mask_data + y * size.x;
+
+            if (row[seed.x] != 0)
+                continue;
 
-        std::function<void(Vector2i)> test_point = [&](Vector2i coord) -> void {
+            int64_t left = seed.x;
+            while (left > 0 and test(left - 1, y))
+                left -= 1;
 
-            int x = coord.x;
-            int y = coord.y;
+            int64_t right = seed.x;
+            while (right < size.x - 1 and test(right + 1, y))
+                right += 1;
 
-            if ((x < 0 or y < 0 or x >= size.x or y == size.y) or (tested.find(coord) != tested.end()) or (points.find(coord) != points.end()))
-                return;
+            std::fill(row + left, row + right + 1, 1);
 
-            auto distance = dist(coord);
-            if (distance >= eps)
+            // 8-neighbourhood: diagonal pixels of the span ends connect as well
+            auto scan_from = std::max<int64_t>(left - 1, 0);
+            auto scan_to = std::min<int64_t>(right + 1, size.x - 1);
+
+            for (int64_t ny : {y - 1, y + 1})
             {
-                tested.insert(coord);
-                return;
+                if (ny < 0 or ny >= size.y)
+                    continue;
+
+                const auto* neighbour_row = mask_data + ny * size.x;
+                bool in_run = false;
+                for (int64_t x = scan_from; x <= scan_to; ++x)
+                {
+                    if (neighbour_row[x] == 0 and test(x, ny))
+                    {
+                        if (not in_run)
+                            seeds.emplace_back(x, ny);
+
+                        in_run = true;
+                    }
+                    else
+                        in_run = false;
+                }
             }
+        }
+
+        return out;
+    }
 
-            points.insert(coord);
-
-            std::vector<Vector2i> neighbors = {
-                {x - 1, y - 1},
-                {x + 0, y - 1},
-                {x + 1, y - 1},
-                {x - 1, y + 0},
-                {x + 1, y + 0},
-                {x - 1, y + 1},
-                {x + 0, y + 1},
-                {x + 1, y + 1},
-            };
-
-            for (auto& p : neighbors)
-                test_point(p);
+    std::vector<PixelMask> generate_bucket_fill_masks(Vector2i origin, const Layer* layer, float eps, bool respect_alpha)
+    {
+        std::vector<PixelMask> out(layer->get_n_frames());
+        if (out.empty())
+            return out;
+
+        // loading creates the texture, which only works on the main thread
+        for (size_t frame_i = 0; frame_i < out.size(); ++frame_i)
+            layer->get_frame(frame_i)->load();
+
+        const size_t n_threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, out.size());
+        std::atomic<size_t> next_frame = 0;
+
+        auto worker = [&]()
+        {
+            for (size_t frame_i = next_frame++; frame_i < out.size(); frame_i = next_frame++)
+                out.at(frame_i) = generate_bucket_fill_mask(origin, layer->get_frame(frame_i), eps, respect_alpha);
         };
 
-        test_point(origin);
+        std::vector<std::thread> threads;
+        threads.reserve(n_threads - 1);
+        for (size_t i = 1; i < n_threads; ++i)
+            threads.emplace_back(worker);
+
+        worker();
+
+        for (auto& thread : threads)
+            thread.join();
+
+        return out;
+    }
+
+    std::vector<Vector2i> generate_bucket_fill_points(Vector2i origin, const Layer::Frame* frame, float eps, bool respect_alpha)
+    {
+        auto mask = generate_bucket_fill_mask(origin, frame, eps, respect_alpha);
 
         std::vector<Vector2i> out;
-        out.reserve(points.size());
-        for (auto& p : points)
-            out.push_back(p);
+        out.reserve(mask.count());
+
+        for (size_t y = 0; y < mask.get_size().y; ++y)
+        {
+            auto row = mask.get_row(y);
+            for (size_t x = 0; x < row.size(); ++x)
+                if (row[x] != 0)
+                    out.emplace_back(x, y);
+        }
 
         return out;
     }
@@ -0,0 +1,882 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/26/23
+//
+
+#include <app/animation_export.hpp>
+
+#include <boost/crc.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <unordered_map>
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        // GIF stores integers little endian, PNG big endian
+        void append_le16(std::string& out, uint16_t value)
+        {
+            out.push_back(char(value & 0xFF));
+            out.push_back(char(value >> 8));
+        }
+
+        void append_be16(std::string& out, uint16_t value)
+        {
+            out.push_back(char(value >> 8));
+            out.push_back(char(value & 0xFF));
+        }
+
+        void append_be32(std::string& out, uint32_t value)
+        {
+            for (int shift = 24; shift >= 0; shift -= 8)
+                out.push_back(char((value >> shift) & 0xFF));
+        }
+
+        // animation time of frame_i, rounded to units per second. Durations are taken as differences, so rounding errors do not add up
+        size_t get_timestamp(size_t frame_i, float fps, size_t units_per_second)
+        {
+            return std::llround(frame_i / double(fps) * units_per_second);
+        }
+
+        struct QuantizedImage
+        {
+            std::vector<uint32_t> palette; // 0xRRGGBB
+            std::vector<uint8_t> indices;
+            int transparent_index = -1;
+        };
+
+        // exact if the image has at most 256 colors, which is the common case for pixel art. Median cut otherwise
+        QuantizedImage quantize(const Image& image)
+        {
+            const size_t n_pixels = image.get_n_pixels();
+            const auto* pixels = static_cast<const uint8_t*>(image.data());
+
+            constexpr uint32_t transparent = 0xFFFFFFFF;
+            std::vector<uint32_t> colors(n_pixels);
+            std::unordered_map<uint32_t, uint32_t> counts;
+            bool has_transparency = false;
+
+            for (size_t i = 0; i < n_pixels; ++i)
+            {
+                const auto* pixel = pixels + i * 4;
+                if (pixel[3] < 128)
+                {
+                    colors[i] = transparent;
+                    has_transparency = true;
+                    continue;
+                }
+
+                colors[i] = (uint32_t(pixel[0]) << 16) | (uint32_t(pixel[1]) << 8) | uint32_t(pixel[2]);
+                counts[colors[i]] += 1;
+            }
+
+            struct Entry
+            {
+                uint32_t color;
+                uint32_t count;
+            };
+
+            std::vector<Entry> entries;
+            entries.reserve(counts.size());
+            for (auto [color, count] : counts)
+                entries.push_back({color, count});
+
+            // sorted, so output does not depend on hash order
+            std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b){
+                return a.color < b.color;
+            });
+
+            QuantizedImage out;
+            std::unordered_map<uint32_t, uint8_t> color_to_index;
+            const size_t max_n_colors = has_transparency ? 255 : 256;
+
+            if (entries.size() <= max_n_colors)
+            {
+                for (const auto& entry : entries)
+                {
+                    color_to_index.insert({entry.color, uint8_t(out.palette.size())});
+                    out.palette.push_back(entry.color);
+                }
+            }
+            else
+            {
+                auto channel = [](uint32_t color, size_t channel_i) -> uint32_t {
+                    return (color >> (16 - 8 * channel_i)) & 0xFF;
+                };
+
+                struct Box
+                {
+                    size_t begin;
+                    size_t end;
+                    size_t channel_i; // channel with the largest range
+                    uint32_t range;
+                };
+
+                auto make_box = [&](size_t begin, size_t end) -> Box {
+                    uint32_t min[3] = {255, 255, 255};
+                    uint32_t max[3] = {0, 0, 0};
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        for (size_t c = 0; c < 3; ++c)
+                        {
+                            min[c] = std::min(min[c], channel(entries[i].color, c));
+                            max[c] = std::max(max[c], channel(entries[i].color, c));
+                        }
+                    }
+
+                    auto box = Box{begin, end, 0, 0};
+                    for (size_t c = 0; c < 3; ++c)
+                    {
+                        if (max[c] - min[c] > box.range)
+                        {
+                            box.channel_i = c;
+                            box.range = max[c] - min[c];
+                        }
+                    }
+                    return box;
+                };
+
+                std::vector<Box> boxes = {make_box(0, entries.size())};
+                while (boxes.size() < max_n_colors)
+                {
+                    auto widest = std::max_element(boxes.begin(), boxes.end(), [](const Box& a, const Box& b){
+                        return a.range < b.range;
+                    });
+
+                    if (widest->range == 0)
+                        break;
+
+                    auto box = *widest;
+                    std::sort(entries.begin() + box.begin, entries.begin() + box.end, [&](const Entry& a, const Entry& b){
+                        return channel(a.color, box.channel_i) < channel(b.color, box.channel_i);
+                    });
+
+                    // split at weighted median, so frequent colors end up in smaller boxes
+                    uint64_t total = 0;
+                    for (size_t i = box.begin; i < box.end; ++i)
+                        total += entries[i].count;
+
+                    size_t split = box.begin + 1;
+                    uint64_t accumulated = 0;
+                    for (size_t i = box.begin; i < box.end; ++i)
+                    {
+                        accumulated += entries[i].count;
+                        if (accumulated * 2 >= total)
+                        {
+                            split = i + 1;
+                            break;
+                        }
+                    }
+                    split = std::clamp(split, box.begin + 1, box.end - 1);
+
+                    *widest = make_box(box.begin, split);
+                    boxes.push_back(make_box(split, box.end));
+                }
+
+                for (const auto& box : boxes)
+                {
+                    uint64_t sum[3] = {0, 0, 0};
+                    uint64_t total = 0;
+                    for (size_t i = box.begin; i < box.end; ++i)
+                    {
+                        for (size_t c = 0; c < 3; ++c)
+                            sum[c] += uint64_t(channel(entries[i].color, c)) * entries[i].count;
+
+                        total += entries[i].count;
+                        color_to_index.insert({entries[i].color, uint8_t(out.palette.size())});
+                    }
+
+                    uint32_t average = 0;
+                    for (size_t c = 0; c < 3; ++c)
+                        average |= uint32_t((sum[c] + total / 2) / total) << (16 - 8 * c);
+
+                    out.palette.push_back(average);
+                }
+            }
+
+            if (has_transparency)
+            {
+                out.transparent_index = out.palette.size();
+                out.palette.push_back(0);
+            }
+
+            out.indices.resize(n_pixels);
+            for (size_t i = 0; i < n_pixels; ++i)
+                out.indices[i] = colors[i] == transparent ? uint8_t(out.transparent_index) : color_to_index.at(colors[i]);
+
+            return out;
+        }
+
+        // variable width LZW as specified by GIF89a, codes are packed least significant bit first
+        std::string lzw_encode(const std::vector<uint8_t>& indices, size_t min_code_size)
+        {
+            std::string out;
+            uint32_t buffer = 0;
+            size_t n_buffered = 0;
+
+            auto write = [&](uint32_t code, size_t width) {
+                buffer |= code << n_buffered;
+                n_buffered += width;
+                while (n_buffered >= 8)
+                {
+                    out.push_back(char(buffer & 0xFF));
+                    buffer >>= 8;
+                    n_buffered -= 8;
+                }
+            };
+
+            constexpr size_t max_n_codes = 4096;
+            const uint32_t clear_code = 1u << min_code_size;
+            const uint32_t end_code = clear_code + 1;
+
+            // open addressing, key is (prefix << 8 | index) + 1 so 0 marks free slots
+            constexpr size_t table_size = 8192;
+            std::vector<uint32_t> keys(table_size, 0);
+            std::vector<uint16_t> codes(table_size, 0);
+
+            uint32_t next_code = clear_code + 2;
+            size_t width = min_code_size + 1;
+
+            write(clear_code, width);
+
+            if (indices.empty())
+            {
+                write(end_code, width);
+                if (n_buffered > 0)
+                    out.push_back(char(buffer & 0xFF));
+                return out;
+            }
+
+            uint32_t prefix = indices[0];
+            for (size_t i = 1; i < indices.size(); ++i)
+            {
+                const uint32_t key = ((prefix << 8) | indices[i]) + 1;
+                size_t slot = (key * 2654435761u) & (table_size - 1);
+                while (keys[slot] != 0 and keys[slot] != key)
+                    slot = (slot + 1) & (table_size - 1);
+
+                if (keys[slot] == key)
+                {
+                    prefix = codes[slot];
+                    continue;
+                }
+
+                write(prefix, width);
+
+                if (next_code < max_n_codes)
+                {
+                    keys[slot] = key;
+                    codes[slot] = next_code;
+
+                    // decoder adds its entry one code later, so it widens when reading the code after this one
+                    if (next_code == (1u << width) and width < 12)
+                        width += 1;
+
+                    next_code += 1;
+                }
+                else
+                {
+                    write(clear_code, width);
+                    std::fill(keys.begin(), keys.end(), 0);
+                    next_code = clear_code + 2;
+                    width = min_code_size + 1;
+                }
+
+                prefix = indices[i];
+            }
+
+            write(prefix, width);
+            write(end_code, width);
+            if (n_buffered > 0)
+                out.push_back(char(buffer & 0xFF));
+
+            return out;
+        }
+
+        // image descriptor, local color table and image data. The graphic control extension is written in order, since it holds the duration
+        std::string encode_gif_frame(const Image& image, int& transparent_index)
+        {
+            auto quantized = quantize(image);
+            transparent_index = quantized.transparent_index;
+
+            size_t table_bits = 1;
+            while ((1u << table_bits) < quantized.palette.size())
+                table_bits += 1;
+
+            const auto size = image.get_size();
+
+            std::string out;
+            out.push_back(0x2C);
+            append_le16(out, 0);
+            append_le16(out, 0);
+            append_le16(out, size.x);
+            append_le16(out, size.y);
+            out.push_back(char(0x80 | (table_bits - 1))); // local color table, not interlaced
+
+            for (size_t i = 0; i < (1u << table_bits); ++i)
+            {
+                const uint32_t color = i < quantized.palette.size() ? quantized.palette[i] : 0;
+                out.push_back(char((color >> 16) & 0xFF));
+                out.push_back(char((color >> 8) & 0xFF));
+                out.push_back(char(color & 0xFF));
+            }
+
+            const size_t min_code_size = std::max<size_t>(table_bits, 2);
+            out.push_back(char(min_code_size));
+
+            auto compressed = lzw_encode(quantized.indices, min_code_size);
+            for (size_t i = 0; i < compressed.size(); i += 255)
+            {
+                const size_t n = std::min<size_t>(255, compressed.size() - i);
+                out.push_back(char(n));
+                out.append(compressed, i, n);
+            }
+            out.push_back(0);
+
+            return out;
+        }
+
+        // zlib stream of filtered rows, the filter of each row is the one with the smallest sum of absolute differences
+        std::string encode_png_frame(const Image& image)
+        {
+            const auto size = image.get_size();
+            const size_t row_size = size.x * 4;
+
+            std::string filtered;
+            filtered.reserve((row_size + 1) * size.y);
+
+            std::vector<uint8_t> zero_row(row_size, 0);
+            std::vector<uint8_t> candidates[5];
+            for (auto& candidate : candidates)
+                candidate.resize(row_size);
+
+            for (size_t y = 0; y < size.y; ++y)
+            {
+                const uint8_t* row = image.get_row(y).data();
+                const uint8_t* above = y > 0 ? image.get_row(y - 1).data() : zero_row.data();
+
+                for (size_t i = 0; i < row_size; ++i)
+                {
+                    const int a = i >= 4 ? row[i - 4] : 0;
+                    const int b = above[i];
+                    const int c = i >= 4 ? above[i - 4] : 0;
+
+                    const int p = a + b - c;
+                    const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+                    const int paeth = (pa <= pb and pa <= pc) ? a : (pb <= pc ? b : c);
+
+                    candidates[0][i] = row[i];
+                    candidates[1][i] = row[i] - a;
+                    candidates[2][i] = row[i] - b;
+                    candidates[3][i] = row[i] - ((a + b) / 2);
+                    candidates[4][i] = row[i] - paeth;
+                }
+
+                size_t best = 0;
+                uint64_t best_cost = UINT64_MAX;
+                for (size_t filter = 0; filter < 5; ++filter)
+                {
+                    uint64_t cost = 0;
+                    for (auto value : candidates[filter])
+                        cost += std::abs(int(int8_t(value)));
+
+                    if (cost < best_cost)
+                    {
+                        best = filter;
+                        best_cost = cost;
+                    }
+                }
+
+                filtered.push_back(char(best));
+                filtered.append(reinterpret_cast<const char*>(candidates[best].data()), row_size);
+            }
+
+            std::string out;
+
+            // stream is flushed on destruction
+            {
+                boost::iostreams::filtering_ostream stream;
+                stream.push(boost::iostreams::zlib_compressor(boost::iostreams::zlib::default_compression));
+                stream.push(boost::iostreams::back_inserter(out));
+                stream.write(filtered.data(), filtered.size());
+            }
+
+            return out;
+        }
+
+        void write_png_chunk(std::ostream& out, const char* type, const std::string& data)
+        {
+            std::string length;
+            append_be32(length, data.size());
+
+            boost::crc_32_type crc;
+            crc.process_bytes(type, 4);
+            crc.process_bytes(data.data(), data.size());
+
+            std::string checksum;
+            append_be32(checksum, crc.checksum());
+
+            out.write(length.data(), length.size());
+            out.write(type, 4);
+            out.write(data.data(), data.size());
+            out.write(checksum.data(), checksum.size());
+        }
+
+        std::string make_actl(uint32_t n_frames)
+        {
+            std::string out;
+            append_be32(out, n_frames);
+            append_be32(out, 0); // loop forever
+            return out;
+        }
+    }
+
+    bool animation_format_from_path(const std::string& path, AnimationFormat& out)
+    {
+        auto extension = std::filesystem::path(path).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c){
+            return std::tolower(c);
+        });
+
+        if (extension == ".gif")
+            out = AnimationFormat::GIF;
+        else if (extension == ".png" or extension == ".apng")
+            out = AnimationFormat::APNG;
+        else
+            return false;
+
+        return true;
+    }
+
+    std::vector<AnimationFrame> get_animation_frames(const ProjectSnapshot& snapshot, const std::set<size_t>& layer_is)
+    {
+        std::vector<AnimationFrame> out;
+        const size_t n_frames = snapshot.layers.empty() ? 0 : snapshot.layers.front().frames.size();
+
+        for (size_t frame_i = 0; frame_i < n_frames; ++frame_i)
+        {
+            bool has_keyframe = frame_i == 0;
+            for (size_t layer_i = 0; layer_i < snapshot.layers.size() and not has_keyframe; ++layer_i)
+            {
+                if (not layer_is.empty() and layer_is.count(layer_i) == 0)
+                    continue;
+
+                const auto& layer = snapshot.layers.at(layer_i);
+                if (layer.is_visible and layer.frames.at(frame_i).is_keyframe)
+                    has_keyframe = true;
+            }
+
+            if (has_keyframe)
+                out.push_back({frame_i, 1});
+            else
+                out.back().n_frames += 1;
+        }
+
+        return out;
+    }
+
+    AnimationEncoder::AnimationEncoder(AnimationFormat format, size_t n_threads)
+        : _format(format)
+    {
+        if (n_threads == 0)
+            n_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+        // one frame per worker, plus one waiting so workers do not run dry while the next frame is composited
+        _max_n_in_flight = n_threads + 1;
+
+        _workers.reserve(n_threads);
+        for (size_t i = 0; i < n_threads; ++i)
+            _workers.emplace_back(&AnimationEncoder::run, this);
+    }
+
+    AnimationEncoder::~AnimationEncoder()
+    {
+        if (_file.is_open())
+            cancel();
+
+        stop();
+
+        if (_file.is_open())
+        {
+            _file.close();
+            std::filesystem::remove(_path);
+        }
+    }
+
+    bool AnimationEncoder::open(const std::string& path, Vector2ui size, float fps)
+    {
+        if (_file.is_open())
+        {
+            std::cerr << "[ERROR] In AnimationEncoder::open: Encoder is already writing `" << _path << "`" << std::endl;
+            return false;
+        }
+
+        if (size.x == 0 or size.y == 0 or fps <= 0)
+        {
+            std::cerr << "[ERROR] In AnimationEncoder::open: Invalid size " << size.x << "x" << size.y << " or fps " << fps << std::endl;
+            return false;
+        }
+
+        if (_format == AnimationFormat::GIF and (size.x > UINT16_MAX or size.y > UINT16_MAX))
+        {
+            std::cerr << "[ERROR] In AnimationEncoder::open: GIF frames can be at most " << UINT16_MAX << "x" << UINT16_MAX << " px" << std::endl;
+            return false;
+        }
+
+        _file.open(path, std::ios::binary | std::ios::trunc);
+        if (not _file)
+        {
+            std::cerr << "[ERROR] In AnimationEncoder::open: Unable to open `" << path << "` for writing" << std::endl;
+            return false;
+        }
+
+        _path = path;
+        _size = size;
+        _fps = fps;
+
+        write_header();
+        return bool(_file);
+    }
+
+    void AnimationEncoder::write_header()
+    {
+        std::string out;
+
+        if (_format == AnimationFormat::GIF)
+        {
+            out.append("GIF89a");
+            detail::append_le16(out, _size.x);
+            detail::append_le16(out, _size.y);
+            out.push_back(0x00); // no global color table, each frame has its own
+            out.push_back(0x00);
+            out.push_back(0x00);
+
+            // loop forever
+            out.append("\x21\xFF\x0B" "NETSCAPE2.0" "\x03\x01", 16);
+            detail::append_le16(out, 0);
+            out.push_back(0x00);
+
+            _file.write(out.data(), out.size());
+        }
+        else if (_format == AnimationFormat::APNG)
+        {
+            _file.write("\x89PNG\r\n\x1A\n", 8);
+
+            detail::append_be32(out, _size.x);
+            detail::append_be32(out, _size.y);
+            out.push_back(8); // bit depth
+            out.push_back(6); // RGBA
+            out.push_back(0);
+            out.push_back(0);
+            out.push_back(0);
+            detail::write_png_chunk(_file, "IHDR", out);
+
+            _n_frames_position = _file.tellp();
+            detail::write_png_chunk(_file, "acTL", detail::make_actl(0));
+        }
+    }
+
+    void AnimationEncoder::push_frame(Image&& image, size_t n_frames)
+    {
+        if (not _file.is_open())
+        {
+            std::cerr << "[ERROR] In AnimationEncoder::push_frame: No file is open" << std::endl;
+            return;
+        }
+
+        auto size = image.get_size();
+        if (size.x != _size.x or size.y != _size.y)
+        {
+            std::cerr << "[ERROR] In AnimationEncoder::push_frame: Frame is " << size.x << "x" << size.y << " px, but animation is " << _size.x << "x" << _size.y << " px" << std::endl;
+            _failed = true;
+            return;
+        }
+
+        queue(std::move(image), nullptr, n_frames);
+    }
+
+    void AnimationEncoder::push_frame(FrameSource source, size_t n_frames)
+    {
+        if (not _file.is_open())
+        {
+            std::cerr << "[ERROR] In AnimationEncoder::push_frame: No file is open" << std::endl;
+            return;
+        }
+
+        queue(Image(), std::move(source), n_frames);
+    }
+
+    void AnimationEncoder::queue(Image&& image, FrameSource source, size_t n_frames)
+    {
+        auto lock = std::unique_lock(_mutex);
+        _written_condition.wait(lock, [&](){
+            return _cancelled or _n_pushed - _n_written < _max_n_in_flight;
+        });
+
+        if (_cancelled)
+            return;
+
+        _pending.push_back({_n_pushed++, std::move(image), std::max<size_t>(n_frames, 1), std::move(source)});
+        _queue_condition.notify_one();
+    }
+
+    bool AnimationEncoder::get_can_push() const
+    {
+        auto lock = std::unique_lock(_mutex);
+        return _n_pushed - _n_written < _max_n_in_flight;
+    }
+
+    size_t AnimationEncoder::get_n_in_flight() const
+    {
+        auto lock = std::unique_lock(_mutex);
+        return _n_pushed - _n_written;
+    }
+
+    bool AnimationEncoder::finish()
+    {
+        if (not _file.is_open())
+        {
+            std::cerr << "[ERROR] In AnimationEncoder::finish: No file is open" << std::endl;
+            return false;
+        }
+
+        {
+            auto lock = std::unique_lock(_mutex);
+            _written_condition.wait(lock, [&](){
+                return _cancelled or _n_written == _n_pushed;
+            });
+        }
+
+        stop();
+
+        if (_n_pushed == 0 and not _cancelled)
+        {
+            std::cerr << "[ERROR] In AnimationEncoder::finish: Animation has no frames" << std::endl;
+            _failed = true;
+        }
+
+        if (_cancelled or _failed)
+        {
+            _file.close();
+            std::filesystem::remove(_path);
+            return false;
+        }
+
+        write_trailer();
+        _file.close();
+
+        if (not _file)
+        {
+            std::cerr << "[ERROR] In AnimationEncoder::finish: Unable to write `" << _path << "`" << std::endl;
+            std::filesystem::remove(_path);
+            return false;
+        }
+
+        return true;
+    }
+
+    void AnimationEncoder::write_trailer()
+    {
+        if (_format == AnimationFormat::GIF)
+            _file.put(0x3B);
+        else if (_format == AnimationFormat::APNG)
+        {
+            detail::write_png_chunk(_file, "IEND", "");
+
+            auto end = _file.tellp();
+            _file.seekp(_n_frames_position);
+            detail::write_png_chunk(_file, "acTL", detail::make_actl(_n_pushed));
+            _file.seekp(end);
+        }
+    }
+
+    void AnimationEncoder::cancel()
+    {
+        _cancelled = true;
+
+        {
+            auto lock = std::unique_lock(_mutex);
+            _pending.clear();
+        }
+
+        _queue_condition.notify_all();
+        _written_condition.notify_all();
+    }
+
+    bool AnimationEncoder::get_is_cancelled() const
+    {
+        return _cancelled;
+    }
+
+    void AnimationEncoder::stop()
+    {
+        {
+            auto lock = std::unique_lock(_mutex);
+            _should_exit = true;
+        }
+
+        _queue_condition.notify_all();
+        for (auto& worker : _workers)
+            if (worker.joinable())
+                worker.join();
+    }
+
+    void AnimationEncoder::run()
+    {
+        while (true)
+        {
+            PendingFrame frame;
+
+            {
+                auto lock = std::unique_lock(_mutex);
+                _queue_condition.wait(lock, [&](){
+                    return _should_exit or not _pending.empty();
+                });
+
+                if (_pending.empty())
+                    return;
+
+                frame = std::move(_pending.front());
+                _pending.pop_front();
+            }
+
+            auto encoded = EncodedFrame();
+            encoded.n_frames = frame.n_frames;
+
+            if (not _cancelled and frame.source)
+            {
+                frame.image = frame.source();
+                frame.source = nullptr;
+
+                auto size = frame.image.get_size();
+                if (size.x != _size.x or size.y != _size.y)
+                {
+                    std::cerr << "[ERROR] In AnimationEncoder::run: Frame " << frame.index << " is " << size.x << "x" << size.y << " px, but animation is " << _size.x << "x" << _size.y << " px" << std::endl;
+                    _failed = true;
+                }
+            }
+
+            if (not _cancelled and not _failed)
+            {
+                if (frame.image.get_format() != ImageFormat::RGBA8)
+                    frame.image.set_format(ImageFormat::RGBA8);
+
+                if (_format == AnimationFormat::GIF)
+                    encoded.data = detail::encode_gif_frame(frame.image, encoded.transparent_index);
+                else if (_format == AnimationFormat::APNG)
+                    encoded.data = detail::encode_png_frame(frame.image);
+            }
+
+            // free pixels before waiting for earlier frames
+            frame.image = Image();
+
+            {
+                auto lock = std::unique_lock(_mutex);
+                _encoded.insert({frame.index, std::move(encoded)});
+            }
+
+            write_encoded_frames();
+        }
+    }
+
+    void AnimationEncoder::write_encoded_frames()
+    {
+        // whichever worker holds the lock writes all frames that are next in line, including ones other workers finished
+        auto write_lock = std::unique_lock(_write_mutex);
+
+        while (true)
+        {
+            EncodedFrame frame;
+            size_t index;
+
+            {
+                auto lock = std::unique_lock(_mutex);
+                auto it = _encoded.find(_n_written);
+                if (it == _encoded.end())
+                    return;
+
+                index = it->first;
+                frame = std::move(it->second);
+                _encoded.erase(it);
+            }
+
+            if (not _cancelled and not _failed)
+            {
+                write_frame(frame, index);
+                if (not _file)
+                {
+                    std::cerr << "[ERROR] In AnimationEncoder::write_encoded_frames: Unable to write frame " << index << " to `" << _path << "`" << std::endl;
+                    _failed = true;
+                }
+            }
+
+            {
+                auto lock = std::unique_lock(_mutex);
+                _n_written += 1;
+            }
+
+            _written_condition.notify_all();
+        }
+    }
+
+    void AnimationEncoder::write_frame(const EncodedFrame& frame, size_t index)
+    {
+        const size_t frame_begin = _n_frames_written;
+        const size_t frame_end = frame_begin + frame.n_frames;
+        _n_frames_written = frame_end;
+
+        if (_format == AnimationFormat::GIF)
+        {
+            // delay in 1/100 s. Viewers play delays below 2 as 10, so faster animations are slowed down to 50 fps instead
+            const size_t delay = std::max<size_t>(detail::get_timestamp(frame_end, _fps, 100) - detail::get_timestamp(frame_begin, _fps, 100), 2);
+
+            std::string out;
+            out.append("\x21\xF9\x04", 3);
+
+            // restore to background, so transparent pixels do not show the previous frame
+            out.push_back(char((2 << 2) | (frame.transparent_index >= 0 ? 1 : 0)));
+            detail::append_le16(out, std::min<size_t>(delay, UINT16_MAX));
+            out.push_back(char(frame.transparent_index >= 0 ? frame.transparent_index : 0));
+            out.push_back(0x00);
+
+            _file.write(out.data(), out.size());
+            _file.write(frame.data.data(), frame.data.size());
+        }
+        else if (_format == AnimationFormat::APNG)
+        {
+            // delay in 1/1000 s
+            const size_t delay = detail::get_timestamp(frame_end, _fps, 1000) - detail::get_timestamp(frame_begin, _fps, 1000);
+
+            std::string control;
+            detail::append_be32(control, _sequence_number++);
+            detail::append_be32(control, _size.x);
+            detail::append_be32(control, _size.y);
+            detail::append_be32(control, 0);
+            detail::append_be32(control, 0);
+            detail::append_be16(control, std::min<size_t>(delay, UINT16_MAX));
+            detail::append_be16(control, 1000);
+            control.push_back(0); // dispose: none
+            control.push_back(0); // blend: source, frames replace the previous one completely
+            detail::write_png_chunk(_file, "fcTL", control);
+
+            // first frame is the default image, viewers without APNG support show it
+            if (index == 0)
+                detail::write_png_chunk(_file, "IDAT", frame.data);
+            else
+            {
+                std::string data;
+                detail::append_be32(data, _sequence_number++);
+                data.append(frame.data);
+                detail::write_png_chunk(_file, "fdAT", data);
+            }
+        }
+    }
+}
@@ -411,7 +411,13 @@ namespace mousetrap
         on_layer_area_resize(&_layer_area, _canvas_size.x, _canvas_size.y, this);
     }
 
-    void AnimationPreview::on_layer_image_updated()
+    void AnimationPreview::on_layer_image_updated(const signals::CellInvalidation& cells)
+    {
+        if (cells.contains_frame(_current_frame))
+            update_layer_textures();
+    }
+
+    void AnimationPreview::update_layer_textures()
     {
         if (not _transparency_area.get_is_realized() or not _layer_area.get_is_realized())
             return;
@@ -425,7 +431,7 @@ namespace mousetrap
 
     void AnimationPreview::on_layer_frame_selection_changed()
     {
-        on_layer_image_updated();
+        update_layer_textures();
     }
 
     void AnimationPreview::on_playback_toggled()
@@ -440,7 +446,7 @@ namespace mousetrap
 
     void AnimationPreview::on_layer_resolution_changed()
     {
-        on_layer_image_updated();
+        update_layer_textures();
     }
 
     void AnimationPreview::on_color_offset_changed()
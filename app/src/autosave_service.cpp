@@ -0,0 +1,199 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/22/23
+//
+
+#include <app/autosave_service.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        static const std::string backup_prefix = "backup_";
+        static const std::string backup_suffix = ".mtp";
+
+        // frames with the same revision have the same pixels, so the pixels themselves need not be compared
+        bool is_same_project_content(const ProjectSnapshot& a, const ProjectSnapshot& b)
+        {
+            if (a.layer_resolution != b.layer_resolution or a.fps != b.fps or a.layers.size() != b.layers.size())
+                return false;
+
+            for (size_t layer_i = 0; layer_i < a.layers.size(); ++layer_i)
+            {
+                const auto& a_layer = a.layers.at(layer_i);
+                const auto& b_layer = b.layers.at(layer_i);
+
+                if (a_layer.name != b_layer.name or a_layer.is_visible != b_layer.is_visible or a_layer.is_locked != b_layer.is_locked or a_layer.opacity != b_layer.opacity or a_layer.blend_mode != b_layer.blend_mode or a_layer.frames.size() != b_layer.frames.size())
+                    return false;
+
+                for (size_t frame_i = 0; frame_i < a_layer.frames.size(); ++frame_i)
+                {
+                    const auto& a_frame = a_layer.frames.at(frame_i);
+                    const auto& b_frame = b_layer.frames.at(frame_i);
+
+                    if (a_frame.revision != b_frame.revision or a_frame.offset != b_frame.offset or a_frame.is_keyframe != b_frame.is_keyframe)
+                        return false;
+                }
+            }
+
+            return true;
+        }
+    }
+
+    AutosaveService::AutosaveService(const std::string& directory, size_t n_backups)
+        : _directory(directory), _n_backups(n_backups)
+    {
+        _worker = std::thread([this](){
+            run();
+        });
+    }
+
+    AutosaveService::~AutosaveService()
+    {
+        {
+            auto lock = std::unique_lock(_mutex);
+            _should_exit = true;
+            _queued.reset();
+        }
+
+        _condition.notify_all();
+        _worker.join();
+    }
+
+    const std::string& AutosaveService::get_directory() const
+    {
+        return _directory;
+    }
+
+    void AutosaveService::set_n_backups(size_t n)
+    {
+        _n_backups = n;
+    }
+
+    size_t AutosaveService::get_n_backups() const
+    {
+        return _n_backups;
+    }
+
+    void AutosaveService::queue_backup(ProjectSnapshot snapshot)
+    {
+        {
+            auto lock = std::unique_lock(_mutex);
+            _queued = std::move(snapshot);
+        }
+
+        _condition.notify_one();
+    }
+
+    bool AutosaveService::get_is_busy() const
+    {
+        auto lock = std::unique_lock(_mutex);
+        return _is_writing or _queued.has_value();
+    }
+
+    std::vector<std::string> AutosaveService::get_backups() const
+    {
+        std::vector<std::string> out;
+
+        std::error_code error;
+        for (auto& entry : std::filesystem::directory_iterator(_directory, error))
+        {
+            auto name = entry.path().filename().string();
+            if (name.size() > detail::backup_prefix.size() + detail::backup_suffix.size() and name.starts_with(detail::backup_prefix) and name.ends_with(detail::backup_suffix))
+                out.push_back(entry.path().string());
+        }
+
+        // names contain a fixed-width timestamp, so lexicographic order is chronological
+        std::sort(out.begin(), out.end(), std::greater<>());
+        return out;
+    }
+
+    void AutosaveService::run()
+    {
+        while (true)
+        {
+            ProjectSnapshot snapshot;
+
+            {
+                auto lock = std::unique_lock(_mutex);
+                _condition.wait(lock, [&](){
+                    return _should_exit or _queued.has_value();
+                });
+
+                if (_should_exit)
+                    return;
+
+                snapshot = std::move(*_queued);
+                _queued.reset();
+                _is_writing = true;
+            }
+
+            write_backup(snapshot);
+
+            // releases the last references to pixels the project modified in the meantime, off the main thread
+            snapshot = ProjectSnapshot();
+
+            auto lock = std::unique_lock(_mutex);
+            _is_writing = false;
+        }
+    }
+
+    void AutosaveService::write_backup(const ProjectSnapshot& snapshot)
+    {
+        if (_last_written.has_value() and detail::is_same_project_content(*_last_written, snapshot))
+            return;
+
+        std::error_code error;
+        std::filesystem::create_directories(_directory, error);
+        if (error)
+        {
+            std::cerr << "[ERROR] In AutosaveService::write_backup: Unable to create directory `" << _directory << "`: " << error.message() << std::endl;
+            return;
+        }
+
+        auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+        std::stringstream path;
+        path << _directory << "/" << detail::backup_prefix << std::setw(16) << std::setfill('0') << milliseconds << detail::backup_suffix;
+
+        if (not _file.save(path.str(), snapshot))
+        {
+            std::cerr << "[ERROR] In AutosaveService::write_backup: Unable to write backup to `" << path.str() << "`" << std::endl;
+            return;
+        }
+
+        // keep everything but the pixels, so later snapshots can be compared against it
+        _last_written = snapshot;
+        for (auto& layer : _last_written->layers)
+        {
+            for (auto& frame : layer.frames)
+            {
+                frame.image.reset();
+                frame.loader = nullptr;
+            }
+        }
+
+        remove_old_backups();
+    }
+
+    void AutosaveService::remove_old_backups()
+    {
+        // the backup that was just written is always kept
+        const size_t n_keep = std::max<size_t>(_n_backups, 1);
+
+        auto backups = get_backups();
+        for (size_t i = n_keep; i < backups.size(); ++i)
+        {
+            std::error_code error;
+            std::filesystem::remove(backups.at(i), error);
+            if (error)
+                std::cerr << "[WARNING] In AutosaveService::remove_old_backups: Unable to remove `" << backups.at(i) << "`: " << error.message() << std::endl;
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #include <app/canvas.hpp>
 #include <app/add_shortcut_action.hpp>
+#include <app/canvas_export.hpp>
 
 namespace mousetrap
 {
@@ -68,22 +69,33 @@ namespace mousetrap
         sep->set_expand(true);
 
         _layer_overlay.set_child(sep);
-        _layer_overlay.add_overlay(*_transparency_tiling_layer);
-        _layer_overlay.add_overlay(*_layer_layer);
-        _layer_overlay.add_overlay(*_onionskin_layer);
-        _layer_overlay.add_overlay(*_brush_shape_layer);
-        //_layer_overlay.add_overlay(*_gradient_layer);
-        _layer_overlay.add_overlay(*_grid_layer);
-        _layer_overlay.add_overlay(*_selection_layer);
-        _layer_overlay.add_overlay(*_symmetry_ruler_layer);
-        //_layer_overlay.add_overlay(*_wireframe_layer);
+        _render_area.connect_signal_realize(on_render_area_realize, this);
+        _render_area.connect_signal_resize(on_render_area_resize, this);
+        _render_area.connect_signal_render(on_render_area_render, this);
+
+        _render_area.add_tick_callback([](FrameClock clock, Canvas* instance) -> bool {
+            for (auto* pass : instance->_render_passes)
+                if (pass->_tick_f)
+                    pass->_tick_f(clock);
+
+            return true;
+        }, this);
+
+        // order of passes is order of compositing, back to front
+        add_render_pass(*_transparency_tiling_layer);
+        add_render_pass(*_layer_layer);
+        add_render_pass(*_onionskin_layer);
+        add_render_pass(*_brush_shape_layer);
+        //add_render_pass(*_gradient_layer);
+        add_render_pass(*_grid_layer);
+        add_render_pass(*_selection_layer);
+        add_render_pass(*_symmetry_ruler_layer);
+        //add_render_pass(*_wireframe_layer);
+
+        _layer_overlay.add_overlay(&_render_area);
         _layer_overlay.add_overlay(*_user_input_layer);
 
-        _transparency_tiling_layer->operator Widget *()->set_expand(true);
-        _layer_layer->operator Widget *()->set_expand(true);
-        _onionskin_layer->operator Widget*()->set_expand(true);
-        _grid_layer->operator Widget*()->set_expand(true);
-        _wireframe_layer->operator Widget*()->set_expand(true);
+        _render_area.set_expand(true);
         _user_input_layer->operator Widget*()->set_expand(true);
 
         float corner_size = _y_offset_scrollbar->get_preferred_size().natural_size.x;
@@ -146,7 +158,14 @@ namespace mousetrap
         });
 
         canvas_copy_to_clipboard.set_function([](){
-            std::cerr << "[ERROR] In canvas_copy_to_clipboard: TODO" << std::endl;
+            auto clipboard = Clipboard(state::main_window);
+
+            std::set<size_t> layer_is;
+            for (size_t i = 0; i < active_state->get_n_layers(); ++i)
+                layer_is.insert(i);
+
+            // storage of the merged image is handed to the clipboard without another copy
+            clipboard.set_image(state::canvas_export->merge_layers(layer_is, active_state->get_current_frame_index()));
         });
 
         canvas_paste_clipboard.set_function([]()
@@ -205,30 +224,64 @@ namespace mousetrap
 
         canvas_apply_bucket_fill.set_function([]()
         {
-            const auto* frame = active_state->get_frame(
-                active_state->get_current_layer_index(),
-                active_state->get_current_frame_index()
-            );
-
             auto pos = active_state->get_cursor_position();
-
-            auto current = frame->get_pixel(pos.x, pos.y).operator HSVA();
             auto next = active_state->get_primary_color();
             float eps = active_state->get_bucket_fill_eps();
 
-            if (frame->get_pixel(pos.x, pos.y).a != 0 and abs(current.h - next.h) < eps and abs(current.s - next.s) < eps and abs(current.v - next.v) < eps and abs(current.a - next.a) < eps)
+            auto is_noop = [&](const Layer::Frame* frame) -> bool {
+                auto current = frame->get_pixel(pos.x, pos.y).operator HSVA();
+                return frame->get_pixel(pos.x, pos.y).a != 0 and abs(current.h - next.h) < eps and abs(current.s - next.s) < eps and abs(current.v - next.v) < eps and abs(current.a - next.a) < eps;
+            };
+
+            auto to_draw_data = [&](const PixelMask& mask) -> DrawData {
+                auto out = DrawData();
+                out.reserve(mask.count());
+
+                auto primary = next.operator RGBA();
+                for (size_t y = 0; y < mask.get_size().y; ++y)
+                {
+                    auto row = mask.get_row(y);
+                    for (size_t x = 0; x < row.size(); ++x)
+                        if (row[x] != 0)
+                            out.insert(Vector2i(x, y), primary);
+                }
+                return out;
+            };
+
+            auto layer_i = active_state->get_current_layer_index();
+
+            if (active_state->get_bucket_fill_all_frames())
+            {
+                const auto* layer = active_state->get_layer(layer_i);
+                auto masks = generate_bucket_fill_masks(pos, layer, eps);
+
+                active_state->begin_undo_transaction();
+                for (size_t frame_i = 0; frame_i < masks.size(); ++frame_i)
+                {
+                    if (is_noop(layer->get_frame(frame_i)))
+                        continue;
+
+                    active_state->draw_to_cell({layer_i, frame_i}, to_draw_data(masks.at(frame_i)));
+                }
+                active_state->end_undo_transaction();
                 return;
+            }
 
-            auto points = generate_bucket_fill_points(pos, frame, active_state->get_bucket_fill_eps());
-
-            auto to_draw = DrawData();
-            auto primary = active_state->get_primary_color();
-            for (auto& p : points)
-                to_draw.insert({p, primary});
+            const auto* frame = active_state->get_frame(layer_i, active_state->get_current_frame_index());
+            if (is_noop(frame))
+                return;
 
-            active_state->draw_to_cell(active_state->get_current_cell_position(), to_draw);
+            auto mask = generate_bucket_fill_mask(pos, frame, eps);
+            active_state->draw_to_cell(active_state->get_current_cell_position(), to_draw_data(mask));
         });
 
+        canvas_toggle_bucket_fill_all_frames.set_stateful_function([](bool) -> bool{
+            auto next = not active_state->get_bucket_fill_all_frames();
+            active_state->set_bucket_fill_all_frames(next);
+            return next;
+        }, false);
+        canvas_toggle_bucket_fill_all_frames.set_state(active_state->get_bucket_fill_all_frames());
+
         canvas_apply_marquee_neighborhood_select.set_function([](){
 
             const auto* frame = active_state->get_frame(
@@ -239,11 +292,8 @@ namespace mousetrap
             auto pos = active_state->get_cursor_position();
             float eps = 1 / 100.f; //active_state->get_bucket_fill_eps();
 
-            auto points = generate_bucket_fill_points(pos, frame, active_state->get_bucket_fill_eps());
-            Vector2iSet selection;
-            for (auto& point : points)
-                selection.insert(point);
-
+            auto selection = Selection();
+            selection.create_from(generate_bucket_fill_mask(pos, frame, active_state->get_bucket_fill_eps()));
             active_state->add_selection(selection);
         });
 
@@ -307,6 +357,7 @@ namespace mousetrap
             &canvas_paste_clipboard,
             &canvas_copy_to_clipboard,
             &canvas_apply_bucket_fill,
+            &canvas_toggle_bucket_fill_all_frames,
             &canvas_apply_color_select,
             &canvas_apply_marquee_neighborhood_select,
             &canvas_select_all,
@@ -481,10 +532,14 @@ namespace mousetrap
         _onionskin_layer->on_onionskin_layer_count_changed();
     }
 
-    void Canvas::on_layer_image_updated()
+    void Canvas::on_layer_image_updated(const signals::CellInvalidation& cells)
     {
-        _layer_layer->on_layer_image_updated();
-        _onionskin_layer->on_layer_image_updated();
+        // layer layer shows the current frame of every layer, onionskin layer every frame of the current layer
+        if (cells.contains_frame(active_state->get_current_frame_index()))
+            _layer_layer->on_layer_image_updated();
+
+        if (cells.contains_layer(active_state->get_current_layer_index()))
+            _onionskin_layer->on_layer_image_updated();
     }
 
     void Canvas::on_layer_count_changed()
@@ -14,7 +14,7 @@ namespace mousetrap
         _area.connect_signal_render(on_area_render, this);
     }
 
-    Canvas::BrushShapeLayer::operator Widget*()
+    Canvas::BrushShapeLayer::operator RenderPass*()
     {
         return &_area;
     }
@@ -104,9 +104,8 @@ namespace mousetrap
         on_color_selection_changed();
     }
 
-    void Canvas::BrushShapeLayer::on_area_realize(Widget* widget, BrushShapeLayer* instance)
+    void Canvas::BrushShapeLayer::on_area_realize(RenderPass* area, BrushShapeLayer* instance)
     {
-        auto* area = (GLArea*) widget;
         area->make_current();
 
         instance->_brush_shape = new Shape();
@@ -137,7 +136,7 @@ namespace mousetrap
         area->queue_render();
     }
 
-    void Canvas::BrushShapeLayer::on_area_resize(GLArea* area, int w, int h, BrushShapeLayer* instance)
+    void Canvas::BrushShapeLayer::on_area_resize(RenderPass* area, int w, int h, BrushShapeLayer* instance)
     {
         *instance->_canvas_size = {w, h};
 
@@ -185,25 +184,11 @@ namespace mousetrap
         on_color_selection_changed();
     }
 
-    bool Canvas::BrushShapeLayer::on_area_render(GLArea* area, GdkGLContext* context, BrushShapeLayer* instance)
+    bool Canvas::BrushShapeLayer::on_area_render(RenderPass* area, GdkGLContext* context, BrushShapeLayer* instance)
     {
-        area->make_current();
-        gdk_gl_context_make_current(context);
-
         auto active_tool = active_state->get_current_tool();
         if (not (active_tool == ToolID::BRUSH or active_tool == ToolID::ERASER))
-        {
-            glClearColor(0, 0, 0, 0);
-            glClear(GL_COLOR_BUFFER_BIT);
-            glFlush();
             return true;
-        }
-
-        static GLNativeHandle before = [](){
-            GLint before = 0;
-            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &before);
-            return before;
-        }();
 
         {
             instance->_render_texture->bind_as_rendertarget();
@@ -215,23 +200,15 @@ namespace mousetrap
             set_current_blend_mode(BlendMode::NORMAL);
 
             instance->_brush_shape_task->render();
-            glFlush();
         }
 
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, before);
-
-            gdk_gl_context_make_current(context);
-
-            glClearColor(0, 0, 0, 0);
-            glClear(GL_COLOR_BUFFER_BIT);
+            area->bind_as_rendertarget();
 
             glEnable(GL_BLEND);
             set_current_blend_mode(BlendMode::NORMAL);
 
             instance->_render_shape_task->render();
-
-            glFlush();
         }
 
         return true;
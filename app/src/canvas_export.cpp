@@ -5,82 +5,148 @@
 #include "app/canvas_export.hpp"
 #include "app/project_state.hpp"
 
+#include <cstring>
+#include <iostream>
+
 namespace mousetrap
 {
     CanvasExport::CanvasExport()
-        : _frame(active_state->get_layer_resolution().x / float(active_state->get_layer_resolution().y))
     {
-        _area.connect_signal_realize(on_area_realize, this);
-        _area.connect_signal_resize(on_area_resize, this);
-        //_area.connect_signal_render(on_area_render, this);
-        _area.set_size_request(active_state->get_layer_resolution());
-        _area.set_align(GTK_ALIGN_CENTER);
-
-        _frame.set_child(&_area);
-        _frame.set_expand(false);
-        _box.push_back(&_frame);
-        _box.set_expand(true);
-    }
+        GError* error = nullptr;
+        _context = gdk_display_create_gl_context(gdk_display_get_default(), &error);
+        if (error != nullptr)
+        {
+            std::cerr << "[ERROR] In CanvasExport::CanvasExport: Unable to create GL context: " << error->message << std::endl;
+            g_error_free(error);
+            _context = nullptr;
+            return;
+        }
 
-    CanvasExport::operator Widget*()
-    {
-        return &_box;
-    }
-    
-    void CanvasExport::queue_render_tasks()
-    {
-        _render_tasks.clear();
+        gdk_gl_context_set_required_version(_context, 3, 2);
+        gdk_gl_context_realize(_context, &error);
+        if (error != nullptr)
+        {
+            std::cerr << "[ERROR] In CanvasExport::CanvasExport: Unable to realize GL context: " << error->message << std::endl;
+            g_error_free(error);
+            g_object_unref(_context);
+            _context = nullptr;
+            return;
+        }
+
+        make_current();
+        _render_texture = new RenderTexture();
+        glGenBuffers(n_pixel_buffers, _pixel_buffers);
 
-        for (size_t layer_i = 0; layer_i < active_state->get_n_layers(); ++layer_i)
-            _render_tasks.emplace_back(_shapes.at(layer_i), nullptr, nullptr, active_state->get_layer(layer_i)->get_blend_mode());
+        _post_fx_shader = new Shader();
+        _post_fx_shader->create_from_file(get_resource_path() + "shaders/project_post_fx.frag", ShaderType::FRAGMENT);
+
+        // texture coordinate (0, 0) at framebuffer origin, so texel rows of output and input have the same order
+        _post_fx_shape = new Shape();
+        _post_fx_shape->as_rectangle({0, 1}, {1, 1}, {1, 0}, {0, 0});
+        _post_fx_shape->set_color(RGBA(1, 1, 1, 1));
+
+        glGenFramebuffers(1, &_post_fx_framebuffer);
+        restore_context();
     }
 
-    void CanvasExport::on_area_realize(Widget* widget, CanvasExport* instance)
+    CanvasExport::~CanvasExport()
     {
-        auto* area = (GLArea*) widget;
-        area->make_current();
+        if (not make_current())
+            return;
+
+        for (auto* shape : _shapes)
+            delete shape;
+
+        delete _render_texture;
+
+        delete _post_fx_shape;
+        delete _post_fx_shader;
+        glDeleteFramebuffers(1, &_post_fx_framebuffer);
+
+        for (auto& fence : _pixel_buffer_fences)
+            if (fence != nullptr)
+                glDeleteSync(fence);
+
+        glDeleteBuffers(n_pixel_buffers, _pixel_buffers);
+
+        restore_context();
+        if (gdk_gl_context_get_current() == _context)
+            gdk_gl_context_clear_current();
 
-        instance->on_layer_count_changed();
-        instance->operator Widget*()->set_opacity(1 / 255.f); // lowest possible opacity that still counts as visible
+        g_object_unref(_context);
     }
-    
-    void CanvasExport::on_area_resize(GLArea*, int w, int h, CanvasExport* instance)
+
+    bool CanvasExport::make_current()
     {
-        instance->_canvas_size = {w, h};
+        if (_context == nullptr)
+            return false;
+
+        _context_before = gdk_gl_context_get_current();
+        gdk_gl_context_make_current(_context);
+        return true;
     }
 
-    gboolean CanvasExport::on_area_render(GLArea* area, GdkGLContext* context, CanvasExport* instance)
+    void CanvasExport::restore_context()
     {
-       // noop
-       return true;
+        // if no context was current, callers may rely on this one staying current to upload the result
+        if (_context_before != nullptr and _context_before != _context)
+            gdk_gl_context_make_current(_context_before);
+
+        _context_before = nullptr;
     }
 
-    void CanvasExport::set_frame(size_t i)
+    void CanvasExport::resize(Vector2ui size)
     {
-        _frame_i = i;
+        if (size == _size)
+            return;
+
+        _render_texture->create(size.x, size.y);
 
-        for (size_t layer_i = 0; layer_i < _render_tasks.size(); ++layer_i)
-            _shapes.at(layer_i)->set_texture(active_state->get_frame(layer_i, _frame_i)->get_texture());
+        for (auto buffer : _pixel_buffers)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, size.x * size.y * 4, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        _size = size;
     }
 
-    Image CanvasExport::merge_layers(const std::set<size_t>& layer_is, size_t frame_i)
+    std::vector<RenderTask> CanvasExport::get_render_tasks(const std::set<size_t>& layer_is, size_t frame_i)
     {
-        set_frame(frame_i);
+        std::vector<RenderTask> out;
+        out.reserve(layer_is.size());
+
+        size_t shape_i = 0;
+        for (size_t layer_i : layer_is)
+        {
+            if (layer_i >= active_state->get_n_layers())
+                continue;
 
-        std::vector<RenderTask> tasks;
-        tasks.reserve(layer_is.size());
+            const auto* layer = active_state->get_layer(layer_i);
+            if (not layer->get_is_visible())
+                continue;
 
-        for (size_t i : layer_is)
-            tasks.push_back(_render_tasks.at(i));
+            if (_shapes.size() <= shape_i)
+            {
+                _shapes.emplace_back(new Shape());
+                _shapes.back()->as_rectangle({0, 0}, {1, 1});
+            }
+
+            auto* shape = _shapes.at(shape_i++);
+            shape->set_texture(active_state->get_cell_texture(layer_i, frame_i)); // inbetweens show the keyframe before them
+            shape->set_color(RGBA(1, 1, 1, layer->get_opacity()));
+
+            out.emplace_back(shape, nullptr, nullptr, layer->get_blend_mode());
+        }
 
-        return merge(tasks);
+        return out;
     }
 
-    Image CanvasExport::merge(const std::vector<RenderTask>& tasks)
+    void CanvasExport::render(const std::vector<RenderTask>& tasks)
     {
-        // update render
-
-        _area.make_current();
+        _render_texture->bind_as_rendertarget();
+        glViewport(0, 0, _size.x, _size.y);
 
         glClearColor(0, 0, 0, 0);
         glClear(GL_COLOR_BUFFER_BIT);
@@ -89,87 +155,174 @@ namespace mousetrap
         set_current_blend_mode(BlendMode::NORMAL);
 
         for (auto task : tasks)
-           task.render();
+            task.render();
+    }
+
+    void CanvasExport::start_download(size_t buffer_i)
+    {
+        // returns immediately, the copy into the buffer happens once rendering is done
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, _pixel_buffers[buffer_i]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, _size.x, _size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
+        _pixel_buffer_fences[buffer_i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
         glFlush();
+    }
 
-        // read buffer
+    Image CanvasExport::finish_download(size_t buffer_i)
+    {
+        auto out = Image(ImageFormat::RGBA8);
+        out.create(_size.x, _size.y, RGBA(0, 0, 0, 0));
 
-        auto out = Image();
-        out.create(active_state->get_layer_resolution().x, active_state->get_layer_resolution().y);
+        auto& fence = _pixel_buffer_fences[buffer_i];
+        if (fence != nullptr)
+        {
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
 
-        std::vector<float> buffer;
-        auto size = active_state->get_layer_resolution();
-        buffer.resize(size.x * size.y * 4);
+        const size_t row_size = _size.x * 4;
 
-        glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_FLOAT, &buffer[0]);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, _pixel_buffers[buffer_i]);
+        const auto* pixels = (const uint8_t*) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, row_size * _size.y, GL_MAP_READ_BIT);
 
-        for (size_t y = 0, i = 0; y < size.y; ++y)
+        if (pixels == nullptr)
+            std::cerr << "[ERROR] In CanvasExport::finish_download: Unable to map pixel buffer" << std::endl;
+        else
         {
-            for (size_t x = 0; x < size.x; ++x, i += 4)
-            {
-                float r = buffer.at(i+0);
-                float g = buffer.at(i+1);
-                float b = buffer.at(i+2);
-                float a = buffer.at(i+3);
+            // framebuffer origin is bottom left
+            for (size_t y = 0; y < _size.y; ++y)
+                std::memcpy(out.get_row(y).data(), pixels + (_size.y - 1 - y) * row_size, row_size);
 
-                out.set_pixel(x, size.y - (y+1), RGBA(r, g, b, a));
-            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
         }
 
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
         return out;
     }
-    
-    void CanvasExport::on_layer_count_changed()
+
+    Image CanvasExport::merge_layers(const std::set<size_t>& layer_is, size_t frame_i)
     {
-        _area.make_current();
+        if (not make_current())
+        {
+            auto size = active_state->get_layer_resolution();
+            auto out = Image(ImageFormat::RGBA8);
+            out.create(size.x, size.y, RGBA(0, 0, 0, 0));
+            return out;
+        }
 
-        for (auto* shape : _shapes)
-            delete shape;
+        resize(active_state->get_layer_resolution());
+        render(get_render_tasks(layer_is, frame_i));
+        start_download(0);
+        auto out = finish_download(0);
 
-        _shapes.clear();
+        restore_context();
+        return out;
+    }
+
+    std::vector<Image> CanvasExport::merge_layers(const std::set<size_t>& layer_is)
+    {
+        const size_t n_frames = active_state->get_n_frames();
+
+        std::vector<Image> out;
+        out.reserve(n_frames);
 
-        for (size_t i = 0; i < active_state->get_n_layers(); ++i)
+        if (not make_current())
         {
-            if (_shapes.size() <= i)
-                _shapes.emplace_back(new Shape());
+            auto size = active_state->get_layer_resolution();
+            for (size_t frame_i = 0; frame_i < n_frames; ++frame_i)
+            {
+                out.emplace_back(ImageFormat::RGBA8);
+                out.back().create(size.x, size.y, RGBA(0, 0, 0, 0));
+            }
+            return out;
+        }
 
-            auto* layer = _shapes.at(i);
-            layer->as_rectangle({0, 0}, {1, 1});
-            layer->set_texture(active_state->get_frame(i, active_state->get_current_frame_index())->get_texture());
-            layer->set_visible(active_state->get_layer(i)->get_is_visible());
-            layer->set_color(RGBA(1, 1, 1, active_state->get_layer(i)->get_is_visible()));
+        resize(active_state->get_layer_resolution());
+
+        for (size_t frame_i = 0; frame_i < n_frames; ++frame_i)
+        {
+            render(get_render_tasks(layer_is, frame_i));
+            start_download(frame_i % n_pixel_buffers);
+
+            // the oldest download had n_pixel_buffers - 1 renders worth of time to complete, so mapping it does not stall
+            if (frame_i + 1 >= n_pixel_buffers)
+                out.push_back(finish_download((frame_i + 1) % n_pixel_buffers));
         }
 
-        queue_render_tasks();
+        for (size_t frame_i = out.size(); frame_i < n_frames; ++frame_i)
+            out.push_back(finish_download(frame_i % n_pixel_buffers));
+
+        restore_context();
+        return out;
     }
 
-    void CanvasExport::on_layer_properties_changed()
+    std::vector<Texture*> CanvasExport::apply_post_fx(const std::vector<const Texture*>& textures, const PostFX& fx)
     {
-        if (not _area.get_is_realized())
-            return;
+        std::vector<Texture*> out;
+        if (not make_current())
+            return out;
+
+        for (size_t i = 0; i < 7; ++i)
+            _post_fx_color_offset[i] = fx.color_offset[i];
+
+        _post_fx_apply_color_offset = fx.apply_color_offset;
+        _post_fx_flip_horizontally = fx.flip_horizontally;
+        _post_fx_flip_vertically = fx.flip_vertically;
+        _post_fx_apply_flip = fx.apply_flip;
 
-        for (size_t i = 0; i < active_state->get_n_layers(); ++i)
+        // no blending, output is exactly what the shader writes
+        auto task = RenderTask(_post_fx_shape, _post_fx_shader, nullptr, BlendMode::NONE);
+
+        task.register_int("_apply_color_offset", &_post_fx_apply_color_offset);
+        task.register_int("_apply_flip", &_post_fx_apply_flip);
+        task.register_int("_flip_horizontally", &_post_fx_flip_horizontally);
+        task.register_int("_flip_vertically", &_post_fx_flip_vertically);
+
+        const char* offset_names[] = {"_h_offset", "_s_offset", "_v_offset", "_r_offset", "_g_offset", "_b_offset", "_a_offset"};
+        for (size_t i = 0; i < 7; ++i)
+            task.register_float(offset_names[i], &_post_fx_color_offset[i]);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, _post_fx_framebuffer);
+
+        out.reserve(textures.size());
+        for (const auto* texture : textures)
         {
-            const auto* layer = active_state->get_layer(i);
-            _shapes.at(i)->set_texture(layer->get_frame(active_state->get_current_frame_index())->get_texture());
-            _shapes.at(i)->set_visible(layer->get_is_visible());
-            _shapes.at(i)->set_color(RGBA(1, 1, 1, layer->get_opacity()));
+            const auto size = texture->get_size();
+
+            auto* result = out.emplace_back(new Texture());
+            result->create(size.x, size.y, ImageFormat::RGBA8);
+
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, result->get_native_handle(), 0);
+            glViewport(0, 0, size.x, size.y);
+
+            _post_fx_shape->set_texture(texture);
+            task.render();
         }
-    }
 
-    void CanvasExport::on_layer_image_updated()
-    {
-        if (not _area.get_is_realized())
-            return;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // results are sampled from the contexts of the canvas widgets next
+        glFinish();
 
-        for (size_t i = 0; i < active_state->get_n_layers(); ++i)
-            _shapes.at(i)->set_texture(active_state->get_frame(i, active_state->get_current_frame_index())->get_texture());
+        restore_context();
+        return out;
     }
 
-    void CanvasExport::on_layer_resolution_changed()
+    Image CanvasExport::download(const Texture& texture)
     {
-        on_layer_image_updated();
-        _area.set_size_request(active_state->get_layer_resolution());
+        if (not make_current())
+        {
+            auto out = Image(ImageFormat::RGBA8);
+            out.create(texture.get_size().x, texture.get_size().y, RGBA(0, 0, 0, 0));
+            return out;
+        }
+
+        auto out = texture.download();
+        restore_context();
+        return out;
     }
 }
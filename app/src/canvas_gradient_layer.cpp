@@ -26,10 +26,12 @@ namespace mousetrap
 
             auto image = self->_render_texture->download();
             auto draw_data = DrawData();
+            draw_data.reserve(image.get_size().x * image.get_size().y);
 
-            for (size_t x = 0; x < image.get_size().x; ++x)
-                for (size_t y = 0; y < image.get_size().y; ++y)
-                    draw_data.insert({{x, y}, image.get_pixel(x, y).operator HSVA()});
+            // row-major so the batch does not need to be sorted
+            for (size_t y = 0; y < image.get_size().y; ++y)
+                for (size_t x = 0; x < image.get_size().x; ++x)
+                    draw_data.insert(Vector2i(x, y), image.get_pixel(x, y));
             active_state->draw_to_cell(active_state->get_current_cell_position(), draw_data);
 
         });
@@ -44,7 +46,7 @@ namespace mousetrap
         // TODO
     }
 
-    Canvas::GradientLayer::operator Widget*()
+    Canvas::GradientLayer::operator RenderPass*()
     {
         return &_area;
     }
@@ -108,9 +110,8 @@ namespace mousetrap
         _area.queue_render();
     }
 
-    void Canvas::GradientLayer::on_area_realize(Widget* widget, GradientLayer* instance)
+    void Canvas::GradientLayer::on_area_realize(RenderPass* area, GradientLayer* instance)
     {
-        auto* area = (GLArea*) widget;
         area->make_current();
 
         if (instance->_shader == nullptr)
@@ -142,50 +143,19 @@ namespace mousetrap
         instance->_shader_task->register_vec2("_canvas_size", instance->_canvas_size);
     }
 
-    void Canvas::GradientLayer::on_area_resize(GLArea*, int w, int h, GradientLayer* instance)
+    void Canvas::GradientLayer::on_area_resize(RenderPass*, int w, int h, GradientLayer* instance)
     {
         *instance->_canvas_size = {w, h};
         instance->reformat();
     }
 
-    bool Canvas::GradientLayer::on_area_render(GLArea* area, GdkGLContext* context, GradientLayer* instance)
+    bool Canvas::GradientLayer::on_area_render(RenderPass* area, GdkGLContext* context, GradientLayer* instance)
     {
-        area->make_current();
-        gdk_gl_context_make_current(context);
-
-        static GLNativeHandle before = [](){
-            GLint before = 0;
-            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &before);
-            return before;
-        }();
-
         glEnable(GL_BLEND);
         set_current_blend_mode(BlendMode::NORMAL);
 
-        {
-            //instance->_render_texture->bind_as_rendertarget();
-
-            glClearColor(0, 0, 0, 0);
-            glClear(GL_COLOR_BUFFER_BIT);
-
-            instance->_shader_task->render();
-            glFlush();
-        }
-
-        return true;
-
-        {
-            glBindFramebuffer(GL_FRAMEBUFFER, before);
-
-            gdk_gl_context_make_current(context);
-
-            glClearColor(0, 0, 0, 0);
-            glClear(GL_COLOR_BUFFER_BIT);
-
-            instance->_render_task->render();
-            glFlush();
-        }
-
+        // render texture path is disabled, the shader output goes straight into the compositor
+        instance->_shader_task->render();
         return true;
     }
 
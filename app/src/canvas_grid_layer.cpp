@@ -13,14 +13,13 @@ namespace mousetrap
         _area.connect_signal_resize(on_area_resize, this);
     }
 
-    Canvas::GridLayer::operator Widget*()
+    Canvas::GridLayer::operator RenderPass*()
     {
         return &_area;
     }
 
-    void Canvas::GridLayer::on_area_realize(Widget* widget, GridLayer* instance)
+    void Canvas::GridLayer::on_area_realize(RenderPass* area, GridLayer* instance)
     {
-        auto* area = (GLArea*) widget;
         area->make_current();
 
         instance->on_layer_resolution_changed();
@@ -29,7 +28,7 @@ namespace mousetrap
         area->queue_render();
     }
 
-    void Canvas::GridLayer::on_area_resize(GLArea*, int w, int h, GridLayer* instance)
+    void Canvas::GridLayer::on_area_resize(RenderPass*, int w, int h, GridLayer* instance)
     {
         *instance->_canvas_size = {w, h};
         instance->reformat();
@@ -67,45 +66,19 @@ namespace mousetrap
 
         _area.make_current();
 
-        auto color = state::settings_file->get_value_as<HSVA>("canvas", "grid_color");
-
-        for (auto* shape : _h_shapes)
-            delete shape;
-
-        _h_shapes.clear();
-        while (_h_shapes.size() <= active_state->get_layer_resolution().y)
-        {
-            auto* shape = _h_shapes.emplace_back(new Shape());
-            shape->set_color(color);
-        }
-
-        for (auto* shape : _v_shapes)
-            delete shape;
-
-        _v_shapes.clear();
-        while (_v_shapes.size() <= active_state->get_layer_resolution().x)
-        {
-            _v_shapes.emplace_back(new Shape());
-            auto* shape = _v_shapes.back();
-            shape->set_color(color);
-        }
+        if (_grid == nullptr)
+            _grid = new ShapeBatch();
 
         reformat();
 
         _area.clear_render_tasks();
-
-        for (auto* shape : _h_shapes)
-            _area.add_render_task(shape);
-
-        for (auto* shape : _v_shapes)
-            _area.add_render_task(shape);
-
+        _area.add_render_task(_grid);
         _area.queue_render();
     }
 
     void Canvas::GridLayer::reformat()
     {
-        if (not _area.get_is_realized())
+        if (not _area.get_is_realized() or _grid == nullptr)
             return;
 
         auto layer_resolution = active_state->get_layer_resolution();
@@ -123,28 +96,35 @@ namespace mousetrap
         float pixel_w = width / layer_resolution.x;
         float pixel_h = height / layer_resolution.y;
 
+        auto color = state::settings_file->get_value_as<HSVA>("canvas", "grid_color");
+
+        _grid->clear();
+
         for (size_t i = 0; i <= layer_resolution.x; ++i)
         {
-            _v_shapes.at(i)->as_line(
+            _grid->add_line(
                 top_left + Vector2f{i * pixel_w, 0},
-                top_left + Vector2f(i * pixel_w, height)
+                top_left + Vector2f(i * pixel_w, height),
+                color
             );
         }
 
         for (size_t i = 0; i <= layer_resolution.y; ++i)
         {
-            _h_shapes.at(i)->as_line(
+            _grid->add_line(
                 top_left + Vector2f{0, i * pixel_h},
-                top_left + Vector2f(width, i * pixel_h)
+                top_left + Vector2f(width, i * pixel_h),
+                color
             );
         }
 
+        _grid->flush();
         update_visibility();
     }
 
     void Canvas::GridLayer::update_visibility()
     {
-        if (not _area.get_is_realized())
+        if (not _area.get_is_realized() or _grid == nullptr)
             return;
 
         auto layer_resolution = active_state->get_layer_resolution();
@@ -158,11 +138,6 @@ namespace mousetrap
         float pixel_h = height / layer_resolution.y;
 
         auto hide = std::min(pixel_w * _canvas_size->x, pixel_h * _canvas_size->y) < state::settings_file->get_value_as<float>("canvas", "grid_minimum_square_size");
-
-        for (auto* shape : _v_shapes)
-            shape->set_visible(not hide and _visible_requested);
-
-        for (auto* shape : _h_shapes)
-            shape->set_visible(not hide and _visible_requested);
+        _grid->set_visible(not hide and _visible_requested);
     }
 }
@@ -14,14 +14,13 @@ namespace mousetrap
         _area.connect_signal_resize(on_area_resize, this);
     }
 
-    Canvas::LayerLayer::operator Widget*()
+    Canvas::LayerLayer::operator RenderPass*()
     {
         return &_area;
     }
 
-    void Canvas::LayerLayer::on_area_realize(Widget* widget, LayerLayer* instance)
+    void Canvas::LayerLayer::on_area_realize(RenderPass* area, LayerLayer* instance)
     {
-        auto* area = (GLArea*) widget;
         area->make_current();
 
         instance->_post_fx_shader = new Shader();
@@ -34,7 +33,7 @@ namespace mousetrap
         area->queue_render();
     }
 
-    void Canvas::LayerLayer::on_area_resize(GLArea*, int w, int h, LayerLayer* instance)
+    void Canvas::LayerLayer::on_area_resize(RenderPass*, int w, int h, LayerLayer* instance)
     {
         *instance->_canvas_size = {w, h};
         instance->reformat();
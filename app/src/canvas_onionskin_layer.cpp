@@ -14,14 +14,13 @@ namespace mousetrap
         _area.connect_signal_resize(on_area_resize, this);
     }
 
-    Canvas::OnionskinLayer::operator Widget*()
+    Canvas::OnionskinLayer::operator RenderPass*()
     {
         return &_area;
     }
 
-    void Canvas::OnionskinLayer::on_area_realize(Widget* widget, OnionskinLayer* instance) 
+    void Canvas::OnionskinLayer::on_area_realize(RenderPass* area, OnionskinLayer* instance) 
     {
-        auto* area = (GLArea*) widget;
         area->make_current();
 
         if (instance->_onionskin_shader == nullptr)
@@ -40,7 +39,7 @@ namespace mousetrap
         area->queue_render();
     }
 
-    void Canvas::OnionskinLayer::on_area_resize(GLArea* area, int w, int h, OnionskinLayer* instance)
+    void Canvas::OnionskinLayer::on_area_resize(RenderPass* area, int w, int h, OnionskinLayer* instance)
     {
         *instance->_canvas_size = {w, h};
         instance->reformat();
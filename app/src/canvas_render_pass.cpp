@@ -0,0 +1,129 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/18/23
+//
+
+#include <app/canvas.hpp>
+
+namespace mousetrap
+{
+    void Canvas::RenderPass::add_render_task(Shape* shape, Shader* shader, GLTransform* transform)
+    {
+        if (shape == nullptr)
+            return;
+
+        _render_tasks.emplace_back(shape, shader, transform);
+    }
+
+    void Canvas::RenderPass::add_render_task(RenderTask task)
+    {
+        _render_tasks.push_back(task);
+    }
+
+    void Canvas::RenderPass::clear_render_tasks()
+    {
+        _render_tasks.clear();
+    }
+
+    void Canvas::RenderPass::queue_render()
+    {
+        if (_target != nullptr)
+            _target->queue_render();
+    }
+
+    void Canvas::RenderPass::make_current()
+    {
+        if (_target != nullptr)
+            _target->make_current();
+    }
+
+    bool Canvas::RenderPass::get_is_realized() const
+    {
+        return _is_realized;
+    }
+
+    void Canvas::RenderPass::bind_as_rendertarget() const
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, _target_framebuffer);
+        glViewport(_target_viewport[0], _target_viewport[1], _target_viewport[2], _target_viewport[3]);
+    }
+
+    void Canvas::RenderPass::realize()
+    {
+        _is_realized = true;
+
+        if (_realize_f)
+            _realize_f(this);
+    }
+
+    void Canvas::RenderPass::resize(int w, int h)
+    {
+        if (_resize_f)
+            _resize_f(this, w, h);
+    }
+
+    void Canvas::RenderPass::render(GdkGLContext* context)
+    {
+        if (_render_f)
+        {
+            _render_f(this, context);
+            return;
+        }
+
+        for (auto& task : _render_tasks)
+            task.render();
+    }
+
+    void Canvas::add_render_pass(RenderPass* pass)
+    {
+        pass->_target = &_render_area;
+        _render_passes.push_back(pass);
+    }
+
+    void Canvas::on_render_area_realize(Widget* widget, Canvas* instance)
+    {
+        auto* area = (GLArea*) widget;
+        area->make_current();
+
+        for (auto* pass : instance->_render_passes)
+            pass->realize();
+
+        area->queue_render();
+    }
+
+    void Canvas::on_render_area_resize(GLArea* area, int w, int h, Canvas* instance)
+    {
+        area->make_current();
+
+        for (auto* pass : instance->_render_passes)
+            pass->resize(w, h);
+
+        instance->_user_input_layer->set_canvas_size({w, h});
+    }
+
+    bool Canvas::on_render_area_render(GLArea* area, GdkGLContext* context, Canvas* instance)
+    {
+        // target was already cleared by GLArea, passes draw on top of each other without clearing
+        area->make_current();
+
+        GLint framebuffer = 0;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+
+        std::array<GLint, 4> viewport;
+        glGetIntegerv(GL_VIEWPORT, viewport.data());
+
+        for (auto* pass : instance->_render_passes)
+        {
+            pass->_target_framebuffer = framebuffer;
+            pass->_target_viewport = viewport;
+            pass->bind_as_rendertarget();
+
+            glEnable(GL_BLEND);
+            set_current_blend_mode(BlendMode::NORMAL);
+
+            pass->render(context);
+        }
+
+        glFlush();
+        return true;
+    }
+}
@@ -15,9 +15,11 @@ namespace mousetrap
 
         _area.add_tick_callback([](FrameClock clock, SelectionLayer* instance) -> bool {
 
-            if (state::settings_file->get_value_as<bool>("canvas", "selection_outline_animated"))
-                *instance->_outline_time_s += clock.get_time_since_last_frame().as_seconds();
+            // only redraw the shared area while the outline is actually moving
+            if (*instance->_animation_paused or not state::settings_file->get_value_as<bool>("canvas", "selection_outline_animated"))
+                return true;
 
+            *instance->_outline_time_s += clock.get_time_since_last_frame().as_seconds();
             instance->_area.queue_render();
             return true;
         }, this);
@@ -26,7 +28,7 @@ namespace mousetrap
         set_offset(_owner->_offset);
     }
 
-    Canvas::SelectionLayer::operator Widget*()
+    Canvas::SelectionLayer::operator RenderPass*()
     {
         return &_area;
     }
@@ -71,26 +73,25 @@ namespace mousetrap
         _area.queue_render();
     }
 
-    void Canvas::SelectionLayer::on_realize(Widget* widget, SelectionLayer* instance)
+    void Canvas::SelectionLayer::on_realize(RenderPass* area, SelectionLayer* instance)
     {
-        auto* area = (GLArea*) widget;
         area->make_current();
 
         instance->_outline_shader = new Shader();
         instance->_outline_shader->create_from_file(get_resource_path() + "shaders/dotted_outline.frag", ShaderType::FRAGMENT);
 
-        instance->_outline_left_to_right = new Shape();
-        instance->_outline_top_to_bottom = new Shape();
-        instance->_outline_right_to_left = new Shape();
-        instance->_outline_bottom_to_top = new Shape();
+        instance->_outline_left_to_right = new ShapeBatch();
+        instance->_outline_top_to_bottom = new ShapeBatch();
+        instance->_outline_right_to_left = new ShapeBatch();
+        instance->_outline_bottom_to_top = new ShapeBatch();
 
-        instance->_outline_outline = new Shape();
+        instance->_outline_outline = new ShapeBatch();
 
         instance->reformat();
         instance->reschedule_render_tasks();
     }
 
-    void Canvas::SelectionLayer::on_resize(GLArea* area, int w, int h, SelectionLayer* instance)
+    void Canvas::SelectionLayer::on_resize(RenderPass* area, int w, int h, SelectionLayer* instance)
     {
         *(instance->_canvas_size) = {w, h};
         instance->reformat();
@@ -144,9 +145,10 @@ namespace mousetrap
         float y_eps = 1.f / _canvas_size->y;
 
         const auto& outline_vertices = active_state->get_selection().get_outline_vertices();
+        const auto selection_offset = Vector2f(active_state->get_selection().get_offset());
         std::vector<std::pair<Vector2f, Vector2f>> outline_outline;
 
-        auto convert_vertices = [&](Shape* shape, const std::vector<std::pair<Vector2f, Vector2f>>& vertices){
+        auto convert_vertices = [&](ShapeBatch* batch, const std::vector<std::pair<Vector2f, Vector2f>>& vertices){
 
             std::vector<std::pair<Vector2f, Vector2f>> converted;
             converted.reserve(vertices.size());
@@ -155,12 +157,12 @@ namespace mousetrap
             {
                 auto to_push = std::pair<Vector2f, Vector2f>();
                 to_push.first = {
-                    top_left.x + pair.first.x * pixel_w,
-                    top_left.y + pair.first.y * pixel_h
+                    top_left.x + (pair.first.x + selection_offset.x) * pixel_w,
+                    top_left.y + (pair.first.y + selection_offset.y) * pixel_h
                 };
                 to_push.second = {
-                    top_left.x + pair.second.x * pixel_w,
-                    top_left.y + pair.second.y * pixel_h
+                    top_left.x + (pair.second.x + selection_offset.x) * pixel_w,
+                    top_left.y + (pair.second.y + selection_offset.y) * pixel_h
                 };
                 converted.push_back(to_push);
 
@@ -190,15 +192,18 @@ namespace mousetrap
                 }
             }
 
-            shape->as_lines(converted);
+            batch->clear();
+            batch->add_lines(converted, _color);
+            batch->flush();
         };
 
         convert_vertices(_outline_left_to_right, outline_vertices.left_to_right);
         convert_vertices(_outline_top_to_bottom, outline_vertices.top_to_bottom);
         convert_vertices(_outline_right_to_left, outline_vertices.right_to_left);
         convert_vertices(_outline_bottom_to_top, outline_vertices.bottom_to_top);
-        _outline_outline->as_lines(outline_outline);
-        _outline_outline->set_color(RGBA(0, 0, 0, 0.5));
+        _outline_outline->clear();
+        _outline_outline->add_lines(outline_outline, RGBA(0, 0, 0, 0.5));
+        _outline_outline->flush();
         reschedule_render_tasks();
     }
 
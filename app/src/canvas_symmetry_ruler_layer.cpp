@@ -13,14 +13,13 @@ namespace mousetrap
         _area.connect_signal_resize(on_area_resize, this);
     }
 
-    Canvas::SymmetryRulerLayer::operator Widget*()
+    Canvas::SymmetryRulerLayer::operator RenderPass*()
     {
         return &_area;
     }
 
-    void Canvas::SymmetryRulerLayer::on_area_realize(Widget* widget, SymmetryRulerLayer* instance)
+    void Canvas::SymmetryRulerLayer::on_area_realize(RenderPass* area, SymmetryRulerLayer* instance)
     {
-        auto* area = (GLArea*) widget;
         area->make_current();
 
         instance->_h_anchor_left= new Shape();
@@ -84,7 +83,7 @@ namespace mousetrap
         area->queue_render();
     }
 
-    void Canvas::SymmetryRulerLayer::on_area_resize(GLArea*, int w, int h, SymmetryRulerLayer* instance)
+    void Canvas::SymmetryRulerLayer::on_area_resize(RenderPass*, int w, int h, SymmetryRulerLayer* instance)
     {
         *instance->_canvas_size = {w, h};
         instance->reformat();
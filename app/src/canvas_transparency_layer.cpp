@@ -13,14 +13,13 @@ namespace mousetrap
         _area.connect_signal_resize(on_area_resize, this);
     }
 
-    Canvas::TransparencyTilingLayer::operator Widget*()
+    Canvas::TransparencyTilingLayer::operator RenderPass*()
     {
         return &_area;
     }
 
-    void Canvas::TransparencyTilingLayer::on_area_realize(Widget* widget, TransparencyTilingLayer* instance)
+    void Canvas::TransparencyTilingLayer::on_area_realize(RenderPass* area, TransparencyTilingLayer* instance)
     {
-        auto* area = (GLArea*) widget;
         area->make_current();
 
         if (instance->_shader == nullptr)
@@ -42,7 +41,7 @@ namespace mousetrap
         area->queue_render();
     }
 
-    void Canvas::TransparencyTilingLayer::on_area_resize(GLArea*, int w, int h, TransparencyTilingLayer* instance)
+    void Canvas::TransparencyTilingLayer::on_area_resize(RenderPass*, int w, int h, TransparencyTilingLayer* instance)
     {
         *instance->_canvas_size = {w, h};
         instance->reformat();
@@ -11,11 +11,11 @@ namespace mousetrap
     Canvas::UserInputLayer::UserInputLayer(Canvas* canvas)
         : _owner(canvas), _shortcut_controller(state::app)
     {
-        _proxy.set_opacity(1 / 255.f);
-        _proxy.connect_signal_resize(on_area_resize, this);
+        _proxy.set_expand(true);
 
         _click_controller.connect_signal_click_pressed(on_click_pressed, this);
         _click_controller.connect_signal_click_released(on_click_released, this);
+        _click_controller.connect_signal_click_cancelled(on_click_cancelled, this);
 
         _motion_controller.connect_signal_motion_enter(on_motion_enter, this);
         _motion_controller.connect_signal_motion(on_motion, this);
@@ -67,48 +67,64 @@ namespace mousetrap
             if (instance->_mouse_button_pressed and (current_tool == ToolID::BRUSH or current_tool == ToolID::ERASER)) {
 
                 auto points = generate_line_points(instance->_previous_cursor_pos, active_state->get_cursor_position());
-                auto brush = active_state->get_current_brush()->get_image();
+                const auto& brush = active_state->get_current_brush()->get_image();
+                const auto* cell = active_state->get_current_cell();
+                const auto resolution = active_state->get_layer_resolution();
+
+                auto& mask = instance->_stroke_mask;
+                if (mask.size() != resolution.x * resolution.y)
+                    mask.assign(resolution.x * resolution.y, false);
+
+                // offsets of all opaque brush pixels relative to the cursor, computed once per tick
+                std::vector<Vector2f> footprint;
+                for (size_t y = 0; y < brush.get_size().y; ++y)
+                    for (size_t x = 0; x < brush.get_size().x; ++x)
+                        if (brush.get_pixel(x, y).a != 0)
+                            footprint.emplace_back(x - 0.5 * brush.get_size().x + 1, y - 0.5 * brush.get_size().y + 1);
+
+                RGBA primary = active_state->get_primary_color();
+                const float opacity = active_state->get_brush_opacity();
+
                 auto out = DrawData();
+                out.reserve(points.size() * footprint.size());
 
                 for (auto p : points)
                 {
-                    for (int x = 0; x < brush.get_size().x; ++x)
+                    for (auto& offset : footprint)
                     {
-                        for (int y = 0; y < brush.get_size().y; ++y)
-                        {
-                            auto pos = Vector2i(
-                                p.x + x - 0.5 * brush.get_size().x + 1,
-                                p.y + y - 0.5 * brush.get_size().y + 1
-                            );
+                        auto pos = Vector2i(
+                            p.x + offset.x,
+                            p.y + offset.y
+                        );
 
-                            if (brush.get_pixel(x, y).a == 0 or pos.x < 0 or pos.x >= active_state->get_layer_resolution().x or pos.y < 0 or pos.y >= active_state->get_layer_resolution().y)
-                                continue;
+                        if (pos.x < 0 or pos.x >= resolution.x or pos.y < 0 or pos.y >= resolution.y)
+                            continue;
 
-                            if (instance->_stroke_points.find(pos) != instance->_stroke_points.end())
-                                continue;
+                        auto mask_i = pos.y * resolution.x + pos.x;
+                        if (mask[mask_i])
+                            continue;
 
-                            instance->_stroke_points.insert(pos);
+                        mask[mask_i] = true;
 
-                            auto current = active_state->get_current_cell()->get_pixel(pos.x, pos.y);
-                            if (current_tool == ToolID::BRUSH)
-                            {
-                                RGBA left = active_state->get_primary_color();
-                                left.a = active_state->get_brush_opacity();
-                                RGBA right = current;
+                        auto current = cell->get_pixel(pos.x, pos.y);
+                        if (current_tool == ToolID::BRUSH)
+                        {
+                            RGBA left = primary;
+                            left.a = opacity;
+                            RGBA right = current;
 
-                                auto mixed = glm::mix(Vector3f(left.r, left.g, left.b), Vector3f(right.r, right.g, right.b), 1 -  left.a);
+                            auto mixed = glm::mix(Vector3f(left.r, left.g, left.b), Vector3f(right.r, right.g, right.b), 1 -  left.a);
 
-                                out.insert(std::pair<Vector2i, HSVA>(pos, RGBA(mixed.r, mixed.g, mixed.b, right.a + left.a)));
-                            }
-                            else if (current_tool == ToolID::ERASER)
-                            {
-                                current.a -= active_state->get_brush_opacity();
+                            out.insert(pos, RGBA(mixed.r, mixed.g, mixed.b, right.a + left.a));
+                        }
+                        else if (current_tool == ToolID::ERASER)
+                        {
+                            current.a -= opacity;
 
-                                if (current.a <= 0)
-                                    current = RGBA(0, 0, 0, 0);
+                            if (current.a <= 0)
+                                current = RGBA(0, 0, 0, 0);
 
-                                out.insert(std::pair<Vector2i, HSVA>(pos, current));
-                            }
+                            out.insert(pos, current);
                         }
                     }
                 }
@@ -126,15 +142,11 @@ namespace mousetrap
         return &_proxy;
     }
 
-    void Canvas::UserInputLayer::on_area_resize(GLArea* area, int x, int y, UserInputLayer* instance)
+    void Canvas::UserInputLayer::set_canvas_size(Vector2f size)
     {
-        instance->_canvas_size = {x, y};
-
-        if (not area->get_is_realized())
-            return;
-
-        instance->_owner->set_canvas_size({x, y});
-        instance->update_cursor_pos();
+        _canvas_size = size;
+        _owner->set_canvas_size(size);
+        update_cursor_pos();
     }
 
     void Canvas::UserInputLayer::set_scale(float scale)
@@ -191,14 +203,12 @@ namespace mousetrap
         instance->update_cursor_pos();
         instance->_mouse_button_pressed = true;
 
-
         switch (active_state->get_current_tool())
         {
             case ToolID::BRUSH:
-                // handled in tick callback
-                return;
             case ToolID::ERASER:
-                // handled in tick callback
+                // drawing is handled in tick callback, all pixels of one stroke are undone together
+                active_state->begin_stroke();
                 return;
             case ToolID::BUCKET_FILL:
                 state::actions::canvas_apply_bucket_fill.activate();
@@ -220,7 +230,16 @@ namespace mousetrap
         instance->_absolute_widget_space_pos = {x, y};
         instance->update_cursor_pos();
         instance->_mouse_button_pressed = false;
-        instance->_stroke_points.clear();
+        instance->_stroke_mask.clear();
+        active_state->end_stroke();
+    }
+
+    void Canvas::UserInputLayer::on_click_cancelled(ClickEventController*, UserInputLayer* instance)
+    {
+        // no release will follow, e.g. because another gesture claimed the sequence or the grab was broken
+        instance->_mouse_button_pressed = false;
+        instance->_stroke_mask.clear();
+        active_state->end_stroke();
     }
 
     void Canvas::UserInputLayer::on_motion_enter(MotionEventController*, double x, double y, UserInputLayer* instance)
@@ -15,7 +15,7 @@ namespace mousetrap
         _area.connect_signal_render(on_area_render, this);
     }
 
-    Canvas::WireframeLayer::operator Widget*()
+    Canvas::WireframeLayer::operator RenderPass*()
     {
         return &_area;
     }
@@ -63,9 +63,8 @@ namespace mousetrap
         _area.queue_render();
     }
 
-    void Canvas::WireframeLayer::on_area_realize(Widget* widget, WireframeLayer* instance)
+    void Canvas::WireframeLayer::on_area_realize(RenderPass* area, WireframeLayer* instance)
     {
-        auto* area = (GLArea*) widget;
         area->make_current();
 
         instance->_render_texture_shape = new Shape();
@@ -78,22 +77,15 @@ namespace mousetrap
         // lines
 
         instance->_line_tool_shape = LineToolShape{
-            new Shape(),
-            new Shape(),
-            new Shape(),
-            new Shape(),
-            new Shape(),
             new Shape(),
             new Shape(),
             new Shape()
         };
 
+        instance->_line_tool_outline = new ShapeBatch();
+
         instance->_line_tool_render_tasks.clear();
-        instance->_line_tool_render_tasks.emplace_back(instance->_line_tool_shape.origin_anchor_inner_outline);
-        instance->_line_tool_render_tasks.emplace_back(instance->_line_tool_shape.origin_anchor_outer_outline);
-        instance->_line_tool_render_tasks.emplace_back(instance->_line_tool_shape.destination_anchor_inner_outline);
-        instance->_line_tool_render_tasks.emplace_back(instance->_line_tool_shape.destination_anchor_outer_outline);
-        instance->_line_tool_render_tasks.emplace_back(instance->_line_tool_shape.line_outline);
+        instance->_line_tool_render_tasks.emplace_back(instance->_line_tool_outline);
 
         instance->_line_tool_render_tasks.emplace_back(instance->_line_tool_shape.destination_anchor_shape);
         instance->_line_tool_render_tasks.emplace_back(instance->_line_tool_shape.origin_anchor_shape);
@@ -129,24 +121,20 @@ namespace mousetrap
             new Shape(),
             new Shape(),
             new Shape(),
-            new Shape(),
-            new Shape(),
-            new Shape(),
-            new Shape(),
             new Shape()
         };
 
+        instance->_rectangle_tool_outline = new ShapeBatch();
+        instance->_circle_tool_outline = new ShapeBatch();
+
         instance->_rectangle_tool_render_tasks.clear();
         instance->_circle_tool_render_tasks.clear();
 
-        for (auto* shape : {
-            instance->_rectangle_tool_shape.circle_inner_outline,
-            instance->_rectangle_tool_shape.circle_outer_outline,
-        })
-        {
-            instance->_circle_tool_render_tasks.emplace_back(shape);
-        }
-        
+        instance->_circle_tool_render_tasks.emplace_back(instance->_circle_tool_outline);
+
+        instance->_rectangle_tool_render_tasks.emplace_back(instance->_rectangle_tool_outline);
+        instance->_circle_tool_render_tasks.emplace_back(instance->_rectangle_tool_outline);
+
         for (auto* shape :  {
             /*
             instance->_rectangle_tool_shape.top_left_anchor_inner_outline,
@@ -176,8 +164,6 @@ namespace mousetrap
             instance->_rectangle_tool_shape.left_anchor_shape,
             instance->_rectangle_tool_shape.right_anchor_shape,
             instance->_rectangle_tool_shape.center_cross,
-            instance->_rectangle_tool_shape.rectangle_inner_outline,
-            instance->_rectangle_tool_shape.rectangle_outer_outline,
             instance->_rectangle_tool_shape.rectangle_shape,
         })
         {
@@ -185,19 +171,12 @@ namespace mousetrap
             instance->_circle_tool_render_tasks.emplace_back(shape);
         }
 
-        for (auto* shape : {
-            instance->_rectangle_tool_shape.circle_inner_outline,
-            instance->_rectangle_tool_shape.circle_outer_outline,
-            instance->_rectangle_tool_shape.circle
-        })
-        {
-            instance->_circle_tool_render_tasks.emplace_back(shape);
-        }
+        instance->_circle_tool_render_tasks.emplace_back(instance->_rectangle_tool_shape.circle);
 
         instance->reformat();
     }
 
-    void Canvas::WireframeLayer::on_area_resize(GLArea* area, int w, int h, WireframeLayer* instance)
+    void Canvas::WireframeLayer::on_area_resize(RenderPass* area, int w, int h, WireframeLayer* instance)
     {
         area->make_current();
 
@@ -282,23 +261,14 @@ namespace mousetrap
             std::vector<std::pair<Vector2f, Vector2f>> vertices;
 
             _line_tool_shape.origin_anchor_shape->as_wireframe(as_ellipse(origin, anchor_radius.x, anchor_radius.y, anchor_vertex_count));
-            _line_tool_shape.origin_anchor_inner_outline->as_wireframe(as_ellipse(origin, anchor_radius.x - x_eps, anchor_radius.y - y_eps, anchor_vertex_count));
-            _line_tool_shape.origin_anchor_outer_outline->as_wireframe(as_ellipse(origin, anchor_radius.x + x_eps, anchor_radius.y + y_eps, anchor_vertex_count));
-
             _line_tool_shape.destination_anchor_shape->as_wireframe(as_ellipse(destination, anchor_radius.x, anchor_radius.y, anchor_vertex_count));
-            _line_tool_shape.destination_anchor_inner_outline->as_wireframe(as_ellipse(destination, anchor_radius.x - x_eps, anchor_radius.y - y_eps, anchor_vertex_count));
-            _line_tool_shape.destination_anchor_outer_outline->as_wireframe(as_ellipse(destination, anchor_radius.x + x_eps, anchor_radius.y + y_eps, anchor_vertex_count));
-
             _line_tool_shape.line_shape->as_line(origin, destination);
 
-            for (auto* shape:{
-                    _line_tool_shape.origin_anchor_inner_outline,
-                    _line_tool_shape.origin_anchor_outer_outline,
-                    _line_tool_shape.destination_anchor_inner_outline,
-                    _line_tool_shape.destination_anchor_outer_outline,
-                    _line_tool_shape.line_outline
-            })
-                shape->set_color(outline_color);
+            _line_tool_outline->clear();
+            _line_tool_outline->add_line_loop(as_ellipse(origin, anchor_radius.x - x_eps, anchor_radius.y - y_eps, anchor_vertex_count), outline_color);
+            _line_tool_outline->add_line_loop(as_ellipse(origin, anchor_radius.x + x_eps, anchor_radius.y + y_eps, anchor_vertex_count), outline_color);
+            _line_tool_outline->add_line_loop(as_ellipse(destination, anchor_radius.x - x_eps, anchor_radius.y - y_eps, anchor_vertex_count), outline_color);
+            _line_tool_outline->add_line_loop(as_ellipse(destination, anchor_radius.x + x_eps, anchor_radius.y + y_eps, anchor_vertex_count), outline_color);
 
             for (auto* shape : {
                 _line_tool_shape.origin_anchor_shape,
@@ -322,7 +292,8 @@ namespace mousetrap
                         {origin + Vector2f(0, +y_eps), destination + Vector2f(0, +y_eps)}
                 };
 
-            _line_tool_shape.line_outline->as_lines(vertices);
+            _line_tool_outline->add_lines(vertices, outline_color);
+            _line_tool_outline->flush();
         }
 
         // rectangle
@@ -350,19 +321,23 @@ namespace mousetrap
                 a + Vector2f(0, height)
             });
 
-            _rectangle_tool_shape.rectangle_outer_outline->as_wireframe({
+            _rectangle_tool_outline->clear();
+
+            _rectangle_tool_outline->add_line_loop({
                 a + Vector2f(0 - x_eps, 0 - y_eps),
                 a + Vector2f(width + x_eps, 0 - y_eps),
                 a + Vector2f(width + x_eps, height + y_eps),
                 a + Vector2f(0 - x_eps, height + y_eps)
-            });
+            }, outline_color);
 
-            _rectangle_tool_shape.rectangle_inner_outline->as_wireframe({
+            _rectangle_tool_outline->add_line_loop({
                 a + Vector2f(0 + x_eps, 0 + y_eps),
                 a + Vector2f(width - x_eps, 0 + y_eps),
                 a + Vector2f(width - x_eps, height - y_eps),
                 a + Vector2f(0 + x_eps, height - y_eps)
-            });
+            }, outline_color);
+
+            _rectangle_tool_outline->flush();
 
             Vector2f top_left_anchor = a;
 
@@ -401,8 +376,11 @@ namespace mousetrap
             auto center = top_left_anchor + Vector2f(0.5 * width, 0.5 * height);
 
             _rectangle_tool_shape.circle->as_wireframe(as_ellipse(center, 0.5 * width, 0.5 * height, 64));
-            _rectangle_tool_shape.circle_inner_outline->as_wireframe(as_ellipse(center, 0.5 * width - x_eps, 0.5 * height - y_eps, 64));
-            _rectangle_tool_shape.circle_outer_outline->as_wireframe(as_ellipse(center, 0.5 * width + x_eps, 0.5 * height + y_eps, 64));
+
+            _circle_tool_outline->clear();
+            _circle_tool_outline->add_line_loop(as_ellipse(center, 0.5 * width - x_eps, 0.5 * height - y_eps, 64), outline_color);
+            _circle_tool_outline->add_line_loop(as_ellipse(center, 0.5 * width + x_eps, 0.5 * height + y_eps, 64), outline_color);
+            _circle_tool_outline->flush();
 
             float cross_w = anchor_radius.x;
             float cross_h = anchor_radius.y;
@@ -422,8 +400,6 @@ namespace mousetrap
             });
 
             for (auto* shape : {
-                _rectangle_tool_shape.rectangle_outer_outline,
-                _rectangle_tool_shape.rectangle_inner_outline,
                 _rectangle_tool_shape.top_left_anchor_inner_outline,
                 _rectangle_tool_shape.top_left_anchor_outer_outline,
                 _rectangle_tool_shape.top_right_anchor_inner_outline,
@@ -441,8 +417,6 @@ namespace mousetrap
                 _rectangle_tool_shape.left_anchor_inner_outline,
                 _rectangle_tool_shape.right_anchor_inner_outline,
                 _rectangle_tool_shape.center_cross_outline,
-                _rectangle_tool_shape.circle_inner_outline,
-                _rectangle_tool_shape.circle_outer_outline
             })
                 shape->set_color(outline_color);
 
@@ -517,7 +491,7 @@ namespace mousetrap
         if (_line_visible)
         {
             auto points = generate_line_points(_a, _b);
-            auto brush = active_state->get_current_brush()->get_image();
+            const auto& brush = active_state->get_current_brush()->get_image();
 
             for (auto p : points)
             {
@@ -535,7 +509,7 @@ namespace mousetrap
 
                         auto color = active_state->get_primary_color();
                         color.a = active_state->get_brush_opacity();
-                        out.insert(std::pair<Vector2i, HSVA>(pos, color));
+                        out.insert(pos, color);
                     }
                 }
             }
@@ -550,7 +524,7 @@ namespace mousetrap
                 std::min(_a.y, _b.y + height)
             );
 
-            auto brush = active_state->get_current_brush()->get_image();
+            const auto& brush = active_state->get_current_brush()->get_image();
             auto points = generate_rectangle_points(top_left, abs(width), abs(height));
 
             for (auto p : points)
@@ -569,7 +543,7 @@ namespace mousetrap
 
                         auto color = active_state->get_primary_color();
                         color.a = active_state->get_brush_opacity();
-                        out.insert(std::pair<Vector2i, HSVA>(pos, color));
+                        out.insert(pos, color);
                     }
                 }
             }
@@ -585,7 +559,7 @@ namespace mousetrap
                 std::min(_a.y, _b.y + height)
             );
 
-            auto brush = active_state->get_current_brush()->get_image();
+            const auto& brush = active_state->get_current_brush()->get_image();
             auto points = generate_circle_points(abs(width), abs(height));
 
             for (auto p : points)
@@ -605,7 +579,7 @@ namespace mousetrap
 
                         auto color = active_state->get_primary_color();
                         color.a = active_state->get_brush_opacity();
-                        out.insert(std::pair<Vector2i, HSVA>(pos, color));
+                        out.insert(pos, color);
                     }
                 }
             }
@@ -614,10 +588,8 @@ namespace mousetrap
         return out;
     }
 
-    bool Canvas::WireframeLayer::on_area_render(GLArea* area, GdkGLContext*, WireframeLayer* instance)
+    bool Canvas::WireframeLayer::on_area_render(RenderPass* area, GdkGLContext*, WireframeLayer* instance)
     {
-        area->make_current();
-
         instance->_render_texture.bind_as_rendertarget();
 
         glClearColor(0, 0, 0, 0);
@@ -641,13 +613,9 @@ namespace mousetrap
         }
 
         instance->_render_texture.unbind_as_rendertarget();
-
-        glClearColor(0, 0, 0, 0);
-        glClear(GL_COLOR_BUFFER_BIT);
+        area->bind_as_rendertarget();
 
         instance->_render_texture_task->render();
-
-        glFlush();
         return true;
     }
 
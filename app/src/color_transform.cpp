@@ -0,0 +1,272 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/24/23
+//
+
+#include <app/color_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        // c.f. rgba_to_hsva and hsva_to_rgba
+        static void apply_color_offset_scalar(uint8_t* pixel, const std::array<float, 7>& offset)
+        {
+            const float r = pixel[0] / 255.f;
+            const float g = pixel[1] / 255.f;
+            const float b = pixel[2] / 255.f;
+            const float a = pixel[3] / 255.f;
+
+            // rgb to hsv
+            const float max = std::max(std::max(r, g), b);
+            const float min = std::min(std::min(r, g), b);
+            const float delta = max - min;
+            const float safe_delta = delta > 0 ? delta : 1;
+
+            float hue = max == r ? (g - b) / safe_delta :
+                        max == g ? (b - r) / safe_delta + 2 :
+                                   (r - g) / safe_delta + 4;
+
+            hue = hue < 0 ? hue + 6 : hue;
+            float h = delta > 0 ? hue / 6 : 0;
+            float s = max > 0 ? delta / max : 1;
+            float v = max;
+
+            // offset hsv
+            h = h + offset[0];
+            h = h - std::floor(h);
+            s = std::clamp(s + offset[1], 0.f, 1.f);
+            v = std::clamp(v + offset[2], 0.f, 1.f);
+
+            // hsv to rgb: component(n) = v - v * s * clamp(min(k, 4 - k), 0, 1) with k = (n + 6h) mod 6
+            auto component = [&](float n) {
+                float k = n + h * 6;
+                k = k >= 6 ? k - 6 : k;
+                return v - v * s * std::clamp(std::min(k, 4 - k), 0.f, 1.f);
+            };
+
+            // offset rgba and pack
+            pixel[0] = uint8_t(std::clamp(component(5) + offset[3], 0.f, 1.f) * 255.f + 0.5f);
+            pixel[1] = uint8_t(std::clamp(component(3) + offset[4], 0.f, 1.f) * 255.f + 0.5f);
+            pixel[2] = uint8_t(std::clamp(component(1) + offset[5], 0.f, 1.f) * 255.f + 0.5f);
+            pixel[3] = uint8_t(std::clamp(a + offset[6], 0.f, 1.f) * 255.f + 0.5f);
+        }
+
+        #if defined(__SSE2__)
+        // same operations as apply_color_offset_scalar on 4 pixels, one per lane. Branches become masks, SSE2 has no blend or floor
+        static void apply_color_offset_sse2(uint8_t* pixels, const std::array<float, 7>& offset)
+        {
+            const auto zero = _mm_setzero_ps();
+            const auto one = _mm_set1_ps(1);
+            const auto six = _mm_set1_ps(6);
+
+            auto select = [](__m128 mask, __m128 if_true, __m128 if_false) {
+                return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false));
+            };
+
+            auto clamp = [&](__m128 x) {
+                return _mm_min_ps(_mm_max_ps(x, zero), one);
+            };
+
+            // valid for |x| < 2^31, hue is always well within that
+            auto floor = [&](__m128 x) {
+                auto truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+                return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, x), one));
+            };
+
+            const auto in = _mm_loadu_si128((const __m128i*) pixels);
+            const auto byte_mask = _mm_set1_epi32(0xFF);
+            auto unpack = [&](int shift) {
+                auto component = _mm_and_si128(_mm_srli_epi32(in, shift), byte_mask);
+                return _mm_div_ps(_mm_cvtepi32_ps(component), _mm_set1_ps(255.f));
+            };
+
+            const auto r = unpack(0);
+            const auto g = unpack(8);
+            const auto b = unpack(16);
+            const auto a = unpack(24);
+
+            // rgb to hsv
+            const auto max = _mm_max_ps(_mm_max_ps(r, g), b);
+            const auto min = _mm_min_ps(_mm_min_ps(r, g), b);
+            const auto delta = _mm_sub_ps(max, min);
+            const auto delta_positive = _mm_cmpgt_ps(delta, zero);
+            const auto safe_delta = select(delta_positive, delta, one);
+
+            const auto max_is_r = _mm_cmpeq_ps(max, r);
+            const auto max_is_g = _mm_cmpeq_ps(max, g);
+            auto hue = select(max_is_r, _mm_div_ps(_mm_sub_ps(g, b), safe_delta),
+                       select(max_is_g, _mm_add_ps(_mm_div_ps(_mm_sub_ps(b, r), safe_delta), _mm_set1_ps(2)),
+                                        _mm_add_ps(_mm_div_ps(_mm_sub_ps(r, g), safe_delta), _mm_set1_ps(4))));
+
+            hue = _mm_add_ps(hue, _mm_and_ps(_mm_cmplt_ps(hue, zero), six));
+            auto h = _mm_and_ps(delta_positive, _mm_div_ps(hue, six));
+
+            const auto max_positive = _mm_cmpgt_ps(max, zero);
+            auto s = select(max_positive, _mm_div_ps(delta, select(max_positive, max, one)), one);
+            auto v = max;
+
+            // offset hsv
+            h = _mm_add_ps(h, _mm_set1_ps(offset[0]));
+            h = _mm_sub_ps(h, floor(h));
+            s = clamp(_mm_add_ps(s, _mm_set1_ps(offset[1])));
+            v = clamp(_mm_add_ps(v, _mm_set1_ps(offset[2])));
+
+            // hsv to rgb
+            const auto v_s = _mm_mul_ps(v, s);
+            auto component = [&](float n) {
+                auto k = _mm_add_ps(_mm_set1_ps(n), _mm_mul_ps(h, six));
+                k = _mm_sub_ps(k, _mm_and_ps(_mm_cmpge_ps(k, six), six));
+                return _mm_sub_ps(v, _mm_mul_ps(v_s, clamp(_mm_min_ps(k, _mm_sub_ps(_mm_set1_ps(4), k)))));
+            };
+
+            // offset rgba and pack
+            auto pack = [&](__m128 x, float component_offset, int shift) {
+                x = clamp(_mm_add_ps(x, _mm_set1_ps(component_offset)));
+                x = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(255.f)), _mm_set1_ps(0.5f));
+                return _mm_slli_epi32(_mm_cvttps_epi32(x), shift);
+            };
+
+            auto out = pack(component(5), offset[3], 0);
+            out = _mm_or_si128(out, pack(component(3), offset[4], 8));
+            out = _mm_or_si128(out, pack(component(1), offset[5], 16));
+            out = _mm_or_si128(out, pack(a, offset[6], 24));
+            _mm_storeu_si128((__m128i*) pixels, out);
+        }
+        #endif
+    }
+
+    void apply_color_offset_rgba8(uint8_t* pixels, size_t n_pixels, const std::array<float, 7>& offset)
+    {
+        size_t i = 0;
+
+        #if defined(__SSE2__)
+        for (; i + 4 <= n_pixels; i += 4)
+            detail::apply_color_offset_sse2(pixels + i * 4, offset);
+        #endif
+
+        for (; i < n_pixels; ++i)
+            detail::apply_color_offset_scalar(pixels + i * 4, offset);
+    }
+
+    void invert_rgba8(uint8_t* pixels, size_t n_pixels)
+    {
+        // rgb = 255 - rgb = rgb ^ 0xFF, a = a
+        for (size_t i = 0; i < n_pixels * 4; i += 4)
+        {
+            pixels[i + 0] ^= 0xFF;
+            pixels[i + 1] ^= 0xFF;
+            pixels[i + 2] ^= 0xFF;
+        }
+    }
+
+    ColorTransformJob::ColorTransformJob(std::vector<Cell> cells, RowTransform transform)
+        : _cells(std::move(cells)), _transform(std::move(transform))
+    {
+        // results are allocated by the workers, so the calling thread only splits the cells into bands
+        _results.resize(_cells.size());
+        _results_prepared = std::make_unique<std::once_flag[]>(_cells.size());
+
+        for (size_t cell_i = 0; cell_i < _cells.size(); ++cell_i)
+        {
+            const auto size = _cells.at(cell_i).image->get_size();
+            for (size_t y = 0; y < size.y; y += band_height)
+                _bands.emplace_back(cell_i, y);
+
+            _n_rows += size.y;
+        }
+
+        const size_t n_threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, std::max<size_t>(_bands.size(), 1));
+        _n_active_workers = n_threads;
+
+        _workers.reserve(n_threads);
+        for (size_t i = 0; i < n_threads; ++i)
+            _workers.emplace_back(&ColorTransformJob::run, this);
+    }
+
+    ColorTransformJob::~ColorTransformJob()
+    {
+        cancel();
+        for (auto& worker : _workers)
+            worker.join();
+    }
+
+    void ColorTransformJob::prepare_result(size_t cell_i)
+    {
+        // copying writes every byte once, rows outside the region are already final afterwards
+        auto& result = _results.at(cell_i);
+        result = *_cells.at(cell_i).image;
+        result.set_format(ImageFormat::RGBA8);
+    }
+
+    void ColorTransformJob::run()
+    {
+        for (size_t band_i = _next_band++; band_i < _bands.size() and not _cancelled; band_i = _next_band++)
+        {
+            auto [cell_i, y_begin] = _bands.at(band_i);
+            std::call_once(_results_prepared[cell_i], &ColorTransformJob::prepare_result, this, cell_i);
+
+            const auto& cell = _cells.at(cell_i);
+            auto& result = _results.at(cell_i);
+
+            const auto size = result.get_size();
+            const size_t y_end = std::min<size_t>(y_begin + band_height, size.y);
+
+            // clip region to image
+            const int64_t x_min = std::max<int64_t>(cell.region_top_left.x, 0);
+            const int64_t x_max = std::min<int64_t>(cell.region_top_left.x + int64_t(cell.region_size.x), size.x);
+            const int64_t y_min = std::max<int64_t>(std::max<int64_t>(cell.region_top_left.y, 0), y_begin);
+            const int64_t y_max = std::min<int64_t>(std::min<int64_t>(cell.region_top_left.y + int64_t(cell.region_size.y), size.y), y_end);
+
+            if (x_min < x_max)
+                for (int64_t y = y_min; y < y_max; ++y)
+                    _transform(result.get_row(y).data() + x_min * 4, x_max - x_min);
+
+            _n_rows_done += y_end - y_begin;
+        }
+
+        _n_active_workers -= 1;
+    }
+
+    void ColorTransformJob::cancel()
+    {
+        _cancelled = true;
+    }
+
+    bool ColorTransformJob::get_is_cancelled() const
+    {
+        return _cancelled;
+    }
+
+    bool ColorTransformJob::get_is_done() const
+    {
+        return _n_active_workers == 0;
+    }
+
+    float ColorTransformJob::get_progress() const
+    {
+        return _n_rows == 0 ? 1 : _n_rows_done / float(_n_rows);
+    }
+
+    size_t ColorTransformJob::get_n_cells() const
+    {
+        return _cells.size();
+    }
+
+    Image& ColorTransformJob::get_result(size_t cell_i)
+    {
+        if (not get_is_done() or _cancelled)
+            std::cerr << "[WARNING] In ColorTransformJob::get_result: Job is not done or was cancelled, result is incomplete" << std::endl;
+
+        return _results.at(cell_i);
+    }
+}
@@ -199,13 +199,33 @@ namespace mousetrap
 
         _accept_button.connect_signal_clicked([](Button*, ColorTransformDialog* instance){
 
+            if (active_state->get_color_transform_active())
+                return;
+
             active_state->apply_color_offset();
 
-            instance->_dialog.close();
-            instance->reset();
+            if (active_state->get_color_transform_active())
+            {
+                // dialog stays open, so the preview is visible until the result is applied
+                instance->set_transform_running(true);
+                g_timeout_add(50, (GSourceFunc) G_CALLBACK(on_progress_timeout), instance);
+            }
+            else
+            {
+                instance->_dialog.close();
+                instance->reset();
+            }
         }, this);
 
         _cancel_button.connect_signal_clicked([](Button*, ColorTransformDialog* instance){
+
+            if (active_state->get_color_transform_active())
+            {
+                instance->_transform_cancelled = true;
+                active_state->cancel_color_transform();
+                return;
+            }
+
             instance->_dialog.close();
             instance->reset();
         }, this);
@@ -229,6 +249,10 @@ namespace mousetrap
         _button_box_spacer.set_hexpand(true);
         _button_box_spacer.set_opacity(0);
 
+        _progress_bar.set_margin_horizontal(state::margin_unit);
+        _progress_bar.set_visible(false);
+        _window_box.push_back(&_progress_bar);
+
         _button_box.set_margin(state::margin_unit);
         _cancel_button.set_margin_end(state::margin_unit);
 
@@ -350,6 +374,41 @@ namespace mousetrap
         update_preview();
     }
 
+    void ColorTransformDialog::set_transform_running(bool b)
+    {
+        _transform_cancelled = false;
+        _progress_bar.set_value(0);
+        _progress_bar.set_visible(b);
+
+        // offsets were already handed to the workers
+        for (auto* widget : std::vector<Widget*>{
+            &_h_offset_box, &_s_offset_box, &_v_offset_box, &_r_offset_box, &_g_offset_box, &_b_offset_box, &_a_offset_box,
+            &_apply_to_dropdown, &_accept_button, &_reset_button
+        })
+            widget->set_can_respond_to_input(not b);
+    }
+
+    gboolean ColorTransformDialog::on_progress_timeout(ColorTransformDialog* instance)
+    {
+        if (active_state->get_color_transform_active())
+        {
+            instance->_progress_bar.set_value(active_state->get_color_transform_progress());
+            return G_SOURCE_CONTINUE;
+        }
+
+        // keep offsets after cancelling, so they can be adjusted and applied again
+        bool cancelled = instance->_transform_cancelled;
+        instance->set_transform_running(false);
+
+        if (not cancelled)
+        {
+            instance->_dialog.close();
+            instance->reset();
+        }
+
+        return G_SOURCE_REMOVE;
+    }
+
     void ColorTransformDialog::reset()
     {
         set_h_offset(0);
@@ -0,0 +1,499 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/23/23
+//
+
+#include <app/compositor.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        // rows composited per work item
+        constexpr size_t compositor_band_height = 32;
+
+        struct CompositorCell
+        {
+            const Image* image; // nullptr for empty cells
+            Vector2i offset;
+            float opacity;
+            BlendMode blend_mode;
+        };
+
+        // threads are started once and shared by all callers, so concurrent exports do not multiply the number of threads
+        class CompositorPool
+        {
+            public:
+                static CompositorPool& get()
+                {
+                    static CompositorPool pool;
+                    return pool;
+                }
+
+                ~CompositorPool()
+                {
+                    {
+                        auto lock = std::unique_lock(_mutex);
+                        _should_exit = true;
+                    }
+
+                    _condition.notify_all();
+                    for (auto& worker : _workers)
+                        worker.join();
+                }
+
+                // calls task(i) for all i in [0, n), the calling thread works on its own job until all items are taken
+                void run(size_t n, const std::function<void(size_t)>& task)
+                {
+                    if (n == 0)
+                        return;
+
+                    auto job = Job{&task, n};
+                    {
+                        auto lock = std::unique_lock(_mutex);
+                        _jobs.push_back(&job);
+                    }
+                    _condition.notify_all();
+
+                    auto lock = std::unique_lock(_mutex);
+                    while (job.next < job.n)
+                    {
+                        const size_t i = job.next++;
+                        lock.unlock();
+                        task(i);
+                        lock.lock();
+                        job.n_done += 1;
+                    }
+
+                    // workers only access jobs that are queued, so it can be destroyed once it is dequeued and done
+                    auto it = std::find(_jobs.begin(), _jobs.end(), &job);
+                    if (it != _jobs.end())
+                        _jobs.erase(it);
+
+                    _job_done.wait(lock, [&](){
+                        return job.n_done == job.n;
+                    });
+                }
+
+            private:
+                CompositorPool()
+                {
+                    const size_t n_workers = std::max<size_t>(std::thread::hardware_concurrency(), 1) - 1;
+                    _workers.reserve(n_workers);
+                    for (size_t i = 0; i < n_workers; ++i)
+                        _workers.emplace_back([this](){
+                            work();
+                        });
+                }
+
+                struct Job
+                {
+                    const std::function<void(size_t)>* task;
+                    size_t n;
+                    size_t next = 0;
+                    size_t n_done = 0;
+                };
+
+                std::mutex _mutex;
+                std::condition_variable _condition;
+                std::condition_variable _job_done;
+                std::deque<Job*> _jobs;
+                bool _should_exit = false;
+                std::vector<std::thread> _workers;
+
+                void work()
+                {
+                    auto lock = std::unique_lock(_mutex);
+                    while (true)
+                    {
+                        _condition.wait(lock, [&](){
+                            return _should_exit or not _jobs.empty();
+                        });
+
+                        if (_should_exit)
+                            return;
+
+                        auto* job = _jobs.front();
+                        if (job->next >= job->n)
+                        {
+                            _jobs.pop_front();
+                            continue;
+                        }
+
+                        const size_t i = job->next++;
+                        lock.unlock();
+                        (*job->task)(i);
+                        lock.lock();
+
+                        job->n_done += 1;
+                        if (job->n_done == job->n)
+                            _job_done.notify_all();
+                    }
+                }
+        };
+
+        // calls task(i) for all i in [0, n), spread across all cores
+        template<typename Task_t>
+        void parallel_for(size_t n, Task_t task)
+        {
+            CompositorPool::get().run(n, std::function<void(size_t)>(task));
+        }
+
+        // c.f. ProjectState::get_cell_texture
+        size_t get_keyframe_index(const ProjectSnapshot::LayerSnapshot& layer, size_t frame_i)
+        {
+            while (frame_i > 0 and not layer.frames.at(frame_i).is_keyframe)
+                frame_i -= 1;
+
+            return frame_i;
+        }
+
+        // read row y of the layer, in layer coordinates, as RGBA32F with opacity applied to alpha
+        void load_row(const CompositorCell& cell, size_t y, size_t width, float* out)
+        {
+            std::fill(out, out + width * 4, 0.f);
+
+            if (cell.image == nullptr)
+                return;
+
+            // layer(x, y) = image(x + offset.x, y + offset.y)
+            const auto image_size = cell.image->get_size();
+            const int64_t image_y = int64_t(y) + cell.offset.y;
+            if (image_y < 0 or image_y >= int64_t(image_size.y))
+                return;
+
+            const size_t x_begin = std::clamp<int64_t>(-cell.offset.x, 0, width);
+            const size_t x_end = std::clamp<int64_t>(int64_t(image_size.x) - cell.offset.x, 0, width);
+            if (x_begin >= x_end)
+                return;
+
+            const auto row = cell.image->get_row(image_y);
+            const size_t image_x_begin = x_begin + cell.offset.x;
+
+            if (cell.image->get_format() == ImageFormat::RGBA8)
+            {
+                const uint8_t* in = row.data() + image_x_begin * 4;
+                for (size_t i = 0; i < (x_end - x_begin) * 4; ++i)
+                    out[x_begin * 4 + i] = in[i] / 255.f;
+            }
+            else
+                std::memcpy(out + x_begin * 4, row.data() + image_x_begin * 4 * sizeof(float), (x_end - x_begin) * 4 * sizeof(float));
+
+            if (cell.opacity != 1)
+                for (size_t x = x_begin; x < x_end; ++x)
+                    out[x * 4 + 3] *= cell.opacity;
+        }
+
+        void composite_rows(const std::vector<CompositorCell>& cells, size_t y_begin, size_t y_end, Image& out)
+        {
+            const size_t width = out.get_size().x;
+            std::vector<float> destination(width * 4);
+            std::vector<float> source(width * 4);
+
+            for (size_t y = y_begin; y < y_end; ++y)
+            {
+                std::fill(destination.begin(), destination.end(), 0.f);
+
+                for (auto& cell : cells)
+                {
+                    load_row(cell, y, width, source.data());
+                    blend_row(destination.data(), source.data(), width, cell.blend_mode);
+                }
+
+                // framebuffer is float, so intermediate results are only clamped once converted
+                auto* row = out.get_row(y).data();
+                for (size_t i = 0; i < width * 4; ++i)
+                    row[i] = uint8_t(std::clamp(destination[i], 0.f, 1.f) * 255.f + 0.5f);
+            }
+        }
+
+        std::vector<Image> composite(const ProjectSnapshot& snapshot, const std::set<size_t>& layer_is, size_t first_frame_i, size_t n_frames)
+        {
+            std::vector<size_t> used_layer_is;
+            for (size_t layer_i : layer_is)
+                if (layer_i < snapshot.layers.size() and snapshot.layers.at(layer_i).is_visible)
+                    used_layer_is.push_back(layer_i);
+
+            // decode each cell at most once, cells are held for all frames until the next keyframe
+            std::vector<std::vector<std::shared_ptr<const Image>>> images(snapshot.layers.size());
+            std::vector<std::pair<size_t, size_t>> to_load;
+            for (size_t layer_i : used_layer_is)
+            {
+                const auto& layer = snapshot.layers.at(layer_i);
+                images.at(layer_i).resize(layer.frames.size());
+
+                for (size_t frame_i = first_frame_i; frame_i < first_frame_i + n_frames; ++frame_i)
+                {
+                    auto keyframe_i = get_keyframe_index(layer, frame_i);
+                    const auto& frame = layer.frames.at(keyframe_i);
+
+                    if (frame.image != nullptr)
+                        images.at(layer_i).at(keyframe_i) = frame.image;
+                    else if (frame.loader and (to_load.empty() or to_load.back() != std::make_pair(layer_i, keyframe_i)))
+                        to_load.emplace_back(layer_i, keyframe_i);
+                }
+            }
+
+            parallel_for(to_load.size(), [&](size_t i){
+                auto [layer_i, frame_i] = to_load.at(i);
+                images.at(layer_i).at(frame_i) = std::make_shared<const Image>(snapshot.layers.at(layer_i).frames.at(frame_i).loader());
+            });
+
+            std::vector<Image> out;
+            std::vector<std::vector<CompositorCell>> cells;
+            out.reserve(n_frames);
+            cells.reserve(n_frames);
+
+            for (size_t frame_i = first_frame_i; frame_i < first_frame_i + n_frames; ++frame_i)
+            {
+                auto& image = out.emplace_back(ImageFormat::RGBA8);
+                image.create(snapshot.layer_resolution.x, snapshot.layer_resolution.y, RGBA(0, 0, 0, 0));
+
+                auto& frame_cells = cells.emplace_back();
+                for (size_t layer_i : used_layer_is)
+                {
+                    const auto& layer = snapshot.layers.at(layer_i);
+                    auto keyframe_i = get_keyframe_index(layer, frame_i);
+                    frame_cells.push_back({
+                        images.at(layer_i).at(keyframe_i).get(),
+                        layer.frames.at(keyframe_i).offset,
+                        layer.opacity,
+                        layer.blend_mode
+                    });
+                }
+            }
+
+            const size_t n_bands = (snapshot.layer_resolution.y + compositor_band_height - 1) / compositor_band_height;
+            parallel_for(n_frames * n_bands, [&](size_t i){
+                const size_t frame_i = i / n_bands;
+                const size_t y_begin = (i % n_bands) * compositor_band_height;
+                const size_t y_end = std::min<size_t>(y_begin + compositor_band_height, snapshot.layer_resolution.y);
+                composite_rows(cells.at(frame_i), y_begin, y_end, out.at(frame_i));
+            });
+
+            return out;
+        }
+
+        std::set<size_t> get_all_layers(const ProjectSnapshot& snapshot)
+        {
+            std::set<size_t> out;
+            for (size_t i = 0; i < snapshot.layers.size(); ++i)
+                out.insert(i);
+
+            return out;
+        }
+
+        size_t get_n_frames(const ProjectSnapshot& snapshot)
+        {
+            return snapshot.layers.empty() ? 0 : snapshot.layers.front().frames.size();
+        }
+    }
+
+    void blend_row(float* destination, const float* source, size_t n_pixels, BlendMode blend_mode)
+    {
+        // mode is resolved once per row, so each loop is branchless and operates on whole pixels at once
+        // c.f. set_current_blend_mode for the equations, S: source, D: destination
+
+        float* d = destination;
+        const float* s = source;
+        const size_t n = n_pixels * 4;
+
+        #if defined(__SSE2__)
+
+        // one pixel per register. With S' = (S.rgb, 1), the equations that scale S by S.a are the same for all four components
+        const auto one = _mm_set1_ps(1);
+        const auto rgb_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+        const auto alpha_one = _mm_setr_ps(0, 0, 0, 1);
+
+        auto load_source = [&](size_t i, __m128& s_prime, __m128& a) {
+            const auto pixel = _mm_loadu_ps(s + i);
+            a = _mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3));
+            s_prime = _mm_or_ps(_mm_and_ps(pixel, rgb_mask), alpha_one);
+        };
+
+        __m128 s_prime, a;
+        switch (blend_mode)
+        {
+            case NORMAL:
+                // O = S.a * S' + (1 - S.a) * D
+                for (size_t i = 0; i < n; i += 4)
+                {
+                    load_source(i, s_prime, a);
+                    const auto scaled = _mm_mul_ps(a, s_prime);
+                    _mm_storeu_ps(d + i, _mm_add_ps(scaled, _mm_mul_ps(_mm_sub_ps(one, a), _mm_loadu_ps(d + i))));
+                }
+                break;
+
+            case ADD:
+                // O = S.a * S' + D
+                for (size_t i = 0; i < n; i += 4)
+                {
+                    load_source(i, s_prime, a);
+                    _mm_storeu_ps(d + i, _mm_add_ps(_mm_loadu_ps(d + i), _mm_mul_ps(a, s_prime)));
+                }
+                break;
+
+            case SUBTRACT:
+                // O = D - S.a * S'
+                for (size_t i = 0; i < n; i += 4)
+                {
+                    load_source(i, s_prime, a);
+                    _mm_storeu_ps(d + i, _mm_sub_ps(_mm_loadu_ps(d + i), _mm_mul_ps(a, s_prime)));
+                }
+                break;
+
+            case REVERSE_SUBTRACT:
+                // O = S.a * S' - D
+                for (size_t i = 0; i < n; i += 4)
+                {
+                    load_source(i, s_prime, a);
+                    _mm_storeu_ps(d + i, _mm_sub_ps(_mm_mul_ps(a, s_prime), _mm_loadu_ps(d + i)));
+                }
+                break;
+
+            case MULTIPLY:
+                // O = S * D
+                for (size_t i = 0; i < n; i += 4)
+                    _mm_storeu_ps(d + i, _mm_mul_ps(_mm_loadu_ps(s + i), _mm_loadu_ps(d + i)));
+                break;
+
+            case MIN:
+                // O = min(S, D)
+                for (size_t i = 0; i < n; i += 4)
+                    _mm_storeu_ps(d + i, _mm_min_ps(_mm_loadu_ps(s + i), _mm_loadu_ps(d + i)));
+                break;
+
+            case MAX:
+                // O = max(S, D)
+                for (size_t i = 0; i < n; i += 4)
+                    _mm_storeu_ps(d + i, _mm_max_ps(_mm_loadu_ps(s + i), _mm_loadu_ps(d + i)));
+                break;
+
+            case NONE:
+            default:
+                std::memcpy(d, s, n * sizeof(float));
+                break;
+        }
+
+        #else
+        switch (blend_mode)
+        {
+            case NORMAL:
+                // O.rgb = S.a * S.rgb + (1 - S.a) * D.rgb
+                // O.a = S.a + (1 - S.a) * D.a
+                for (size_t i = 0; i < n; i += 4)
+                {
+                    const float a = s[i + 3];
+                    d[i + 0] = a * s[i + 0] + (1 - a) * d[i + 0];
+                    d[i + 1] = a * s[i + 1] + (1 - a) * d[i + 1];
+                    d[i + 2] = a * s[i + 2] + (1 - a) * d[i + 2];
+                    d[i + 3] = a + (1 - a) * d[i + 3];
+                }
+                break;
+
+            case ADD:
+                // O.rgb = S.a * S.rgb + D.rgb
+                // O.a = S.a + D.a
+                for (size_t i = 0; i < n; i += 4)
+                {
+                    const float a = s[i + 3];
+                    d[i + 0] += a * s[i + 0];
+                    d[i + 1] += a * s[i + 1];
+                    d[i + 2] += a * s[i + 2];
+                    d[i + 3] += a;
+                }
+                break;
+
+            case SUBTRACT:
+                // O.rgb = D.rgb - S.a * S.rgb
+                // O.a = D.a - S.a
+                for (size_t i = 0; i < n; i += 4)
+                {
+                    const float a = s[i + 3];
+                    d[i + 0] -= a * s[i + 0];
+                    d[i + 1] -= a * s[i + 1];
+                    d[i + 2] -= a * s[i + 2];
+                    d[i + 3] -= a;
+                }
+                break;
+
+            case REVERSE_SUBTRACT:
+                // O.rgb = S.a * S.rgb - D.rgb
+                // O.a = S.a - D.a
+                for (size_t i = 0; i < n; i += 4)
+                {
+                    const float a = s[i + 3];
+                    d[i + 0] = a * s[i + 0] - d[i + 0];
+                    d[i + 1] = a * s[i + 1] - d[i + 1];
+                    d[i + 2] = a * s[i + 2] - d[i + 2];
+                    d[i + 3] = a - d[i + 3];
+                }
+                break;
+
+            case MULTIPLY:
+                // O = S * D
+                for (size_t i = 0; i < n; ++i)
+                    d[i] *= s[i];
+                break;
+
+            case MIN:
+                // O = min(S, D)
+                for (size_t i = 0; i < n; ++i)
+                    d[i] = std::min(s[i], d[i]);
+                break;
+
+            case MAX:
+                // O = max(S, D)
+                for (size_t i = 0; i < n; ++i)
+                    d[i] = std::max(s[i], d[i]);
+                break;
+
+            case NONE:
+            default:
+                std::memcpy(d, s, n * sizeof(float));
+                break;
+        }
+
+        #endif
+    }
+
+    Image composite_frame(const ProjectSnapshot& snapshot, const std::set<size_t>& layer_is, size_t frame_i)
+    {
+        if (frame_i >= detail::get_n_frames(snapshot))
+        {
+            std::cerr << "[ERROR] In composite_frame: Frame index " << frame_i << " out of bounds for project with " << detail::get_n_frames(snapshot) << " frames" << std::endl;
+            auto out = Image(ImageFormat::RGBA8);
+            out.create(snapshot.layer_resolution.x, snapshot.layer_resolution.y, RGBA(0, 0, 0, 0));
+            return out;
+        }
+
+        return std::move(detail::composite(snapshot, layer_is, frame_i, 1).front());
+    }
+
+    Image composite_frame(const ProjectSnapshot& snapshot, size_t frame_i)
+    {
+        return composite_frame(snapshot, detail::get_all_layers(snapshot), frame_i);
+    }
+
+    std::vector<Image> composite_frames(const ProjectSnapshot& snapshot, const std::set<size_t>& layer_is)
+    {
+        return detail::composite(snapshot, layer_is, 0, detail::get_n_frames(snapshot));
+    }
+
+    std::vector<Image> composite_frames(const ProjectSnapshot& snapshot)
+    {
+        return composite_frames(snapshot, detail::get_all_layers(snapshot));
+    }
+}
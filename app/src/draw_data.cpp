@@ -0,0 +1,131 @@
+#include <app/draw_data.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace mousetrap
+{
+    Vector2i DrawData::Entry::get_position() const
+    {
+        return unpack_position(position);
+    }
+
+    RGBA DrawData::Entry::get_color() const
+    {
+        return unpack_color(color);
+    }
+
+    uint64_t DrawData::pack_position(Vector2i position)
+    {
+        return (uint64_t(uint32_t(position.y)) << 32) | uint64_t(uint32_t(position.x));
+    }
+
+    Vector2i DrawData::unpack_position(uint64_t position)
+    {
+        return Vector2i(int64_t(position & 0xFFFFFFFF), int64_t(position >> 32));
+    }
+
+    uint32_t DrawData::pack_color(RGBA color)
+    {
+        auto to_byte = [](float x) -> uint8_t {
+            return uint8_t(glm::clamp<float>(x, 0, 1) * 255.f + 0.5f);
+        };
+
+        uint8_t bytes[4] = {to_byte(color.r), to_byte(color.g), to_byte(color.b), to_byte(color.a)};
+        uint32_t out;
+        std::memcpy(&out, bytes, 4);
+        return out;
+    }
+
+    RGBA DrawData::unpack_color(uint32_t color)
+    {
+        uint8_t bytes[4];
+        std::memcpy(bytes, &color, 4);
+        return RGBA(bytes[0] / 255.f, bytes[1] / 255.f, bytes[2] / 255.f, bytes[3] / 255.f);
+    }
+
+    void DrawData::insert(Vector2i position, RGBA color)
+    {
+        if (position.x < 0 or position.y < 0)
+            return;
+
+        auto key = pack_position(position);
+
+        if (not _entries.empty())
+        {
+            auto last = _entries.back().position;
+            if (key == last)
+            {
+                _entries.back().color = pack_color(color);
+                return;
+            }
+
+            if (key < last)
+                _is_normalized = false;
+        }
+
+        _entries.push_back(Entry{key, pack_color(color)});
+    }
+
+    void DrawData::reserve(size_t n)
+    {
+        _entries.reserve(n);
+    }
+
+    void DrawData::clear()
+    {
+        _entries.clear();
+        _is_normalized = true;
+    }
+
+    void DrawData::normalize() const
+    {
+        if (_is_normalized)
+            return;
+
+        // stable so the color inserted last at a position survives deduplication, as if the pixels were painted in order
+        std::stable_sort(_entries.begin(), _entries.end(), [](const Entry& a, const Entry& b){
+            return a.position < b.position;
+        });
+
+        size_t n = 0;
+        for (size_t i = 0; i < _entries.size(); ++i)
+        {
+            if (n > 0 and _entries[n - 1].position == _entries[i].position)
+                _entries[n - 1].color = _entries[i].color;
+            else
+                _entries[n++] = _entries[i];
+        }
+        _entries.resize(n);
+        _is_normalized = true;
+    }
+
+    size_t DrawData::size() const
+    {
+        normalize();
+        return _entries.size();
+    }
+
+    bool DrawData::empty() const
+    {
+        return _entries.empty();
+    }
+
+    const std::vector<DrawData::Entry>& DrawData::get_entries() const
+    {
+        normalize();
+        return _entries;
+    }
+
+    std::vector<DrawData::Entry>::const_iterator DrawData::begin() const
+    {
+        normalize();
+        return _entries.cbegin();
+    }
+
+    std::vector<DrawData::Entry>::const_iterator DrawData::end() const
+    {
+        normalize();
+        return _entries.cend();
+    }
+}
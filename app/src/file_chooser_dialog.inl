@@ -32,6 +32,12 @@ namespace mousetrap
         _window.set_child(&_main);
     }
 
+    inline FilePreview::~FilePreview()
+    {
+        if (_preview_request != 0 and state::image_decode_service != nullptr)
+            state::image_decode_service->cancel(_preview_request);
+    }
+
     inline FilePreview::operator Widget*()
     {
         return &_window;
@@ -49,37 +55,48 @@ namespace mousetrap
         if (_file == nullptr)
             return;
 
-        auto* pixbuf_maybe = gdk_pixbuf_new_from_file(_file->get_path().c_str(), nullptr);
-
+        // show content type icon until the file is decoded, non-images keep it
         _icon_image_box.clear();
-        if (pixbuf_maybe != nullptr)
+        _icon_image = nullptr;
+
+        auto* icon = g_content_type_get_icon(_file->query_info(G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE).c_str());
+        if (icon != nullptr)
+        {
+            _icon_image = GTK_IMAGE(gtk_image_new_from_gicon(G_ICON(icon)));
+            gtk_widget_set_halign(GTK_WIDGET(_icon_image), GTK_ALIGN_CENTER);
+            gtk_image_set_pixel_size(_icon_image, preview_icon_pixel_size_factor * state::margin_unit);
+            gtk_box_append(_icon_image_box.operator GtkBox*(), GTK_WIDGET(_icon_image));
+            g_object_unref(icon);
+        }
+
+        if (_preview_request != 0 and state::image_decode_service != nullptr)
+            state::image_decode_service->cancel(_preview_request);
+
+        const size_t target_width = preview_icon_pixel_size_factor * state::margin_unit;
+        auto on_decoded = [this](Image&& preview)
         {
-            auto target_width = preview_icon_pixel_size_factor * state::margin_unit;
-            auto target_height = (gdk_pixbuf_get_height(pixbuf_maybe) / float(gdk_pixbuf_get_width(pixbuf_maybe))) * target_width;
+            _preview_request = 0;
+
+            auto size = preview.get_size();
+            if (size.x == 0 or size.y == 0)
+                return;
+
+            auto* texture = preview.move_to_texture();
 
-            auto* pixbuf_scaled = gdk_pixbuf_scale_simple(pixbuf_maybe, target_width, target_height, GDK_INTERP_NEAREST);
-            _icon_image = GTK_IMAGE(gtk_image_new_from_pixbuf(pixbuf_scaled));
+            _icon_image_box.clear();
+            _icon_image = GTK_IMAGE(gtk_image_new_from_paintable(GDK_PAINTABLE(texture)));
+            g_object_unref(texture);
 
-            gtk_widget_set_size_request(GTK_WIDGET(_icon_image), target_width, target_height);
+            gtk_widget_set_size_request(GTK_WIDGET(_icon_image), size.x, size.y);
             gtk_widget_set_halign(GTK_WIDGET(_icon_image), GTK_ALIGN_CENTER);
             gtk_box_append(_icon_image_box.operator GtkBox*(), GTK_WIDGET(_icon_image));
+        };
 
-            g_object_unref(pixbuf_maybe);
-            g_object_unref(pixbuf_scaled);
-        }
+        // service does not exist yet or was already shut down
+        if (state::image_decode_service != nullptr)
+            _preview_request = state::image_decode_service->queue(_file->get_path(), on_decoded, target_width);
         else
-        {
-            //auto* info = g_file_query_info(_file->operator GFile*(), G_FILE_ATTRIBUTE_PREVIEW_ICON, G_FILE_QUERY_INFO_NONE, nullptr, nullptr);
-            auto* icon = g_content_type_get_icon(_file->query_info(G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE).c_str());
-
-            if (icon != nullptr)
-            {
-                _icon_image = GTK_IMAGE(gtk_image_new_from_gicon(G_ICON(icon)));
-                gtk_widget_set_halign(GTK_WIDGET(_icon_image), GTK_ALIGN_CENTER);
-                gtk_image_set_pixel_size(_icon_image, preview_icon_pixel_size_factor * state::margin_unit);
-                gtk_box_append(_icon_image_box.operator GtkBox*(), GTK_WIDGET(_icon_image));
-            }
-        }
+            on_decoded(ImageDecodeService::decode(_file->get_path(), target_width));
 
         std::stringstream file_name_text;
         file_name_text << "<span weight=\"bold\" size=\"100%\">"
@@ -6,100 +6,68 @@
 
 namespace mousetrap
 {
-    FrameView::FramePreview::FramePreview(FrameView* owner)
-        : _owner(owner), _aspect_frame(active_state->get_layer_resolution().x / float(active_state->get_layer_resolution().y))
+    FrameView::CellGrid::CellGrid(FrameView* owner)
+        : _owner(owner)
     {
         _area.connect_signal_realize(on_realize, this);
         _area.connect_signal_resize(on_resize, this);
+        _area.connect_signal_render(on_render, this);
+        _area.set_expand(true);
 
-        _aspect_frame.set_child(&_area);
-
-        _inbetween_indicator.set_size_request(_inbetween_indicator.get_size());
-        _inbetween_indicator.set_expand(false);
-        _inbetween_indicator.set_align(GTK_ALIGN_CENTER);
-
-        set_preview_size(owner->_preview_size);
-        _inbetween_label_overlay.set_child(&_aspect_frame);
-        _inbetween_label_overlay.add_overlay(&_inbetween_indicator);
-    }
-
-    FrameView::FramePreview::~FramePreview()
-    {
-        delete _transparency_tiling_shape;
-        delete _layer_shape;
-        delete _negative_overlay;
-    }
-
-    void FrameView::FramePreview::set_preview_size(size_t px)
-    {
-        auto resolution = active_state->get_layer_resolution();
-        float height, width;
+        _h_scrollbar.set_adjustment(_h_adjustment);
+        _v_scrollbar.set_adjustment(_v_adjustment);
 
-        if (resolution.x <= resolution.y)
+        for (auto* adjustment : {&_h_adjustment, &_v_adjustment})
         {
-            height = px;
-            width = (resolution.x / float(resolution.y)) * height;
-        }
-        else
-        {
-            width = px;
-            height = (resolution.y / float(resolution.x)) * width;
+            adjustment->connect_signal_value_changed([](Adjustment*, CellGrid* instance){
+                instance->update_labels();
+                instance->queue_render();
+            }, this);
         }
 
-        _area.set_size_request({width, height});
+        _click_controller.connect_signal_click_pressed(on_click_pressed, this);
+        _scroll_controller.connect_signal_scroll(on_scroll, this);
+        _area.add_controller(&_click_controller);
+        _area.add_controller(&_scroll_controller);
 
-        _area.set_expand(true);
-        _area.set_align(GTK_ALIGN_CENTER);
-        if (active_state->get_layer_resolution().x > active_state->get_layer_resolution().y)
-            _area.set_hexpand(false);
-        else if (active_state->get_layer_resolution().y > active_state->get_layer_resolution().x)
-            _area.set_vexpand(false);
-    }
+        const float label_column_width = 3 * state::margin_unit;
+        _layer_label_fixed.set_size_request({label_column_width, 0});
+        _frame_label_corner.set_size_request({label_column_width, 0});
+        _frame_label_fixed.set_size_request({0, 2 * state::margin_unit});
+        _frame_label_fixed.set_hexpand(true);
 
-    void FrameView::FramePreview::set_is_inbetween(bool b)
-    {
-        _is_inbetween = b;
+        _frame_label_box.push_back(&_frame_label_corner);
+        _frame_label_box.push_back(&_frame_label_fixed);
 
-        _inbetween_indicator.set_visible(b);
-
-        if (_negative_overlay)
-            _negative_overlay->set_visible(b);
-    }
-
-    void FrameView::FramePreview::set_opacity(float x)
-    {
-        if (_layer_shape != nullptr)
-            _layer_shape->set_color(RGBA(1, 1, 1, x));
+        _area_box.push_back(&_layer_label_fixed);
+        _area_box.push_back(&_area);
+        _area_box.push_back(&_v_scrollbar);
 
-        _area.queue_render();
-    }
+        _main.push_back(&_frame_label_box);
+        _main.push_back(&_area_box);
+        _main.push_back(&_h_scrollbar);
+        _main.set_homogeneous(false);
 
-    void FrameView::FramePreview::set_visible(bool b)
-    {
-        _area.set_opacity(b ? 1 : state::settings_file->get_value_as<float>("layer_view", "hidden_layer_opacity"));
-        _area.queue_render();
+        set_preview_size(owner->_preview_size);
     }
 
-    void FrameView::FramePreview::set_selected(bool b)
+    FrameView::CellGrid::~CellGrid()
     {
-        // noop
-    }
+        for (auto* batch : {_background_batch, _preview_batch, _inbetween_batch, _inbetween_indicator_batch, _selection_batch})
+            delete batch;
 
-    void FrameView::FramePreview::set_texture(const Texture* texture)
-    {
-        _texture = texture;
-        if (_layer_shape != nullptr)
-            _layer_shape->set_texture(_texture);
+        delete _inbetween_indicator_texture;
 
-        _area.queue_render();
+        if (_atlas != nullptr)
+            _atlas->remove_requirements(this);
     }
 
-    FrameView::FramePreview::operator Widget*()
+    FrameView::CellGrid::operator Widget*()
     {
-        return &_inbetween_label_overlay;
+        return &_main;
     }
 
-    void FrameView::FramePreview::on_realize(Widget* widget, FramePreview* instance)
+    void FrameView::CellGrid::on_realize(Widget* widget, CellGrid* instance)
     {
         auto* area = (GLArea*) widget;
         area->make_current();
@@ -110,194 +78,392 @@ namespace mousetrap
             _transparency_tiling_shader->create_from_file(get_resource_path() + "shaders/transparency_tiling.frag", ShaderType::FRAGMENT);
         }
 
-        instance->_transparency_tiling_shape = new Shape();
-        instance->_layer_shape = new Shape();
-
-        for (auto* shape : {instance->_transparency_tiling_shape, instance->_layer_shape})
-            shape->as_rectangle({0, 0}, {1, 1});
+        instance->_atlas = state::thumbnail_atlas;
 
+        instance->_inbetween_indicator_texture = new Texture();
+        instance->_inbetween_indicator_texture->create_from_file(get_resource_path() + "icons/inbetween_indicator.png");
 
-        if (instance->_texture != nullptr)
-            instance->_layer_shape->set_texture(instance->_texture);
+        instance->_background_batch = new ShapeBatch(ShapeBatchType::RECTANGLES);
+        instance->_preview_batch = new ShapeBatch(ShapeBatchType::RECTANGLES);
+        instance->_inbetween_batch = new ShapeBatch(ShapeBatchType::RECTANGLES);
+        instance->_inbetween_indicator_batch = new ShapeBatch(ShapeBatchType::RECTANGLES);
+        instance->_selection_batch = new ShapeBatch(ShapeBatchType::LINES);
 
-        instance->_negative_overlay = new Shape();
-        instance->_negative_overlay->as_rectangle({-0.5, -0.5}, {2.0, 2.0});
-        instance->_negative_overlay->set_color(RGBA(0, 0, 0, 0));
-        instance->_negative_overlay->set_visible(false);
+        instance->_preview_batch->set_texture(instance->_atlas->get_texture());
+        instance->_inbetween_indicator_batch->set_texture(instance->_inbetween_indicator_texture);
 
-        area->clear_render_tasks();
+        instance->_render_tasks.clear();
 
-        auto transparency_task = RenderTask(instance->_transparency_tiling_shape, _transparency_tiling_shader);
-        transparency_task.register_vec2("_canvas_size", &instance->_canvas_size);
+        auto& background_task = instance->_render_tasks.emplace_back(instance->_background_batch, _transparency_tiling_shader);
+        background_task.register_vec2("_canvas_size", instance->_canvas_size);
 
-        area->add_render_task(transparency_task);
-        area->add_render_task(instance->_layer_shape);
-
-        auto task = RenderTask(instance->_negative_overlay, nullptr, nullptr, BlendMode::MULTIPLY);
-        area->add_render_task(task);
+        instance->_render_tasks.emplace_back(instance->_preview_batch);
+        instance->_render_tasks.emplace_back(instance->_inbetween_batch, nullptr, nullptr, BlendMode::MULTIPLY);
+        instance->_render_tasks.emplace_back(instance->_inbetween_indicator_batch);
+        instance->_render_tasks.emplace_back(instance->_selection_batch);
 
+        instance->update_adjustments();
+        instance->update_labels();
         area->queue_render();
     }
 
-    void FrameView::FramePreview::on_resize(GLArea* area, int w, int h, FramePreview* instance)
+    void FrameView::CellGrid::on_resize(GLArea* area, int w, int h, CellGrid* instance)
     {
-        instance->_canvas_size = {w, h};
-        instance->_area.queue_render();
+        *instance->_canvas_size = {w, h};
+        instance->update_adjustments();
+        instance->update_labels();
+        instance->queue_render();
     }
 
-    void FrameView::FramePreview::set_resolution(Vector2ui resolution)
+    Vector2f FrameView::CellGrid::get_stride() const
     {
-        _aspect_frame.set_ratio(resolution.x / float(resolution.y));
+        return {_cell_size.x + _cell_spacing, _cell_size.y + _cell_spacing};
     }
 
-    FrameView::FrameColumn::PreviewElement::PreviewElement(FrameView* owner)
-        :  _preview(owner),
-          _wrapper(GTK_ORIENTATION_HORIZONTAL, GTK_SELECTION_NONE),
-          _wrapper_box(GTK_ORIENTATION_HORIZONTAL)
+    std::pair<Vector2ui, Vector2ui> FrameView::CellGrid::get_visible_range() const
     {
-        _frame_label.set_visible(false);
-        _layer_label.set_margin_horizontal(state::margin_unit);
+        const auto stride = get_stride();
+        const auto offset = Vector2f(_h_adjustment.get_value(), _v_adjustment.get_value());
+        const auto n = Vector2ui(active_state->get_n_frames(), active_state->get_n_layers());
+
+        Vector2ui first = {
+            std::min<size_t>(std::max<float>(offset.x, 0) / stride.x, n.x),
+            std::min<size_t>(std::max<float>(offset.y, 0) / stride.y, n.y)
+        };
 
-        _frame.set_label_align(0.5);
-        _frame.set_child(_preview);
-        _frame.set_label_widget(&_frame_label);
+        Vector2ui last = {
+            std::min<size_t>(std::ceil((offset.x + _canvas_size->x) / stride.x), n.x),
+            std::min<size_t>(std::ceil((offset.y + _canvas_size->y) / stride.y), n.y)
+        };
 
-        _layer_label_spacer.set_size_request({state::margin_unit / 10 * 4, 0});
-        _layer_label_spacer.set_margin_horizontal((state::margin_unit / 10 * 4) / 2);
-        _wrapper_box.push_back(&_layer_label);
-        _wrapper_box.push_back(&_layer_label_spacer);
-        _wrapper_box.push_back(&_frame);
-        _wrapper.push_back(&_wrapper_box);
+        return {first, last};
     }
 
-    void FrameView::FrameColumn::PreviewElement::set_layer_frame_index(size_t layer_i, size_t frame_i)
+    void FrameView::CellGrid::update_adjustments()
     {
-        _frame_label.set_text(std::string("<tt>") + (frame_i < 10 ? "00" : (frame_i < 100 ? "0" : "")) + std::to_string(frame_i) + "</tt>");
-        _layer_label.set_text(std::string("<tt><span size=\"120%\">") + (frame_i < 10 ? "0" : "") + std::to_string(layer_i) + "</span></tt>");
+        const auto stride = get_stride();
 
-        _preview.set_texture(active_state->get_frame(layer_i, frame_i)->get_texture());
-        _layer_label_spacer.set_visible(frame_i == 0);
-        _layer_label.set_visible(frame_i == 0);
-    }
+        auto update = [](Adjustment& adjustment, float content_size, float page_size, float step)
+        {
+            adjustment.set_upper(content_size);
+            adjustment.set_page_size(page_size);
+            adjustment.set_page_increment(page_size);
+            adjustment.set_step_increment(step);
 
-    FrameView::FrameColumn::PreviewElement::operator Widget*()
-    {
-        return &_wrapper;
-    }
+            // re-clamp value to the new range
+            adjustment.set_value(std::min(adjustment.get_value(), std::max<float>(content_size - page_size, 0)));
+        };
 
-    void FrameView::FrameColumn::PreviewElement::set_resolution(Vector2ui resolution)
-    {
-        _preview.set_resolution(resolution);
+        update(_h_adjustment, active_state->get_n_frames() * stride.x, _canvas_size->x, stride.x);
+        update(_v_adjustment, active_state->get_n_layers() * stride.y, _canvas_size->y, stride.y);
     }
 
-    void FrameView::FrameColumn::PreviewElement::set_preview_size(size_t x)
+    void FrameView::CellGrid::update_labels()
     {
-        _preview.set_preview_size(x);
+        const auto stride = get_stride();
+        const auto offset = Vector2f(_h_adjustment.get_value(), _v_adjustment.get_value());
+        const auto range = get_visible_range();
+        const auto first = range.first;
+        const auto last = range.second;
+
+        // skip labels of columns that are too narrow to fit the text
+        const size_t label_every_nth = std::max<size_t>(std::ceil(3 * state::margin_unit / stride.x), 1);
+
+        const size_t n_columns = last.x - first.x;
+        while (_frame_labels.size() < n_columns)
+        {
+            auto& label = _frame_labels.emplace_back();
+            _frame_label_fixed.add_child(&label, {0, 0});
+        }
+
+        for (size_t i = 0; i < _frame_labels.size(); ++i)
+        {
+            auto& label = _frame_labels.at(i);
+            const size_t frame_i = first.x + i;
+            const float x = frame_i * stride.x - offset.x + 0.5 * _cell_spacing;
+
+            if (i >= n_columns or x < 0 or frame_i % label_every_nth != 0)
+            {
+                label.set_visible(false);
+                continue;
+            }
+
+            label.set_text(std::string("<tt>") + (frame_i < 10 ? "00" : (frame_i < 100 ? "0" : "")) + std::to_string(frame_i) + "</tt>");
+            label.set_visible(true);
+            _frame_label_fixed.set_child_position(&label, {x, 0});
+        }
+
+        const size_t n_layers = active_state->get_n_layers();
+        const size_t n_rows = last.y - first.y;
+        while (_layer_labels.size() < n_rows)
+        {
+            auto& label = _layer_labels.emplace_back();
+            _layer_label_fixed.add_child(&label, {0, 0});
+        }
+
+        for (size_t i = 0; i < _layer_labels.size(); ++i)
+        {
+            auto& label = _layer_labels.at(i);
+            const size_t row = first.y + i;
+            const float y = row * stride.y - offset.y + 0.5 * _cell_spacing + 0.5 * _cell_size.y - state::margin_unit;
+
+            if (i >= n_rows or y < 0)
+            {
+                label.set_visible(false);
+                continue;
+            }
+
+            const size_t layer_i = n_layers - 1 - row;
+            label.set_text(std::string("<tt><span size=\"120%\">") + (layer_i < 10 ? "0" : "") + std::to_string(layer_i) + "</span></tt>");
+            label.set_visible(true);
+            _layer_label_fixed.set_child_position(&label, {state::margin_unit / 2, y});
+        }
     }
 
-    void FrameView::FrameColumn::PreviewElement::set_opacity(float x)
+    void FrameView::CellGrid::scroll_to_selection()
     {
-        _preview.set_opacity(x);
+        const auto stride = get_stride();
+        const size_t row = active_state->get_n_layers() - 1 - _selected_layer_i;
+
+        auto scroll_to = [](Adjustment& adjustment, float begin, float end)
+        {
+            if (begin < adjustment.get_value())
+                adjustment.set_value(begin);
+            else if (end > adjustment.get_value() + adjustment.get_page_size())
+                adjustment.set_value(end - adjustment.get_page_size());
+        };
+
+        scroll_to(_h_adjustment, _selected_frame_i * stride.x, (_selected_frame_i + 1) * stride.x);
+        scroll_to(_v_adjustment, row * stride.y, (row + 1) * stride.y);
     }
 
-    void FrameView::FrameColumn::PreviewElement::set_visible(bool x)
+    void FrameView::CellGrid::set_preview_size(size_t px)
     {
-        _preview.set_visible(x);
+        auto resolution = active_state->get_layer_resolution();
+        float height, width;
+
+        if (resolution.x <= resolution.y)
+        {
+            height = px;
+            width = (resolution.x / float(resolution.y)) * height;
+        }
+        else
+        {
+            width = px;
+            height = (resolution.y / float(resolution.x)) * width;
+        }
+
+        _cell_size = {std::max<size_t>(width, 1), std::max<size_t>(height, 1)};
+
+        update_adjustments();
+        update_labels();
+        queue_render();
     }
 
-    void FrameView::FrameColumn::PreviewElement::set_is_inbetween(bool b)
+    void FrameView::CellGrid::set_selection(size_t layer_i, size_t frame_i)
     {
-        _preview.set_is_inbetween(b);
+        _selected_layer_i = layer_i;
+        _selected_frame_i = frame_i;
+
+        scroll_to_selection();
+        queue_render();
     }
 
-    void FrameView::FrameColumn::PreviewElement::set_selected(bool b)
+    void FrameView::CellGrid::invalidate(const signals::CellInvalidation& cells)
     {
-        _frame_label.set_visible(b);
-        _preview.set_selected(b);
+        if (cells.get_is_all())
+        {
+            invalidate_all();
+            return;
+        }
+
+        if (_atlas != nullptr)
+            for (auto& pair : cells.get_cells())
+                _atlas->invalidate({pair.first.first, pair.first.second});
+
+        // cells keep their tile, so only the previews are re-rendered and the batches stay as they are
+        _area.queue_render();
     }
 
-    FrameView::FrameColumn::FrameColumn::FrameColumn(FrameView* owner, size_t frame_i)
-        : _owner(owner), _frame_i(frame_i)
+    void FrameView::CellGrid::invalidate_all()
     {
-        set_n_layers(active_state->get_n_layers());
-        _list_view.set_show_separators(true);
-        _list_view.get_selection_model()->connect_signal_selection_changed([](SelectionModel*, size_t i, size_t n_items, FrameColumn* instance){
-            active_state->set_current_layer_and_frame(instance->_list_view.get_n_items() - i - 1, instance->_frame_i);
-        }, this);
+        if (_atlas != nullptr)
+            _atlas->invalidate_all();
+
+        _area.queue_render();
     }
 
-    FrameView::FrameColumn::operator Widget*()
+    void FrameView::CellGrid::on_cells_changed()
     {
-        return &_list_view;
+        if (_atlas != nullptr)
+            _atlas->clear();
+
+        update_adjustments();
+        update_labels();
+        queue_render();
     }
 
-    void FrameView::FrameColumn::set_resolution(Vector2ui resolution)
+    void FrameView::CellGrid::queue_render()
     {
-        for (auto& element : _preview_elements)
-            element.set_resolution(resolution);
+        _batches_outdated = true;
+        _area.queue_render();
     }
 
-    void FrameView::FrameColumn::set_n_layers(size_t n)
+    gboolean FrameView::CellGrid::on_render(GLArea* area, GdkGLContext*, CellGrid* instance)
     {
-        _list_view.clear();
+        area->make_current();
 
-        while (_preview_elements.size() < n)
-            _preview_elements.emplace_back(_owner);
+        glClearColor(0, 0, 0, 0);
+        glClear(GL_COLOR_BUFFER_BIT);
 
-        for (size_t i = 0; i < _preview_elements.size(); ++i)
+        if (instance->_atlas == nullptr)
+            return TRUE;
+
+        const auto range = instance->get_visible_range();
+        auto* atlas = instance->_atlas;
+
+        atlas->set_requirements(instance, instance->_cell_size, (range.second.x - range.first.x) * (range.second.y - range.first.y));
+
+        const size_t n_layers = active_state->get_n_layers();
+
+        if (not instance->_batches_outdated)
         {
-            auto& element = _preview_elements.at(i);
-            element.set_layer_frame_index(i, _frame_i);
-            _list_view.push_front(element);
-
-            auto* layer = active_state->get_layer(i);
-            element.set_visible(layer->get_is_visible());
-            element.set_opacity(layer->get_opacity());
-            element.set_is_inbetween(not layer->get_frame(_frame_i)->get_is_keyframe());
+            // re-render invalidated previews, geometry only has to be uploaded again if one of them moved to another tile
+            for (size_t row = range.first.y; row < range.second.y; ++row)
+                for (size_t frame_i = range.first.x; frame_i < range.second.x; ++frame_i)
+                    atlas->request({n_layers - 1 - row, frame_i});
+
+            if (atlas->get_layout_revision() != instance->_batches_layout_revision)
+                instance->_batches_outdated = true;
         }
+
+        if (instance->_batches_outdated)
+            instance->update_batches(range);
+
+        glEnable(GL_BLEND);
+        for (auto& task : instance->_render_tasks)
+            task.render();
+
+        glFlush();
+        return TRUE;
     }
 
-    void FrameView::FrameColumn::set_frame(size_t i)
+    void FrameView::CellGrid::update_batches(std::pair<Vector2ui, Vector2ui> range)
     {
-        _frame_i = i;
-
-        for (size_t i = 0; i < _preview_elements.size(); ++i)
+        const auto stride = get_stride();
+        const auto offset = Vector2f(_h_adjustment.get_value(), _v_adjustment.get_value());
+        const auto canvas_size = *_canvas_size;
+        const auto cell_size = Vector2f(_cell_size);
+
+        // pixels to area coordinates
+        auto to_area = [&](Vector2f px) -> Vector2f {
+            return {px.x / canvas_size.x, px.y / canvas_size.y};
+        };
+
+        auto add_outline = [&](Vector2f top_left, Vector2f bottom_right, RGBA color){
+            _selection_batch->add_line_loop({
+                to_area(top_left),
+                to_area({bottom_right.x, top_left.y}),
+                to_area(bottom_right),
+                to_area({top_left.x, bottom_right.y})
+            }, color);
+        };
+
+        for (auto* batch : {_background_batch, _preview_batch, _inbetween_batch, _inbetween_indicator_batch, _selection_batch})
+            batch->clear();
+
+        const float hidden_opacity = state::settings_file->get_value_as<float>("frame_view", "hidden_layer_opacity");
+        const auto indicator_size = glm::min(Vector2f(_inbetween_indicator_texture->get_size()), cell_size);
+        const size_t n_layers = active_state->get_n_layers();
+
+        // previews are requested first, so every cell of this batch has its final tile
+        for (size_t row = range.first.y; row < range.second.y; ++row)
+            for (size_t frame_i = range.first.x; frame_i < range.second.x; ++frame_i)
+                _atlas->request({n_layers - 1 - row, frame_i});
+
+        _batches_layout_revision = _atlas->get_layout_revision();
+
+        for (size_t row = range.first.y; row < range.second.y; ++row)
         {
-            auto& element = _preview_elements.at(i);
-            element.set_layer_frame_index(i, _frame_i);
+            const size_t layer_i = n_layers - 1 - row;
+            const auto* layer = active_state->get_layer(layer_i);
+            const float visibility = layer->get_is_visible() ? 1 : hidden_opacity;
+
+            for (size_t frame_i = range.first.x; frame_i < range.second.x; ++frame_i)
+            {
+                const auto top_left = Vector2f(
+                    frame_i * stride.x - offset.x + 0.5 * _cell_spacing,
+                    row * stride.y - offset.y + 0.5 * _cell_spacing
+                );
+
+                const auto texture_region = _atlas->request({layer_i, frame_i});
+
+                _background_batch->add_rectangle(to_area(top_left), to_area(cell_size), RGBA(1, 1, 1, visibility));
+                _preview_batch->add_rectangle(
+                    to_area(top_left),
+                    to_area(cell_size),
+                    RGBA(1, 1, 1, visibility * layer->get_opacity()),
+                    texture_region.top_left,
+                    texture_region.size
+                );
+
+                if (not layer->get_frame(frame_i)->get_is_keyframe())
+                {
+                    _inbetween_batch->add_rectangle(to_area(top_left), to_area(cell_size), RGBA(1 - visibility, 1 - visibility, 1 - visibility, 1));
+                    _inbetween_indicator_batch->add_rectangle(
+                        to_area(top_left + 0.5f * (cell_size - indicator_size)),
+                        to_area(indicator_size),
+                        RGBA(1, 1, 1, visibility)
+                    );
+                }
+
+                if (layer_i == _selected_layer_i and frame_i == _selected_frame_i)
+                {
+                    // lines at half pixels so they cover exactly one pixel
+                    add_outline(top_left - Vector2f(0.5), top_left + cell_size + Vector2f(0.5), RGBA(0, 0, 0, 1));
+                    add_outline(top_left + Vector2f(0.5), top_left + cell_size - Vector2f(0.5), RGBA(1, 1, 1, 1));
+                }
+            }
         }
-    }
 
-    void FrameView::FrameColumn::set_preview_size(size_t size)
-    {
-        for (auto& preview : _preview_elements)
-            preview.set_preview_size(size);
-    }
+        for (auto* batch : {_background_batch, _preview_batch, _inbetween_batch, _inbetween_indicator_batch, _selection_batch})
+            batch->flush();
 
-    void FrameView::FrameColumn::set_is_inbetween(size_t i, bool b)
-    {
-        auto& element = _preview_elements.at(i);
-        element.set_is_inbetween(b);
+        _batches_outdated = false;
     }
 
-    void FrameView::FrameColumn::select_layer(size_t i)
+    void FrameView::CellGrid::on_click_pressed(ClickEventController*, size_t n, double x, double y, CellGrid* instance)
     {
-        for (size_t preview_i = 0; preview_i < _preview_elements.size(); ++preview_i)
-            _preview_elements.at(preview_i).set_selected(preview_i == i);
+        const auto stride = instance->get_stride();
+        const auto position = Vector2f(
+            x + instance->_h_adjustment.get_value(),
+            y + instance->_v_adjustment.get_value()
+        );
 
-        _list_view.get_selection_model()->set_signal_selection_changed_blocked(true);
-        _list_view.get_selection_model()->select(_list_view.get_n_items() - i - 1);
-        _list_view.get_selection_model()->set_signal_selection_changed_blocked(false);
-    }
+        if (position.x < 0 or position.y < 0)
+            return;
 
-    void FrameView::FrameColumn::set_layer_opacity(size_t i, float v)
-    {
-        _preview_elements.at(i).set_opacity(v);
+        const size_t frame_i = position.x / stride.x;
+        const size_t row = position.y / stride.y;
+
+        if (frame_i >= active_state->get_n_frames() or row >= active_state->get_n_layers())
+            return;
+
+        active_state->set_current_layer_and_frame(active_state->get_n_layers() - 1 - row, frame_i);
     }
 
-    void FrameView::FrameColumn::set_layer_visible(size_t i, bool v)
+    void FrameView::CellGrid::on_scroll(ScrollEventController*, double x, double y, CellGrid* instance)
     {
-        _preview_elements.at(i).set_visible(v);
+        const auto stride = instance->get_stride();
+        auto& h = instance->_h_adjustment;
+        auto& v = instance->_v_adjustment;
+
+        // scroll through frames with a regular mouse wheel if all layers already fit
+        if (x == 0 and v.get_upper() <= v.get_page_size())
+            std::swap(x, y);
+
+        h.set_value(h.get_value() + x * stride.x);
+        v.set_value(v.get_value() + y * stride.y);
     }
 
     FrameView::ControlBar::ControlBar(FrameView* owner)
@@ -855,24 +1021,11 @@ namespace mousetrap
 
     FrameView::FrameView()
     {
-        on_layer_count_changed();
-
-        _frame_column_list_view.get_selection_model()->connect_signal_selection_changed([](SelectionModel*, size_t i, size_t n_items, FrameView* instance){
-            active_state->set_current_layer_and_frame(instance->_selected_layer_i, i);
-        }, this);
-
-        _frame_column_list_view.set_expand(false);
-        _frame_colum_list_view_window_spacer.set_expand(true);
-        _frame_column_list_view_window.set_expand(true);
-
-        _frame_colum_list_view_window_box.push_back(&_frame_column_list_view);
-        _frame_colum_list_view_window_box.push_back(&_frame_colum_list_view_window_spacer);
-
-        _frame_column_list_view_window.set_child(&_frame_colum_list_view_window_box);
         _main.push_back(_control_bar);
-        _main.push_back(&_frame_column_list_view_window);
-
+        _main.push_back(_cell_grid);
         _main.set_homogeneous(false);
+
+        on_layer_count_changed();
     }
 
     FrameView::operator Widget*()
@@ -884,33 +1037,18 @@ namespace mousetrap
     {
         _selected_layer_i = layer_i;
         _selected_frame_i = frame_i;
-
-        for (auto& column : _frame_columns)
-            column.select_layer(layer_i);
-
-        _frame_column_list_view.get_selection_model()->set_signal_selection_changed_blocked(true);
-        _frame_column_list_view.get_selection_model()->select(frame_i);
-        _frame_column_list_view.get_selection_model()->set_signal_selection_changed_blocked(false);
+        _cell_grid.set_selection(layer_i, frame_i);
     }
 
     void FrameView::set_preview_size(size_t x)
     {
         _preview_size = x;
-
-        for (auto& column : _frame_columns)
-            column.set_preview_size(_preview_size);
+        _cell_grid.set_preview_size(_preview_size);
     }
 
     void FrameView::on_layer_count_changed()
     {
-        _frame_column_list_view.clear();
-        _frame_columns.clear();
-
-        for (size_t i = 0; i < active_state->get_n_frames(); ++i)
-        {
-            auto& column = _frame_columns.emplace_back(this, i);
-            _frame_column_list_view.push_back(column);
-        }
+        _cell_grid.on_cells_changed();
 
         state::actions::frame_view_frame_delete.set_enabled(active_state->get_n_frames() > 1);
         on_layer_properties_changed();
@@ -943,25 +1081,15 @@ namespace mousetrap
         frame_view_swap_with_cell_after.set_enabled(frame_i < active_state->get_n_frames() - 1);
     }
 
-    void FrameView::on_layer_image_updated()
+    void FrameView::on_layer_image_updated(const signals::CellInvalidation& cells)
     {
-        for (size_t i = 0; i < active_state->get_n_frames(); ++i)
-            _frame_columns.at(i).set_frame(i);
+        _cell_grid.invalidate(cells);
     }
 
     void FrameView::on_layer_properties_changed()
     {
-        for (size_t frame_i = 0; frame_i < active_state->get_n_frames(); ++frame_i)
-        {
-            auto& column = _frame_columns.at(frame_i);
-            for (size_t layer_i = 0; layer_i < active_state->get_n_layers(); ++layer_i)
-            {
-                auto* layer = active_state->get_layer(layer_i);
-                column.set_layer_visible(layer_i, layer->get_is_visible());
-                column.set_layer_opacity(layer_i, layer->get_opacity());
-                column.set_is_inbetween(layer_i, not layer->get_frame(frame_i)->get_is_keyframe());
-            }
-        }
+        // visibility, opacity and keyframe state are read while rendering
+        _cell_grid.queue_render();
 
         auto* current = active_state->get_current_frame();
         _control_bar.set_is_keyframe(current->get_is_keyframe());
@@ -982,9 +1110,7 @@ namespace mousetrap
 
     void FrameView::on_layer_resolution_changed()
     {
-        for (auto& column : _frame_columns)
-            column.set_resolution(active_state->get_layer_resolution());
-
+        _cell_grid.invalidate_all();
         set_preview_size(_preview_size);
     }
 
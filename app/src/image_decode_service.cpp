@@ -0,0 +1,184 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/25/23
+//
+
+#include <app/image_decode_service.hpp>
+
+#include <algorithm>
+
+namespace mousetrap
+{
+    ImageDecodeService::ImageDecodeService(size_t n_threads)
+    {
+        if (n_threads == 0)
+            n_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+        _workers.reserve(n_threads);
+        for (size_t i = 0; i < n_threads; ++i)
+            _workers.emplace_back([this](){
+                run();
+            });
+    }
+
+    ImageDecodeService::~ImageDecodeService()
+    {
+        {
+            auto lock = std::unique_lock(_mutex);
+            _should_exit = true;
+            _queued.clear();
+        }
+
+        _condition.notify_all();
+        for (auto& worker : _workers)
+            worker.join();
+
+        if (_dispatch_source != 0)
+            g_source_remove(_dispatch_source);
+    }
+
+    ImageDecodeService::RequestID ImageDecodeService::queue(const std::string& path, OnDecoded on_decoded, size_t scale_to_width)
+    {
+        auto id = _next_id++;
+        _callbacks.insert({id, std::move(on_decoded)});
+
+        {
+            auto lock = std::unique_lock(_mutex);
+            _queued.push_back({id, path, scale_to_width});
+        }
+
+        _condition.notify_one();
+        return id;
+    }
+
+    void ImageDecodeService::cancel(RequestID id)
+    {
+        if (_callbacks.erase(id) == 0)
+            return;
+
+        // files that are already being decoded finish, their result is dropped on delivery
+        auto lock = std::unique_lock(_mutex);
+        auto it = std::find_if(_queued.begin(), _queued.end(), [id](const Request& request){
+            return request.id == id;
+        });
+
+        if (it != _queued.end())
+            _queued.erase(it);
+    }
+
+    void ImageDecodeService::cancel_all()
+    {
+        _callbacks.clear();
+
+        auto lock = std::unique_lock(_mutex);
+        _queued.clear();
+        _decoded.clear();
+    }
+
+    size_t ImageDecodeService::get_n_pending() const
+    {
+        return _callbacks.size();
+    }
+
+    void ImageDecodeService::run()
+    {
+        while (true)
+        {
+            Request request;
+
+            {
+                auto lock = std::unique_lock(_mutex);
+                _condition.wait(lock, [&](){
+                    return _should_exit or not _queued.empty();
+                });
+
+                if (_should_exit)
+                    return;
+
+                request = std::move(_queued.front());
+                _queued.pop_front();
+            }
+
+            auto image = decode(request.path, request.scale_to_width);
+
+            auto lock = std::unique_lock(_mutex);
+            _decoded.push_back({request.id, std::move(image)});
+
+            if (_dispatch_source == 0)
+                _dispatch_source = g_idle_add((GSourceFunc) G_CALLBACK(on_dispatch), this);
+        }
+    }
+
+    gboolean ImageDecodeService::on_dispatch(ImageDecodeService* instance)
+    {
+        // deliver in batches, so many small files do not block the main loop for long
+        std::vector<Result> results;
+        bool done;
+
+        {
+            auto lock = std::unique_lock(instance->_mutex);
+            while (not instance->_decoded.empty() and results.size() < max_n_delivered_per_dispatch)
+            {
+                results.push_back(std::move(instance->_decoded.front()));
+                instance->_decoded.pop_front();
+            }
+
+            done = instance->_decoded.empty();
+            if (done)
+                instance->_dispatch_source = 0;
+        }
+
+        for (auto& result : results)
+        {
+            auto it = instance->_callbacks.find(result.id);
+            if (it == instance->_callbacks.end())
+                continue;
+
+            // callback may queue or cancel requests itself
+            auto on_decoded = std::move(it->second);
+            instance->_callbacks.erase(it);
+            on_decoded(std::move(result.image));
+        }
+
+        return done ? G_SOURCE_REMOVE : G_SOURCE_CONTINUE;
+    }
+
+    Image ImageDecodeService::decode(const std::string& path, size_t scale_to_width)
+    {
+        auto* pixbuf = gdk_pixbuf_new_from_file(path.c_str(), nullptr);
+        if (pixbuf == nullptr)
+            return Image();
+
+        const size_t width = gdk_pixbuf_get_width(pixbuf);
+        const size_t height = gdk_pixbuf_get_height(pixbuf);
+
+        auto out = Image();
+        if (scale_to_width == 0 or scale_to_width == width)
+        {
+            out.create_from_pixbuf(pixbuf);
+            g_object_unref(pixbuf);
+            return out;
+        }
+
+        // scale straight into image storage, instead of into an intermediate pixbuf that is then copied
+        const size_t scaled_height = std::max<size_t>((height / float(width)) * scale_to_width, 1);
+        out.create(scale_to_width, scaled_height, RGBA(0, 0, 0, 0));
+
+        auto* destination = gdk_pixbuf_new_from_data(
+            static_cast<guchar*>(out.data()),
+            GDK_COLORSPACE_RGB, true, 8,
+            scale_to_width, scaled_height, scale_to_width * 4,
+            nullptr, nullptr
+        );
+
+        gdk_pixbuf_scale(
+            pixbuf, destination,
+            0, 0, scale_to_width, scaled_height,
+            0, 0, scale_to_width / double(width), scaled_height / double(height),
+            GDK_INTERP_NEAREST
+        );
+
+        g_object_unref(destination);
+        g_object_unref(pixbuf);
+        return out;
+    }
+}
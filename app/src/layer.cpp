@@ -2,10 +2,12 @@
 #include <app/algorithms.hpp>
 #include <app/project_state.hpp>
 
+#include <cstring>
+
 namespace mousetrap
 {
     Layer::Frame::Frame()
-        : _image(new Image()), _texture(new Texture()), _size(0, 0)
+        : _image(std::make_shared<Image>()), _texture(new Texture()), _size(0, 0)
     {}
 
     Layer::Frame::Frame(Vector2i size)
@@ -19,83 +21,100 @@ namespace mousetrap
     Layer::Frame::Frame(const Frame& other)
         : Frame::Frame()
     {
-        _image->create(other._image->get_size().x, other._image->get_size().y);
-        for (size_t x = 0; x < other._image->get_size().x; ++x)
-            for (size_t y = 0; y < other._image->get_size().y; ++y)
-                _image->set_pixel(x, y, other._image->get_pixel(x, y));
+        if (other._texture_read_back)
+            other.read_back_texture();
 
-        _texture->create_from_image(*_image);
+        // pixels are shared until either frame is modified
+        _image = other._image;
+        _is_keyframe = other._is_keyframe;
+        _offset = other._offset;
+        _size = other._size;
+        _image_loader = other._image_loader;
+        _unloaded_image_size = other._unloaded_image_size;
+
+        mark_all_dirty();
+        update_texture();
+
+        // identical content
+        _revision = other._revision;
     }
 
     Layer::Frame& Layer::Frame::operator=(const Frame& other)
     {
-        if (_image == nullptr)
-            _image = new Image();
+        if (&other == this)
+            return *this;
 
         if (_texture == nullptr)
             _texture = new Texture();
 
-        _image->create(other._image->get_size().x, other._image->get_size().y);
-        for (size_t x = 0; x < other._image->get_size().x; ++x)
-            for (size_t y = 0; y < other._image->get_size().y; ++y)
-                _image->set_pixel(x, y, other._image->get_pixel(x, y));
+        if (other._texture_read_back)
+            other.read_back_texture();
 
-        _texture->create_from_image(*_image);
+        _texture_read_back = nullptr;
+        _image = other._image;
+        _is_keyframe = other._is_keyframe;
+        _offset = other._offset;
+        _size = other._size;
+        _image_loader = other._image_loader;
+        _unloaded_image_size = other._unloaded_image_size;
+
+        mark_all_dirty();
+        update_texture();
+
+        _revision = other._revision;
         return *this;
     }
 
     Layer::Frame::Frame(Frame&& other)
-            : _image(new Image()), _texture(new Texture())
+        : _image(std::move(other._image)),
+          _texture(other._texture),
+          _is_keyframe(other._is_keyframe),
+          _image_loader(std::move(other._image_loader)),
+          _unloaded_image_size(other._unloaded_image_size),
+          _texture_read_back(std::move(other._texture_read_back)),
+          _revision(other._revision),
+          _offset(other._offset),
+          _size(other._size),
+          _dirty_top_left(other._dirty_top_left),
+          _dirty_bottom_right(other._dirty_bottom_right),
+          _texture_needs_full_update(other._texture_needs_full_update)
     {
-        if (_image == nullptr)
-            _image = new Image();
-
-        if (_texture == nullptr)
-            _texture = new Texture();
-
-        _image->create(other._image->get_size().x, other._image->get_size().y);
-        for (size_t x = 0; x < other._image->get_size().x; ++x)
-            for (size_t y = 0; y < other._image->get_size().y; ++y)
-                _image->set_pixel(x, y, other._image->get_pixel(x, y));
-
-        _texture->create_from_image(*_image);
-
-        delete other._image;
-        other._image = nullptr;
-        delete other._texture;
         other._texture = nullptr;
     }
 
     Layer::Frame& Layer::Frame::operator=(Frame&& other)
     {
-        if (_image == nullptr)
-            _image = new Image();
-
-        if (_texture == nullptr)
-            _texture = new Texture();
+        if (&other == this)
+            return *this;
 
-        _image->create(other._image->get_size().x, other._image->get_size().y);
-        for (size_t x = 0; x < other._image->get_size().x; ++x)
-            for (size_t y = 0; y < other._image->get_size().y; ++y)
-                _image->set_pixel(x, y, other._image->get_pixel(x, y));
+        delete _texture;
 
-        _texture->create_from_image(*_image);
+        _image = std::move(other._image);
+        _texture = other._texture;
+        _is_keyframe = other._is_keyframe;
+        _offset = other._offset;
+        _size = other._size;
+        _image_loader = std::move(other._image_loader);
+        _unloaded_image_size = other._unloaded_image_size;
+        _texture_read_back = std::move(other._texture_read_back);
+        _revision = other._revision;
+        _dirty_top_left = other._dirty_top_left;
+        _dirty_bottom_right = other._dirty_bottom_right;
+        _texture_needs_full_update = other._texture_needs_full_update;
 
-        delete other._image;
-        other._image = nullptr;
-        delete other._texture;
         other._texture = nullptr;
         return *this;
     }
 
     Layer::Frame::~Frame()
     {
-        delete _image;
         delete _texture;
     }
 
     RGBA Layer::Frame::get_pixel(size_t x, size_t y) const
     {
+        ensure_loaded();
+
         auto coords = Vector2i(x + _offset.x, y + _offset.y);
         if (not (coords.x < 0 or coords.y < 0 or coords.x >= _image->get_size().x or coords.y >= _image->get_size().y))
             return _image->get_pixel(coords.x, coords.y);
@@ -105,17 +124,319 @@ namespace mousetrap
 
     void Layer::Frame::set_pixel(size_t x, size_t y, RGBA color)
     {
-        _image->set_pixel(x - _offset.x, y - _offset.y, color);
+        ensure_loaded();
+
+        auto coords = Vector2i(x + _offset.x, y + _offset.y);
+        if (coords.x < 0 or coords.y < 0 or coords.x >= _image->get_size().x or coords.y >= _image->get_size().y)
+            return;
+
+        detach_image();
+        _image->set_pixel(coords.x, coords.y, color);
+        mark_dirty(coords, coords + Vector2i(1, 1));
+    }
+
+    void Layer::Frame::draw(const DrawData& data)
+    {
+        if (data.empty())
+            return;
+
+        ensure_loaded();
+        detach_image();
+
+        if (_image->get_format() != ImageFormat::RGBA8)
+        {
+            for (auto& entry : data)
+            {
+                auto pos = entry.get_position();
+                set_pixel(pos.x, pos.y, entry.get_color());
+            }
+            return;
+        }
+
+        const auto image_size = Vector2i(_image->get_size().x, _image->get_size().y);
+        auto top_left = image_size;
+        auto bottom_right = Vector2i(0, 0);
+
+        int64_t row_y = -1;
+        uint8_t* row = nullptr;
+
+        // entries are sorted row-major, so each image row is fetched once
+        for (auto& entry : data)
+        {
+            auto pos = entry.get_position() + _offset;
+            if (pos.x < 0 or pos.y < 0 or pos.x >= image_size.x or pos.y >= image_size.y)
+                continue;
+
+            if (pos.y != row_y)
+            {
+                row = _image->get_row(pos.y).data();
+                row_y = pos.y;
+            }
+
+            std::memcpy(row + pos.x * 4, &entry.color, 4);
+
+            top_left.x = std::min(top_left.x, pos.x);
+            top_left.y = std::min(top_left.y, pos.y);
+            bottom_right.x = std::max(bottom_right.x, pos.x + 1);
+            bottom_right.y = std::max(bottom_right.y, pos.y + 1);
+        }
+
+        if (top_left.x < bottom_right.x and top_left.y < bottom_right.y)
+            mark_dirty(top_left, bottom_right);
+    }
+
+    void Layer::Frame::mark_dirty(Vector2i top_left, Vector2i bottom_right)
+    {
+        _revision = _next_revision++;
+
+        if (_dirty_top_left.x >= _dirty_bottom_right.x or _dirty_top_left.y >= _dirty_bottom_right.y)
+        {
+            _dirty_top_left = top_left;
+            _dirty_bottom_right = bottom_right;
+            return;
+        }
+
+        _dirty_top_left.x = std::min(_dirty_top_left.x, top_left.x);
+        _dirty_top_left.y = std::min(_dirty_top_left.y, top_left.y);
+        _dirty_bottom_right.x = std::max(_dirty_bottom_right.x, bottom_right.x);
+        _dirty_bottom_right.y = std::max(_dirty_bottom_right.y, bottom_right.y);
+    }
+
+    void Layer::Frame::mark_all_dirty()
+    {
+        _revision = _next_revision++;
+        _texture_needs_full_update = true;
+    }
+
+    void Layer::Frame::set_image_loader(ImageLoader loader, Vector2ui image_size)
+    {
+        _image_loader = std::move(loader);
+        _unloaded_image_size = image_size;
+        _image = std::make_shared<Image>();
+        mark_all_dirty();
+    }
+
+    bool Layer::Frame::get_is_loaded() const
+    {
+        return not _image_loader;
+    }
+
+    void Layer::Frame::ensure_loaded() const
+    {
+        if (_texture_read_back)
+            read_back_texture();
+
+        if (not _image_loader)
+            return;
+
+        // frames are only ever allocated non-const, loading does not change any observable state
+        auto* self = const_cast<Frame*>(this);
+        auto loader = std::move(self->_image_loader);
+        self->_image_loader = nullptr;
+
+        self->_image = std::make_shared<Image>(loader());
+        if (self->_image->get_size() != _unloaded_image_size)
+            std::cerr << "[WARNING] In Layer::Frame::ensure_loaded: Loaded image does not have the announced size" << std::endl;
+
+        self->_texture_needs_full_update = true;
+        self->update_texture();
+    }
+
+    void Layer::Frame::load() const
+    {
+        ensure_loaded();
+    }
+
+    void Layer::Frame::overwrite_texture(Texture* texture, TextureReadback read_back)
+    {
+        if (texture->get_size() != Vector2i(_size))
+            std::cerr << "[WARNING] In Layer::Frame::overwrite_texture: Texture does not have the size of the frame" << std::endl;
+
+        delete _texture;
+        _texture = texture;
+        _texture_read_back = std::move(read_back);
+
+        // texture is already current, nothing to upload
+        _revision = _next_revision++;
+        _texture_needs_full_update = false;
+        _dirty_top_left = {0, 0};
+        _dirty_bottom_right = {0, 0};
+    }
+
+    bool Layer::Frame::get_is_read_back_pending() const
+    {
+        return bool(_texture_read_back);
+    }
+
+    void Layer::Frame::read_back_texture() const
+    {
+        // same as ensure_loaded, pixels change representation but not content
+        auto* self = const_cast<Frame*>(this);
+        auto read_back = std::move(self->_texture_read_back);
+        self->_texture_read_back = nullptr;
+
+        auto pixels = read_back(*_texture);
+
+        // texture(x, y) = image(x + offset.x, y + offset.y), pixels outside the texture are unchanged
+        if (_offset == Vector2i(0, 0) and Vector2ui(_image->get_size()) == _size and _image->get_format() == pixels.get_format())
+        {
+            self->_image = std::make_shared<Image>(std::move(pixels));
+            return;
+        }
+
+        self->detach_image();
+        self->_image->copy_region(pixels, {0, 0}, _size, _offset);
+    }
+
+    size_t Layer::Frame::get_revision() const
+    {
+        return _revision;
     }
 
     void Layer::Frame::overwrite_image(const Image& image)
     {
-        *_image = image;
+        _image_loader = nullptr;
+        _texture_read_back = nullptr;
+        _image = std::make_shared<Image>(image);
+        mark_all_dirty();
+    }
+
+    void Layer::Frame::overwrite_image(Image&& image)
+    {
+        _image_loader = nullptr;
+        _texture_read_back = nullptr;
+        _image = std::make_shared<Image>(std::move(image));
+        mark_all_dirty();
+    }
+
+    Image* Layer::Frame::get_image()
+    {
+        ensure_loaded();
+        detach_image();
+        mark_all_dirty();
+        return _image.get();
+    }
+
+    const Image* Layer::Frame::get_image() const
+    {
+        ensure_loaded();
+        return _image.get();
+    }
+
+    void Layer::Frame::detach_image()
+    {
+        // only the main thread creates new references, so a count of 1 can not go up concurrently
+        if (_image.use_count() > 1)
+            _image = std::make_shared<Image>(*_image);
+    }
+
+    Layer::Frame::Snapshot Layer::Frame::snapshot() const
+    {
+        Snapshot out;
+        out.image_size = get_image_size();
+        out.offset = _offset;
+        out.is_keyframe = _is_keyframe;
+        out.revision = _revision;
+
+        if (_texture_read_back)
+            read_back_texture();
+
+        if (_image_loader)
+            out.loader = _image_loader;
+        else
+            out.image = _image;
+
+        return out;
+    }
+
+    void Layer::Frame::read_region(Vector2i top_left, Vector2ui size, uint32_t* out) const
+    {
+        ensure_loaded();
+
+        for (size_t y = 0; y < size.y; ++y)
+        {
+            auto* out_row = out + y * size.x;
+            if (_image->get_format() == ImageFormat::RGBA8)
+            {
+                std::memcpy(out_row, _image->get_row(top_left.y + y).data() + top_left.x * 4, size.x * 4);
+                continue;
+            }
+
+            for (size_t x = 0; x < size.x; ++x)
+                out_row[x] = DrawData::pack_color(_image->get_pixel(top_left.x + x, top_left.y + y));
+        }
+    }
+
+    void Layer::Frame::write_region(Vector2i top_left, Vector2ui size, const uint32_t* pixels)
+    {
+        if (size.x == 0 or size.y == 0)
+            return;
+
+        ensure_loaded();
+        detach_image();
+
+        for (size_t y = 0; y < size.y; ++y)
+        {
+            const auto* row = pixels + y * size.x;
+            if (_image->get_format() == ImageFormat::RGBA8)
+            {
+                std::memcpy(_image->get_row(top_left.y + y).data() + top_left.x * 4, row, size.x * 4);
+                continue;
+            }
+
+            for (size_t x = 0; x < size.x; ++x)
+                _image->set_pixel(top_left.x + x, top_left.y + y, DrawData::unpack_color(row[x]));
+        }
+
+        mark_dirty(top_left, top_left + Vector2i(size.x, size.y));
+    }
+
+    void Layer::Frame::copy_from(const Frame& other)
+    {
+        ensure_loaded();
+        other.ensure_loaded();
+        mark_all_dirty();
+
+        if (_offset == Vector2i(0, 0) and other._offset == Vector2i(0, 0) and _image->get_size() == other._image->get_size())
+        {
+            _image = other._image;
+            return;
+        }
+
+        detach_image();
+
+        // equivalent to set_pixel(x, y, other.get_pixel(x, y)) for all x, y in frame bounds
+        _image->fill_region(_offset, _size, RGBA(0, 0, 0, 0));
+        _image->copy_region(*other._image, other._offset, _size, _offset);
+    }
+
+    void Layer::Frame::swap_image(Frame& other)
+    {
+        // textures are not swapped, so both images have to be current
+        if (_texture_read_back)
+            read_back_texture();
+
+        if (other._texture_read_back)
+            other.read_back_texture();
+
+        std::swap(_image, other._image);
+        std::swap(_offset, other._offset);
+        std::swap(_image_loader, other._image_loader);
+        std::swap(_unloaded_image_size, other._unloaded_image_size);
+
+        // content moved with the image, so does its revision
+        std::swap(_revision, other._revision);
+        _texture_needs_full_update = true;
+        other._texture_needs_full_update = true;
     }
 
     void Layer::Frame::set_size(Vector2ui size)
     {
+        if (_texture_read_back)
+            read_back_texture();
+
         _size = size;
+        mark_all_dirty();
     }
 
     Vector2ui Layer::Frame::get_size() const
@@ -125,11 +446,18 @@ namespace mousetrap
 
     Vector2ui Layer::Frame::get_image_size() const
     {
+        if (_image_loader)
+            return _unloaded_image_size;
+
         return _image->get_size();
     }
 
     const Texture* Layer::Frame::get_texture() const
     {
+        // a texture rendered on the GPU is newer than the image, so it is not read back here
+        if (_image_loader)
+            ensure_loaded();
+
         return _texture;
     }
 
@@ -145,7 +473,11 @@ namespace mousetrap
 
     void Layer::Frame::set_offset(Vector2i offset)
     {
+        if (_texture_read_back)
+            read_back_texture();
+
         _offset = offset;
+        mark_all_dirty();
     }
 
     Vector2i Layer::Frame::get_offset() const
@@ -155,20 +487,49 @@ namespace mousetrap
 
     void Layer::Frame::update_texture()
     {
-        auto image = Image();
-        image.create(_size.x, _size.y, RGBA(0, 0, 0, 0));
+        // texture(x, y) = get_pixel(x, y) = image(x + offset.x, y + offset.y)
 
-        for (int x = 0; x < _size.x; ++x)
+        // texture is created once the image is loaded
+        if (_image_loader)
+            return;
+
+        if (_texture_needs_full_update or _texture->get_size() != Vector2i(_size))
         {
-            for (int y = 0; y < _size.y; ++y)
+            if (_offset == Vector2i(0, 0) and Vector2ui(_image->get_size()) == _size)
+                _texture->create_from_image(*_image);
+            else
             {
-                auto coords = Vector2i(x + _offset.x, y + _offset.y);
-                if (not (coords.x < 0 or coords.y < 0 or coords.x >= _image->get_size().x or coords.y >= _image->get_size().y))
-                    image.set_pixel(x, y, get_pixel(coords.x, coords.y));
+                auto image = Image(_image->get_format());
+                image.create(_size.x, _size.y, RGBA(0, 0, 0, 0));
+                image.copy_region(*_image, _offset, _size, {0, 0});
+                _texture->create_from_image(image);
             }
         }
+        else
+        {
+            // clip dirty region to the part of the image that is visible in the texture
+            auto top_left = Vector2i(
+                std::max<int64_t>(_dirty_top_left.x, _offset.x),
+                std::max<int64_t>(_dirty_top_left.y, _offset.y)
+            );
+
+            auto bottom_right = Vector2i(
+                std::min<int64_t>(_dirty_bottom_right.x, _offset.x + int64_t(_size.x)),
+                std::min<int64_t>(_dirty_bottom_right.y, _offset.y + int64_t(_size.y))
+            );
+
+            if (top_left.x < bottom_right.x and top_left.y < bottom_right.y)
+                _texture->update_from_image(
+                    *_image,
+                    top_left,
+                    Vector2ui(bottom_right.x - top_left.x, bottom_right.y - top_left.y),
+                    top_left - _offset
+                );
+        }
 
-        _texture->create_from_image(image);
+        _texture_needs_full_update = false;
+        _dirty_top_left = {0, 0};
+        _dirty_bottom_right = {0, 0};
     }
 
     Layer::Layer(const std::string& name, Vector2ui size, size_t n_frames)
@@ -214,41 +575,27 @@ namespace mousetrap
         _blend_mode = other._blend_mode;
 
         _frames.clear();
-        for (size_t i = 0; i < other._frames.size(); ++i)
-        {
-            auto size = other._frames.at(i)->_image->get_size();
-
-            _frames.emplace_back(new Frame(size));
-            for (size_t x = 0; x < size.x; ++x)
-                for (size_t y = 0; y < size.y; ++y)
-                    _frames.back()->_image->set_pixel(x, y, other._frames.at(i)->_image->get_pixel(x, y));
-
-            _frames.back()->update_texture();
-            _frames.back()->set_is_keyframe(other._frames.at(i)->get_is_keyframe());
-        }
+        for (auto* frame : other._frames)
+            _frames.emplace_back(new Frame(*frame));
     }
 
     Layer& Layer::operator=(const Layer& other)
     {
+        if (&other == this)
+            return *this;
+
         _name = other._name;
         _is_locked = other._is_locked;
         _is_visible = other._is_visible;
         _opacity = other._opacity;
         _blend_mode = other._blend_mode;
 
-        _frames.clear();
-        for (size_t i = 0; i < other._frames.size(); ++i)
-        {
-            auto size = other._frames.at(i)->_image->get_size();
-
-            _frames.emplace_back(new Frame(size));
-            for (size_t x = 0; x < size.x; ++x)
-                for (size_t y = 0; y < size.y; ++y)
-                    _frames.back()->_image->set_pixel(x, y, other._frames.at(i)->_image->get_pixel(x, y));
+        for (auto* frame : _frames)
+            delete frame;
 
-            _frames.back()->update_texture();
-            _frames.back()->set_is_keyframe(other._frames.at(i)->get_is_keyframe());
-        }
+        _frames.clear();
+        for (auto* frame : other._frames)
+            _frames.emplace_back(new Frame(*frame));
 
         return *this;
     }
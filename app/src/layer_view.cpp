@@ -12,6 +12,7 @@ namespace mousetrap
     {
         _area.connect_signal_realize(on_realize, this);
         _area.connect_signal_resize(on_resize, this);
+        _area.connect_signal_render(on_render, this);
     }
 
     LayerView::LayerPreview::~LayerPreview()
@@ -25,76 +26,107 @@ namespace mousetrap
         return &_area;
     }
 
-    void LayerView::LayerPreview::set_texture(const Texture* texture)
+    void LayerView::LayerPreview::on_realize(Widget* widget, LayerPreview* instance)
     {
-        if (_layer_shape != nullptr)
-            _layer_shape->set_texture(texture);
+        auto* area = (GLArea*) widget;
+        area->make_current();
 
-        _area.queue_render();
-    }
+        if (_transparency_tiling_shader == nullptr)
+        {
+            _transparency_tiling_shader = new Shader();
+            _transparency_tiling_shader->create_from_file(get_resource_path() + "shaders/transparency_tiling.frag", ShaderType::FRAGMENT);
+        }
 
-    void LayerView::LayerPreview::set_opacity(float v)
-    {
-        if (_layer_shape != nullptr)
-            _layer_shape->set_color(RGBA(1, 1, 1, v));
+        if (instance->_layer_shape == nullptr)
+        {
+            instance->_transparency_tiling_shape = new Shape();
+            instance->_layer_shape = new Shape();
 
-        _area.queue_render();
-    }
+            for (auto* shape : {instance->_transparency_tiling_shape, instance->_layer_shape})
+                shape->as_rectangle({0, 0}, {1, 1});
 
-    void LayerView::LayerPreview::set_visible(bool b)
-    {
-        _area.set_opacity(b ? 1 : state::settings_file->get_value_as<float>("frame_view", "hidden_layer_opacity"));
-        _area.queue_render();
-    }
+            instance->_layer_shape->set_texture(state::thumbnail_atlas->get_texture());
+            instance->_layer_shape->set_color(RGBA(1, 1, 1, instance->_opacity));
+            instance->_texture_region = {{0, 0}, {1, 1}};
 
-    void LayerView::LayerPreview::set_locked(bool b)
-    {
-        // noop
-        _area.queue_render();
+            auto transparency_task = RenderTask(instance->_transparency_tiling_shape, _transparency_tiling_shader);
+            transparency_task.register_vec2("_canvas_size", &instance->_canvas_size);
+
+            instance->_render_tasks.push_back(transparency_task);
+            instance->_render_tasks.emplace_back(instance->_layer_shape);
+        }
+
+        area->queue_render();
     }
 
-    void LayerView::LayerPreview::set_resolution(Vector2ui resolution)
+    void LayerView::LayerPreview::on_resize(GLArea* area, int w, int h, LayerPreview* instance)
     {
-        // noop
-        _area.queue_render();
+        instance->_canvas_size = {w, h};
+        area->queue_render();
     }
 
-    void LayerView::LayerPreview::on_realize(Widget* widget, LayerPreview* instance)
+    gboolean LayerView::LayerPreview::on_render(GLArea* area, GdkGLContext*, LayerPreview* instance)
     {
-        auto* area = (GLArea*) widget;
         area->make_current();
 
-        if (_transparency_tiling_shader == nullptr)
+        glClearColor(0, 0, 0, 0);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        if (instance->_layer_shape == nullptr)
+            return TRUE;
+
+        // the tile of the cell may have moved since the last render, re-point texture coordinates only if it did
+        auto region = state::thumbnail_atlas->request({instance->_layer_i, active_state->get_current_frame_index()});
+        auto& current = instance->_texture_region;
+        if (region.top_left != current.top_left or region.size != current.size)
         {
-            _transparency_tiling_shader = new Shader();
-            _transparency_tiling_shader->create_from_file(get_resource_path() + "shaders/transparency_tiling.frag", ShaderType::FRAGMENT);
+            instance->_layer_shape->set_vertex_texture_coordinate(0, region.top_left);
+            instance->_layer_shape->set_vertex_texture_coordinate(1, region.top_left + Vector2f(region.size.x, 0));
+            instance->_layer_shape->set_vertex_texture_coordinate(2, region.top_left + region.size);
+            instance->_layer_shape->set_vertex_texture_coordinate(3, region.top_left + Vector2f(0, region.size.y));
+            current = region;
         }
 
-        instance->_transparency_tiling_shape = new Shape();
-        instance->_layer_shape = new Shape();
+        glEnable(GL_BLEND);
+        set_current_blend_mode(BlendMode::NORMAL);
+
+        for (auto& task : instance->_render_tasks)
+            task.render();
 
-        for (auto* shape : {instance->_transparency_tiling_shape, instance->_layer_shape})
-            shape->as_rectangle({0, 0}, {1, 1});
+        glFlush();
+        return TRUE;
+    }
+
+    void LayerView::LayerPreview::queue_render()
+    {
+        _area.queue_render();
+    }
 
-        area->clear_render_tasks();
+    void LayerView::LayerPreview::set_opacity(float v)
+    {
+        if (_opacity == v)
+            return;
 
-        auto transparency_task = RenderTask(instance->_transparency_tiling_shape, _transparency_tiling_shader);
-        transparency_task.register_vec2("_canvas_size", &instance->_canvas_size);
+        _opacity = v;
+        if (_layer_shape != nullptr)
+            _layer_shape->set_color(RGBA(1, 1, 1, v));
 
-        area->add_render_task(transparency_task);
-        area->add_render_task(instance->_layer_shape);
+        _area.queue_render();
+    }
 
-        instance->set_texture(active_state->get_frame(instance->_layer_i, active_state->get_current_frame_index())->get_texture());
-        instance->set_opacity(active_state->get_layer(instance->_layer_i)->get_opacity());
-        instance->set_visible(active_state->get_layer(instance->_layer_i)->get_is_visible());
+    void LayerView::LayerPreview::set_visible(bool b)
+    {
+        _area.set_opacity(b ? 1 : state::settings_file->get_value_as<float>("layer_view", "hidden_layer_opacity"));
+    }
 
-        area->queue_render();
+    void LayerView::LayerPreview::set_locked(bool b)
+    {
+        // noop
     }
 
-    void LayerView::LayerPreview::on_resize(GLArea* area, int w, int h, LayerPreview* instance)
+    void LayerView::LayerPreview::set_resolution(Vector2ui resolution)
     {
-        instance->_canvas_size = {w, h};
-        instance->_area.queue_render();
+        // noop, handled by set_preview_size
     }
 
     void LayerView::LayerPreview::set_preview_size(size_t px)
@@ -114,10 +146,6 @@ namespace mousetrap
         }
 
         _area.set_size_request({width, height});
-    }
-
-    void LayerView::LayerPreview::queue_render()
-    {
         _area.queue_render();
     }
 
@@ -378,9 +406,9 @@ namespace mousetrap
         _layer_preview.set_resolution(resolution);
     }
 
-    void LayerView::LayerRow::set_texture(const Texture* texture)
+    void LayerView::LayerRow::update_preview()
     {
-        _layer_preview.set_texture(texture);
+        _layer_preview.queue_render();
     }
 
     void LayerView::LayerRow::set_all_signals_blocked(bool b)
@@ -403,13 +431,7 @@ namespace mousetrap
         }, this);
         _layer_rows_list_view.get_selection_model()->select(active_state->get_current_layer_index());
 
-        _layer_rows_scrolled_window_spacer.set_size_request({0, state::margin_unit * 10});
-
-        _layer_rows_scrolled_window_box.push_back(&_layer_rows_list_view);
-        _layer_rows_scrolled_window_box.push_back(&_layer_rows_scrolled_window_spacer);
-        _layer_rows_scrolled_window_spacer.set_expand(true);
-
-        _layer_rows_scrolled_window.set_child(&_layer_rows_scrolled_window_box);
+        _layer_rows_scrolled_window.set_child(&_layer_rows_list_view);
         _layer_rows_scrolled_window.set_policy(GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
         _layer_rows_scrolled_window.set_propagate_natural_height(true);
         _layer_rows_scrolled_window.set_expand(true);
@@ -704,12 +726,40 @@ namespace mousetrap
 
         for (auto& row : _layer_rows)
             row.set_preview_size(_preview_size);
+
+        update_atlas_requirements();
+    }
+
+    Vector2ui LayerView::get_preview_tile_size() const
+    {
+        auto resolution = active_state->get_layer_resolution();
+        float height, width;
+
+        if (resolution.x <= resolution.y)
+        {
+            height = _preview_size;
+            width = (resolution.x / float(resolution.y)) * height;
+        }
+        else
+        {
+            width = _preview_size;
+            height = (resolution.y / float(resolution.x)) * width;
+        }
+
+        return {std::max<size_t>(width, 1), std::max<size_t>(height, 1)};
+    }
+
+    void LayerView::update_atlas_requirements()
+    {
+        // at most one preview per layer, of the current frame
+        if (state::thumbnail_atlas != nullptr)
+            state::thumbnail_atlas->set_requirements(this, get_preview_tile_size(), active_state->get_n_layers());
     }
 
     void LayerView::on_layer_frame_selection_changed()
     {
         for (size_t layer_i = 0; layer_i < active_state->get_n_layers(); ++layer_i)
-            _layer_rows.at(layer_i).set_texture(active_state->get_frame(layer_i, active_state->get_current_frame_index())->get_texture());
+            _layer_rows.at(layer_i).update_preview();
 
         _layer_rows_list_view.get_selection_model()->set_signal_selection_changed_blocked(true);
         _layer_rows_list_view.get_selection_model()->select(_layer_rows_list_view.get_n_items() - active_state->get_current_layer_index() - 1);
@@ -729,10 +779,19 @@ namespace mousetrap
         layer_view_toggle_layer_locked.set_state(active_state->get_current_layer()->get_is_locked());
     }
 
-    void LayerView::on_layer_image_updated()
+    void LayerView::on_layer_image_updated(const signals::CellInvalidation& cells)
     {
-        for (size_t layer_i = 0; layer_i < active_state->get_n_layers(); ++layer_i)
-            _layer_rows.at(layer_i).set_texture(active_state->get_frame(layer_i, active_state->get_current_frame_index())->get_texture());
+        const auto frame_i = active_state->get_current_frame_index();
+        for (size_t layer_i = 0; layer_i < _layer_rows.size(); ++layer_i)
+        {
+            if (not cells.contains({layer_i, frame_i}))
+                continue;
+
+            if (state::thumbnail_atlas != nullptr)
+                state::thumbnail_atlas->invalidate({layer_i, frame_i});
+
+            _layer_rows.at(layer_i).update_preview();
+        }
     }
 
     void LayerView::on_layer_properties_changed()
@@ -773,18 +832,16 @@ namespace mousetrap
         _layer_rows_list_view.get_selection_model()->set_signal_selection_changed_blocked(false);
 
         on_layer_properties_changed();
-        on_layer_frame_selection_changed(); // also updates texture
+        on_layer_frame_selection_changed(); // also updates preview
 
         state::actions::layer_view_layer_delete.set_enabled(active_state->get_n_layers() > 1);
+        update_atlas_requirements();
     }
 
     void LayerView::on_layer_resolution_changed()
     {
-        for (size_t layer_i = 0; layer_i < active_state->get_n_layers(); ++layer_i)
-        {
-            _layer_rows.at(layer_i).set_resolution(active_state->get_layer_resolution());
-            _layer_rows.at(layer_i).set_texture(active_state->get_frame(layer_i, active_state->get_current_frame_index())->get_texture());
-        }
+        for (auto& row : _layer_rows)
+            row.set_resolution(active_state->get_layer_resolution());
 
         set_preview_size(_preview_size);
     }
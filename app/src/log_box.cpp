@@ -52,8 +52,11 @@ namespace mousetrap
         update_current_color();
     }
 
-    void LogBox::on_layer_image_updated()
+    void LogBox::on_layer_image_updated(const signals::CellInvalidation& cells)
     {
+        if (not cells.contains(active_state->get_current_cell_position()))
+            return;
+
         update_current_color();
     }
 
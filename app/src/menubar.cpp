@@ -4,6 +4,7 @@
 #include <app/resize_canvas_dialog.hpp>
 #include <app/scale_canvas_dialog.hpp>
 #include <app/color_transform_dialog.hpp>
+#include <app/add_shortcut_action.hpp>
 
 namespace mousetrap
 {
@@ -12,6 +13,22 @@ namespace mousetrap
         std::cout << "called state: " << g_variant_get_boolean(variant) << std::endl;
     }
 
+    void initialize_menubar_actions()
+    {
+        using namespace state::actions;
+
+        state_undo.set_function([](){
+            active_state->undo();
+        });
+
+        state_redo.set_function([](){
+            active_state->redo();
+        });
+
+        for (auto* action : {&state_undo, &state_redo})
+            state::add_shortcut_action(*action);
+    }
+
     void setup_global_menu_bar_model()
     {
         state::global_menu_bar_model = new MenuModel();
@@ -44,6 +61,7 @@ namespace mousetrap
         file_submenu_import_section.add_action(tooltip("save_file", "import_from_image"), save_file_import_from_image.get_id());
         file_submenu_import_section.add_action(tooltip("save_file", "export_as_image"), save_file_export_as_image.get_id());
         file_submenu_import_section.add_action(tooltip("save_file", "export_as_spritesheet"), save_file_export_as_spritesheet.get_id());
+        file_submenu_import_section.add_action(tooltip("save_file", "export_as_animation"), save_file_export_as_animation.get_id());
         file_submenu_import_section.add_action(tooltip("save_file", "export_metadata"), save_file_export_metadata.get_id());
         file_submenu.add_section("Import / Export", &file_submenu_import_section);
 
@@ -200,6 +218,10 @@ namespace mousetrap
         canvas_brush_section.add_stateful_action(tooltip("canvas", "toggle_brush_outline_visible"), canvas_toggle_brush_outline_visible.get_id(), initial_state("canvas", "brush_outline_visible"));
         canvas_submenu.add_section("Brush", &canvas_brush_section);
 
+        auto canvas_bucket_fill_section = MenuModel();
+        canvas_bucket_fill_section.add_stateful_action(tooltip("canvas", "toggle_bucket_fill_all_frames"), canvas_toggle_bucket_fill_all_frames.get_id(), false);
+        canvas_submenu.add_section("Bucket Fill", &canvas_bucket_fill_section);
+
         auto canvas_mirror_section = MenuModel();
         canvas_mirror_section.add_stateful_action(tooltip("canvas", "toggle_horizontal_symmetry_active"), canvas_toggle_horizontal_symmetry_active.get_id(), initial_state("canvas", "horizontal_symmetry_active"));
         canvas_mirror_section.add_stateful_action(tooltip("canvas", "toggle_vertical_symmetry_active"), canvas_toggle_vertical_symmetry_active.get_id(), initial_state("canvas", "vertical_symmetry_active"));
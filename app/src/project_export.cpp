@@ -0,0 +1,228 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/23/23
+//
+
+#include <app/project_export.hpp>
+#include <app/compositor.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        std::set<size_t> get_export_layers(const ProjectSnapshot& snapshot, const std::set<size_t>& layer_is)
+        {
+            if (not layer_is.empty())
+                return layer_is;
+
+            std::set<size_t> out;
+            for (size_t i = 0; i < snapshot.layers.size(); ++i)
+                out.insert(i);
+
+            return out;
+        }
+
+        Vector2ui get_spritesheet_layout(const ProjectSnapshot& snapshot, size_t n_columns)
+        {
+            const size_t n_frames = snapshot.layers.empty() ? 0 : snapshot.layers.front().frames.size();
+            if (n_columns == 0 or n_columns > n_frames)
+                n_columns = std::max<size_t>(n_frames, 1);
+
+            return {n_columns, (n_frames + n_columns - 1) / n_columns};
+        }
+
+        std::string to_json_string(const std::string& in)
+        {
+            std::string out = "\"";
+            for (char c : in)
+            {
+                if (c == '"' or c == '\\')
+                    out.push_back('\\');
+
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out.append(escaped);
+                }
+                else
+                    out.push_back(c);
+            }
+            out.push_back('"');
+            return out;
+        }
+    }
+
+    bool export_frames(const ProjectSnapshot& snapshot, const std::set<size_t>& layer_is, const std::string& prefix)
+    {
+        auto frames = composite_frames(snapshot, detail::get_export_layers(snapshot, layer_is));
+
+        bool success = true;
+        for (size_t frame_i = 0; frame_i < frames.size(); ++frame_i)
+            success = frames.at(frame_i).save_to_file(prefix + "_" + std::to_string(frame_i) + ".png") and success;
+
+        return success;
+    }
+
+    bool export_spritesheet(const ProjectSnapshot& snapshot, const std::set<size_t>& layer_is, const std::string& path, size_t n_columns)
+    {
+        auto frames = composite_frames(snapshot, detail::get_export_layers(snapshot, layer_is));
+        if (frames.empty())
+        {
+            std::cerr << "[ERROR] In export_spritesheet: Project has no frames" << std::endl;
+            return false;
+        }
+
+        const auto layout = detail::get_spritesheet_layout(snapshot, n_columns);
+        const auto frame_size = snapshot.layer_resolution;
+
+        auto out = Image(ImageFormat::RGBA8);
+        out.create(layout.x * frame_size.x, layout.y * frame_size.y, RGBA(0, 0, 0, 0));
+
+        for (size_t frame_i = 0; frame_i < frames.size(); ++frame_i)
+        {
+            auto top_left = Vector2i((frame_i % layout.x) * frame_size.x, (frame_i / layout.x) * frame_size.y);
+            out.copy_region(frames.at(frame_i), {0, 0}, frame_size, top_left);
+        }
+
+        return out.save_to_file(path);
+    }
+
+    bool export_packed_spritesheet(const ProjectSnapshot& snapshot, const std::set<size_t>& layer_is, const std::string& path, size_t padding)
+    {
+        // inbetweens are never composited, frames that still end up identical are caught by the packer
+        auto frames = get_animation_frames(snapshot, layer_is);
+        if (frames.empty())
+        {
+            std::cerr << "[ERROR] In export_packed_spritesheet: Project has no frames" << std::endl;
+            return false;
+        }
+
+        const auto export_layers = detail::get_export_layers(snapshot, layer_is);
+        auto packer = SpritesheetPacker(snapshot.layer_resolution, padding);
+        for (const auto& frame : frames)
+            packer.add_frame(composite_frame(snapshot, export_layers, frame.frame_i));
+
+        auto sheet = packer.pack();
+        if (not sheet.image.save_to_file(path))
+            return false;
+
+        auto json_path = std::filesystem::path(path).replace_extension(".json").string();
+        auto file = std::ofstream(json_path, std::ios::trunc);
+        if (not file)
+        {
+            std::cerr << "[ERROR] In export_packed_spritesheet: Unable to open `" << json_path << "` for writing" << std::endl;
+            return false;
+        }
+
+        // durations in ms, rounded cumulatively so they add up to the length of the animation
+        auto get_timestamp = [&](size_t frame_i) -> size_t {
+            return snapshot.fps > 0 ? std::llround(frame_i / double(snapshot.fps) * 1000) : 0;
+        };
+
+        file << "{\n"
+             << "  \"image\": " << detail::to_json_string(std::filesystem::path(path).filename().string()) << ",\n"
+             << "  \"size\": {\"w\": " << sheet.image.get_size().x << ", \"h\": " << sheet.image.get_size().y << "},\n"
+             << "  \"frame_size\": {\"w\": " << sheet.frame_size.x << ", \"h\": " << sheet.frame_size.y << "},\n"
+             << "  \"fps\": " << snapshot.fps << ",\n"
+             << "  \"sprites\": [";
+
+        for (size_t sprite_i = 0; sprite_i < sheet.sprites.size(); ++sprite_i)
+        {
+            const auto& sprite = sheet.sprites.at(sprite_i);
+            file << (sprite_i == 0 ? "\n" : ",\n")
+                 << "    {\"x\": " << sprite.position.x << ", \"y\": " << sprite.position.y
+                 << ", \"w\": " << sprite.size.x << ", \"h\": " << sprite.size.y << "}";
+        }
+
+        file << "\n  ],\n"
+             << "  \"frames\": [";
+
+        // sprite is null for fully transparent frames, offset is where the sprite is drawn inside the untrimmed frame
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            const auto& frame = frames.at(i);
+            const auto& packed = sheet.frames.at(i);
+
+            file << (i == 0 ? "\n" : ",\n")
+                 << "    {\"frame\": " << frame.frame_i << ", \"n_frames\": " << frame.n_frames
+                 << ", \"duration\": " << get_timestamp(frame.frame_i + frame.n_frames) - get_timestamp(frame.frame_i)
+                 << ", \"sprite\": " << (packed.sprite_i < 0 ? std::string("null") : std::to_string(packed.sprite_i))
+                 << ", \"offset\": {\"x\": " << packed.offset.x << ", \"y\": " << packed.offset.y << "}}";
+        }
+
+        file << "\n  ]\n"
+             << "}\n";
+
+        file.close();
+        if (not file)
+        {
+            std::cerr << "[ERROR] In export_packed_spritesheet: Unable to write `" << json_path << "`" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool export_animation(const ProjectSnapshot& snapshot, const std::set<size_t>& layer_is, const std::string& path, AnimationFormat format)
+    {
+        auto frames = get_animation_frames(snapshot, layer_is);
+        if (frames.empty())
+        {
+            std::cerr << "[ERROR] In export_animation: Project has no frames" << std::endl;
+            return false;
+        }
+
+        auto encoder = AnimationEncoder(format);
+        if (not encoder.open(path, snapshot.layer_resolution, snapshot.fps))
+            return false;
+
+        const auto export_layers = detail::get_export_layers(snapshot, layer_is);
+        for (const auto& frame : frames)
+            encoder.push_frame(composite_frame(snapshot, export_layers, frame.frame_i), frame.n_frames);
+
+        return encoder.finish();
+    }
+
+    bool export_metadata(const ProjectSnapshot& snapshot, const std::string& path, size_t n_columns)
+    {
+        const auto layout = detail::get_spritesheet_layout(snapshot, n_columns);
+        const size_t n_frames = snapshot.layers.empty() ? 0 : snapshot.layers.front().frames.size();
+
+        auto file = KeyFile();
+
+        file.set_value_as<size_t>("project", "n_frames", n_frames);
+        file.set_value_as<size_t>("project", "n_layers", snapshot.layers.size());
+        file.set_value_as<std::vector<size_t>>("project", "frame_size", {snapshot.layer_resolution.x, snapshot.layer_resolution.y});
+        file.set_value_as<float>("project", "fps", snapshot.fps);
+
+        file.set_value_as<size_t>("spritesheet", "n_columns", layout.x);
+        file.set_value_as<size_t>("spritesheet", "n_rows", layout.y);
+        file.add_comment_above("spritesheet", "frame i is at column i % n_columns, row i / n_columns");
+
+        for (size_t layer_i = 0; layer_i < snapshot.layers.size(); ++layer_i)
+        {
+            const auto& layer = snapshot.layers.at(layer_i);
+            auto group = "layer_" + std::to_string(layer_i);
+
+            file.set_value_as<std::string>(group, "name", layer.name);
+            file.set_value_as<bool>(group, "visible", layer.is_visible);
+            file.set_value_as<float>(group, "opacity", layer.opacity);
+            file.set_value_as<std::string>(group, "blend_mode", blend_mode_to_string(layer.blend_mode));
+
+            std::vector<size_t> keyframes;
+            for (size_t frame_i = 0; frame_i < layer.frames.size(); ++frame_i)
+                if (layer.frames.at(frame_i).is_keyframe)
+                    keyframes.push_back(frame_i);
+
+            file.set_value_as<std::vector<size_t>>(group, "keyframes", keyframes);
+        }
+
+        return file.save_to_file(path);
+    }
+}
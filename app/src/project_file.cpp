@@ -0,0 +1,704 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/22/23
+//
+
+#include <app/project_file.hpp>
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        // layout:
+        //   header:   magic, byte order marker, version, tile size, index offset, index size
+        //   chunks:   zlib compressed RGBA8 tiles, in any order, possibly with unreferenced chunks from earlier saves in between
+        //   index:    resolution, frame count, fps, then per layer: properties and per cell: offset, image size, keyframe, tile chunks
+        // all values are stored in the byte order of the machine that wrote the file, files with a different byte order are rejected
+
+        static constexpr char project_file_magic[8] = {'M', 'T', 'P', 'R', 'O', 'J', 0, 0};
+        static constexpr uint32_t project_file_byte_order = 0x01020304;
+        static constexpr uint32_t project_file_version = 1;
+        static constexpr size_t project_file_header_size = 8 + 4 * 4 + 2 * 8;
+
+        // per tile in the index: offset, compressed size
+        static constexpr size_t project_file_tile_record_size = 8 + 4;
+
+        // larger cells are rejected instead of allocated, bounds memory use of corrupt files
+        static constexpr uint32_t project_file_max_image_size = 16384;
+
+        // rewrite the whole file once unreferenced chunks make up more than half of it
+        static constexpr float project_file_max_garbage_ratio = 0.5;
+
+        template<typename T>
+        void serialize(std::string& out, T value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        void serialize(std::string& out, const std::string& value)
+        {
+            serialize<uint32_t>(out, value.size());
+            out.append(value);
+        }
+
+        struct ByteReader
+        {
+            const char* data;
+            size_t size;
+            size_t position = 0;
+            bool is_valid = true;
+
+            template<typename T>
+            T read()
+            {
+                static_assert(std::is_trivially_copyable_v<T>);
+
+                T out{};
+                if (sizeof(T) > size - position)
+                {
+                    is_valid = false;
+                    return out;
+                }
+
+                std::memcpy(&out, data + position, sizeof(T));
+                position += sizeof(T);
+                return out;
+            }
+
+            std::string read_string()
+            {
+                auto n = read<uint32_t>();
+                if (n > size - position)
+                {
+                    is_valid = false;
+                    return "";
+                }
+
+                auto out = std::string(data + position, n);
+                position += n;
+                return out;
+            }
+
+            size_t get_n_remaining() const
+            {
+                return size - position;
+            }
+        };
+
+        std::string compress_tile(const uint32_t* pixels, size_t n_pixels)
+        {
+            std::string out;
+
+            // stream is flushed on destruction
+            {
+                boost::iostreams::filtering_ostream stream;
+                stream.push(boost::iostreams::zlib_compressor(boost::iostreams::zlib::best_speed));
+                stream.push(boost::iostreams::back_inserter(out));
+                stream.write(reinterpret_cast<const char*>(pixels), n_pixels * sizeof(uint32_t));
+            }
+
+            return out;
+        }
+
+        bool decompress_tile(const char* data, size_t size, uint32_t* out, size_t n_pixels)
+        {
+            try
+            {
+                boost::iostreams::filtering_istream stream;
+                stream.push(boost::iostreams::zlib_decompressor());
+                stream.push(boost::iostreams::array_source(data, size));
+                stream.read(reinterpret_cast<char*>(out), n_pixels * sizeof(uint32_t));
+                return size_t(stream.gcount()) == n_pixels * sizeof(uint32_t);
+            }
+            catch (const boost::iostreams::zlib_error&)
+            {
+                return false;
+            }
+        }
+
+        Vector2ui get_n_tiles(Vector2ui image_size, size_t tile_size)
+        {
+            return {
+                (image_size.x + tile_size - 1) / tile_size,
+                (image_size.y + tile_size - 1) / tile_size
+            };
+        }
+    }
+
+    ProjectSnapshot::ProjectSnapshot(const std::deque<Layer*>& layers_in, Vector2ui layer_resolution_in, float fps_in)
+        : layer_resolution(layer_resolution_in), fps(fps_in)
+    {
+        layers.reserve(layers_in.size());
+        for (auto* layer : layers_in)
+        {
+            auto& entry = layers.emplace_back();
+            entry.name = layer->get_name();
+            entry.is_visible = layer->get_is_visible();
+            entry.is_locked = layer->get_is_locked();
+            entry.opacity = layer->get_opacity();
+            entry.blend_mode = layer->get_blend_mode();
+
+            entry.frames.reserve(layer->get_n_frames());
+            for (size_t frame_i = 0; frame_i < layer->get_n_frames(); ++frame_i)
+                entry.frames.push_back(layer->get_frame(frame_i)->snapshot());
+        }
+    }
+
+    ProjectFile::ProjectFile()
+    {}
+
+    ProjectFile::~ProjectFile()
+    {
+        close();
+    }
+
+    bool ProjectFile::open(const std::string& path)
+    {
+        std::shared_ptr<Mapping> mapping;
+        try
+        {
+            mapping = std::make_shared<Mapping>(path);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "[ERROR] In ProjectFile::open: Unable to open file at `" << path << "`: " << e.what() << std::endl;
+            return false;
+        }
+
+        auto header = detail::ByteReader{mapping->data(), mapping->size()};
+
+        char magic[8];
+        for (auto& c : magic)
+            c = header.read<char>();
+
+        auto byte_order = header.read<uint32_t>();
+        auto version = header.read<uint32_t>();
+        auto tile_size_in_file = header.read<uint32_t>();
+        header.read<uint32_t>(); // reserved
+        auto index_offset = header.read<uint64_t>();
+        auto index_size = header.read<uint64_t>();
+
+        auto fail = [&](const std::string& reason) {
+            std::cerr << "[ERROR] In ProjectFile::open: File at `" << path << "` is not a valid project file: " << reason << std::endl;
+            return false;
+        };
+
+        if (not header.is_valid or std::memcmp(magic, detail::project_file_magic, sizeof(magic)) != 0)
+            return fail("Header missing");
+
+        if (byte_order != detail::project_file_byte_order)
+            return fail("File was written on a machine with different byte order");
+
+        if (version != detail::project_file_version)
+            return fail("Unsupported version " + std::to_string(version));
+
+        if (tile_size_in_file != tile_size)
+            return fail("Unsupported tile size " + std::to_string(tile_size_in_file));
+
+        // all checks on values read from the file are written so they cannot overflow
+        if (index_offset > mapping->size() or index_size > mapping->size() - index_offset)
+            return fail("Index out of bounds");
+
+        auto index = detail::ByteReader{mapping->data() + index_offset, index_size};
+
+        Vector2ui layer_resolution;
+        layer_resolution.x = index.read<uint32_t>();
+        layer_resolution.y = index.read<uint32_t>();
+        auto n_layers = index.read<uint64_t>();
+        auto n_frames = index.read<uint64_t>();
+        auto fps = index.read<float>();
+
+        // every layer and cell takes up at least one byte, bounds huge counts in corrupt files
+        if (not index.is_valid or n_layers == 0 or n_frames == 0 or n_frames > index_size / n_layers)
+            return fail("Index corrupted");
+
+        if (layer_resolution.x > detail::project_file_max_image_size or layer_resolution.y > detail::project_file_max_image_size)
+            return fail("Resolution too large");
+
+        std::vector<LayerEntry> layers;
+        layers.reserve(n_layers);
+        uint64_t n_live_bytes = detail::project_file_header_size + index_size;
+
+        for (size_t layer_i = 0; layer_i < n_layers and index.is_valid; ++layer_i)
+        {
+            auto& layer = layers.emplace_back();
+            layer.name = index.read_string();
+            layer.is_visible = index.read<uint8_t>() != 0;
+            layer.is_locked = index.read<uint8_t>() != 0;
+            layer.opacity = index.read<float>();
+            layer.blend_mode = BlendMode(index.read<uint32_t>());
+
+            layer.cells.reserve(n_frames);
+            for (size_t frame_i = 0; frame_i < n_frames and index.is_valid; ++frame_i)
+            {
+                auto& cell = layer.cells.emplace_back();
+                cell.offset.x = index.read<int64_t>();
+                cell.offset.y = index.read<int64_t>();
+                cell.image_size.x = index.read<uint32_t>();
+                cell.image_size.y = index.read<uint32_t>();
+                cell.is_keyframe = index.read<uint8_t>() != 0;
+                cell.revision = 0;
+
+                if (cell.image_size.x > detail::project_file_max_image_size or cell.image_size.y > detail::project_file_max_image_size)
+                    return fail("Cell " + std::to_string(layer_i) + ", " + std::to_string(frame_i) + " too large");
+
+                auto n_tiles = detail::get_n_tiles(cell.image_size, tile_size);
+                if (index.read<uint64_t>() != n_tiles.x * n_tiles.y)
+                    return fail("Tile count of cell " + std::to_string(layer_i) + ", " + std::to_string(frame_i) + " does not match its size");
+
+                if (n_tiles.x * n_tiles.y > index.get_n_remaining() / detail::project_file_tile_record_size)
+                    return fail("Index truncated");
+
+                cell.tiles.resize(n_tiles.x * n_tiles.y);
+                for (auto& tile : cell.tiles)
+                {
+                    tile.offset = index.read<uint64_t>();
+                    tile.size = index.read<uint32_t>();
+
+                    if (tile.offset > index_offset or tile.size > index_offset - tile.offset)
+                        return fail("Tile out of bounds");
+
+                    n_live_bytes += tile.size;
+                }
+            }
+        }
+
+        if (not index.is_valid)
+            return fail("Index truncated");
+
+        _path = path;
+        _mapping = std::move(mapping);
+        _layer_resolution = layer_resolution;
+        _n_frames = n_frames;
+        _fps = fps;
+        _layers = std::move(layers);
+        _n_live_bytes = n_live_bytes;
+
+        // cells have no frame yet, they are indexed by create_layer
+        _written_cells.clear();
+        return true;
+    }
+
+    void ProjectFile::close()
+    {
+        // frames that were not yet loaded keep the mapping alive
+        _path = "";
+        _mapping.reset();
+        _layer_resolution = {0, 0};
+        _n_frames = 0;
+        _fps = 0;
+        _layers.clear();
+        _written_cells.clear();
+        _n_live_bytes = 0;
+    }
+
+    bool ProjectFile::get_is_open() const
+    {
+        return _mapping != nullptr;
+    }
+
+    const std::string& ProjectFile::get_path() const
+    {
+        return _path;
+    }
+
+    Vector2ui ProjectFile::get_layer_resolution() const
+    {
+        return _layer_resolution;
+    }
+
+    size_t ProjectFile::get_n_layers() const
+    {
+        return _layers.size();
+    }
+
+    size_t ProjectFile::get_n_frames() const
+    {
+        return _n_frames;
+    }
+
+    float ProjectFile::get_fps() const
+    {
+        return _fps;
+    }
+
+    Layer* ProjectFile::create_layer(size_t layer_i)
+    {
+        if (_mapping == nullptr)
+        {
+            std::cerr << "[ERROR] In ProjectFile::create_layer: No file open" << std::endl;
+            return nullptr;
+        }
+
+        if (layer_i >= _layers.size())
+        {
+            std::cerr << "[ERROR] In ProjectFile::create_layer: Layer index " << layer_i << " out of bounds for file with " << _layers.size() << " layers" << std::endl;
+            return nullptr;
+        }
+
+        auto& entry = _layers.at(layer_i);
+
+        // frames start out empty, their images are only allocated once decoded
+        auto* out = new Layer(entry.name, {0, 0}, _n_frames);
+        out->set_is_visible(entry.is_visible);
+        out->set_is_locked(entry.is_locked);
+        out->set_opacity(entry.opacity);
+        out->set_blend_mode(entry.blend_mode);
+
+        for (size_t frame_i = 0; frame_i < _n_frames; ++frame_i)
+        {
+            auto& cell = entry.cells.at(frame_i);
+            auto* frame = out->get_frame(frame_i);
+
+            frame->set_size(_layer_resolution);
+            frame->set_is_keyframe(cell.is_keyframe);
+            frame->set_offset(cell.offset);
+            frame->set_image_loader([mapping = _mapping, cell = cell]() {
+                return decode_cell(*mapping, cell);
+            }, cell.image_size);
+
+            // unmodified frames reuse the tiles already in the file on the next save
+            cell.revision = frame->get_revision();
+            _written_cells.insert_or_assign(cell.revision, &cell);
+        }
+
+        return out;
+    }
+
+    ProjectSnapshot ProjectFile::get_snapshot() const
+    {
+        ProjectSnapshot out;
+        if (_mapping == nullptr)
+        {
+            std::cerr << "[ERROR] In ProjectFile::get_snapshot: No file open" << std::endl;
+            return out;
+        }
+
+        out.layer_resolution = _layer_resolution;
+        out.fps = _fps;
+        out.layers.reserve(_layers.size());
+
+        for (auto& entry : _layers)
+        {
+            auto& layer = out.layers.emplace_back();
+            layer.name = entry.name;
+            layer.is_visible = entry.is_visible;
+            layer.is_locked = entry.is_locked;
+            layer.opacity = entry.opacity;
+            layer.blend_mode = entry.blend_mode;
+
+            layer.frames.reserve(entry.cells.size());
+            for (auto& cell : entry.cells)
+            {
+                auto& frame = layer.frames.emplace_back();
+                frame.loader = [mapping = _mapping, cell = cell]() {
+                    return decode_cell(*mapping, cell);
+                };
+                frame.image_size = cell.image_size;
+                frame.offset = cell.offset;
+                frame.is_keyframe = cell.is_keyframe;
+                frame.revision = 0;
+            }
+        }
+
+        return out;
+    }
+
+    bool ProjectFile::save(const std::string& path, const ProjectSnapshot& snapshot)
+    {
+        if (snapshot.layers.empty())
+        {
+            std::cerr << "[ERROR] In ProjectFile::save: Project has no layers" << std::endl;
+            return false;
+        }
+
+        bool append = _mapping != nullptr and path == _path;
+        if (append and _n_live_bytes < (1 - detail::project_file_max_garbage_ratio) * _mapping->size())
+            append = false;
+
+        // full rewrites go to a temporary file first, so the previous file stays intact if writing fails
+        auto write_path = append ? path : path + ".tmp";
+
+        std::vector<LayerEntry> entries;
+        uint64_t n_live_bytes = 0;
+        if (not write(write_path, snapshot, append, entries, n_live_bytes))
+            return false;
+
+        if (not append)
+        {
+            std::error_code error;
+            std::filesystem::rename(write_path, path, error);
+            if (error)
+            {
+                std::cerr << "[ERROR] In ProjectFile::save: Unable to move `" << write_path << "` to `" << path << "`: " << error.message() << std::endl;
+                std::filesystem::remove(write_path, error);
+                return false;
+            }
+        }
+
+        // frames that were not yet loaded keep their previous mapping, which stays valid on rename
+        try
+        {
+            _mapping = std::make_shared<Mapping>(path);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "[ERROR] In ProjectFile::save: Unable to map file at `" << path << "` after writing: " << e.what() << std::endl;
+            close();
+            return false;
+        }
+
+        _path = path;
+        _layer_resolution = snapshot.layer_resolution;
+        _n_frames = snapshot.layers.front().frames.size();
+        _fps = snapshot.fps;
+        _layers = std::move(entries);
+        _n_live_bytes = n_live_bytes;
+
+        index_written_cells();
+        return true;
+    }
+
+    void ProjectFile::index_written_cells()
+    {
+        _written_cells.clear();
+        for (auto& layer : _layers)
+            for (auto& cell : layer.cells)
+                if (cell.revision != 0) // not written from a frame, c.f. get_snapshot
+                    _written_cells.insert_or_assign(cell.revision, &cell);
+    }
+
+    bool ProjectFile::write(const std::string& path, const ProjectSnapshot& snapshot, bool append, std::vector<LayerEntry>& entries, uint64_t& n_live_bytes) const
+    {
+        auto file = std::fstream();
+        if (append)
+            file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::ate);
+        else
+            file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (not file.is_open())
+        {
+            std::cerr << "[ERROR] In ProjectFile::write: Unable to open file at `" << path << "` for writing" << std::endl;
+            return false;
+        }
+
+        uint64_t position = 0;
+        if (append)
+            position = file.tellp();
+        else
+        {
+            // written for real once the index is complete
+            file.write(std::string(detail::project_file_header_size, 0).data(), detail::project_file_header_size);
+            position = detail::project_file_header_size;
+        }
+
+        const size_t n_frames = snapshot.layers.front().frames.size();
+        n_live_bytes = detail::project_file_header_size;
+
+        entries.clear();
+        entries.reserve(snapshot.layers.size());
+
+        for (auto& layer : snapshot.layers)
+        {
+            auto& entry = entries.emplace_back();
+            entry.name = layer.name;
+            entry.is_visible = layer.is_visible;
+            entry.is_locked = layer.is_locked;
+            entry.opacity = layer.opacity;
+            entry.blend_mode = layer.blend_mode;
+
+            entry.cells.reserve(n_frames);
+            for (size_t frame_i = 0; frame_i < n_frames; ++frame_i)
+            {
+                const auto& frame = layer.frames.at(frame_i);
+
+                auto& cell = entry.cells.emplace_back();
+                cell.offset = frame.offset;
+                cell.image_size = frame.image_size;
+                cell.is_keyframe = frame.is_keyframe;
+                cell.revision = frame.revision;
+
+                auto it = _written_cells.find(cell.revision);
+                if (it == _written_cells.end())
+                    cell.tiles = encode_cell(frame, file, position);
+                else if (append)
+                    cell.tiles = it->second->tiles;
+                else
+                {
+                    // copy compressed chunks over without decoding them
+                    cell.tiles = it->second->tiles;
+                    for (auto& tile : cell.tiles)
+                    {
+                        if (tile.size == 0)
+                            continue;
+
+                        file.write(_mapping->data() + tile.offset, tile.size);
+                        tile.offset = position;
+                        position += tile.size;
+                    }
+                }
+
+                for (auto& tile : cell.tiles)
+                    n_live_bytes += tile.size;
+            }
+        }
+
+        std::string index;
+        detail::serialize<uint32_t>(index, snapshot.layer_resolution.x);
+        detail::serialize<uint32_t>(index, snapshot.layer_resolution.y);
+        detail::serialize<uint64_t>(index, entries.size());
+        detail::serialize<uint64_t>(index, n_frames);
+        detail::serialize<float>(index, snapshot.fps);
+
+        for (auto& entry : entries)
+        {
+            detail::serialize(index, entry.name);
+            detail::serialize<uint8_t>(index, entry.is_visible);
+            detail::serialize<uint8_t>(index, entry.is_locked);
+            detail::serialize<float>(index, entry.opacity);
+            detail::serialize<uint32_t>(index, entry.blend_mode);
+
+            for (auto& cell : entry.cells)
+            {
+                detail::serialize<int64_t>(index, cell.offset.x);
+                detail::serialize<int64_t>(index, cell.offset.y);
+                detail::serialize<uint32_t>(index, cell.image_size.x);
+                detail::serialize<uint32_t>(index, cell.image_size.y);
+                detail::serialize<uint8_t>(index, cell.is_keyframe);
+                detail::serialize<uint64_t>(index, cell.tiles.size());
+
+                for (auto& tile : cell.tiles)
+                {
+                    detail::serialize<uint64_t>(index, tile.offset);
+                    detail::serialize<uint32_t>(index, tile.size);
+                }
+            }
+        }
+
+        const uint64_t index_offset = position;
+        file.write(index.data(), index.size());
+        n_live_bytes += index.size();
+
+        // header goes last, an interrupted save leaves the previous index in effect
+        file.flush();
+
+        std::string header;
+        header.append(detail::project_file_magic, sizeof(detail::project_file_magic));
+        detail::serialize<uint32_t>(header, detail::project_file_byte_order);
+        detail::serialize<uint32_t>(header, detail::project_file_version);
+        detail::serialize<uint32_t>(header, tile_size);
+        detail::serialize<uint32_t>(header, 0);
+        detail::serialize<uint64_t>(header, index_offset);
+        detail::serialize<uint64_t>(header, index.size());
+
+        file.seekp(0);
+        file.write(header.data(), header.size());
+        file.flush();
+
+        if (not file.good())
+        {
+            std::cerr << "[ERROR] In ProjectFile::write: Unable to write to file at `" << path << "`" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    std::vector<ProjectFile::TileEntry> ProjectFile::encode_cell(const Layer::Frame::Snapshot& frame, std::ostream& out, uint64_t& position)
+    {
+        auto image = frame.image;
+        if (image == nullptr)
+            image = std::make_shared<const Image>(frame.loader ? frame.loader() : Image());
+
+        const auto image_size = image->get_size();
+        const auto n_tiles = detail::get_n_tiles(image_size, tile_size);
+
+        std::vector<TileEntry> tiles;
+        tiles.reserve(n_tiles.x * n_tiles.y);
+
+        std::vector<uint32_t> pixels(tile_size * tile_size);
+        for (size_t tile_y = 0; tile_y < n_tiles.y; ++tile_y)
+        {
+            for (size_t tile_x = 0; tile_x < n_tiles.x; ++tile_x)
+            {
+                auto top_left = Vector2i(tile_x * tile_size, tile_y * tile_size);
+                auto size = Vector2ui(
+                    std::min<size_t>(tile_size, image_size.x - top_left.x),
+                    std::min<size_t>(tile_size, image_size.y - top_left.y)
+                );
+
+                const size_t n_pixels = size.x * size.y;
+                for (size_t y = 0; y < size.y; ++y)
+                {
+                    auto* row = pixels.data() + y * size.x;
+                    if (image->get_format() == ImageFormat::RGBA8)
+                    {
+                        std::memcpy(row, image->get_row(top_left.y + y).data() + top_left.x * 4, size.x * 4);
+                        continue;
+                    }
+
+                    for (size_t x = 0; x < size.x; ++x)
+                        row[x] = DrawData::pack_color(image->get_pixel(top_left.x + x, top_left.y + y));
+                }
+
+                // most tiles of a pixel art animation are empty, those take up no space
+                if (std::all_of(pixels.begin(), pixels.begin() + n_pixels, [](uint32_t pixel){ return pixel == 0; }))
+                {
+                    tiles.push_back({0, 0});
+                    continue;
+                }
+
+                auto compressed = detail::compress_tile(pixels.data(), n_pixels);
+                out.write(compressed.data(), compressed.size());
+                tiles.push_back({position, uint32_t(compressed.size())});
+                position += compressed.size();
+            }
+        }
+
+        return tiles;
+    }
+
+    Image ProjectFile::decode_cell(const Mapping& mapping, const CellEntry& cell)
+    {
+        auto out = Image();
+        out.create(cell.image_size.x, cell.image_size.y, RGBA(0, 0, 0, 0));
+
+        const auto n_tiles = detail::get_n_tiles(cell.image_size, tile_size);
+        std::vector<uint32_t> pixels(tile_size * tile_size);
+
+        for (size_t tile_i = 0; tile_i < cell.tiles.size(); ++tile_i)
+        {
+            const auto& tile = cell.tiles.at(tile_i);
+            if (tile.size == 0)
+                continue;
+
+            auto top_left = Vector2ui((tile_i % n_tiles.x) * tile_size, (tile_i / n_tiles.x) * tile_size);
+            auto size = Vector2ui(
+                std::min<size_t>(tile_size, cell.image_size.x - top_left.x),
+                std::min<size_t>(tile_size, cell.image_size.y - top_left.y)
+            );
+
+            if (not detail::decompress_tile(mapping.data() + tile.offset, tile.size, pixels.data(), size.x * size.y))
+            {
+                std::cerr << "[ERROR] In ProjectFile::decode_cell: Tile " << tile_i << " is corrupted, it will be left transparent" << std::endl;
+                continue;
+            }
+
+            for (size_t y = 0; y < size.y; ++y)
+                std::memcpy(out.get_row(top_left.y + y).data() + top_left.x * 4, pixels.data() + y * size.x, size.x * 4);
+        }
+
+        return out;
+    }
+}
@@ -26,6 +26,8 @@
 #include <app/scale_canvas_dialog.hpp>
 #include <app/resize_canvas_dialog.hpp>
 #include <app/log_box.hpp>
+#include <app/image_decode_service.hpp>
+#include <app/compositor.hpp>
 
 namespace mousetrap
 {
@@ -83,6 +85,13 @@ namespace mousetrap
     ProjectState::ProjectState(Vector2i layer_resolution)
         : _layer_resolution(layer_resolution)
     {
+        _undo_history.set_budget(state::settings_file->get_value_as<size_t>("global", "undo_cache_size") * 1024 * 1024);
+
+        _autosave.set_n_backups(state::settings_file->get_value_as<size_t>("autosave", "n_backups"));
+        auto backup_interval = state::settings_file->get_value_as<size_t>("autosave", "backup_interval");
+        if (backup_interval > 0)
+            _autosave_timeout_id = g_timeout_add_seconds(backup_interval, (GSourceFunc) G_CALLBACK(on_autosave_timeout), this);
+
         auto colors = state::load_default_palette_colors();
         _palette = Palette(colors);
         _primary_color = colors.at(0);
@@ -98,20 +107,36 @@ namespace mousetrap
 
         for (size_t i = 0; i < 10; ++i)
         {
-            auto image = Image();
-            image.create_from_file(get_resource_path() + "example_animation/0" + std::to_string(i) + ".png");
+            auto path = get_resource_path() + "example_animation/0" + std::to_string(i) + ".png";
+            auto* layer = _layers.at(0);
 
-            auto* frame = _layers.at(0)->get_frame(i);
+            auto copy_to_frame = [this, layer, i, revision = layer->get_frame(i)->get_revision()](Image&& image)
+            {
+                // skip if layer was deleted or frame was drawn on before the file finished decoding
+                auto it = std::find(_layers.begin(), _layers.end(), layer);
+                if (it == _layers.end() or i >= layer->get_n_frames() or image.get_size().x == 0)
+                    return;
 
-            for (size_t x = 0; x < image.get_size().x; ++x)
-                for (size_t y = 0; y < image.get_size().y; ++y)
-                    frame->set_pixel(x, y, image.get_pixel(x, y));
+                auto* frame = layer->get_frame(i);
+                if (frame->get_revision() != revision)
+                    return;
 
-            frame->update_texture();
+                frame->get_image()->copy_region(image, {0, 0}, image.get_size(), {0, 0});
+                frame->update_texture();
+                signal_layer_image_updated({size_t(it - _layers.begin()), i});
+            };
+
+            if (state::image_decode_service != nullptr)
+                _decode_requests.push_back(state::image_decode_service->queue(path, copy_to_frame));
+            else
+            {
+                auto image = Image();
+                image.create_from_file(path);
+                copy_to_frame(std::move(image));
+            }
         }
 
         select_all();
-        set_save_path("temp/TODO");
 
         /*
 
@@ -168,6 +193,25 @@ namespace mousetrap
         */
     }
 
+    ProjectState::~ProjectState()
+    {
+        if (_autosave_timeout_id != 0)
+            g_source_remove(_autosave_timeout_id);
+
+        if (_color_transform_timeout_id != 0)
+            g_source_remove(_color_transform_timeout_id);
+
+        if (_animation_export_timeout_id != 0)
+            g_source_remove(_animation_export_timeout_id);
+
+        if (_cell_invalidation_tick_id != 0 and state::main_window != nullptr)
+            gtk_widget_remove_tick_callback(state::main_window->operator GtkWidget*(), _cell_invalidation_tick_id);
+
+        if (state::image_decode_service != nullptr)
+            for (auto id : _decode_requests)
+                state::image_decode_service->cancel(id);
+    }
+
     const Brush* ProjectState::get_current_brush() const
     {
         return &_brushes.at(_current_brush_i);
@@ -262,6 +306,16 @@ namespace mousetrap
         _bucket_fill_eps = eps;
     }
 
+    bool ProjectState::get_bucket_fill_all_frames() const
+    {
+        return _bucket_fill_all_frames;
+    }
+
+    void ProjectState::set_bucket_fill_all_frames(bool b)
+    {
+        _bucket_fill_all_frames = b;
+    }
+
     size_t ProjectState::get_brush_size() const
     {
         return _brush_size;
@@ -274,6 +328,7 @@ namespace mousetrap
 
     void ProjectState::set_current_tool(ToolID id)
     {
+        end_stroke();
         _active_tool = id;
         signal_active_tool_changed();
     }
@@ -366,14 +421,9 @@ namespace mousetrap
 
         for (size_t frame_i = 0; frame_i < _n_frames; ++frame_i)
         {
-            auto* from = duplicate_from.get_frame(frame_i);
             auto* to = new_layer->get_frame(frame_i);
-
-            for (size_t x = 0; x < _layer_resolution.x; ++x)
-                for (size_t y = 0; y < _layer_resolution.y; ++y)
-                    to->set_pixel(x, y, from->get_pixel(x, y));
-
-            new_layer->get_frame(frame_i)->update_texture();
+            to->copy_from(*duplicate_from.get_frame(frame_i));
+            to->update_texture();
         }
 
         signal_layer_count_changed();
@@ -392,7 +442,11 @@ namespace mousetrap
         auto* a = _layers.at(a_i);
         auto* b = _layers.at(b_i);
 
-        auto a_copy = Layer(*_layers.at(a_i));
+        const auto a_name = a->get_name();
+        const auto a_is_locked = a->get_is_locked();
+        const auto a_is_visible = a->get_is_visible();
+        const auto a_opacity = a->get_opacity();
+        const auto a_blend_mode = a->get_blend_mode();
 
         a->set_name(b->get_name());
         a->set_is_locked(b->get_is_locked());
@@ -400,32 +454,29 @@ namespace mousetrap
         a->set_opacity(b->get_opacity());
         a->set_blend_mode(b->get_blend_mode());
 
-        b->set_name(a_copy.get_name());
-        b->set_is_locked(a_copy.get_is_locked());
-        b->set_is_visible(a_copy.get_is_visible());
-        b->set_opacity(a_copy.get_opacity());
-        b->set_blend_mode(a_copy.get_blend_mode());
+        b->set_name(a_name);
+        b->set_is_locked(a_is_locked);
+        b->set_is_visible(a_is_visible);
+        b->set_opacity(a_opacity);
+        b->set_blend_mode(a_blend_mode);
+
+        // layer properties are not part of the pixel history, so it can not be kept consistent
+        _undo_history.clear();
 
         for (size_t i = 0; i < _n_frames; ++i)
         {
             auto* a_frame = a->get_frame(i);
             auto* b_frame = b->get_frame(i);
 
-            for (size_t x = 0; x < _layer_resolution.x; ++x)
-            {
-                for (size_t y = 0; y < _layer_resolution.y; ++y)
-                {
-                    a_frame->set_pixel(x, y, b_frame->get_pixel(x, y));
-                    b_frame->set_pixel(x, y, a_copy.get_frame(i)->get_pixel(x, y));
-                }
-            }
-
+            a_frame->swap_image(*b_frame);
             a_frame->update_texture();
             b_frame->update_texture();
+
+            signal_layer_image_updated({a_i, i});
+            signal_layer_image_updated({b_i, i});
         }
 
         signal_layer_properties_changed();
-        signal_layer_image_updated();
     }
 
     void ProjectState::delete_layer(size_t i)
@@ -463,17 +514,11 @@ namespace mousetrap
 
         Layer* new_layer = new Layer(new_name.str() , _layer_resolution, _n_frames);
 
-        const size_t frame_i_before = get_current_frame_index();
-        const size_t layer_i_before = get_current_layer_index();
+        auto merged = state::canvas_export->merge_layers(from_layer_is);
         for (size_t frame_i = 0; frame_i < _n_frames; ++frame_i)
         {
-            auto image = state::canvas_export->merge_layers(from_layer_is, frame_i);
             auto* new_frame = new_layer->get_frame(frame_i);
-
-            for (size_t x = 0; x < _layer_resolution.x; ++x)
-                for (size_t y = 0; y < _layer_resolution.y; ++y)
-                    new_frame->set_pixel(x, y, image.get_pixel(x, y));
-
+            new_frame->overwrite_image(std::move(merged.at(frame_i)));
             new_frame->update_texture();
         }
 
@@ -530,31 +575,22 @@ namespace mousetrap
 
     void ProjectState::swap_frames(size_t a, size_t b)
     {
+        begin_undo_transaction();
         for (size_t layer_i = 0; layer_i < _layers.size(); ++layer_i)
         {
             auto* a_frame = _layers.at(layer_i)->get_frame(a);
             auto* b_frame = _layers.at(layer_i)->get_frame(b);
 
-            auto a_frame_img = Image();
-            a_frame_img.create(_layer_resolution.x, _layer_resolution.y);
-            for (size_t x = 0; x < _layer_resolution.x; ++x)
-                for (size_t y = 0; y < _layer_resolution.y; ++y)
-                    a_frame_img.set_pixel(x, y, a_frame->get_pixel(x, y));
-
-            for (size_t x = 0; x < _layer_resolution.x; ++x)
-            {
-                for (size_t y = 0; y < _layer_resolution.y; ++y)
-                {
-                    a_frame->set_pixel(x, y, b_frame->get_pixel(x, y));
-                    b_frame->set_pixel(x, y, a_frame_img.get_pixel(x, y));
-                }
-            }
-
+            record_undo({layer_i, a});
+            record_undo({layer_i, b});
+            a_frame->swap_image(*b_frame);
             a_frame->update_texture();
             b_frame->update_texture();
-        }
 
-        signal_layer_image_updated();
+            signal_layer_image_updated({layer_i, a});
+            signal_layer_image_updated({layer_i, b});
+        }
+        end_undo_transaction();
     }
 
     void ProjectState::duplicate_frame(int after, size_t duplicate_from)
@@ -562,19 +598,10 @@ namespace mousetrap
         for (size_t layer_i = 0; layer_i < _layers.size(); ++layer_i)
         {
             auto* layer = _layers.at(layer_i);
-            Image image = Image();
-            image.create(_layer_resolution.x, _layer_resolution.y);
-
-            for (size_t x = 0; x < _layer_resolution.x; ++x)
-                for (size_t y = 0; y < _layer_resolution.y; ++y)
-                    image.set_pixel(x, y, layer->get_frame(duplicate_from)->get_pixel(x, y));
+            const auto* from = layer->get_frame(duplicate_from);
 
             auto* inserted = layer->add_frame(_layer_resolution, after + 1);
-
-            for (size_t x = 0; x < _layer_resolution.x; ++x)
-                for (size_t y = 0; y < _layer_resolution.y; ++y)
-                    inserted->set_pixel(x, y, image.get_pixel(x, y));
-
+            inserted->copy_from(*from);
             inserted->update_texture();
         }
 
@@ -608,9 +635,14 @@ namespace mousetrap
     void ProjectState::set_cell_offset(CellPosition position, Vector2i offset)
     {
         auto* frame = _layers.at(position.x)->get_frame(position.y);
+
+        begin_undo_transaction();
+        record_undo(position);
         frame->set_offset(offset);
+        end_undo_transaction();
+
         frame->update_texture();
-        signal_layer_image_updated();
+        signal_layer_image_updated(position);
     }
 
     CellPosition ProjectState::get_current_cell_position() const
@@ -626,9 +658,14 @@ namespace mousetrap
     void ProjectState::overwrite_cell_image(CellPosition position, const Image& image)
     {
         auto* frame = _layers.at(position.x)->get_frame(position.y);
+
+        begin_undo_transaction();
+        record_undo(position);
         frame->overwrite_image(image);
+        end_undo_transaction();
+
         frame->update_texture();
-        signal_layer_image_updated();
+        signal_layer_image_updated(position);
     }
 
     void ProjectState::set_layer_visible(size_t i, bool b)
@@ -687,11 +724,8 @@ namespace mousetrap
             {
                 auto* frame = _layers.at(layer_i)->get_frame(frame_i);
                 auto image = Image();
-                image.create(_layer_resolution.x, _layer_resolution.y);
-
-                for (size_t x = 0; x < _layer_resolution.x; ++x)
-                    for (size_t y = 0; y < _layer_resolution.y; ++y)
-                        image.set_pixel(x, y, frame->get_pixel(x, y));
+                image.create(_layer_resolution.x, _layer_resolution.y, RGBA(0, 0, 0, 0));
+                image.copy_region(*frame->get_image(), frame->get_offset(), _layer_resolution, {0, 0});
 
                 image = image.as_cropped(offset.x, offset.y, new_size.x, new_size.y);
                 frame->overwrite_image(image);
@@ -713,11 +747,8 @@ namespace mousetrap
                 auto* frame = _layers.at(layer_i)->get_frame(frame_i);
 
                 auto image = Image();
-                image.create(_layer_resolution.x, _layer_resolution.y);
-
-                for (size_t x = 0; x < _layer_resolution.x; ++x)
-                    for (size_t y = 0; y < _layer_resolution.y; ++y)
-                        image.set_pixel(x, y, frame->get_pixel(x, y));
+                image.create(_layer_resolution.x, _layer_resolution.y, RGBA(0, 0, 0, 0));
+                image.copy_region(*frame->get_image(), frame->get_offset(), _layer_resolution, {0, 0});
                 image = image.as_scaled(new_size.x, new_size.y, interpolation_type);
 
                 frame->overwrite_image(image);
@@ -784,151 +815,313 @@ namespace mousetrap
 
     void ProjectState::apply_color_offset()
     {
-        auto& offset = _color_offset;
+        auto fx = CanvasExport::PostFX();
+        fx.color_offset = _color_offset;
+        fx.apply_color_offset = true;
 
-        auto apply_to_frame = [&](Layer::Frame* frame)
-        {
-            for (size_t y = 0; y < _layer_resolution.x; ++y)
-            {
-                for (size_t x = 0; x < _layer_resolution.y; ++x)
-                {
-                    auto as_hsva = frame->get_pixel(x, y).operator HSVA();
-                    as_hsva.h = glm::fract<float>(as_hsva.h + offset.at(0));
-                    as_hsva.s = glm::clamp<float>(as_hsva.s + offset.at(1), 0, 1);
-                    as_hsva.v = glm::clamp<float>(as_hsva.v + offset.at(2), 0, 1);
-
-                    auto as_rgba = as_hsva.operator RGBA();
-                    as_rgba.r = glm::clamp<float>(as_rgba.r + offset.at(3), 0, 1);
-                    as_rgba.g = glm::clamp<float>(as_rgba.g + offset.at(4), 0, 1);
-                    as_rgba.b = glm::clamp<float>(as_rgba.b + offset.at(5), 0, 1);
-                    as_rgba.a = glm::clamp<float>(as_rgba.a + offset.at(6), 0, 1);
-
-                    frame->set_pixel(x, y, as_rgba);
-                }
-            }
-        };
+        // the whole project runs on the color transform workers, so the dialog can show progress and cancel it
+        if (_color_offset_apply_scope != ApplyScope::EVERYWHERE and apply_post_fx(_color_offset_apply_scope, fx))
+            return;
+
+        auto offset = _color_offset;
+        start_color_transform(_color_offset_apply_scope, false, [offset](uint8_t* pixels, size_t n_pixels){
+            apply_color_offset_rgba8(pixels, n_pixels, offset);
+        });
+    }
+
+    void ProjectState::color_to_grayscale(ApplyScope scope)
+    {
+        const std::array<float, 7> offset = {0, -1, 0, 0, 0, 0, 0};
+
+        auto fx = CanvasExport::PostFX();
+        fx.color_offset = offset;
+        fx.apply_color_offset = true;
+
+        if (scope != ApplyScope::EVERYWHERE and apply_post_fx(scope, fx))
+            return;
 
-        auto& scope = _color_offset_apply_scope;
+        start_color_transform(scope, false, [offset](uint8_t* pixels, size_t n_pixels){
+            apply_color_offset_rgba8(pixels, n_pixels, offset);
+        });
+    }
+
+    std::vector<CellPosition> ProjectState::get_cell_positions(ApplyScope scope) const
+    {
+        std::vector<CellPosition> out;
         if (scope == CURRENT_CELL)
-        {
-            auto* frame = _layers.at(_current_layer_i)->get_frame(_current_frame_i);
-            apply_to_frame(frame);
-            frame->update_texture();
-        }
+            out.push_back({_current_layer_i, _current_frame_i});
         else if (scope == CURRENT_LAYER)
         {
             for (size_t frame_i = 0; frame_i < _n_frames; ++frame_i)
-            {
-                auto* frame = _layers.at(_current_layer_i)->get_frame(frame_i);
-                apply_to_frame(frame);
-                frame->update_texture();
-            }
+                out.push_back({_current_layer_i, frame_i});
         }
         else if (scope == CURRENT_FRAME)
         {
             for (size_t layer_i = 0; layer_i < _layers.size(); ++layer_i)
-            {
-                auto* frame = _layers.at(layer_i)->get_frame(_current_frame_i);
-                apply_to_frame(frame);
-                frame->update_texture();
-            }
+                out.push_back({layer_i, _current_frame_i});
         }
         else if (scope == ApplyScope::EVERYWHERE)
         {
             for (size_t layer_i = 0; layer_i < _layers.size(); ++layer_i)
-            {
                 for (size_t frame_i = 0; frame_i < _n_frames; ++frame_i)
-                {
-                    auto* frame = _layers.at(layer_i)->get_frame(frame_i);
-                    apply_to_frame(frame);
-                    frame->update_texture();
-                }
-            }
-        }
-        else if (scope == ApplyScope::SELECTION)
-        {
-            std::cerr << "[ERROR] In ProjectState::apply_color_transform: TODO SELECTION" << std::endl;
+                    out.push_back({layer_i, frame_i});
         }
 
-        signal_layer_image_updated();
+        return out;
     }
 
-    void ProjectState::color_to_grayscale(ApplyScope scope)
+    bool ProjectState::apply_post_fx(ApplyScope scope, const CanvasExport::PostFX& fx)
     {
-        auto offset_before = _color_offset;
-        auto offset_scope_before = _color_offset_apply_scope;
+        if (state::canvas_export == nullptr)
+            return false;
 
-        _color_offset = {0, -1, 0, 0, 0, 0, 0};
-        _color_offset_apply_scope = scope;
+        if (scope == ApplyScope::SELECTION)
+        {
+            std::cerr << "[ERROR] In ProjectState::apply_post_fx: TODO SELECTION" << std::endl;
+            return true;
+        }
+
+        auto positions = get_cell_positions(scope);
 
-        apply_color_offset();
+        std::vector<const Texture*> textures;
+        textures.reserve(positions.size());
+        for (auto position : positions)
+            textures.push_back(_layers.at(position.x)->get_frame(position.y)->get_texture());
 
-        _color_offset = offset_before;
-        _color_offset_apply_scope = offset_scope_before;
+        auto results = state::canvas_export->apply_post_fx(textures, fx);
+        if (results.size() != positions.size())
+            return false;
+
+        // pixels are only downloaded once something needs them, e.g. the next brush stroke, backup or undo of this cell.
+        // The undo history defers capturing the result until then, c.f. UndoHistory::capture_pending
+        auto read_back = [](const Texture& texture) -> Image {
+            return state::canvas_export->download(texture);
+        };
+
+        begin_undo_transaction();
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            auto position = positions.at(i);
+            record_undo(position);
+            _layers.at(position.x)->get_frame(position.y)->overwrite_texture(results.at(i), read_back);
+        }
+        end_undo_transaction();
 
         signal_layer_image_updated();
+        return true;
     }
 
     void ProjectState::color_invert(ApplyScope scope)
     {
-        auto apply_to_frame = [&](Layer::Frame* frame)
-        {
-            for (size_t y = 0; y < _layer_resolution.y; ++y)
-            {
-                for (size_t x = 0; x < _layer_resolution.x; ++x)
-                {
-                    auto as_rgba = frame->get_pixel(x, y);
-                    as_rgba.r = 1 - as_rgba.r;
-                    as_rgba.g = 1 - as_rgba.g;
-                    as_rgba.b = 1 - as_rgba.b;
+        start_color_transform(scope, true, invert_rgba8);
+    }
 
-                    frame->set_pixel(x, y, as_rgba);
-                }
-            }
-        };
+    void ProjectState::start_color_transform(ApplyScope scope, bool whole_image, ColorTransformJob::RowTransform transform)
+    {
+        if (_color_transform_job)
+        {
+            state::bubble_log->send_message("A color transform is already in progress, please wait for it to finish", InfoMessageType::WARNING);
+            return;
+        }
 
-        if (scope == CURRENT_CELL)
+        if (scope == ApplyScope::SELECTION)
         {
-            auto* frame = _layers.at(_current_layer_i)->get_frame(_current_frame_i);
-            apply_to_frame(frame);
-            frame->update_texture();
+            std::cerr << "[ERROR] In ProjectState::start_color_transform: TODO SELECTION" << std::endl;
+            return;
         }
-        else if (scope == CURRENT_LAYER)
+
+        auto positions = get_cell_positions(scope);
+
+        std::vector<ColorTransformJob::Cell> cells;
+        cells.reserve(positions.size());
+        _color_transform_cells.clear();
+
+        for (auto position : positions)
         {
-            for (size_t frame_i = 0; frame_i < _n_frames; ++frame_i)
+            // workers only see snapshots, so loading has to happen here
+            const auto* frame = _layers.at(position.x)->get_frame(position.y);
+            frame->load();
+
+            auto snapshot = frame->snapshot();
+            auto& cell = cells.emplace_back();
+            cell.image = snapshot.image;
+
+            if (whole_image)
             {
-                auto* frame = _layers.at(_current_layer_i)->get_frame(frame_i);
-                apply_to_frame(frame);
-                frame->update_texture();
+                cell.region_top_left = {0, 0};
+                cell.region_size = snapshot.image_size;
             }
-        }
-        else if (scope == CURRENT_FRAME)
-        {
-            for (size_t layer_i = 0; layer_i < _layers.size(); ++layer_i)
+            else
             {
-                auto* frame = _layers.at(layer_i)->get_frame(_current_frame_i);
-                apply_to_frame(frame);
-                frame->update_texture();
+                // only pixels visible on the canvas
+                cell.region_top_left = snapshot.offset;
+                cell.region_size = _layer_resolution;
             }
+
+            _color_transform_cells.emplace_back(position, snapshot.revision);
         }
-        else if (scope == ApplyScope::EVERYWHERE)
+
+        _color_transform_job = std::make_unique<ColorTransformJob>(std::move(cells), std::move(transform));
+        _color_transform_timeout_id = g_timeout_add(30, (GSourceFunc) G_CALLBACK(on_color_transform_timeout), this);
+    }
+
+    gboolean ProjectState::on_color_transform_timeout(ProjectState* instance)
+    {
+        if (not instance->_color_transform_job or not instance->_color_transform_job->get_is_done())
+            return G_SOURCE_CONTINUE;
+
+        instance->_color_transform_timeout_id = 0;
+        instance->finish_color_transform();
+        return G_SOURCE_REMOVE;
+    }
+
+    void ProjectState::finish_color_transform()
+    {
+        auto job = std::move(_color_transform_job);
+        if (job->get_is_cancelled())
+            return;
+
+        std::vector<Layer::Frame*> to_update;
+        size_t n_skipped = 0;
+
+        begin_undo_transaction();
+        for (size_t cell_i = 0; cell_i < _color_transform_cells.size(); ++cell_i)
         {
-            for (size_t layer_i = 0; layer_i < _layers.size(); ++layer_i)
+            auto [position, revision] = _color_transform_cells.at(cell_i);
+            if (position.x >= _layers.size() or position.y >= _n_frames)
             {
-                for (size_t frame_i = 0; frame_i < _n_frames; ++frame_i)
-                {
-                    auto* frame = _layers.at(layer_i)->get_frame(frame_i);
-                    apply_to_frame(frame);
-                    frame->update_texture();
-                }
+                n_skipped += 1;
+                continue;
+            }
+
+            auto* frame = _layers.at(position.x)->get_frame(position.y);
+            if (frame->get_revision() != revision)
+            {
+                // cell was drawn on while the job was running, keep the users changes
+                n_skipped += 1;
+                continue;
             }
+
+            record_undo(position);
+            frame->overwrite_image(std::move(job->get_result(cell_i)));
+            to_update.push_back(frame);
         }
-        else if (scope == ApplyScope::SELECTION)
+        end_undo_transaction();
+
+        for (auto* frame : to_update)
+            frame->update_texture();
+
+        _color_transform_cells.clear();
+
+        if (n_skipped > 0)
+            state::bubble_log->send_message(std::to_string(n_skipped) + " cells were modified during the color transform and have been left unchanged", InfoMessageType::WARNING);
+
+        signal_layer_image_updated();
+    }
+
+    bool ProjectState::get_color_transform_active() const
+    {
+        return _color_transform_job != nullptr;
+    }
+
+    float ProjectState::get_color_transform_progress() const
+    {
+        return _color_transform_job ? _color_transform_job->get_progress() : 1;
+    }
+
+    void ProjectState::cancel_color_transform()
+    {
+        if (_color_transform_job)
+            _color_transform_job->cancel();
+    }
+
+    bool ProjectState::export_animation(const std::string& path)
+    {
+        if (_animation_encoder)
         {
-            std::cerr << "[ERROR] In ProjectState::color_invert: TODO SELECTION" << std::endl;
+            state::bubble_log->send_message("An animation is already being exported, please wait for it to finish", InfoMessageType::WARNING);
+            return false;
         }
 
-        signal_layer_image_updated();
+        AnimationFormat format;
+        if (not animation_format_from_path(path, format))
+        {
+            state::bubble_log->send_message("Unable to export animation to `" + path + "`: Only .gif, .png and .apng are supported", InfoMessageType::ERROR);
+            return false;
+        }
+
+        _animation_snapshot = std::make_shared<const ProjectSnapshot>(_layers, _layer_resolution, _playback_fps);
+        _animation_frames = get_animation_frames(*_animation_snapshot, {});
+        _n_animation_frames_pushed = 0;
+        _animation_export_path = path;
+
+        _animation_encoder = std::make_unique<AnimationEncoder>(format);
+        if (_animation_frames.empty() or not _animation_encoder->open(path, _layer_resolution, _playback_fps))
+        {
+            _animation_encoder.reset();
+            state::bubble_log->send_message("Unable to export animation to `" + path + "`", InfoMessageType::ERROR);
+            return false;
+        }
+
+        _animation_export_timeout_id = g_timeout_add(10, (GSourceFunc) G_CALLBACK(on_animation_export_timeout), this);
+        return true;
+    }
+
+    gboolean ProjectState::on_animation_export_timeout(ProjectState* instance)
+    {
+        if (not instance->_animation_encoder)
+        {
+            instance->_animation_export_timeout_id = 0;
+            return G_SOURCE_REMOVE;
+        }
+
+        auto& encoder = *instance->_animation_encoder;
+        if (encoder.get_is_cancelled())
+        {
+            instance->finish_animation_export();
+            return G_SOURCE_REMOVE;
+        }
+
+        // composited from the snapshot on the encoder workers, so edits made during the export do not end up in some of the frames
+        while (instance->_n_animation_frames_pushed < instance->_animation_frames.size() and encoder.get_can_push())
+        {
+            const auto& frame = instance->_animation_frames.at(instance->_n_animation_frames_pushed++);
+            encoder.push_frame([snapshot = instance->_animation_snapshot, frame_i = frame.frame_i]() -> Image {
+                return composite_frame(*snapshot, frame_i);
+            }, frame.n_frames);
+        }
+
+        if (instance->_n_animation_frames_pushed < instance->_animation_frames.size() or encoder.get_n_in_flight() > 0)
+            return G_SOURCE_CONTINUE;
+
+        instance->finish_animation_export();
+        return G_SOURCE_REMOVE;
+    }
+
+    void ProjectState::finish_animation_export()
+    {
+        auto encoder = std::move(_animation_encoder);
+        const bool cancelled = encoder->get_is_cancelled();
+
+        if (encoder->finish())
+            state::bubble_log->send_message("Exported animation to `" + _animation_export_path + "`");
+        else if (not cancelled)
+            state::bubble_log->send_message("Unable to export animation to `" + _animation_export_path + "`", InfoMessageType::ERROR);
+
+        _animation_snapshot.reset();
+        _animation_frames.clear();
+        _animation_export_timeout_id = 0;
+    }
+
+    bool ProjectState::get_animation_export_active() const
+    {
+        return _animation_encoder != nullptr;
+    }
+
+    void ProjectState::cancel_animation_export()
+    {
+        if (_animation_encoder)
+            _animation_encoder->cancel();
     }
 
     HSVA ProjectState::get_preview_color_current() const
@@ -1021,6 +1214,21 @@ namespace mousetrap
         signal_selection_changed();
     }
 
+    void ProjectState::add_selection(const Selection& selection)
+    {
+        if (_selection_mode == SelectionMode::SUBTRACT)
+            _selection.subtract(selection);
+        else
+        {
+            if (_selection.size() == 0 or _selection_mode == SelectionMode::REPLACE)
+                _selection = selection;
+            else if (_selection_mode == SelectionMode::ADD)
+                _selection.add(selection);
+        }
+
+        signal_selection_changed();
+    }
+
     void ProjectState::move_selection(Vector2i offset_px)
     {
        _selection.apply_offset(offset_px);
@@ -1099,11 +1307,25 @@ namespace mousetrap
         size_t frame_i = cell_ij.y;
         auto* frame = _layers.at(layer_i)->get_frame(frame_i);
 
-        for (auto& pair : data)
-            frame->set_pixel(pair.first.x, pair.first.y, pair.second);
+        if (data.empty())
+            return;
+
+        auto top_left = Vector2i(std::numeric_limits<int64_t>::max());
+        auto bottom_right = Vector2i(std::numeric_limits<int64_t>::min());
+        for (auto& entry : data)
+        {
+            auto position = entry.get_position();
+            top_left = {std::min(top_left.x, position.x), std::min(top_left.y, position.y)};
+            bottom_right = {std::max(bottom_right.x, position.x + 1), std::max(bottom_right.y, position.y + 1)};
+        }
+
+        begin_undo_transaction();
+        record_undo(cell_ij, top_left, bottom_right - top_left);
+        frame->draw(data);
+        end_undo_transaction();
 
         frame->update_texture();
-        signal_layer_image_updated();
+        signal_layer_image_updated(cell_ij, top_left, bottom_right - top_left);
     }
 
     void ProjectState::copy_to_cell(CellPosition a, CellPosition b)
@@ -1111,13 +1333,14 @@ namespace mousetrap
         auto* from = _layers.at(a.x)->get_frame(a.y);
         auto* to = _layers.at(b.x)->get_frame(b.y);
 
-        for (size_t x = 0; x < _layer_resolution.x; ++x)
-            for (size_t y = 0; y < _layer_resolution.y; ++y)
-                to->set_pixel(x, y, from->get_pixel(x, y));
+        begin_undo_transaction();
+        record_undo(b);
+        to->copy_from(*from);
+        end_undo_transaction();
 
         to->update_texture();
 
-        signal_layer_image_updated();
+        signal_layer_image_updated(b);
     }
 
     void ProjectState::swap_cells(CellPosition a, CellPosition b)
@@ -1125,34 +1348,93 @@ namespace mousetrap
         auto* a_frame = _layers.at(a.x)->get_frame(a.y);
         auto* b_frame = _layers.at(b.x)->get_frame(b.y);
 
-        Image a_img;
-        Image b_img;
+        begin_undo_transaction();
+        record_undo(a);
+        record_undo(b);
+        a_frame->swap_image(*b_frame);
+        end_undo_transaction();
 
-        a_img.create(_layer_resolution.x, _layer_resolution.y);
-        b_img.create(_layer_resolution.x, _layer_resolution.y);
+        a_frame->update_texture();
+        b_frame->update_texture();
 
-        for (size_t x = 0; x < _layer_resolution.x; ++x)
-        {
-            for (size_t y = 0; y < _layer_resolution.y; ++y)
-            {
-                a_img.set_pixel(x, y, a_frame->get_pixel(x, y));
-                b_img.set_pixel(x, y, b_frame->get_pixel(x, y));
-            }
-        }
+        signal_layer_image_updated(a);
+        signal_layer_image_updated(b);
+    }
 
-        for (size_t x = 0; x < _layer_resolution.x; ++x)
+    void ProjectState::record_undo(CellPosition position)
+    {
+        _undo_history.record(position, _layers.at(position.x)->get_frame(position.y));
+    }
+
+    void ProjectState::record_undo(CellPosition position, Vector2i top_left, Vector2i size)
+    {
+        // history works in image coordinates, which are shifted by the cells offset
+        auto* frame = _layers.at(position.x)->get_frame(position.y);
+        _undo_history.record(position, frame, top_left + frame->get_offset(), size);
+    }
+
+    void ProjectState::begin_undo_transaction()
+    {
+        _undo_history.begin_transaction();
+    }
+
+    void ProjectState::end_undo_transaction()
+    {
+        _undo_history.end_transaction();
+    }
+
+    void ProjectState::begin_stroke()
+    {
+        if (_stroke_open)
+            return;
+
+        begin_undo_transaction();
+        _stroke_open = true;
+    }
+
+    void ProjectState::end_stroke()
+    {
+        if (not _stroke_open)
+            return;
+
+        end_undo_transaction();
+        _stroke_open = false;
+    }
+
+    void ProjectState::undo()
+    {
+        end_stroke();
+
+        auto resolve = [&](CellPosition position) -> Layer::Frame* {
+            if (position.x >= _layers.size() or position.y >= _n_frames)
+                return nullptr;
+
+            return _layers.at(position.x)->get_frame(position.y);
+        };
+
+        for (auto position : _undo_history.undo(resolve))
         {
-            for (size_t y = 0; y < _layer_resolution.y; ++y)
-            {
-                a_frame->set_pixel(x, y, b_img.get_pixel(x, y));
-                b_frame->set_pixel(x, y, a_img.get_pixel(x, y));
-            }
+            _layers.at(position.x)->get_frame(position.y)->update_texture();
+            signal_layer_image_updated(position);
         }
+    }
 
-        a_frame->update_texture();
-        b_frame->update_texture();
+    void ProjectState::redo()
+    {
+        end_stroke();
 
-        signal_layer_image_updated();
+        auto resolve = [&](CellPosition position) -> Layer::Frame* {
+            if (position.x >= _layers.size() or position.y >= _n_frames)
+                return nullptr;
+
+            return _layers.at(position.x)->get_frame(position.y);
+        };
+
+        for (auto position : _undo_history.redo(resolve))
+        {
+            _layers.at(position.x)->get_frame(position.y)->update_texture();
+            signal_layer_image_updated(position);
+        }
     }
 
     void ProjectState::set_fps(float fps)
@@ -1191,26 +1473,31 @@ namespace mousetrap
 
     void ProjectState::apply_image_flip()
     {
-        auto apply_to_frame = [&](Layer::Frame* frame)
-        {
-            auto image = Image();
-            image.create(_layer_resolution.x, _layer_resolution.y);
+        auto fx = CanvasExport::PostFX();
+        fx.flip_horizontally = _image_flip.flip_horizontally;
+        fx.flip_vertically = _image_flip.flip_vertically;
+        fx.apply_flip = true;
 
-            for (size_t x = 0; x < _layer_resolution.x; ++x)
-                for (size_t y = 0; y < _layer_resolution.y; ++y)
-                    image.set_pixel(x, y, frame->get_pixel(x, y));
+        if (apply_post_fx(_image_flip_apply_scope, fx))
+        {
+            _image_flip.flip_horizontally = false;
+            _image_flip.flip_vertically = false;
+            signal_image_flip_changed();
+            return;
+        }
 
-            image = image.as_flipped(_image_flip.flip_horizontally, _image_flip.flip_vertically);
+        begin_undo_transaction();
 
-            for (size_t x = 0; x < _layer_resolution.x; ++x)
-                for (size_t y = 0; y < _layer_resolution.y; ++y)
-                    frame->set_pixel(x, y, image.get_pixel(x, y));
+        auto apply_to_frame = [&](Layer::Frame* frame)
+        {
+            frame->get_image()->flip_in_place(_image_flip.flip_horizontally, _image_flip.flip_vertically);
         };
 
         auto& scope = _image_flip_apply_scope;
         if (scope == CURRENT_CELL)
         {
             auto* frame = _layers.at(_current_layer_i)->get_frame(_current_frame_i);
+            record_undo({_current_layer_i, _current_frame_i});
             apply_to_frame(frame);
             frame->update_texture();
         }
@@ -1219,6 +1506,7 @@ namespace mousetrap
             for (size_t frame_i = 0; frame_i < _n_frames; ++frame_i)
             {
                 auto* frame = _layers.at(_current_layer_i)->get_frame(frame_i);
+                record_undo({_current_layer_i, frame_i});
                 apply_to_frame(frame);
                 frame->update_texture();
             }
@@ -1228,6 +1516,7 @@ namespace mousetrap
             for (size_t layer_i = 0; layer_i < _layers.size(); ++layer_i)
             {
                 auto* frame = _layers.at(layer_i)->get_frame(_current_frame_i);
+                record_undo({layer_i, _current_frame_i});
                 apply_to_frame(frame);
                 frame->update_texture();
             }
@@ -1239,6 +1528,7 @@ namespace mousetrap
                 for (size_t frame_i = 0; frame_i < _n_frames; ++frame_i)
                 {
                     auto* frame = _layers.at(layer_i)->get_frame(frame_i);
+                    record_undo({layer_i, frame_i});
                     apply_to_frame(frame);
                     frame->update_texture();
                 }
@@ -1249,6 +1539,7 @@ namespace mousetrap
             std::cerr << "[ERROR] In ProjectState::apply_image_flip: TODO SELECTION" << std::endl;
         }
 
+        end_undo_transaction();
         signal_layer_image_updated();
 
         _image_flip.flip_horizontally = false;
@@ -1258,95 +1549,37 @@ namespace mousetrap
 
     void ProjectState::rotate_clockwise()
     {
-        auto rotate  = [](Image* image)
-        {
-            auto out = Image();
-            out.create(image->get_size().y, image->get_size().x);
-
-            for(size_t x = 0; x < image->get_size().x; x++)
-                for(size_t y = 0; y < image->get_size().y; y++)
-                    out.set_pixel(y, x, image->get_pixel(image->get_size().x - 1 - x, y));
-
-            return out;
-        };
-
         for (size_t layer_i = 0; layer_i < _layers.size(); ++layer_i)
         {
             for (size_t frame_i = 0; frame_i < _n_frames; ++frame_i)
             {
                 auto* frame = _layers.at(layer_i)->get_frame(frame_i);
-                auto image = Image();
-                image.create(_layer_resolution.x, _layer_resolution.y);
-
-                for (size_t x = 0; x < _layer_resolution.x; ++x)
-                    for (size_t y = 0; y < _layer_resolution.y; ++y)
-                        image.set_pixel(x, y, frame->get_pixel(x, y));
-
-                image = rotate(&image);
-
-                for (size_t x = 0; x < _layer_resolution.x; ++x)
-                    for (size_t y = 0; y < _layer_resolution.y; ++y)
-                        frame->set_pixel(x, y, image.get_pixel(x, y));
-
+                frame->overwrite_image(frame->get_image()->as_rotated_clockwise());
+                frame->set_size({_layer_resolution.y, _layer_resolution.x});
                 frame->update_texture();
             }
         }
 
         _layer_resolution = {_layer_resolution.y, _layer_resolution.x};
+
         signal_layer_resolution_changed();
+        signal_layer_image_updated();
     }
 
     void ProjectState::rotate_counterclockwise()
     {
-        auto apply_to_frame  = [](Image* image)
-        {
-            auto out = Image();
-            out.create(image->get_size().y, image->get_size().x);
-
-            for(size_t x = 0; x < image->get_size().x; x++)
-                for(size_t y = 0; y < image->get_size().y; y++)
-                    out.set_pixel(y, x, image->get_pixel(x, image->get_size().y - 1 - y));
-
-            *image = out;
-        };
-
-        auto rotate = [](Image* image)
-        {
-            auto out = Image();
-            out.create(image->get_size().y, image->get_size().x);
-
-            for(size_t x = 0; x < image->get_size().x; x++)
-                for(size_t y = 0; y < image->get_size().y; y++)
-                    out.set_pixel(y, x, image->get_pixel(image->get_size().x - 1 - x, y));
-
-            return out;
-        };
-
         for (size_t layer_i = 0; layer_i < _layers.size(); ++layer_i)
         {
             for (size_t frame_i = 0; frame_i < _n_frames; ++frame_i)
             {
                 auto* frame = _layers.at(layer_i)->get_frame(frame_i);
-                auto image = Image();
-                image.create(_layer_resolution.x, _layer_resolution.y);
-
-                for (size_t x = 0; x < _layer_resolution.x; ++x)
-                    for (size_t y = 0; y < _layer_resolution.y; ++y)
-                        image.set_pixel(x, y, frame->get_pixel(x, y));
-
-                image = rotate(&image);
-
-                for (size_t x = 0; x < _layer_resolution.x; ++x)
-                    for (size_t y = 0; y < _layer_resolution.y; ++y)
-                        frame->set_pixel(x, y, image.get_pixel(x, y));
-
+                frame->overwrite_image(frame->get_image()->as_rotated_counterclockwise());
+                frame->set_size({_layer_resolution.y, _layer_resolution.x});
                 frame->update_texture();
             }
         }
 
-        auto before = _layer_resolution;
-        _layer_resolution.x = before.y;
-        _layer_resolution.y = before.x;
+        _layer_resolution = {_layer_resolution.y, _layer_resolution.x};
 
         signal_layer_resolution_changed();
         signal_layer_image_updated();
@@ -1374,6 +1607,50 @@ namespace mousetrap
         return _save_path;
     }
 
+    bool ProjectState::save_to_file(const std::string& path)
+    {
+        if (not _project_file.save(path, ProjectSnapshot(_layers, _layer_resolution, _playback_fps)))
+            return false;
+
+        set_save_path(path);
+        return true;
+    }
+
+    gboolean ProjectState::on_autosave_timeout(ProjectState* instance)
+    {
+        instance->_autosave.queue_backup(ProjectSnapshot(instance->_layers, instance->_layer_resolution, instance->_playback_fps));
+        return G_SOURCE_CONTINUE;
+    }
+
+    bool ProjectState::load_from_file(const std::string& path)
+    {
+        if (not _project_file.open(path))
+            return false;
+
+        std::deque<Layer*> layers;
+        for (size_t layer_i = 0; layer_i < _project_file.get_n_layers(); ++layer_i)
+            layers.push_back(_project_file.create_layer(layer_i));
+
+        for (auto* layer : _layers)
+            delete layer;
+
+        _layers = std::move(layers);
+        _n_frames = _project_file.get_n_frames();
+        _layer_resolution = _project_file.get_layer_resolution();
+        _current_layer_i = 0;
+        _current_frame_i = 0;
+
+        signal_layer_count_changed();
+        signal_layer_resolution_changed();
+        signal_layer_frame_selection_changed();
+        signal_layer_image_updated();
+
+        select_all();
+        set_fps(_project_file.get_fps());
+        set_save_path(path);
+        return true;
+    }
+
     void ProjectState::signal_brush_selection_changed()
     {
         if (state::brush_options)
@@ -1474,27 +1751,74 @@ namespace mousetrap
 
     void ProjectState::signal_layer_image_updated()
     {
+        _pending_cell_invalidation.add_all();
+        queue_cell_invalidation_flush();
+    }
+
+    void ProjectState::signal_layer_image_updated(CellPosition cell)
+    {
+        _pending_cell_invalidation.add(cell);
+        queue_cell_invalidation_flush();
+    }
+
+    void ProjectState::signal_layer_image_updated(CellPosition cell, Vector2i top_left, Vector2i size)
+    {
+        _pending_cell_invalidation.add(cell, top_left, size);
+        queue_cell_invalidation_flush();
+    }
+
+    void ProjectState::queue_cell_invalidation_flush()
+    {
+        if (_cell_invalidation_tick_id != 0)
+            return;
+
+        // no frame clock to wait for, deliver immediately
+        if (state::main_window == nullptr)
+        {
+            flush_cell_invalidation();
+            return;
+        }
+
+        _cell_invalidation_tick_id = gtk_widget_add_tick_callback(state::main_window->operator GtkWidget*(), (GtkTickCallback) G_CALLBACK(on_cell_invalidation_tick), this, (GDestroyNotify) nullptr);
+    }
+
+    gboolean ProjectState::on_cell_invalidation_tick(GtkWidget*, GdkFrameClock*, ProjectState* instance)
+    {
+        instance->_cell_invalidation_tick_id = 0;
+        instance->flush_cell_invalidation();
+        return G_SOURCE_REMOVE;
+    }
+
+    void ProjectState::flush_cell_invalidation()
+    {
+        if (_pending_cell_invalidation.empty())
+            return;
+
+        // listeners may draw and queue new invalidations, those are delivered next frame
+        auto cells = std::move(_pending_cell_invalidation);
+        _pending_cell_invalidation.clear();
+
         if (state::canvas)
-            state::canvas->signal_layer_image_updated();
+            state::canvas->signal_layer_image_updated(cells);
 
         if (state::layer_view)
-            state::layer_view->signal_layer_image_updated();
+            state::layer_view->signal_layer_image_updated(cells);
 
         if (state::frame_view)
-            state::frame_view->signal_layer_image_updated();
+            state::frame_view->signal_layer_image_updated(cells);
 
         if (state::animation_preview)
-            state::animation_preview->signal_layer_image_updated();
-
-        if (state::canvas_export)
-            state::canvas_export->signal_layer_image_updated();
+            state::animation_preview->signal_layer_image_updated(cells);
 
         if (state::log_box)
-            state::log_box->signal_layer_image_updated();
+            state::log_box->signal_layer_image_updated(cells);
     }
 
     void ProjectState::signal_layer_count_changed()
     {
+        // history refers to cells by index and assumes a fixed resolution
+        _undo_history.clear();
+
         if (state::canvas)
             state::canvas->signal_layer_count_changed();
 
@@ -1506,13 +1830,13 @@ namespace mousetrap
 
         if (state::animation_preview)
             state::animation_preview->signal_layer_count_changed();
-
-        if (state::canvas_export)
-            state::canvas_export->signal_layer_count_changed();
     }
 
     void ProjectState::signal_layer_resolution_changed()
     {
+        // history refers to cells by index and assumes a fixed resolution
+        _undo_history.clear();
+
         if (state::canvas)
             state::canvas->signal_layer_resolution_changed();
 
@@ -1525,9 +1849,6 @@ namespace mousetrap
         if (state::animation_preview)
             state::animation_preview->signal_layer_resolution_changed();
 
-        if (state::canvas_export)
-            state::canvas_export->signal_layer_resolution_changed();
-
         if (state::scale_canvas_dialog)
             state::scale_canvas_dialog->signal_layer_resolution_changed();
 
@@ -1551,9 +1872,6 @@ namespace mousetrap
 
         if (state::animation_preview)
             state::animation_preview->signal_layer_properties_changed();
-
-        if (state::canvas_export)
-            state::canvas_export->signal_layer_properties_changed();
     }
 
     void ProjectState::signal_active_tool_changed()
@@ -1605,6 +1923,8 @@ namespace mousetrap
     {
         if (state::log_box)
             state::log_box->signal_save_path_changed();
+
+        state::actions::save_file_load_state_from_file.set_enabled(not _save_path.empty());
     }
 
     void ProjectState::signal_cursor_position_changed()
@@ -50,7 +50,7 @@ namespace mousetrap
         update_current_image_texture();
     }
 
-    void ResizeCanvasDialog::on_layer_image_updated()
+    void ResizeCanvasDialog::on_layer_image_updated(const signals::CellInvalidation&)
     {
         update_current_image_texture();
     }
@@ -7,7 +7,93 @@
 #include <app/frame_view.hpp>
 #include <app/animation_preview.hpp>
 #include <app/color_swapper.hpp>
+#include <app/bubble_log_area.hpp>
+#include <app/add_shortcut_action.hpp>
+#include <app/file_chooser_dialog.hpp>
+
+#include <filesystem>
 
 namespace mousetrap
 {
-}
\ No newline at end of file
+    namespace detail
+    {
+        // used until the project was saved or loaded once, so saving never writes relative to the working directory
+        std::string get_untitled_save_path()
+        {
+            auto directory = std::filesystem::path(g_get_user_data_dir()) / "mousetrap" / "projects";
+
+            std::error_code error;
+            std::filesystem::create_directories(directory, error);
+
+            auto path = directory / "untitled.mtp";
+            for (size_t i = 1; std::filesystem::exists(path, error); ++i)
+                path = directory / ("untitled_" + std::to_string(i) + ".mtp");
+
+            return path.string();
+        }
+    }
+
+    void initialize_save_file_actions()
+    {
+        using namespace state::actions;
+
+        save_file_save_state_to_file.set_function([](){
+            auto path = active_state->get_save_path();
+            if (path.empty())
+            {
+                path = detail::get_untitled_save_path();
+                state::bubble_log->send_message("Project was not saved before, saving to `" + path + "`", InfoMessageType::WARNING);
+            }
+
+            if (active_state->save_to_file(path))
+                state::bubble_log->send_message("Saved project to `" + path + "`");
+            else
+                state::bubble_log->send_message("Unable to save project to `" + path + "`", InfoMessageType::ERROR);
+        });
+
+        save_file_load_state_from_file.set_function([](){
+            auto path = active_state->get_save_path();
+            if (active_state->load_from_file(path))
+                state::bubble_log->send_message("Loaded project from `" + path + "`");
+            else
+                state::bubble_log->send_message("Unable to load project from `" + path + "`: File does not exist or is not a valid project file", InfoMessageType::ERROR);
+        });
+
+        // dialog warns before overwriting, frames are encoded on worker threads, c.f. ProjectState::export_animation
+        save_file_export_as_animation.set_function([](){
+            static SaveAsFileDialog* dialog = nullptr;
+            if (dialog == nullptr)
+            {
+                dialog = new SaveAsFileDialog("Export As Animation...");
+                dialog->set_on_accept_pressed([](SaveAsFileDialog* instance){
+                    active_state->export_animation(instance->get_current_name());
+                    instance->close();
+                });
+
+                dialog->set_on_cancel_pressed([](SaveAsFileDialog* instance){
+                    instance->close();
+                });
+
+                auto gif = FileFilter(".gif");
+                gif.add_allowed_suffix("gif");
+                dialog->get_file_chooser().add_filter(gif, true);
+
+                auto apng = FileFilter(".apng");
+                apng.add_allowed_suffix("apng");
+                apng.add_allowed_suffix("png");
+                dialog->get_file_chooser().add_filter(apng);
+            }
+
+            auto path = active_state->get_save_path();
+            auto name = path.empty() ? std::string("untitled") : std::filesystem::path(path).stem().string();
+            dialog->get_name_entry().set_text(name + ".gif");
+            dialog->show();
+        });
+
+        for (auto* action : {&save_file_save_state_to_file, &save_file_load_state_from_file})
+            state::add_shortcut_action(*action);
+
+        // nothing to load until the project was saved or loaded, c.f. ProjectState::signal_save_path_changed
+        save_file_load_state_from_file.set_enabled(false);
+    }
+}
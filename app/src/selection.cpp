@@ -7,224 +7,356 @@
 
 namespace mousetrap
 {
+    namespace detail
+    {
+        using SelectionRow = std::vector<std::pair<int64_t, int64_t>>;
+
+        // append range, merging it with the last range if they touch. Ranges have to be pushed in ascending order
+        void push_range(SelectionRow& row, int64_t begin, int64_t end)
+        {
+            if (begin >= end)
+                return;
+
+            if (not row.empty() and begin <= row.back().second)
+                row.back().second = std::max(row.back().second, end);
+            else
+                row.emplace_back(begin, end);
+        }
+
+        SelectionRow row_union(const SelectionRow& a, const SelectionRow& b)
+        {
+            SelectionRow out;
+            out.reserve(a.size() + b.size());
+
+            auto a_it = a.begin();
+            auto b_it = b.begin();
+            while (a_it != a.end() or b_it != b.end())
+            {
+                if (b_it == b.end() or (a_it != a.end() and a_it->first < b_it->first))
+                    push_range(out, a_it->first, a_it->second), ++a_it;
+                else
+                    push_range(out, b_it->first, b_it->second), ++b_it;
+            }
+
+            return out;
+        }
+
+        SelectionRow row_subtract(const SelectionRow& a, const SelectionRow& b)
+        {
+            SelectionRow out;
+            out.reserve(a.size() + b.size());
+
+            auto b_it = b.begin();
+            for (auto range : a)
+            {
+                auto begin = range.first;
+                while (b_it != b.end() and b_it->second <= begin)
+                    ++b_it;
+
+                for (auto it = b_it; it != b.end() and it->first < range.second; ++it)
+                {
+                    push_range(out, begin, it->first);
+                    begin = std::max(begin, it->second);
+                }
+
+                push_range(out, begin, range.second);
+            }
+
+            return out;
+        }
+
+        // ranges of [begin, end) not covered by row
+        SelectionRow row_complement(const SelectionRow& row, int64_t begin, int64_t end)
+        {
+            return row_subtract(SelectionRow{{begin, end}}, row);
+        }
+    }
+
     Selection::Selection()
     {}
 
     bool Selection::at(Vector2i xy) const
     {
-         return _data.find(xy) != _data.end();
+        auto local = xy - _offset;
+        auto row_i = local.y - _y_min;
+        if (row_i < 0 or row_i >= int64_t(_rows.size()))
+            return false;
+
+        const auto& row = _rows[row_i];
+
+        // first range that ends after x
+        auto it = std::upper_bound(row.begin(), row.end(), local.x, [](int64_t x, const std::pair<int64_t, int64_t>& range){
+            return x < range.second;
+        });
+
+        return it != row.end() and it->first <= local.x;
     }
 
     void Selection::create_from(const Vector2iSet& set)
     {
-        _x_min = std::numeric_limits<int>::max();
-        _x_max = std::numeric_limits<int>::min();
-        _y_min = std::numeric_limits<int>::max();
-        _y_max = std::numeric_limits<int>::min();
+        _rows.clear();
+        _offset = {0, 0};
+        _y_min = 0;
 
+        if (set.empty())
+        {
+            generate_outline_vertices();
+            return;
+        }
+
+        auto y_min = std::numeric_limits<int64_t>::max();
+        auto y_max = std::numeric_limits<int64_t>::min();
         for (const auto& vec : set)
         {
-            if (vec.x <= _x_min)
-                _x_min = vec.x;
+            y_min = std::min(y_min, vec.y);
+            y_max = std::max(y_max, vec.y);
+        }
 
-            if (vec.x >= _x_max)
-                _x_max = vec.x;
+        std::vector<std::vector<int64_t>> xs(y_max - y_min + 1);
+        for (const auto& vec : set)
+            xs.at(vec.y - y_min).push_back(vec.x);
 
-            if (vec.y <= _y_min)
-                _y_min = vec.y;
+        _y_min = y_min;
+        _rows.resize(xs.size());
+        for (size_t i = 0; i < xs.size(); ++i)
+        {
+            auto& row_xs = xs.at(i);
+            std::sort(row_xs.begin(), row_xs.end());
 
-            if (vec.y >= _y_max)
-                _y_max = vec.y;
+            for (auto x : row_xs)
+                detail::push_range(_rows.at(i), x, x + 1);
         }
 
-        _data = set;
+        trim();
         generate_outline_vertices();
     }
 
-    void Selection::create_from_rectangle(Vector2i top_left, Vector2i size)
+    void Selection::create_from(const PixelMask& mask)
     {
-        _data.clear();
+        _rows.clear();
+        _rows.resize(mask.get_size().y);
+        _offset = {0, 0};
+        _y_min = 0;
 
-        _x_min = top_left.x;
-        _y_min = top_left.y;
-        _x_max = top_left.x + size.x;
-        _y_max = top_left.y + size.y;
+        for (size_t y = 0; y < mask.get_size().y; ++y)
+        {
+            auto pixels = mask.get_row(y);
+            auto& row = _rows.at(y);
 
-        for (int x = _x_min; x <= _x_max; ++x)
-            for (int y = _y_min; y <= _y_max; ++y)
-                _data.insert({x, y});
+            size_t x = 0;
+            while (x < pixels.size())
+            {
+                while (x < pixels.size() and pixels[x] == 0)
+                    ++x;
 
-        _outline_vertices.left_to_right = {
-            {{top_left.x, top_left.y}, {top_left.x + size.x, top_left.y}}
-        };
+                auto begin = x;
+                while (x < pixels.size() and pixels[x] != 0)
+                    ++x;
 
-        _outline_vertices.right_to_left = {
-            {{top_left.x + size.x, top_left.y + size.y}, {top_left.x, top_left.y + size.y}}
-        };
+                detail::push_range(row, begin, x);
+            }
+        }
+
+        trim();
+        generate_outline_vertices();
+    }
 
-        _outline_vertices.bottom_to_top = {
-            {{top_left.x, top_left.y}, {top_left.x, top_left.y + size.y}}
-        };
+    void Selection::create_from_rectangle(Vector2i top_left, Vector2i size)
+    {
+        _offset = {0, 0};
+        _y_min = top_left.y;
+        _rows.assign(std::max<int64_t>(size.y, 0), Row());
 
-        _outline_vertices.top_to_bottom = {
-            {{top_left.x + size.x, top_left.y}, {top_left.x + size.x, top_left.y + size.y}}
-        };
+        for (auto& row : _rows)
+            detail::push_range(row, top_left.x, top_left.x + size.x);
+
+        trim();
+        generate_outline_vertices();
     }
 
     void Selection::apply_offset(Vector2i offset)
     {
-        auto new_set = Vector2iSet();
-        for (auto pair : _data)
-            new_set.insert(pair + offset);
-
-        create_from(new_set);
+        _offset += offset;
     }
 
-    const Selection::OutlineVertices& Selection::get_outline_vertices() const
+    Vector2i Selection::get_offset() const
     {
-        return _outline_vertices;
+        return _offset;
     }
 
-    void Selection::invert(int x_min, int y_min, int x_max, int y_max)
+    void Selection::bake_offset()
     {
-         auto set = Vector2iSet();
-         for (int x = x_min; x < x_max; ++x)
-             for (int y = y_min; y < y_max; ++y)
-                 if (not at({x, y}))
-                     set.insert({x, y});
+        if (_offset.x == 0 and _offset.y == 0)
+            return;
 
-        create_from(set);
+        _y_min += _offset.y;
+        for (auto& row : _rows)
+        {
+            for (auto& range : row)
+            {
+                range.first += _offset.x;
+                range.second += _offset.x;
+            }
+        }
+
+        _offset = {0, 0};
+        generate_outline_vertices();
     }
 
-    void Selection::add(const Vector2iSet& other)
+    void Selection::trim()
     {
-        auto before = _data.size();
-        auto add = other.size();
+        size_t n_leading = 0;
+        while (n_leading < _rows.size() and _rows.at(n_leading).empty())
+            ++n_leading;
 
-        for (auto pos : other)
+        if (n_leading == _rows.size())
         {
-            if (pos.x < _x_min)
-                _x_min = pos.x;
+            _rows.clear();
+            _y_min = 0;
+            return;
+        }
 
-            if (pos.y < _y_min)
-                _y_min = pos.y;
+        size_t n_trailing = 0;
+        while (_rows.at(_rows.size() - 1 - n_trailing).empty())
+            ++n_trailing;
 
-            if (pos.x > _x_max)
-                _x_max = pos.x;
+        _rows.erase(_rows.end() - n_trailing, _rows.end());
+        _rows.erase(_rows.begin(), _rows.begin() + n_leading);
+        _y_min += n_leading;
+    }
 
-            if (pos.y > _y_max)
-                _y_max = pos.y;
+    const Selection::OutlineVertices& Selection::get_outline_vertices() const
+    {
+        return _outline_vertices;
+    }
 
-            _data.insert(pos);
+    void Selection::invert(int x_min, int y_min, int x_max, int y_max)
+    {
+        bake_offset();
+
+        std::vector<Row> rows(std::max(y_max - y_min, 0));
+        for (int y = y_min; y < y_max; ++y)
+        {
+            auto row_i = int64_t(y) - _y_min;
+            if (row_i >= 0 and row_i < int64_t(_rows.size()))
+                rows.at(y - y_min) = detail::row_complement(_rows.at(row_i), x_min, x_max);
+            else
+                rows.at(y - y_min) = Row{{x_min, x_max}};
         }
 
+        _rows = std::move(rows);
+        _y_min = y_min;
+
+        trim();
         generate_outline_vertices();
     }
 
-    void Selection::subtract(const Vector2iSet& other)
+    void Selection::add(const Selection& other_in)
     {
-        for (auto pos : other)
-            _data.erase(pos);
+        if (other_in._rows.empty())
+            return;
+
+        auto other = other_in;
+        other.bake_offset();
+        bake_offset();
 
-        for (auto& pos : _data)
+        if (_rows.empty())
         {
-            if (pos.x < _x_min)
-                _x_min = pos.x;
+            _rows = std::move(other._rows);
+            _y_min = other._y_min;
+            generate_outline_vertices();
+            return;
+        }
 
-            if (pos.y < _y_min)
-                _y_min = pos.y;
+        auto y_min = std::min(_y_min, other._y_min);
+        auto y_max = std::max<int64_t>(_y_min + _rows.size(), other._y_min + other._rows.size());
 
-            if (pos.x > _x_max)
-                _x_max = pos.x;
+        std::vector<Row> rows(y_max - y_min);
+        for (int64_t y = y_min; y < y_max; ++y)
+        {
+            static const Row empty;
+            auto self_i = y - _y_min;
+            auto other_i = y - other._y_min;
 
-            if (pos.y > _y_max)
-                _y_max = pos.y;
+            const auto& a = (self_i >= 0 and self_i < int64_t(_rows.size())) ? _rows.at(self_i) : empty;
+            const auto& b = (other_i >= 0 and other_i < int64_t(other._rows.size())) ? other._rows.at(other_i) : empty;
+            rows.at(y - y_min) = detail::row_union(a, b);
         }
 
+        _rows = std::move(rows);
+        _y_min = y_min;
+
         generate_outline_vertices();
     }
 
-    void Selection::generate_outline_vertices()
+    void Selection::add(const Vector2iSet& other)
     {
-        _outline_vertices = OutlineVertices();
+        auto selection = Selection();
+        selection.create_from(other);
+        add(selection);
+    }
 
-        std::map<int, std::vector<std::pair<int, int>>> data_by_y;
-        for (int y = _y_min; y <= _y_max; ++y)
-        {
-            std::vector<std::pair<int, int>> vec = {};
-            for (int x = _x_min; x <= _x_max; ++x)
-            {
-                auto it = _data.find({x, y});
-                if (it == _data.end())
-                    continue;
-
-                if (vec.empty())
-                    vec.push_back({x, x});
-                else if (x == vec.back().second + 1)
-                    vec.back().second += 1;
-                else
-                    vec.push_back({x, x});
-            }
+    void Selection::subtract(const Selection& other_in)
+    {
+        if (_rows.empty() or other_in._rows.empty())
+            return;
 
-            if (not vec.empty())
-                data_by_y[y] = vec;
-        }
+        auto other = other_in;
+        other.bake_offset();
+        bake_offset();
 
-        std::map<int, std::vector<std::pair<int, int>>> data_by_x;
-        for (int x = _x_min; x <= _x_max; ++x)
+        for (size_t i = 0; i < _rows.size(); ++i)
         {
-            std::vector<std::pair<int, int>> vec = {};
-            for (int y = _y_min; y <= _y_max; ++y)
-            {
-                auto it = _data.find({x, y});
-                if (it == _data.end())
-                    continue;
-
-                if (vec.empty())
-                    vec.push_back({y, y});
-                else if (y == vec.back().second + 1)
-                    vec.back().second += 1;
-                else
-                    vec.push_back({y, y});
-            }
-
-            if (not vec.empty())
-                data_by_x[x] = vec;
+            auto other_i = int64_t(_y_min + i) - other._y_min;
+            if (other_i >= 0 and other_i < int64_t(other._rows.size()))
+                _rows.at(i) = detail::row_subtract(_rows.at(i), other._rows.at(other_i));
         }
 
-        for (int x = _x_min; x <= _x_max; ++x)
-        {
-            auto it = data_by_x.find(x);
-            if (it == data_by_x.end())
-                continue;
+        trim();
+        generate_outline_vertices();
+    }
 
-            for (auto& range : it->second)
-            {
-                int y1 = range.first;
-                int y2 = range.second;
-                _outline_vertices.left_to_right.push_back({{x, y1}, {x+1, y1}});
-                _outline_vertices.right_to_left.push_back({{x, y2+1}, {x+1, y2+1}});
-            }
-        }
+    void Selection::subtract(const Vector2iSet& other)
+    {
+        auto selection = Selection();
+        selection.create_from(other);
+        subtract(selection);
+    }
 
-        for (int y = _y_min; y <= _y_max; ++y)
+    void Selection::generate_outline_vertices()
+    {
+        _outline_vertices = OutlineVertices();
+
+        static const Row empty;
+        for (size_t i = 0; i < _rows.size(); ++i)
         {
-            auto it = data_by_y.find(y);
-            if (it == data_by_y.end())
-                continue;
+            const int64_t y = _y_min + i;
+            const auto& row = _rows.at(i);
+            const auto& above = i > 0 ? _rows.at(i - 1) : empty;
+            const auto& below = i + 1 < _rows.size() ? _rows.at(i + 1) : empty;
 
-            for (auto& range : it->second)
+            for (auto& range : row)
             {
-                int x1 = range.first;
-                int x2 = range.second;
-                _outline_vertices.bottom_to_top.push_back({{x1, y}, {x1, y+1}});
-                _outline_vertices.top_to_bottom.push_back({{x2+1, y}, {x2+1, y+1}});
+                _outline_vertices.bottom_to_top.push_back({{range.first, y}, {range.first, y + 1}});
+                _outline_vertices.top_to_bottom.push_back({{range.second, y}, {range.second, y + 1}});
             }
+
+            // horizontal edges are the parts of a row not covered by its neighbour
+            for (auto& range : detail::row_subtract(row, above))
+                _outline_vertices.left_to_right.push_back({{range.first, y}, {range.second, y}});
+
+            for (auto& range : detail::row_subtract(row, below))
+                _outline_vertices.right_to_left.push_back({{range.first, y + 1}, {range.second, y + 1}});
         }
     }
 
     size_t Selection::size() const
     {
-        return _data.size();
+        size_t out = 0;
+        for (auto& row : _rows)
+            for (auto& range : row)
+                out += range.second - range.first;
+
+        return out;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,324 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/27/23
+//
+
+#include <app/spritesheet_packer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        struct PackerRect
+        {
+            size_t x, y, width, height;
+
+            bool contains(const PackerRect& other) const
+            {
+                return other.x >= x and other.y >= y and other.x + other.width <= x + width and other.y + other.height <= y + height;
+            }
+
+            bool intersects(const PackerRect& other) const
+            {
+                return other.x < x + width and other.x + other.width > x and other.y < y + height and other.y + other.height > y;
+            }
+        };
+
+        size_t hash_sprite(const Image& sprite)
+        {
+            const auto size = sprite.get_size();
+            auto bytes = std::string_view(static_cast<const char*>(sprite.data()), sprite.get_n_pixels() * 4);
+            return std::hash<std::string_view>()(bytes) ^ (size.x * 0x9E3779B97F4A7C15ull + size.y);
+        }
+
+        bool sprites_equal(const Image& a, const Image& b)
+        {
+            const auto a_size = a.get_size();
+            const auto b_size = b.get_size();
+            return a_size.x == b_size.x and a_size.y == b_size.y and std::memcmp(a.data(), b.data(), a.get_n_pixels() * 4) == 0;
+        }
+    }
+
+    Vector2ui get_alpha_bounds(const Image& image, Vector2ui& top_left)
+    {
+        const auto size = image.get_size();
+        top_left = {0, 0};
+
+        // or-reduce alpha of whole rows, which needs no branch per pixel
+        auto row_is_transparent = [&](size_t y) {
+            const uint8_t* row = image.get_row(y).data();
+            uint8_t alpha = 0;
+            for (size_t x = 0; x < size.x; ++x)
+                alpha |= row[x * 4 + 3];
+
+            return alpha == 0;
+        };
+
+        size_t y_min = 0;
+        while (y_min < size.y and row_is_transparent(y_min))
+            y_min += 1;
+
+        if (y_min == size.y)
+            return {0, 0};
+
+        size_t y_max = size.y - 1;
+        while (y_max > y_min and row_is_transparent(y_max))
+            y_max -= 1;
+
+        // each row only has to be scanned up to the bounds found so far
+        size_t x_min = size.x - 1;
+        size_t x_max = 0;
+        for (size_t y = y_min; y <= y_max; ++y)
+        {
+            const uint8_t* row = image.get_row(y).data();
+
+            for (size_t x = 0; x < x_min; ++x)
+            {
+                if (row[x * 4 + 3] != 0)
+                {
+                    x_min = x;
+                    break;
+                }
+            }
+
+            for (size_t x = size.x - 1; x > x_max; --x)
+            {
+                if (row[x * 4 + 3] != 0)
+                {
+                    x_max = x;
+                    break;
+                }
+            }
+        }
+
+        top_left = {x_min, y_min};
+        return {x_max - x_min + 1, y_max - y_min + 1};
+    }
+
+    SpritesheetPacker::SpritesheetPacker(Vector2ui frame_size, size_t padding)
+        : _frame_size(frame_size), _padding(padding)
+    {}
+
+    size_t SpritesheetPacker::add_frame(const Image& frame_in)
+    {
+        const size_t frame_i = _frames.size();
+
+        const auto size = frame_in.get_size();
+        if (size.x != _frame_size.x or size.y != _frame_size.y)
+        {
+            std::cerr << "[ERROR] In SpritesheetPacker::add_frame: Frame is " << size.x << "x" << size.y << " px, but frames of this sheet are " << _frame_size.x << "x" << _frame_size.y << " px" << std::endl;
+            _frames.push_back({-1, {0, 0}});
+            return frame_i;
+        }
+
+        const Image* frame = &frame_in;
+        Image converted;
+        if (frame_in.get_format() != ImageFormat::RGBA8)
+        {
+            converted = frame_in;
+            converted.set_format(ImageFormat::RGBA8);
+            frame = &converted;
+        }
+
+        Vector2ui top_left;
+        const auto sprite_size = get_alpha_bounds(*frame, top_left);
+        if (sprite_size.x == 0 or sprite_size.y == 0)
+        {
+            _frames.push_back({-1, {0, 0}});
+            return frame_i;
+        }
+
+        auto sprite = Image(ImageFormat::RGBA8);
+        sprite.create(sprite_size.x, sprite_size.y, RGBA(0, 0, 0, 0));
+        sprite.copy_region(*frame, Vector2i(top_left.x, top_left.y), sprite_size, {0, 0});
+
+        const auto hash = detail::hash_sprite(sprite);
+        auto [begin, end] = _sprite_hashes.equal_range(hash);
+        for (auto it = begin; it != end; ++it)
+        {
+            if (detail::sprites_equal(_sprites.at(it->second), sprite))
+            {
+                _frames.push_back({int(it->second), top_left});
+                return frame_i;
+            }
+        }
+
+        _sprite_hashes.insert({hash, _sprites.size()});
+        _frames.push_back({int(_sprites.size()), top_left});
+        _sprites.push_back(std::move(sprite));
+        return frame_i;
+    }
+
+    size_t SpritesheetPacker::get_n_frames() const
+    {
+        return _frames.size();
+    }
+
+    size_t SpritesheetPacker::get_n_sprites() const
+    {
+        return _sprites.size();
+    }
+
+    bool SpritesheetPacker::place(size_t width, std::vector<Vector2ui>& positions, Vector2ui& sheet_size) const
+    {
+        // padding is added to the right and bottom of each sprite, the bin is widened so the last column needs none
+        size_t bin_height = 0;
+        for (const auto& sprite : _sprites)
+            bin_height += sprite.get_size().y + _padding;
+
+        std::vector<detail::PackerRect> free = {{0, 0, width + _padding, bin_height}};
+
+        // largest first, small sprites fill the gaps they leave
+        std::vector<size_t> order(_sprites.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){
+            auto a_size = _sprites.at(a).get_size();
+            auto b_size = _sprites.at(b).get_size();
+            return std::max(a_size.x, a_size.y) > std::max(b_size.x, b_size.y);
+        });
+
+        positions.assign(_sprites.size(), {0, 0});
+        sheet_size = {0, 0};
+
+        for (size_t sprite_i : order)
+        {
+            const auto size = _sprites.at(sprite_i).get_size();
+            const size_t rect_width = size.x + _padding;
+            const size_t rect_height = size.y + _padding;
+
+            // bottom left rule: lowest top edge, then leftmost, keeps the sheet short
+            const detail::PackerRect* best = nullptr;
+            for (const auto& rect : free)
+            {
+                if (rect.width < rect_width or rect.height < rect_height)
+                    continue;
+
+                if (best == nullptr or rect.y < best->y or (rect.y == best->y and rect.x < best->x))
+                    best = &rect;
+            }
+
+            if (best == nullptr)
+                return false;
+
+            const auto placed = detail::PackerRect{best->x, best->y, rect_width, rect_height};
+            positions.at(sprite_i) = {placed.x, placed.y};
+            sheet_size.x = std::max<size_t>(sheet_size.x, placed.x + size.x);
+            sheet_size.y = std::max<size_t>(sheet_size.y, placed.y + size.y);
+
+            // split every free rect the sprite overlaps into up to four maximal rects around it
+            std::vector<detail::PackerRect> next;
+            next.reserve(free.size() + 4);
+            for (const auto& rect : free)
+            {
+                if (not rect.intersects(placed))
+                {
+                    next.push_back(rect);
+                    continue;
+                }
+
+                if (placed.x > rect.x)
+                    next.push_back({rect.x, rect.y, placed.x - rect.x, rect.height});
+
+                if (placed.x + placed.width < rect.x + rect.width)
+                    next.push_back({placed.x + placed.width, rect.y, rect.x + rect.width - (placed.x + placed.width), rect.height});
+
+                if (placed.y > rect.y)
+                    next.push_back({rect.x, rect.y, rect.width, placed.y - rect.y});
+
+                if (placed.y + placed.height < rect.y + rect.height)
+                    next.push_back({rect.x, placed.y + placed.height, rect.width, rect.y + rect.height - (placed.y + placed.height)});
+            }
+
+            // drop rects contained in others, keeps the list from growing with every placement
+            free.clear();
+            for (size_t i = 0; i < next.size(); ++i)
+            {
+                bool is_contained = false;
+                for (size_t j = 0; j < next.size() and not is_contained; ++j)
+                {
+                    if (i == j or not next[j].contains(next[i]))
+                        continue;
+
+                    // of two identical rects, keep the first
+                    is_contained = not next[i].contains(next[j]) or j < i;
+                }
+
+                if (not is_contained)
+                    free.push_back(next[i]);
+            }
+        }
+
+        return true;
+    }
+
+    PackedSpritesheet SpritesheetPacker::pack() const
+    {
+        PackedSpritesheet out;
+        out.frame_size = _frame_size;
+        out.frames = _frames;
+        out.image = Image(ImageFormat::RGBA8);
+
+        if (_sprites.empty())
+        {
+            out.image.create(1, 1, RGBA(0, 0, 0, 0));
+            return out;
+        }
+
+        size_t max_width = 0;
+        size_t area = 0;
+        for (const auto& sprite : _sprites)
+        {
+            auto size = sprite.get_size();
+            max_width = std::max<size_t>(max_width, size.x);
+            area += (size.x + _padding) * (size.y + _padding);
+        }
+
+        // widths around the square layout, as well as powers of two since some targets need them
+        std::vector<size_t> widths = {max_width};
+        const auto side = std::sqrt(double(area));
+        for (double factor : {0.75, 0.875, 1.0, 1.125, 1.25, 1.5, 2.0})
+            widths.push_back(std::max<size_t>(max_width, std::ceil(side * factor)));
+
+        for (size_t width = 1; width < 2 * side; width *= 2)
+            if (width >= max_width)
+                widths.push_back(width);
+
+        std::vector<Vector2ui> best_positions;
+        Vector2ui best_size = {0, 0};
+
+        for (size_t width : widths)
+        {
+            std::vector<Vector2ui> positions;
+            Vector2ui size;
+            if (not place(width, positions, size))
+                continue;
+
+            const bool is_smaller = size.x * size.y < best_size.x * best_size.y;
+            const bool is_squarer = size.x * size.y == best_size.x * best_size.y and std::max(size.x, size.y) < std::max(best_size.x, best_size.y);
+            if (best_positions.empty() or is_smaller or is_squarer)
+            {
+                best_positions = std::move(positions);
+                best_size = size;
+            }
+        }
+
+        out.image.create(best_size.x, best_size.y, RGBA(0, 0, 0, 0));
+        for (size_t sprite_i = 0; sprite_i < _sprites.size(); ++sprite_i)
+        {
+            const auto& sprite = _sprites.at(sprite_i);
+            const auto position = best_positions.at(sprite_i);
+
+            out.image.copy_region(sprite, {0, 0}, sprite.get_size(), Vector2i(position.x, position.y));
+            out.sprites.push_back({position, sprite.get_size()});
+        }
+
+        return out;
+    }
+}
@@ -0,0 +1,245 @@
+// 
+// Copyright 2022 Clemens Cords
+// Created on 3/20/23 by clem (mail@clemens-cords.com)
+//
+
+#include <app/thumbnail_atlas.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace mousetrap
+{
+    Image generate_cell_preview(const Layer::Frame* frame, Vector2ui size)
+    {
+        auto out = Image();
+        out.create(size.x, size.y, RGBA(0, 0, 0, 0));
+
+        if (frame == nullptr or size.x == 0 or size.y == 0)
+            return out;
+
+        const auto resolution = frame->get_size();
+        if (resolution.x == 0 or resolution.y == 0)
+            return out;
+
+        const float x_step = resolution.x / float(size.x);
+        const float y_step = resolution.y / float(size.y);
+
+        // when minifying, average up to 2x2 samples per pixel instead of the whole footprint so the cost does not depend on the frame resolution
+        const size_t x_n_samples = x_step > 1 ? 2 : 1;
+        const size_t y_n_samples = y_step > 1 ? 2 : 1;
+
+        for (size_t y = 0; y < size.y; ++y)
+        {
+            for (size_t x = 0; x < size.x; ++x)
+            {
+                auto sum = RGBA(0, 0, 0, 0);
+                for (size_t sample_y = 0; sample_y < y_n_samples; ++sample_y)
+                {
+                    for (size_t sample_x = 0; sample_x < x_n_samples; ++sample_x)
+                    {
+                        auto source_x = std::min<size_t>((x + (sample_x + 0.5f) / x_n_samples) * x_step, resolution.x - 1);
+                        auto source_y = std::min<size_t>((y + (sample_y + 0.5f) / y_n_samples) * y_step, resolution.y - 1);
+
+                        // premultiply so transparent pixels do not bleed their color
+                        auto color = frame->get_pixel(source_x, source_y);
+                        sum.r += color.r * color.a;
+                        sum.g += color.g * color.a;
+                        sum.b += color.b * color.a;
+                        sum.a += color.a;
+                    }
+                }
+
+                if (sum.a > 0)
+                {
+                    sum.r /= sum.a;
+                    sum.g /= sum.a;
+                    sum.b /= sum.a;
+                    sum.a /= x_n_samples * y_n_samples;
+                    out.set_pixel(x, y, sum);
+                }
+            }
+        }
+
+        return out;
+    }
+
+    ThumbnailAtlas::ThumbnailAtlas()
+    {
+        _texture = new Texture();
+    }
+
+    ThumbnailAtlas::~ThumbnailAtlas()
+    {
+        delete _texture;
+    }
+
+    void ThumbnailAtlas::set_requirements(const void* owner, Vector2ui tile_size, size_t n_tiles)
+    {
+        auto it = _requirements.find(owner);
+        if (it != _requirements.end() and it->second.tile_size == tile_size and it->second.n_tiles == n_tiles)
+            return;
+
+        _requirements.insert_or_assign(owner, Requirements{tile_size, n_tiles});
+        _allocation_outdated = true;
+    }
+
+    void ThumbnailAtlas::remove_requirements(const void* owner)
+    {
+        if (_requirements.erase(owner) > 0)
+            _allocation_outdated = true;
+    }
+
+    void ThumbnailAtlas::update_allocation()
+    {
+        _allocation_outdated = false;
+
+        // keep the texture inside the size every driver supports, and the number of tiles bounded for tiny previews
+        static const size_t max_texture_size = 4096;
+        static const size_t max_n_tiles_per_side = 128;
+
+        Vector2ui tile_size = {1, 1};
+        size_t n_tiles = 0;
+        for (auto& pair : _requirements)
+        {
+            tile_size.x = std::max<size_t>(tile_size.x, pair.second.tile_size.x);
+            tile_size.y = std::max<size_t>(tile_size.y, pair.second.tile_size.y);
+            n_tiles += pair.second.n_tiles;
+        }
+
+        tile_size.x = std::min<size_t>(tile_size.x, max_texture_size);
+        tile_size.y = std::min<size_t>(tile_size.y, max_texture_size);
+
+        const Vector2ui max_n_tiles = {
+            std::min<size_t>(max_texture_size / tile_size.x, max_n_tiles_per_side),
+            std::min<size_t>(max_texture_size / tile_size.y, max_n_tiles_per_side)
+        };
+
+        n_tiles = std::clamp<size_t>(n_tiles, 1, max_n_tiles.x * max_n_tiles.y);
+
+        // only grow while the tile size stays the same, so scrolling back and forth does not reallocate
+        if (tile_size == _tile_size and n_tiles <= _tiles.size())
+            return;
+
+        // round up so the atlas is reallocated a logarithmic number of times while views grow
+        size_t capacity = 16;
+        while (capacity < n_tiles)
+            capacity *= 2;
+
+        capacity = std::min<size_t>(capacity, max_n_tiles.x * max_n_tiles.y);
+
+        _tile_size = tile_size;
+        _n_tiles.x = std::min<size_t>(std::ceil(std::sqrt(double(capacity))), max_n_tiles.x);
+        _n_tiles.y = (capacity + _n_tiles.x - 1) / _n_tiles.x;
+
+        _tiles.clear();
+        _tiles.resize(_n_tiles.x * _n_tiles.y);
+        _cell_to_tile.clear();
+        _n_requests = 0;
+        _layout_revision += 1;
+
+        // previews are 8-bit, a float texture would double the memory for nothing
+        _texture->create(_n_tiles.x * _tile_size.x, _n_tiles.y * _tile_size.y, ImageFormat::RGBA8);
+    }
+
+    Vector2ui ThumbnailAtlas::get_tile_size() const
+    {
+        return _tile_size;
+    }
+
+    Vector2ui ThumbnailAtlas::get_tile_top_left(size_t tile_i) const
+    {
+        return {
+            (tile_i % _n_tiles.x) * _tile_size.x,
+            (tile_i / _n_tiles.x) * _tile_size.y
+        };
+    }
+
+    Rectangle ThumbnailAtlas::request(CellPosition cell)
+    {
+        if (_allocation_outdated)
+            update_allocation();
+
+        auto key = std::pair<size_t, size_t>(cell.x, cell.y);
+        auto it = _cell_to_tile.find(key);
+
+        size_t tile_i;
+        if (it != _cell_to_tile.end())
+            tile_i = it->second;
+        else
+        {
+            // free tile if there is one, least recently used otherwise
+            tile_i = 0;
+            for (size_t i = 0; i < _tiles.size(); ++i)
+            {
+                if (not _tiles.at(i).is_occupied)
+                {
+                    tile_i = i;
+                    break;
+                }
+
+                if (_tiles.at(i).last_used < _tiles.at(tile_i).last_used)
+                    tile_i = i;
+            }
+
+            auto& tile = _tiles.at(tile_i);
+            if (tile.is_occupied)
+                _cell_to_tile.erase({tile.cell.x, tile.cell.y});
+
+            tile.cell = cell;
+            tile.is_occupied = true;
+            tile.is_valid = false;
+            _cell_to_tile.insert({key, tile_i});
+            _layout_revision += 1;
+        }
+
+        auto& tile = _tiles.at(tile_i);
+        tile.last_used = ++_n_requests;
+
+        auto top_left = get_tile_top_left(tile_i);
+        if (not tile.is_valid)
+        {
+            auto preview = generate_cell_preview(active_state->get_frame(cell.x, cell.y), _tile_size);
+            _texture->update_from_image(preview, {0, 0}, _tile_size, Vector2i(top_left));
+            tile.is_valid = true;
+        }
+
+        auto texture_size = Vector2f(_texture->get_size());
+        return Rectangle{
+            {top_left.x / texture_size.x, top_left.y / texture_size.y},
+            {_tile_size.x / texture_size.x, _tile_size.y / texture_size.y}
+        };
+    }
+
+    void ThumbnailAtlas::invalidate(CellPosition cell)
+    {
+        auto it = _cell_to_tile.find({cell.x, cell.y});
+        if (it != _cell_to_tile.end())
+            _tiles.at(it->second).is_valid = false;
+    }
+
+    void ThumbnailAtlas::invalidate_all()
+    {
+        for (auto& tile : _tiles)
+            tile.is_valid = false;
+    }
+
+    void ThumbnailAtlas::clear()
+    {
+        for (auto& tile : _tiles)
+            tile = Tile();
+
+        _cell_to_tile.clear();
+        _layout_revision += 1;
+    }
+
+    size_t ThumbnailAtlas::get_layout_revision() const
+    {
+        return _layout_revision;
+    }
+
+    const Texture* ThumbnailAtlas::get_texture() const
+    {
+        return _texture;
+    }
+}
@@ -0,0 +1,499 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/21/23
+//
+
+#include <app/undo_history.hpp>
+
+#include <iostream>
+
+namespace mousetrap
+{
+    size_t UndoHistory::Tile::get_memory_usage() const
+    {
+        return sizeof(Tile) + (pixels.capacity() + runs.capacity()) * sizeof(uint32_t);
+    }
+
+    std::vector<uint32_t> UndoHistory::Tile::get_pixels() const
+    {
+        if (runs.empty())
+            return pixels;
+
+        std::vector<uint32_t> out;
+        out.reserve(size.x * size.y);
+
+        for (size_t i = 0; i < runs.size(); i += 2)
+            out.insert(out.end(), size_t(runs.at(i)), runs.at(i + 1));
+
+        return out;
+    }
+
+    void UndoHistory::Tile::compress()
+    {
+        if (not runs.empty())
+            return;
+
+        // pixel art has long runs of identical colors, especially transparent ones
+        std::vector<uint32_t> out;
+        size_t i = 0;
+        while (i < pixels.size())
+        {
+            auto color = pixels.at(i);
+            size_t n = 1;
+            while (i + n < pixels.size() and pixels.at(i + n) == color)
+                ++n;
+
+            out.push_back(n);
+            out.push_back(color);
+            i += n;
+
+            // no gain, keep uncompressed
+            if (out.size() >= pixels.size())
+                return;
+        }
+
+        out.shrink_to_fit();
+        runs = std::move(out);
+        pixels.clear();
+        pixels.shrink_to_fit();
+    }
+
+    UndoHistory::UndoHistory(size_t budget)
+        : _budget(budget)
+    {}
+
+    UndoHistory::~UndoHistory()
+    {
+        // tiles notify the history when they are destroyed, so they have to go first
+        _open_cells.clear();
+        _undo_steps.clear();
+        _redo_steps.clear();
+    }
+
+    void UndoHistory::set_budget(size_t budget)
+    {
+        _budget = budget;
+        enforce_budget();
+    }
+
+    size_t UndoHistory::get_budget() const
+    {
+        return _budget;
+    }
+
+    size_t UndoHistory::get_memory_usage() const
+    {
+        return _memory_usage;
+    }
+
+    UndoHistory::TileRef UndoHistory::get_tile(std::vector<uint32_t>&& pixels, Vector2ui size)
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&](uint64_t value) {
+            hash ^= value;
+            hash *= 1099511628211ull;
+        };
+
+        mix(size.x);
+        mix(size.y);
+        for (auto pixel : pixels)
+            mix(pixel);
+
+        auto range = _tile_store.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            auto tile = it->second.lock();
+            if (tile != nullptr and tile->size == size and tile->get_pixels() == pixels)
+                return tile;
+        }
+
+        auto* tile = new Tile{this, hash, size, std::move(pixels), {}};
+        _memory_usage += tile->get_memory_usage();
+
+        auto out = TileRef(tile, [](Tile* tile){
+            tile->owner->on_tile_destroyed(tile);
+            delete tile;
+        });
+
+        _tile_store.emplace(hash, out);
+        return out;
+    }
+
+    void UndoHistory::on_tile_destroyed(Tile* tile)
+    {
+        _memory_usage -= tile->get_memory_usage();
+
+        auto range = _tile_store.equal_range(tile->hash);
+        for (auto it = range.first; it != range.second;)
+        {
+            if (it->second.expired())
+                it = _tile_store.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    Vector2ui UndoHistory::get_n_tiles(Vector2ui image_size) const
+    {
+        return {
+            (image_size.x + tile_size - 1) / tile_size,
+            (image_size.y + tile_size - 1) / tile_size
+        };
+    }
+
+    UndoHistory::TileRef UndoHistory::capture_tile(const Layer::Frame* frame, size_t tile_i)
+    {
+        const auto image_size = frame->get_image_size();
+        const auto n_tiles = get_n_tiles(image_size);
+
+        auto top_left = Vector2i((tile_i % n_tiles.x) * tile_size, (tile_i / n_tiles.x) * tile_size);
+        auto size = Vector2ui(
+            std::min<size_t>(tile_size, image_size.x - top_left.x),
+            std::min<size_t>(tile_size, image_size.y - top_left.y)
+        );
+
+        std::vector<uint32_t> pixels(size.x * size.y);
+        frame->read_region(top_left, size, pixels.data());
+        return get_tile(std::move(pixels), size);
+    }
+
+    void UndoHistory::begin_transaction()
+    {
+        _transaction_depth += 1;
+    }
+
+    void UndoHistory::end_transaction()
+    {
+        if (_transaction_depth == 0)
+        {
+            std::cerr << "[WARNING] In UndoHistory::end_transaction: No transaction is open" << std::endl;
+            return;
+        }
+
+        _transaction_depth -= 1;
+        if (_transaction_depth == 0)
+            commit();
+    }
+
+    bool UndoHistory::get_is_in_transaction() const
+    {
+        return _transaction_depth > 0;
+    }
+
+    UndoHistory::OpenCell& UndoHistory::open_cell(Vector2ui cell, Layer::Frame* frame)
+    {
+        auto it = _open_cells.find({cell.x, cell.y});
+        if (it != _open_cells.end())
+            return it->second;
+
+        auto& out = _open_cells[{cell.x, cell.y}];
+        out.frame = frame;
+        out.change.cell = cell;
+        out.change.before.image_size = frame->get_image_size();
+        out.change.before.offset = frame->get_offset();
+        return out;
+    }
+
+    void UndoHistory::record(Vector2ui cell, Layer::Frame* frame, Vector2i top_left, Vector2i size)
+    {
+        if (_transaction_depth == 0)
+        {
+            std::cerr << "[ERROR] In UndoHistory::record: Changes can only be recorded during a transaction" << std::endl;
+            return;
+        }
+
+        // the frame is about to change, so its previous state has to be known now
+        capture_pending(cell, frame);
+
+        auto& open = open_cell(cell, frame);
+        auto& before = open.change.before;
+
+        // image was replaced earlier in this transaction, its previous content is already recorded in full
+        const auto image_size = frame->get_image_size();
+        if (image_size != before.image_size)
+            return;
+
+        auto min = Vector2i(std::max<int64_t>(top_left.x, 0), std::max<int64_t>(top_left.y, 0));
+        auto max = Vector2i(
+            std::min<int64_t>(top_left.x + size.x, image_size.x),
+            std::min<int64_t>(top_left.y + size.y, image_size.y)
+        );
+
+        if (min.x >= max.x or min.y >= max.y)
+            return;
+
+        const auto n_tiles = get_n_tiles(image_size);
+        for (size_t tile_y = min.y / tile_size; tile_y <= (max.y - 1) / tile_size; ++tile_y)
+        {
+            for (size_t tile_x = min.x / tile_size; tile_x <= (max.x - 1) / tile_size; ++tile_x)
+            {
+                size_t tile_i = tile_y * n_tiles.x + tile_x;
+                if (before.tiles.find(tile_i) == before.tiles.end())
+                    before.tiles.emplace(tile_i, capture_tile(frame, tile_i));
+            }
+        }
+    }
+
+    void UndoHistory::record(Vector2ui cell, Layer::Frame* frame)
+    {
+        auto image_size = frame->get_image_size();
+        record(cell, frame, {0, 0}, Vector2i(image_size.x, image_size.y));
+    }
+
+    void UndoHistory::commit()
+    {
+        Step step;
+        for (auto& pair : _open_cells)
+        {
+            auto* frame = pair.second.frame;
+            auto& change = pair.second.change;
+
+            change.after.image_size = frame->get_image_size();
+            change.after.offset = frame->get_offset();
+
+            // capturing now would download the texture, defer until the pixels are needed anyway
+            if (frame->get_is_read_back_pending())
+            {
+                change.after_pending = true;
+                _n_pending_changes += 1;
+                step.push_back(std::move(change));
+                continue;
+            }
+
+            capture_after(change, frame);
+
+            auto& before = change.before;
+            auto& after = change.after;
+            if (before.tiles.empty() and after.tiles.empty() and before.offset == after.offset and before.image_size == after.image_size)
+                continue;
+
+            step.push_back(std::move(change));
+        }
+
+        _open_cells.clear();
+
+        if (step.empty())
+            return;
+
+        _undo_steps.push_back(std::move(step));
+        _redo_steps.clear();
+
+        compress_cold_steps();
+        enforce_budget();
+    }
+
+    void UndoHistory::capture_after(CellChange& change, const Layer::Frame* frame)
+    {
+        auto& before = change.before;
+        auto& after = change.after;
+
+        if (after.image_size == before.image_size)
+        {
+            // identical content resolves to the same tile, so unchanged tiles can be dropped by comparing pointers
+            for (auto it = before.tiles.begin(); it != before.tiles.end();)
+            {
+                auto tile = capture_tile(frame, it->first);
+                if (tile == it->second)
+                {
+                    it = before.tiles.erase(it);
+                    continue;
+                }
+
+                after.tiles.emplace(it->first, std::move(tile));
+                ++it;
+            }
+        }
+        else
+        {
+            auto n_tiles = get_n_tiles(after.image_size);
+            for (size_t tile_i = 0; tile_i < n_tiles.x * n_tiles.y; ++tile_i)
+                after.tiles.emplace(tile_i, capture_tile(frame, tile_i));
+        }
+    }
+
+    void UndoHistory::capture_pending(Vector2ui cell, const Layer::Frame* frame)
+    {
+        if (_n_pending_changes == 0)
+            return;
+
+        for (size_t step_i = _undo_steps.size(); step_i > 0; --step_i)
+        {
+            for (auto& change : _undo_steps.at(step_i - 1))
+            {
+                if (change.cell != cell)
+                    continue;
+
+                // earlier changes of this cell were captured when it was recorded for this one
+                if (change.after_pending)
+                {
+                    change.after_pending = false;
+                    _n_pending_changes -= 1;
+                    capture_after(change, frame);
+
+                    if (step_i - 1 < _n_compressed_steps)
+                    {
+                        compress(change.before);
+                        compress(change.after);
+                    }
+                }
+                return;
+            }
+        }
+    }
+
+    void UndoHistory::restore(Layer::Frame* frame, const CellState& state)
+    {
+        if (frame->get_image_size() != state.image_size)
+        {
+            auto image = Image();
+            image.create(state.image_size.x, state.image_size.y, RGBA(0, 0, 0, 0));
+            frame->overwrite_image(std::move(image));
+        }
+
+        if (frame->get_offset() != state.offset)
+            frame->set_offset(state.offset);
+
+        const auto n_tiles = get_n_tiles(state.image_size);
+        for (auto& pair : state.tiles)
+        {
+            auto top_left = Vector2i((pair.first % n_tiles.x) * tile_size, (pair.first / n_tiles.x) * tile_size);
+            auto pixels = pair.second->get_pixels();
+            frame->write_region(top_left, pair.second->size, pixels.data());
+        }
+    }
+
+    std::vector<Vector2ui> UndoHistory::undo(const FrameResolver& resolve)
+    {
+        if (_transaction_depth > 0)
+        {
+            std::cerr << "[WARNING] In UndoHistory::undo: Unable to undo while a transaction is open" << std::endl;
+            return {};
+        }
+
+        if (_undo_steps.empty())
+            return {};
+
+        auto step = std::move(_undo_steps.back());
+        _undo_steps.pop_back();
+        _n_compressed_steps = std::min(_n_compressed_steps, _undo_steps.size());
+
+        std::vector<Vector2ui> out;
+        for (auto& change : step)
+        {
+            auto* frame = resolve(change.cell);
+
+            if (change.after_pending)
+            {
+                change.after_pending = false;
+                _n_pending_changes -= 1;
+                if (frame != nullptr)
+                    capture_after(change, frame);
+            }
+
+            if (frame == nullptr)
+                continue;
+
+            restore(frame, change.before);
+            out.push_back(change.cell);
+        }
+
+        _redo_steps.push_back(std::move(step));
+        return out;
+    }
+
+    std::vector<Vector2ui> UndoHistory::redo(const FrameResolver& resolve)
+    {
+        if (_transaction_depth > 0)
+        {
+            std::cerr << "[WARNING] In UndoHistory::redo: Unable to redo while a transaction is open" << std::endl;
+            return {};
+        }
+
+        if (_redo_steps.empty())
+            return {};
+
+        auto step = std::move(_redo_steps.back());
+        _redo_steps.pop_back();
+
+        std::vector<Vector2ui> out;
+        for (auto& change : step)
+        {
+            auto* frame = resolve(change.cell);
+            if (frame == nullptr)
+                continue;
+
+            restore(frame, change.after);
+            out.push_back(change.cell);
+        }
+
+        _undo_steps.push_back(std::move(step));
+        compress_cold_steps();
+        return out;
+    }
+
+    bool UndoHistory::get_can_undo() const
+    {
+        return not _undo_steps.empty();
+    }
+
+    bool UndoHistory::get_can_redo() const
+    {
+        return not _redo_steps.empty();
+    }
+
+    void UndoHistory::clear()
+    {
+        _open_cells.clear();
+        _undo_steps.clear();
+        _redo_steps.clear();
+        _n_compressed_steps = 0;
+        _n_pending_changes = 0;
+    }
+
+    void UndoHistory::compress(CellState& state)
+    {
+        for (auto& pair : state.tiles)
+        {
+            auto& tile = *pair.second;
+            auto before = tile.get_memory_usage();
+            tile.compress();
+            _memory_usage = _memory_usage - before + tile.get_memory_usage();
+        }
+    }
+
+    void UndoHistory::compress_cold_steps()
+    {
+        while (_undo_steps.size() - _n_compressed_steps > n_uncompressed_steps)
+        {
+            for (auto& change : _undo_steps.at(_n_compressed_steps))
+            {
+                compress(change.before);
+                compress(change.after);
+            }
+
+            _n_compressed_steps += 1;
+        }
+    }
+
+    void UndoHistory::enforce_budget()
+    {
+        // the most recent step is always kept, even if it alone exceeds the budget
+        while (_memory_usage > _budget)
+        {
+            if (not _redo_steps.empty())
+                _redo_steps.pop_front();
+            else if (_undo_steps.size() > 1)
+            {
+                for (auto& change : _undo_steps.front())
+                    if (change.after_pending)
+                        _n_pending_changes -= 1;
+
+                _undo_steps.pop_front();
+                if (_n_compressed_steps > 0)
+                    _n_compressed_steps -= 1;
+            }
+            else
+                break;
+        }
+    }
+}
@@ -0,0 +1,88 @@
+// 
+// Copyright 2022 Clemens Cords
+// Created on 3/20/23 by clem (mail@clemens-cords.com)
+//
+
+#pragma once
+
+#include <mousetrap.hpp>
+#include <app/layer.hpp>
+#include <app/project_state.hpp>
+
+#include <map>
+
+namespace mousetrap
+{
+    /// \brief downsampled copy of the frame, stretched to size. Cost only depends on size, not on the resolution of the frame
+    Image generate_cell_preview(const Layer::Frame*, Vector2ui size);
+
+    /// \brief previews of cells packed into one shared texture. Tiles are rendered on request, the least recently used tile is reused once the atlas is full
+    class ThumbnailAtlas
+    {
+        public:
+            /// \brief has to be called while a gl context is bound, storage is allocated on the first request
+            ThumbnailAtlas();
+            ~ThumbnailAtlas();
+
+            ThumbnailAtlas(const ThumbnailAtlas&) = delete;
+            ThumbnailAtlas& operator=(const ThumbnailAtlas&) = delete;
+
+            /// \brief size and number of previews a view shows at once. Tiles are as large as the largest size registered, the atlas grows until the previews of all views fit
+            void set_requirements(const void* owner, Vector2ui tile_size, size_t n_tiles);
+            void remove_requirements(const void* owner);
+
+            Vector2ui get_tile_size() const;
+
+            /// \brief region of the texture holding the preview of the cell, in texture coordinates. Renders the preview if it is missing or outdated, a gl context has to be bound
+            Rectangle request(CellPosition);
+
+            /// \brief preview will be re-rendered on the next request
+            void invalidate(CellPosition);
+            void invalidate_all();
+
+            /// \brief forget all tiles, for when cell indices no longer refer to the same cells
+            void clear();
+
+            /// \brief incremented whenever a cell is moved to another tile, regions returned by request are outdated once it changes
+            size_t get_layout_revision() const;
+
+            const Texture* get_texture() const;
+
+        private:
+            struct Tile
+            {
+                CellPosition cell = {0, 0};
+                uint64_t last_used = 0;
+                bool is_occupied = false;
+                bool is_valid = false;
+            };
+
+            struct Requirements
+            {
+                Vector2ui tile_size;
+                size_t n_tiles;
+            };
+
+            void update_allocation();
+            Vector2ui get_tile_top_left(size_t tile_i) const;
+
+            std::map<const void*, Requirements> _requirements;
+            bool _allocation_outdated = true;
+
+            Vector2ui _tile_size = {1, 1};
+            Vector2ui _n_tiles = {0, 0};
+
+            std::vector<Tile> _tiles;
+            std::map<std::pair<size_t, size_t>, size_t> _cell_to_tile;
+            uint64_t _n_requests = 0;
+            size_t _layout_revision = 0;
+
+            Texture* _texture = nullptr;
+    };
+
+    namespace state
+    {
+        /// \brief shared by frame view and layer view, gl contexts of the display share textures
+        inline ThumbnailAtlas* thumbnail_atlas = nullptr;
+    }
+}
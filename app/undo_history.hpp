@@ -0,0 +1,140 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/21/23
+//
+
+#pragma once
+
+#include <mousetrap.hpp>
+#include <app/layer.hpp>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+namespace mousetrap
+{
+    /// \brief pixel history of all cells. Changes are stored as square tiles, tiles with identical content are shared between all steps of the history
+    class UndoHistory
+    {
+        public:
+            /// \brief width and height of a tile, in px
+            static constexpr size_t tile_size = 32;
+
+            /// \brief number of most recent steps that are kept uncompressed
+            static constexpr size_t n_uncompressed_steps = 8;
+
+            /// \param budget: maximum number of bytes used by tiles, oldest steps are dropped once exceeded
+            UndoHistory(size_t budget);
+            ~UndoHistory();
+
+            UndoHistory(const UndoHistory&) = delete;
+            UndoHistory& operator=(const UndoHistory&) = delete;
+
+            void set_budget(size_t);
+            size_t get_budget() const;
+            size_t get_memory_usage() const;
+
+            /// \brief all changes recorded until the matching end_transaction are undone in one step, transactions may be nested
+            void begin_transaction();
+            void end_transaction();
+            bool get_is_in_transaction() const;
+
+            /// \brief has to be called before pixels of the cell are modified. Rectangle is in image coordinates, regions outside the image are ignored
+            void record(Vector2ui cell, Layer::Frame*, Vector2i top_left, Vector2i size);
+
+            /// \brief has to be called before the whole image, its size or its offset are modified
+            void record(Vector2ui cell, Layer::Frame*);
+
+            bool get_can_undo() const;
+            bool get_can_redo() const;
+
+            using FrameResolver = std::function<Layer::Frame*(Vector2ui cell)>;
+
+            /// \brief restore state before the last step. Frame textures are not updated
+            /// \returns {layer_i, frame_i} of all cells that changed
+            std::vector<Vector2ui> undo(const FrameResolver&);
+
+            /// \brief restore state after the last undone step. Frame textures are not updated
+            /// \returns {layer_i, frame_i} of all cells that changed
+            std::vector<Vector2ui> redo(const FrameResolver&);
+
+            /// \brief forget all steps, for when cell indices or the resolution changed
+            void clear();
+
+        private:
+            struct Tile
+            {
+                UndoHistory* owner;
+                uint64_t hash;
+                Vector2ui size;
+
+                // exactly one of these is non-empty
+                std::vector<uint32_t> pixels;
+                std::vector<uint32_t> runs; // {n, color} pairs
+
+                size_t get_memory_usage() const;
+                std::vector<uint32_t> get_pixels() const;
+                void compress();
+            };
+
+            using TileRef = std::shared_ptr<Tile>;
+
+            // content addressed, so identical tiles of different steps share memory
+            std::unordered_multimap<uint64_t, std::weak_ptr<Tile>> _tile_store;
+            TileRef get_tile(std::vector<uint32_t>&& pixels, Vector2ui size);
+            void on_tile_destroyed(Tile*);
+
+            struct CellState
+            {
+                Vector2ui image_size;
+                Vector2i offset;
+                std::map<size_t, TileRef> tiles; // tile index -> content
+            };
+
+            struct CellChange
+            {
+                Vector2ui cell;
+                CellState before;
+                CellState after;
+
+                // frame texture was overwritten on the GPU, after.tiles are captured once the frame is recorded or undone next
+                bool after_pending = false;
+            };
+
+            using Step = std::vector<CellChange>;
+
+            std::deque<Step> _undo_steps;
+            std::deque<Step> _redo_steps;
+            size_t _n_compressed_steps = 0;
+
+            // cells recorded since begin_transaction
+            struct OpenCell
+            {
+                Layer::Frame* frame;
+                CellChange change;
+            };
+
+            std::map<std::pair<size_t, size_t>, OpenCell> _open_cells;
+            size_t _transaction_depth = 0;
+
+            OpenCell& open_cell(Vector2ui cell, Layer::Frame*);
+            void commit();
+            void capture_after(CellChange&, const Layer::Frame*);
+
+            // only the most recent change of a cell can be pending
+            size_t _n_pending_changes = 0;
+            void capture_pending(Vector2ui cell, const Layer::Frame*);
+            void restore(Layer::Frame*, const CellState&);
+
+            Vector2ui get_n_tiles(Vector2ui image_size) const;
+            TileRef capture_tile(const Layer::Frame*, size_t tile_i);
+
+            void compress(CellState&);
+            void compress_cold_steps();
+            void enforce_budget();
+
+            size_t _budget;
+            size_t _memory_usage = 0;
+    };
+}
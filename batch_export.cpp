@@ -0,0 +1,254 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 3/23/23
+//
+
+// exports project files without opening a window or creating a GL context, c.f. print_usage
+
+#include <mousetrap.hpp>
+#include <app/project_file.hpp>
+#include <app/project_export.hpp>
+
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+using namespace mousetrap;
+
+struct BatchExportOptions
+{
+    bool export_frames = false;
+    bool export_spritesheet = false;
+    bool export_metadata = false;
+    bool export_gif = false;
+    bool export_apng = false;
+    bool export_packed = false;
+
+    size_t n_columns = 0;
+    size_t padding = 0;
+    std::set<size_t> layer_is;  // all layers if empty
+    std::string output_directory; // next to each project if empty
+    size_t n_jobs = 1;
+
+    std::vector<std::string> paths;
+};
+
+static void print_usage()
+{
+    std::cout << "usage: batch_export [options] <project.mtp>...\n"
+              << "\n"
+              << "  --frames              write merged layers of each frame to <name>_<frame>.png (default)\n"
+              << "  --spritesheet         write all frames to <name>.png\n"
+              << "  --metadata            write spritesheet layout and layer properties to <name>.ini\n"
+              << "  --gif                 write animation to <name>.gif, at most 256 colors per frame\n"
+              << "  --apng                write animation to <name>.apng\n"
+              << "  --packed              write trimmed frames to <name>_packed.png, identical frames are stored once.\n"
+              << "                        Layout, offsets and durations are written to <name>_packed.json\n"
+              << "  --padding <n>         transparent pixels between frames of --packed, 0 by default\n"
+              << "  --columns <n>         frames per spritesheet row, all frames in one row by default\n"
+              << "  --layers <i,j,...>    only merge these layers, all layers by default. Hidden layers are always skipped\n"
+              << "  --output <directory>  write files to directory instead of next to each project\n"
+              << "  --jobs <n>            number of projects exported at the same time, 1 by default.\n"
+              << "                        Each project is already composited on all cores, more jobs help with many small projects\n"
+              << std::endl;
+}
+
+static bool parse_size(const std::string& in, size_t& out)
+{
+    try
+    {
+        size_t n_parsed = 0;
+        out = std::stoul(in, &n_parsed);
+        return n_parsed == in.size();
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+static bool parse_options(int argc, char** argv, BatchExportOptions& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        auto arg = std::string(argv[i]);
+        auto next = [&](std::string& out) {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "[ERROR] In batch_export: Missing value for `" << arg << "`" << std::endl;
+                return false;
+            }
+            out = argv[++i];
+            return true;
+        };
+
+        std::string value;
+        if (arg == "--help" or arg == "-h")
+            return false;
+        else if (arg == "--frames")
+            options.export_frames = true;
+        else if (arg == "--spritesheet")
+            options.export_spritesheet = true;
+        else if (arg == "--metadata")
+            options.export_metadata = true;
+        else if (arg == "--gif")
+            options.export_gif = true;
+        else if (arg == "--apng")
+            options.export_apng = true;
+        else if (arg == "--packed")
+            options.export_packed = true;
+        else if (arg == "--padding")
+        {
+            if (not next(value) or not parse_size(value, options.padding))
+                return false;
+        }
+        else if (arg == "--columns")
+        {
+            if (not next(value) or not parse_size(value, options.n_columns))
+                return false;
+        }
+        else if (arg == "--jobs")
+        {
+            if (not next(value) or not parse_size(value, options.n_jobs) or options.n_jobs == 0)
+                return false;
+        }
+        else if (arg == "--output")
+        {
+            if (not next(options.output_directory))
+                return false;
+        }
+        else if (arg == "--layers")
+        {
+            if (not next(value))
+                return false;
+
+            auto stream = std::stringstream(value);
+            std::string layer;
+            while (std::getline(stream, layer, ','))
+            {
+                size_t layer_i = 0;
+                if (not parse_size(layer, layer_i))
+                {
+                    std::cerr << "[ERROR] In batch_export: `" << layer << "` is not a layer index" << std::endl;
+                    return false;
+                }
+                options.layer_is.insert(layer_i);
+            }
+        }
+        else if (arg.starts_with("--"))
+        {
+            std::cerr << "[ERROR] In batch_export: Unknown option `" << arg << "`" << std::endl;
+            return false;
+        }
+        else
+            options.paths.push_back(arg);
+    }
+
+    if (not (options.export_frames or options.export_spritesheet or options.export_metadata or options.export_gif or options.export_apng or options.export_packed))
+        options.export_frames = true;
+
+    return not options.paths.empty();
+}
+
+static bool export_project(const std::string& path, const BatchExportOptions& options)
+{
+    ProjectFile file;
+    if (not file.open(path))
+    {
+        std::cerr << "[ERROR] In batch_export: Unable to open `" << path << "`: File does not exist or is not a valid project file" << std::endl;
+        return false;
+    }
+
+    for (auto layer_i : options.layer_is)
+    {
+        if (layer_i >= file.get_n_layers())
+        {
+            std::cerr << "[ERROR] In batch_export: Layer index " << layer_i << " out of bounds for `" << path << "` with " << file.get_n_layers() << " layers" << std::endl;
+            return false;
+        }
+    }
+
+    auto as_path = std::filesystem::path(path);
+    auto directory = options.output_directory.empty() ? as_path.parent_path() : std::filesystem::path(options.output_directory);
+    auto prefix = (directory / as_path.stem()).string();
+
+    auto snapshot = file.get_snapshot();
+
+    bool success = true;
+    if (options.export_frames)
+        success = export_frames(snapshot, options.layer_is, prefix) and success;
+
+    if (options.export_spritesheet)
+        success = export_spritesheet(snapshot, options.layer_is, prefix + ".png", options.n_columns) and success;
+
+    if (options.export_metadata)
+        success = export_metadata(snapshot, prefix + ".ini", options.n_columns) and success;
+
+    if (options.export_gif)
+        success = export_animation(snapshot, options.layer_is, prefix + ".gif", AnimationFormat::GIF) and success;
+
+    if (options.export_apng)
+        success = export_animation(snapshot, options.layer_is, prefix + ".apng", AnimationFormat::APNG) and success;
+
+    if (options.export_packed)
+        success = export_packed_spritesheet(snapshot, options.layer_is, prefix + "_packed.png", options.padding) and success;
+
+    return success;
+}
+
+int main(int argc, char** argv)
+{
+    BatchExportOptions options;
+    if (not parse_options(argc, argv, options))
+    {
+        print_usage();
+        return 1;
+    }
+
+    if (not options.output_directory.empty())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(options.output_directory, error);
+        if (error)
+        {
+            std::cerr << "[ERROR] In batch_export: Unable to create `" << options.output_directory << "`: " << error.message() << std::endl;
+            return 1;
+        }
+    }
+
+    const size_t n_threads = std::min(options.n_jobs, options.paths.size());
+    std::atomic<size_t> next_path = 0;
+    std::atomic<size_t> n_failed = 0;
+    std::mutex log_mutex;
+
+    auto worker = [&]()
+    {
+        for (size_t path_i = next_path++; path_i < options.paths.size(); path_i = next_path++)
+        {
+            const auto& path = options.paths.at(path_i);
+            bool success = export_project(path, options);
+            if (not success)
+                n_failed += 1;
+
+            auto lock = std::lock_guard(log_mutex);
+            std::cout << (success ? "exported " : "failed   ") << path << std::endl;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(n_threads - 1);
+    for (size_t i = 1; i < n_threads; ++i)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    if (n_failed > 0)
+        std::cerr << "[ERROR] In batch_export: " << n_failed << " of " << options.paths.size() << " projects could not be exported" << std::endl;
+
+    return n_failed == 0 ? 0 : 1;
+}
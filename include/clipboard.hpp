@@ -29,8 +29,12 @@ namespace mousetrap
             template<typename Function_t, typename Data_t>
             bool get_string(Function_t on_string_read, Data_t);
 
+            /// @brief offers a copy of the image storage, no per-pixel conversion
             void set_image(const Image&);
 
+            /// @brief offers the image storage itself, image is empty afterwards
+            void set_image(Image&&);
+
             /// @param Function_t: void(Clipboard*, const Image&, Data_t)
             template<typename Function_t, typename Data_t>
             bool get_image(Function_t on_image_red, Data_t);
@@ -53,7 +53,8 @@ namespace mousetrap
     /// handles mouse button press
     class ClickEventController : public EventController,
         public HasClickPressedSignal<ClickEventController>,
-        public HasClickReleasedSignal<ClickEventController>
+        public HasClickReleasedSignal<ClickEventController>,
+        public HasClickCancelledSignal<ClickEventController>
     {
         public:
             ClickEventController();
@@ -9,13 +9,22 @@
 #include <include/vector.hpp>
 #include <gtk/gtk.h>
 #include <vector>
+#include <span>
 
 namespace mousetrap
 {
+    /// \brief pixel storage format of an image
+    enum class ImageFormat
+    {
+        RGBA8,      // 8-bit unsigned normalized per component, 4 bytes per pixel
+        RGBA32F     // 32-bit float per component, 16 bytes per pixel, for intermediate results
+    };
+
     class Image
     {
         public:
             Image() = default;
+            explicit Image(ImageFormat);
 
             Image(const Image&);
             Image(Image&&);
@@ -25,17 +34,33 @@ namespace mousetrap
             void create(size_t width, size_t height, RGBA default_color = RGBA(0, 0, 0, 1));
             bool create_from_file(const std::string&);
             void create_from_pixbuf(GdkPixbuf*);
+
+            /// \brief download texture straight into image storage, RGBA32F if the texture has more than 8 bits per component, RGBA8 otherwise
             void create_from_texture(GdkTexture*);
 
             bool save_to_file(const std::string&) const;
 
             void* data() const;
-            /// \returns <number of pixels> * <number of components>
+            /// \returns size of data() in bytes, <number of pixels> * get_bytes_per_pixel()
             size_t get_data_size() const;
 
+            ImageFormat get_format() const;
+
+            /// \brief convert pixel storage to format, pixel values are preserved up to precision of the new format
+            void set_format(ImageFormat);
+
+            size_t get_bytes_per_pixel() const;
+
             size_t get_n_pixels() const;
 
             GdkPixbuf* to_pixbuf() const;
+
+            /// \brief wrap copy of image storage as memory texture, no per-pixel conversion. Free with g_object_unref
+            /// \returns nullptr if image is empty
+            GdkTexture* to_texture() const;
+
+            /// \brief hand image storage to a memory texture without copying, image is empty afterwards
+            GdkTexture* move_to_texture();
             Vector2ui get_size() const;
 
             Image as_scaled(size_t size_x, size_t size_y, GdkInterpType type) const;
@@ -50,9 +75,31 @@ namespace mousetrap
             void set_pixel(size_t linear_index, HSVA);
             RGBA get_pixel(size_t linear_index) const;
 
+            /// \brief access raw bytes of row y directly, layout depends on format, no bounds checking
+            std::span<uint8_t> get_row(size_t y);
+            std::span<const uint8_t> get_row(size_t y) const;
+
+            /// \brief set all pixels to color
+            void fill(RGBA);
+
+            /// \brief set all pixels in rectangle to color, rectangle is clipped to image bounds
+            void fill_region(Vector2i top_left, Vector2ui size, RGBA);
+
+            /// \brief copy rectangle of other image into this image, clipped to the bounds of both images
+            void copy_region(const Image& source, Vector2i source_top_left, Vector2ui size, Vector2i destination_top_left);
+
+            void flip_in_place(bool flip_horizontally, bool flip_vertically);
+
+            /// \brief invert rgb components, alpha is left untouched
+            void invert_in_place();
+
+            Image as_rotated_clockwise() const;
+            Image as_rotated_counterclockwise() const;
+
         private:
             Vector2i _size;
-            std::vector<float> _data; // rgba 32f per component
+            ImageFormat _format = ImageFormat::RGBA8;
+            std::vector<uint8_t> _data; // raw bytes, layout depends on _format
 
             size_t to_linear_index(size_t, size_t) const;
     };
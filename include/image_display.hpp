@@ -18,6 +18,9 @@ namespace mousetrap
             ImageDisplay(const Image&);
             ImageDisplay(GdkPixbuf*);
 
+            /// \brief replace displayed image
+            void create_from_image(const Image&);
+
             Vector2ui get_size() const;
 
         private:
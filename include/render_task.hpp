@@ -11,6 +11,7 @@
 #include <include/blend_mode.hpp>
 
 #include <map>
+#include <vector>
 
 namespace mousetrap
 {
@@ -39,6 +40,9 @@ namespace mousetrap
             void register_color(const std::string& uniform_name, const RGBA*);
             void register_color(const std::string& uniform_name, const HSVA* will_not_be_converted);
 
+            /// \brief resolve all registered uniform names to locations of the current shader program, called by render whenever registrations or the program changed
+            void compile();
+
             void render();
 
             Shape* get_shape();
@@ -63,6 +67,30 @@ namespace mousetrap
             std::map<std::string, const GLTransform*> _transforms;
             std::map<std::string, const RGBA*> _colors_rgba;
             std::map<std::string, const HSVA*> _colors_hsva;
+
+            struct UniformBinding
+            {
+                enum Type
+                {
+                    FLOAT,
+                    INT,
+                    UINT,
+                    VEC2,
+                    VEC3,
+                    VEC4,
+                    TRANSFORM,
+                    COLOR_RGBA,
+                    COLOR_HSVA
+                };
+
+                Type type;
+                int location;
+                const void* value;
+            };
+
+            std::vector<UniformBinding> _bindings;
+            GLNativeHandle _compiled_program_id = 0;
+            bool _bindings_dirty = true;
     };
 }
 
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 #include <include/gl_common.hpp>
 #include <include/gl_transform.hpp>
 
@@ -23,17 +24,25 @@ namespace mousetrap
             Shader();
             ~Shader();
 
+            // program is reference counted by ShaderLibrary, copies would release it twice
+            Shader(const Shader&) = delete;
+            Shader& operator=(const Shader&) = delete;
+
             GLNativeHandle get_program_id() const;
             GLNativeHandle get_fragment_shader_id() const;
             GLNativeHandle get_vertex_shader_id() const;
 
-            //
+            /// \brief program is shared with all shaders of the same sources, c.f. ShaderLibrary
             void create_from_string(const std::string& code, ShaderType);
             void create_from_file(const std::string& path, ShaderType);
 
-            //
+            /// \brief location is looked up once per program and cached afterwards
             int get_uniform_location(const std::string&) const;
 
+            /// \brief locations of the uniforms every shape sets, resolved when the program is linked
+            int get_transform_location() const;
+            int get_texture_set_location() const;
+
             //
             void set_uniform_float(const std::string& uniform_name, float);
             void set_uniform_int(const std::string& uniform_name, int);
@@ -49,19 +58,17 @@ namespace mousetrap
             static int get_vertex_texture_coordinate_location();
 
         private:
-            [[nodiscard]] GLNativeHandle compile_shader(const std::string&, ShaderType shader_type);
-            [[nodiscard]] GLNativeHandle link_program(GLNativeHandle fragment_id, GLNativeHandle vertex_id);
+            // owned by ShaderLibrary
+            GLNativeHandle _program_id = 0;
+            std::string _fragment_source = _noop_fragment_shader_source;
+            std::string _vertex_source = _noop_vertex_shader_source;
 
-            // local
-            GLNativeHandle _program_id,
-                    _fragment_shader_id,
-                    _vertex_shader_id;
+            void update_uniform_locations();
+            mutable std::unordered_map<std::string, int> _uniform_locations;
+            int _transform_location = -1;
+            int _texture_set_location = -1;
 
             // default noop
-            static inline size_t _noop_program_id,
-                                 _noop_fragment_shader_id,
-                                 _noop_vertex_shader_id;
-
             static inline const std::string _noop_fragment_shader_source = R"(
                 #version 130
 
@@ -0,0 +1,70 @@
+//
+// Copyright 2023 Clemens Cords
+// Created on 3/28/23 by clem (mail@clemens-cords.com)
+//
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <include/gl_common.hpp>
+#include <include/shader.hpp>
+
+namespace mousetrap
+{
+    /// \brief process-wide cache of compiled shaders and linked programs, keyed by hash of their source. All GL contexts of the display share programs, so each is compiled only once
+    /// \note has to be called with a GL context current
+    class ShaderLibrary
+    {
+        public:
+            ShaderLibrary() = delete;
+
+            /// \brief program linked from both sources, loaded from the binary cache or compiled on first request
+            /// \returns 0 if compiling or linking failed
+            static GLNativeHandle acquire_program(const std::string& fragment_source, const std::string& vertex_source);
+
+            /// \brief program is deleted once every acquire_program was matched by a release
+            static void release_program(GLNativeHandle);
+
+            /// \brief shader object compiled from source, compiled on first request and kept for the lifetime of the process
+            /// \returns 0 if compiling failed
+            static GLNativeHandle get_shader(const std::string& source, ShaderType);
+
+            /// \brief write linked programs to directory with glGetProgramBinary, so the next launch does not have to compile them. Disabled if empty
+            static void set_binary_cache_directory(const std::string&);
+            static const std::string& get_binary_cache_directory();
+
+            /// \brief driver can retrieve and load program binaries
+            static bool get_program_binaries_supported();
+
+        private:
+            struct Program
+            {
+                GLNativeHandle id;
+                size_t n_users;
+                std::string fragment_source; // to tell hash collisions apart
+                std::string vertex_source;
+            };
+
+            struct CompiledShader
+            {
+                GLNativeHandle id;
+                std::string source;
+            };
+
+            static inline std::unordered_map<size_t, Program> _programs;
+            static inline std::unordered_map<GLNativeHandle, size_t> _program_hashes;
+            static inline std::unordered_map<size_t, CompiledShader> _shaders;
+            static inline std::string _binary_cache_directory;
+
+            static size_t hash(const std::string& fragment_source, const std::string& vertex_source);
+            static GLNativeHandle compile(const std::string& source, ShaderType);
+            static GLNativeHandle link(GLNativeHandle fragment_id, GLNativeHandle vertex_id);
+
+            // binaries are only valid for the driver they were retrieved from, the driver is identified by vendor, renderer and version
+            static size_t get_driver_hash();
+            static std::string get_binary_path(size_t hash);
+            static GLNativeHandle load_binary(size_t hash);
+            static void store_binary(GLNativeHandle program, size_t hash);
+    };
+}
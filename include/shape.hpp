@@ -98,6 +98,9 @@ namespace mousetrap
             void update_texture_coordinate();
             void initialize();
 
+            /// \brief refresh vertex buffer data of vertices [first, last) from _vertices, upload is deferred to the next render
+            void update_vertex_data(size_t first, size_t last);
+
             std::vector<Vector2f> sort_by_angle(const std::vector<Vector2f>&);
 
         private:
@@ -108,16 +111,25 @@ namespace mousetrap
                 float _texture_coordinates[2];
             };
 
-            void update_data(
-                    bool update_position = true,
-                    bool update_color = true,
-                    bool update_tex_coords = true
-            );
+            static void write_vertex_info(const Vertex&, VertexInfo&);
+
+            /// \brief upload dirty vertices and indices, noop if nothing changed since the last call
+            void update_data();
 
             std::vector<VertexInfo> _vertex_data;
 
             GLNativeHandle _vertex_array_id = 0,
-                    _vertex_buffer_id = 0;
+                    _vertex_buffer_id = 0,
+                    _element_buffer_id = 0;
+
+            // number of vertices the vertex buffer storage was allocated for
+            size_t _vertex_buffer_capacity = 0;
+
+            // vertices [_dirty_begin, _dirty_end) differ from the vertex buffer
+            size_t _dirty_begin = 0;
+            size_t _dirty_end = 0;
+            bool _indices_dirty = false;
+            size_t _n_indices = 0;
 
             const TextureObject* _texture = nullptr;
     };
@@ -0,0 +1,45 @@
+// 
+// Copyright 2022 Clemens Cords
+// Created on 3/19/23 by clem (mail@clemens-cords.com)
+//
+
+#pragma once
+
+#include <include/shape.hpp>
+
+namespace mousetrap
+{
+    enum class ShapeBatchType
+    {
+        LINES,
+        RECTANGLES
+    };
+
+    /// \brief collection of lines or rectangles that share one vertex buffer and are rendered with a single draw call, each element can have its own color
+    class ShapeBatch : public Shape
+    {
+        public:
+            ShapeBatch(ShapeBatchType = ShapeBatchType::LINES);
+
+            /// \brief remove all lines, takes effect on the next flush
+            void clear();
+
+            void add_line(Vector2f a, Vector2f b, RGBA = RGBA(1, 1, 1, 1));
+            void add_lines(const std::vector<std::pair<Vector2f, Vector2f>>&, RGBA = RGBA(1, 1, 1, 1));
+
+            /// \brief closed outline through all points, in order
+            void add_line_loop(const std::vector<Vector2f>&, RGBA = RGBA(1, 1, 1, 1));
+
+            /// \brief axis-aligned rectangle, texture coordinates map to its corners. Only valid for batches of type RECTANGLES
+            void add_rectangle(Vector2f top_left, Vector2f size, RGBA = RGBA(1, 1, 1, 1), Vector2f texture_top_left = {0, 0}, Vector2f texture_size = {1, 1});
+
+            /// \brief upload all lines added since the last clear, lines added after the last flush are not rendered
+            void flush();
+
+            size_t get_n_lines() const;
+            size_t get_n_rectangles() const;
+
+        private:
+            ShapeBatchType _type;
+    };
+}
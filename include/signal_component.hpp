@@ -561,6 +561,36 @@ namespace mousetrap
             void* _on_click_released_data;
     };
 
+    template<typename Owner_t>
+    class HasClickCancelledSignal
+    {
+        public:
+            template<typename T>
+            using on_click_cancelled_function_t = void(Owner_t*, T);
+
+            template<typename Function_t, typename T>
+            void connect_signal_click_cancelled(Function_t, T);
+
+            void set_signal_click_cancelled_blocked(bool b) {
+                _blocked = b;
+            }
+
+        protected:
+            HasClickCancelledSignal(Owner_t* instance)
+                : _instance(instance)
+            {}
+
+        private:
+            Owner_t* _instance;
+
+            // emitted instead of released if another gesture claims the sequence or the grab is broken
+            static void on_click_cancelled_wrapper(void*, GdkEventSequence*, HasClickCancelledSignal<Owner_t>* instance);
+
+            bool _blocked = false;
+            std::function<on_click_cancelled_function_t<void*>> _on_click_cancelled_f;
+            void* _on_click_cancelled_data;
+    };
+
     template<typename Owner_t>
     class HasScrollBeginSignal
     {
@@ -1432,6 +1462,26 @@ namespace mousetrap
 
     // ###
 
+    template<typename Owner_t>
+    template<typename Function_t, typename T>
+    void HasClickCancelledSignal<Owner_t>::connect_signal_click_cancelled(Function_t function, T data)
+    {
+        auto temp =  std::function<on_click_cancelled_function_t<T>>(function);
+        _on_click_cancelled_f = std::function<on_click_cancelled_function_t<void*>>(*((std::function<on_click_cancelled_function_t<void*>>*) &temp));
+        _on_click_cancelled_data = data;
+
+        _instance->connect_signal("cancel", on_click_cancelled_wrapper, this);
+    }
+
+    template<typename Owner_t>
+    void HasClickCancelledSignal<Owner_t>::on_click_cancelled_wrapper(void*, GdkEventSequence*, HasClickCancelledSignal<Owner_t>* self)
+    {
+        if (self->_on_click_cancelled_f != nullptr and not self->_blocked)
+            self->_on_click_cancelled_f(self->_instance, self->_on_click_cancelled_data);
+    }
+
+    // ###
+
     template<typename Owner_t>
     template<typename Function_t, typename T>
     void HasScrollBeginSignal<Owner_t>::connect_signal_scroll_begin(Function_t function, T data)
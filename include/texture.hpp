@@ -48,9 +48,18 @@ namespace mousetrap
             void unbind() const override;
 
             void create(size_t width, size_t height);
+
+            /// \brief allocate without uploading, storage matches that of create_from_image for an image of the given format
+            void create(size_t width, size_t height, ImageFormat);
             void create_from_file(const std::string& path);
             void create_from_image(const Image&);
 
+            /// \brief re-upload rectangle of image without reallocating, texture has to have been created before
+            /// @param image_top_left: top left of region in image coordinates
+            /// @param size: size of region, has to be inside both the image and the texture
+            /// @param texture_top_left: top left of region in texture coordinates
+            void update_from_image(const Image&, Vector2i image_top_left, Vector2ui size, Vector2i texture_top_left);
+
             void set_wrap_mode(TextureWrapMode);
             TextureWrapMode get_wrap_mode();
 
@@ -41,6 +41,7 @@
 #include <app/color_transform_dialog.hpp>
 #include <app/image_transform_dialog.hpp>
 #include <app/log_box.hpp>
+#include <app/image_decode_service.hpp>
 
 using namespace mousetrap;
 
@@ -48,14 +49,19 @@ static void activate(GtkApplication* app, void*)
 {
     state::main_window = new Window(GTK_WINDOW(gtk_application_window_new(app)));
     gtk_initialize_opengl(GTK_WINDOW(state::main_window->operator GtkWidget*()));
+    ShaderLibrary::set_binary_cache_directory(std::string(g_get_user_cache_dir()) + "/mousetrap/shaders");
     state::app->add_window(state::main_window);
     state::main_window->set_show_menubar(true);
 
     state::shortcut_controller = new ShortcutController(state::app);
     state::main_window->add_controller(state::shortcut_controller);
+    initialize_menubar_actions();
+    initialize_save_file_actions();
 
+    state::image_decode_service = new ImageDecodeService();
     active_state = project_states.emplace_back(new ProjectState({75, 50}));
 
+    state::thumbnail_atlas = new ThumbnailAtlas();
     state::frame_view = new FrameView();
     state::brush_options = new BrushOptions();
     state::color_preview = new ColorPreview();
@@ -93,7 +99,6 @@ static void activate(GtkApplication* app, void*)
     Widget* frame_view = state::frame_view->operator Widget*();
     Widget* animation_preview = state::animation_preview->operator Widget*();
     Widget* resize_canvas_dialog = state::resize_canvas_dialog->operator Widget*();
-    Widget* canvas_export = state::canvas_export->operator Widget*();
     Widget* log_box = state::log_box->operator Widget*();
     toolbox->set_vexpand(false);
 
@@ -231,13 +236,6 @@ static void activate(GtkApplication* app, void*)
     auto bubble_log_overlay = Overlay();
     bubble_log_overlay.set_child(&main);
 
-    // c.f. canvas_export.hpp @note
-    bubble_log_overlay.add_overlay(canvas_export);
-    canvas_export->set_halign(GTK_ALIGN_START);
-    canvas_export->set_valign(GTK_ALIGN_START);
-    canvas_export->set_can_respond_to_input(false);
-    canvas_export->set_opacity(1);
-
     //bubble_log_overlay.add_overlay(bubble_log);
     // MAIN
 
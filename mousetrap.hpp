@@ -9,8 +9,10 @@
 #include <include/get_resource_path.hpp>
 #include <include/gl_common.hpp>
 #include <include/shape.hpp>
+#include <include/shape_batch.hpp>
 #include <include/colors.hpp>
 #include <include/shader.hpp>
+#include <include/shader_library.hpp>
 #include <include/gl_area.hpp>
 #include <include/gl_transform.hpp>
 #include <include/widget.hpp>
@@ -56,9 +56,22 @@ namespace mousetrap
 
     void Clipboard::set_image(const Image& image)
     {
-        auto* pixbuf = image.to_pixbuf();
-        auto* texture = gdk_texture_new_for_pixbuf(pixbuf);
+        auto* texture = image.to_texture();
+        if (texture == nullptr)
+            return;
+
+        gdk_clipboard_set_texture(_native, texture);
+        g_object_unref(texture);
+    }
+
+    void Clipboard::set_image(Image&& image)
+    {
+        auto* texture = image.move_to_texture();
+        if (texture == nullptr)
+            return;
+
         gdk_clipboard_set_texture(_native, texture);
+        g_object_unref(texture);
     }
 
     void Clipboard::get_image_callback_wrapper(GObject* clipboard, GAsyncResult* result, gpointer data)
@@ -70,7 +83,10 @@ namespace mousetrap
         auto image = Image();
 
         if (error == nullptr)
+        {
             image.create_from_texture(texture);
+            g_object_unref(texture);
+        }
         else
             g_error_free(error);
 
@@ -62,7 +62,8 @@ namespace mousetrap
     ClickEventController::ClickEventController()
             : EventController(GTK_EVENT_CONTROLLER(gtk_gesture_click_new())),
               HasClickPressedSignal<ClickEventController>(this),
-              HasClickReleasedSignal<ClickEventController>(this)
+              HasClickReleasedSignal<ClickEventController>(this),
+              HasClickCancelledSignal<ClickEventController>(this)
     {}
 
     ScrollEventController::ScrollEventController(bool emit_vertical, bool emit_horizontal)
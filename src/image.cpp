@@ -1,56 +1,265 @@
-// 
+//
 // Copyright 2022 Clemens Cords
 // Created on 8/6/22 by clem (mail@clemens-cords.com)
 //
 
 #include <include/image.hpp>
+#include <algorithm>
 #include <iostream>
+#include <cstring>
+
+#if defined(__AVX__) or defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 namespace mousetrap
 {
-    Image::Image(const Image& other)
+    namespace detail
     {
-        _data = std::vector<float>();
-        _data.reserve(other._data.size());
-        for (auto v : other._data)
-            _data.push_back(v);
+        // row kernels, operate on n tightly packed pixels of the given format
 
-        _size = other._size;
+        struct PixelRGBA8
+        {
+            uint8_t components[4];
+        };
+
+        struct PixelRGBA32F
+        {
+            float components[4];
+        };
+
+        static_assert(sizeof(PixelRGBA8) == 4 and sizeof(PixelRGBA32F) == 16);
+
+        static uint8_t to_rgba8_component(float v)
+        {
+            return uint8_t(glm::clamp<float>(v, 0, 1) * 255.f + 0.5f);
+        }
+
+        static float from_rgba8_component(uint8_t v)
+        {
+            return v / 255.f;
+        }
+
+        static void fill_row_rgba8(uint8_t* row, size_t n_pixels, RGBA color)
+        {
+            const uint8_t pixel[4] = {
+                to_rgba8_component(color.r),
+                to_rgba8_component(color.g),
+                to_rgba8_component(color.b),
+                to_rgba8_component(color.a)
+            };
+
+            int32_t pattern;
+            std::memcpy(&pattern, pixel, 4);
+
+            size_t i = 0;
+
+            #if defined(__AVX__)
+                const auto wide = _mm256_set1_epi32(pattern);
+                for (; i + 8 <= n_pixels; i += 8)
+                    _mm256_storeu_si256((__m256i*) (row + i * 4), wide);
+            #elif defined(__SSE2__)
+                const auto wide = _mm_set1_epi32(pattern);
+                for (; i + 4 <= n_pixels; i += 4)
+                    _mm_storeu_si128((__m128i*) (row + i * 4), wide);
+            #endif
+
+            for (; i < n_pixels; ++i)
+                std::memcpy(row + i * 4, &pattern, 4);
+        }
+
+        static void fill_row_rgba32f(float* row, size_t n_pixels, RGBA color)
+        {
+            size_t i = 0;
+
+            #if defined(__AVX__)
+                const auto pattern = _mm256_setr_ps(color.r, color.g, color.b, color.a, color.r, color.g, color.b, color.a);
+                for (; i + 2 <= n_pixels; i += 2)
+                    _mm256_storeu_ps(row + i * 4, pattern);
+            #elif defined(__SSE2__)
+                const auto pattern = _mm_setr_ps(color.r, color.g, color.b, color.a);
+                for (; i < n_pixels; ++i)
+                    _mm_storeu_ps(row + i * 4, pattern);
+            #endif
+
+            for (; i < n_pixels; ++i)
+            {
+                row[i * 4 + 0] = color.r;
+                row[i * 4 + 1] = color.g;
+                row[i * 4 + 2] = color.b;
+                row[i * 4 + 3] = color.a;
+            }
+        }
+
+        static void invert_row_rgba8(uint8_t* row, size_t n_pixels)
+        {
+            // rgb = 255 - rgb = rgb ^ 0xFF, a = a
+            const uint8_t mask_pixel[4] = {0xFF, 0xFF, 0xFF, 0x00};
+            int32_t mask;
+            std::memcpy(&mask, mask_pixel, 4);
+
+            size_t i = 0;
+
+            #if defined(__AVX2__)
+                const auto wide = _mm256_set1_epi32(mask);
+                for (; i + 8 <= n_pixels; i += 8)
+                {
+                    auto* ptr = (__m256i*) (row + i * 4);
+                    _mm256_storeu_si256(ptr, _mm256_xor_si256(_mm256_loadu_si256(ptr), wide));
+                }
+            #elif defined(__SSE2__)
+                const auto wide = _mm_set1_epi32(mask);
+                for (; i + 4 <= n_pixels; i += 4)
+                {
+                    auto* ptr = (__m128i*) (row + i * 4);
+                    _mm_storeu_si128(ptr, _mm_xor_si128(_mm_loadu_si128(ptr), wide));
+                }
+            #endif
+
+            for (; i < n_pixels; ++i)
+            {
+                row[i * 4 + 0] ^= 0xFF;
+                row[i * 4 + 1] ^= 0xFF;
+                row[i * 4 + 2] ^= 0xFF;
+            }
+        }
+
+        static void invert_row_rgba32f(float* row, size_t n_pixels)
+        {
+            // rgb = 1 - rgb, a = a
+            size_t i = 0;
+
+            #if defined(__AVX__)
+                const auto add = _mm256_setr_ps(1, 1, 1, 0, 1, 1, 1, 0);
+                const auto mul = _mm256_setr_ps(-1, -1, -1, 1, -1, -1, -1, 1);
+                for (; i + 2 <= n_pixels; i += 2)
+                {
+                    auto* ptr = row + i * 4;
+                    _mm256_storeu_ps(ptr, _mm256_add_ps(add, _mm256_mul_ps(_mm256_loadu_ps(ptr), mul)));
+                }
+            #elif defined(__SSE2__)
+                const auto add = _mm_setr_ps(1, 1, 1, 0);
+                const auto mul = _mm_setr_ps(-1, -1, -1, 1);
+                for (; i < n_pixels; ++i)
+                {
+                    auto* ptr = row + i * 4;
+                    _mm_storeu_ps(ptr, _mm_add_ps(add, _mm_mul_ps(_mm_loadu_ps(ptr), mul)));
+                }
+            #endif
+
+            for (; i < n_pixels; ++i)
+            {
+                row[i * 4 + 0] = 1 - row[i * 4 + 0];
+                row[i * 4 + 1] = 1 - row[i * 4 + 1];
+                row[i * 4 + 2] = 1 - row[i * 4 + 2];
+            }
+        }
+
+        static void reverse_row_rgba8(uint8_t* row, size_t n_pixels)
+        {
+            size_t left = 0;
+            size_t right = n_pixels;
+
+            #if defined(__SSE2__)
+                // swap blocks of 4 pixels from both ends, reversing pixel order within each block
+                for (; right >= left + 8; left += 4, right -= 4)
+                {
+                    auto* a_ptr = (__m128i*) (row + left * 4);
+                    auto* b_ptr = (__m128i*) (row + (right - 4) * 4);
+                    auto a = _mm_shuffle_epi32(_mm_loadu_si128(a_ptr), _MM_SHUFFLE(0, 1, 2, 3));
+                    auto b = _mm_shuffle_epi32(_mm_loadu_si128(b_ptr), _MM_SHUFFLE(0, 1, 2, 3));
+                    _mm_storeu_si128(a_ptr, b);
+                    _mm_storeu_si128(b_ptr, a);
+                }
+            #endif
+
+            auto* pixels = (PixelRGBA8*) row;
+            for (; right > 0 and left < right - 1; ++left, --right)
+                std::swap(pixels[left], pixels[right - 1]);
+        }
+
+        static void reverse_row_rgba32f(float* row, size_t n_pixels)
+        {
+            // one pixel is exactly one 128-bit lane, so swap whole pixels
+            for (size_t left = 0, right = n_pixels - 1; n_pixels > 0 and left < right; ++left, --right)
+            {
+                #if defined(__SSE2__)
+                    auto a = _mm_loadu_ps(row + left * 4);
+                    auto b = _mm_loadu_ps(row + right * 4);
+                    _mm_storeu_ps(row + left * 4, b);
+                    _mm_storeu_ps(row + right * 4, a);
+                #else
+                    for (size_t c = 0; c < 4; ++c)
+                        std::swap(row[left * 4 + c], row[right * 4 + c]);
+                #endif
+            }
+        }
+
+        static void copy_row(uint8_t* destination, const uint8_t* source, size_t n_bytes)
+        {
+            std::memmove(destination, source, n_bytes);
+        }
+
+        /// \brief out[transform(x, y)] = in(x, y), traversed in tiles to stay within cache
+        template<typename Pixel_t, typename Transform_t>
+        static void rotate(const Pixel_t* in, size_t w, size_t h, Pixel_t* out, Transform_t transform)
+        {
+            constexpr size_t tile_size = 32;
+
+            for (size_t tile_y = 0; tile_y < h; tile_y += tile_size)
+                for (size_t tile_x = 0; tile_x < w; tile_x += tile_size)
+                    for (size_t y = tile_y; y < std::min(tile_y + tile_size, h); ++y)
+                        for (size_t x = tile_x; x < std::min(tile_x + tile_size, w); ++x)
+                            out[transform(x, y)] = in[y * w + x];
+        }
+
+        /// \brief clip rectangle to [0, size), returns false if the result is empty
+        static bool clip_region(Vector2i& top_left, Vector2i& bottom_right, Vector2i size)
+        {
+            top_left.x = std::max<int64_t>(top_left.x, 0);
+            top_left.y = std::max<int64_t>(top_left.y, 0);
+            bottom_right.x = std::min<int64_t>(bottom_right.x, size.x);
+            bottom_right.y = std::min<int64_t>(bottom_right.y, size.y);
+
+            return top_left.x < bottom_right.x and top_left.y < bottom_right.y;
+        }
     }
 
-    Image::Image(Image&& other)
-    {
-        _data = std::vector<float>();
-        _data.reserve(other._data.size());
-        for (auto v : other._data)
-            _data.push_back(v);
+    Image::Image(ImageFormat format)
+        : _format(format)
+    {}
 
-        _size = other._size;
+    Image::Image(const Image& other)
+        : _size(other._size), _format(other._format), _data(other._data)
+    {}
 
+    Image::Image(Image&& other)
+        : _size(other._size), _format(other._format), _data(std::move(other._data))
+    {
         other._data.clear();
         other._size = {0, 0};
     }
 
     Image& Image::operator=(const Image& other)
     {
-        _data = std::vector<float>();
-        _data.reserve(other._data.size());
-        for (auto v : other._data)
-            _data.push_back(v);
+        if (&other == this)
+            return *this;
 
+        _data = other._data;
         _size = other._size;
+        _format = other._format;
 
         return *this;
     }
 
     Image& Image::operator=(Image&& other)
     {
-        _data = std::vector<float>();
-        _data.reserve(other._data.size());
-        for (auto v : other._data)
-            _data.push_back(v);
+        if (&other == this)
+            return *this;
 
+        _data = std::move(other._data);
         _size = other._size;
+        _format = other._format;
 
         other._data.clear();
         other._size = {0, 0};
@@ -60,37 +269,42 @@ namespace mousetrap
 
     void Image::create(size_t width, size_t height, RGBA default_color)
     {
-        _data.clear();
-        _data.reserve(width * height * 4);
-        for (size_t i = 0; i < width * height; ++i)
-        {
-            _data.push_back(default_color.r);
-            _data.push_back(default_color.g);
-            _data.push_back(default_color.b);
-            _data.push_back(default_color.a);
-        }
-
+        _data.resize(width * height * get_bytes_per_pixel());
         _size = {width, height};
+
+        fill(default_color);
     }
 
     void Image::create_from_pixbuf(GdkPixbuf* pixbuf)
     {
-        unsigned char* buffer = gdk_pixbuf_get_pixels(pixbuf);
+        const unsigned char* buffer = gdk_pixbuf_get_pixels(pixbuf);
 
-        bool has_alpha = gdk_pixbuf_get_has_alpha(pixbuf);
-        size_t padding_bytes = gdk_pixbuf_get_rowstride(pixbuf) / sizeof(unsigned char) - gdk_pixbuf_get_width(pixbuf) * (has_alpha ? 4 : 3);
-        _size = {gdk_pixbuf_get_width(pixbuf) - padding_bytes, gdk_pixbuf_get_height(pixbuf)};
-        size_t n = _size.x * _size.y * (has_alpha ? 4 : 3);
+        const bool has_alpha = gdk_pixbuf_get_has_alpha(pixbuf);
+        const size_t n_channels = gdk_pixbuf_get_n_channels(pixbuf);
+        const size_t row_stride = gdk_pixbuf_get_rowstride(pixbuf);
 
-        _data.clear();
-        _data.reserve(n);
+        _format = ImageFormat::RGBA8;
+        _size = {gdk_pixbuf_get_width(pixbuf), gdk_pixbuf_get_height(pixbuf)};
+        _data.resize(_size.x * _size.y * 4);
 
-        for (size_t i = 0; i < n; ++i)
+        for (size_t y = 0; y < _size.y; ++y)
         {
-            _data.push_back(buffer[i] / 255.f);
+            const auto* in = buffer + y * row_stride;
+            auto* out = get_row(y).data();
+
+            if (has_alpha and n_channels == 4)
+            {
+                detail::copy_row(out, in, _size.x * 4);
+                continue;
+            }
 
-            if (not has_alpha)
-                _data.push_back(1);
+            for (size_t x = 0; x < _size.x; ++x)
+            {
+                out[x * 4 + 0] = in[x * n_channels + 0];
+                out[x * 4 + 1] = in[x * n_channels + 1];
+                out[x * 4 + 2] = in[x * n_channels + 2];
+                out[x * 4 + 3] = has_alpha ? in[x * n_channels + 3] : 255;
+            }
         }
     }
 
@@ -112,41 +326,127 @@ namespace mousetrap
         return true;
     }
 
+    namespace detail
+    {
+        static GdkMemoryFormat to_memory_format(ImageFormat format)
+        {
+            // straight alpha, same layout as image storage
+            return format == ImageFormat::RGBA8 ? GDK_MEMORY_R8G8B8A8 : GDK_MEMORY_R32G32B32A32_FLOAT;
+        }
+
+        static GdkTexture* new_memory_texture(Vector2ui size, ImageFormat format, GBytes* bytes)
+        {
+            const size_t stride = size.x * (format == ImageFormat::RGBA8 ? sizeof(PixelRGBA8) : sizeof(PixelRGBA32F));
+            auto* out = gdk_memory_texture_new(size.x, size.y, to_memory_format(format), bytes, stride);
+            g_bytes_unref(bytes);
+            return out;
+        }
+    }
+
     void Image::create_from_texture(GdkTexture* texture)
     {
-        auto size = Vector2ui(gdk_texture_get_width(texture), gdk_texture_get_height(texture));
+        _size = {gdk_texture_get_width(texture), gdk_texture_get_height(texture)};
+
+        #if GTK_CHECK_VERSION(4, 10, 0)
 
-        // FORMAT: ARGB32, c.f. https://docs.gtk.org/gdk4/method.Texture.download.html
+            switch (gdk_texture_get_format(texture))
+            {
+                case GDK_MEMORY_R16G16B16:
+                case GDK_MEMORY_R16G16B16A16_PREMULTIPLIED:
+                case GDK_MEMORY_R16G16B16A16:
+                case GDK_MEMORY_R16G16B16_FLOAT:
+                case GDK_MEMORY_R16G16B16A16_FLOAT_PREMULTIPLIED:
+                case GDK_MEMORY_R16G16B16A16_FLOAT:
+                case GDK_MEMORY_R32G32B32_FLOAT:
+                case GDK_MEMORY_R32G32B32A32_FLOAT_PREMULTIPLIED:
+                case GDK_MEMORY_R32G32B32A32_FLOAT:
+                    _format = ImageFormat::RGBA32F;
+                    break;
+                default:
+                    _format = ImageFormat::RGBA8;
+            }
+
+            _data.resize(_size.x * _size.y * get_bytes_per_pixel());
+
+            // GDK converts to our layout while copying, including un-premultiplying alpha
+            auto* downloader = gdk_texture_downloader_new(texture);
+            gdk_texture_downloader_set_format(downloader, detail::to_memory_format(_format));
+            gdk_texture_downloader_download_into(downloader, _data.data(), _size.x * get_bytes_per_pixel());
+            gdk_texture_downloader_free(downloader);
 
-        auto* surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,gdk_texture_get_width(texture), gdk_texture_get_height(texture));
-        gdk_texture_download(texture,cairo_image_surface_get_data(surface),cairo_image_surface_get_stride(surface));
-        auto* data = cairo_image_surface_get_data(surface);
+        #else
 
-        create(size.x, size.y);
-        for (size_t i = 0; i < size.x * size.y * 4; i = i + 4)
+            // only premultiplied BGRA in native byte order is available, c.f. https://docs.gtk.org/gdk4/method.Texture.download.html
+            _format = ImageFormat::RGBA8;
+            _data.resize(_size.x * _size.y * 4);
+            gdk_texture_download(texture, _data.data(), _size.x * 4);
+
+            for (size_t i = 0; i < _data.size(); i += 4)
+            {
+                uint32_t argb;
+                std::memcpy(&argb, _data.data() + i, 4);
+
+                const uint8_t a = argb >> 24;
+                const uint8_t r = argb >> 16;
+                const uint8_t g = argb >> 8;
+                const uint8_t b = argb;
+
+                auto unpremultiply = [a](uint8_t c) -> uint8_t {
+                    return a == 0 ? 0 : std::min<int>((c * 255 + a / 2) / a, 255);
+                };
+
+                _data[i + 0] = unpremultiply(r);
+                _data[i + 1] = unpremultiply(g);
+                _data[i + 2] = unpremultiply(b);
+                _data[i + 3] = a;
+            }
+
+        #endif
+    }
+
+    GdkTexture* Image::to_texture() const
+    {
+        if (_size.x == 0 or _size.y == 0)
         {
-            guchar b = data[i+0];
-            guchar g = data[i+1];
-            guchar r = data[i+2];
-            guchar a = data[i+3];
+            std::cerr << "[WARNING] In Image::to_texture: Image is empty, no texture will be created" << std::endl;
+            return nullptr;
+        }
+
+        return detail::new_memory_texture(get_size(), _format, g_bytes_new(_data.data(), _data.size()));
+    }
 
-            _data[i+0] = float(r) / 255.f;
-            _data[i+1] = float(g) / 255.f;
-            _data[i+2] = float(b) / 255.f;
-            _data[i+3] = float(a) / 255.f;
+    GdkTexture* Image::move_to_texture()
+    {
+        if (_size.x == 0 or _size.y == 0)
+        {
+            std::cerr << "[WARNING] In Image::move_to_texture: Image is empty, no texture will be created" << std::endl;
+            return nullptr;
         }
 
-        cairo_surface_mark_dirty(surface);
-        g_free(surface);
+        // storage is freed once the texture and all its copies are released
+        auto* storage = new std::vector<uint8_t>(std::move(_data));
+        auto* bytes = g_bytes_new_with_free_func(storage->data(), storage->size(), [](gpointer data){
+            delete (std::vector<uint8_t>*) data;
+        }, storage);
+
+        auto* out = detail::new_memory_texture(get_size(), _format, bytes);
+
+        _data.clear();
+        _size = {0, 0};
+        return out;
     }
 
     GdkPixbuf* Image::to_pixbuf() const
     {
         auto* out = gdk_pixbuf_new(GDK_COLORSPACE_RGB, true, 8, _size.x, _size.y);
         auto* data = gdk_pixbuf_get_pixels(out);
+        const size_t row_stride = gdk_pixbuf_get_rowstride(out);
 
-        for (size_t i = 0; i < _data.size(); ++i)
-            data[i] = uint8_t(_data.at(i) * 255.f);
+        auto as_rgba8 = Image(*this);
+        as_rgba8.set_format(ImageFormat::RGBA8);
+
+        for (size_t y = 0; y < _size.y; ++y)
+            detail::copy_row(data + y * row_stride, as_rgba8.get_row(y).data(), _size.x * 4);
 
         return out;
     }
@@ -187,6 +487,43 @@ namespace mousetrap
         return _data.size();
     }
 
+    ImageFormat Image::get_format() const
+    {
+        return _format;
+    }
+
+    size_t Image::get_bytes_per_pixel() const
+    {
+        return _format == ImageFormat::RGBA8 ? sizeof(detail::PixelRGBA8) : sizeof(detail::PixelRGBA32F);
+    }
+
+    void Image::set_format(ImageFormat format)
+    {
+        if (format == _format)
+            return;
+
+        const size_t n_components = get_n_pixels() * 4;
+        std::vector<uint8_t> converted;
+
+        if (format == ImageFormat::RGBA32F)
+        {
+            converted.resize(n_components * sizeof(float));
+            auto* out = (float*) converted.data();
+            for (size_t i = 0; i < n_components; ++i)
+                out[i] = detail::from_rgba8_component(_data[i]);
+        }
+        else
+        {
+            converted.resize(n_components);
+            const auto* in = (const float*) _data.data();
+            for (size_t i = 0; i < n_components; ++i)
+                converted[i] = detail::to_rgba8_component(in[i]);
+        }
+
+        _data = std::move(converted);
+        _format = format;
+    }
+
     size_t Image::get_n_pixels() const
     {
         return get_size().x * get_size().y;
@@ -194,23 +531,18 @@ namespace mousetrap
 
     size_t Image::to_linear_index(size_t x, size_t y) const
     {
-        return y * (_size.x * 4) + (x * 4);
+        return (y * _size.x + x) * get_bytes_per_pixel();
     }
 
     void Image::set_pixel(size_t x, size_t y, RGBA color)
     {
-        auto i = to_linear_index(x, y);
-
-        if (i >= _data.size())
+        if (x >= _size.x or y >= _size.y)
         {
             std::cerr << "[ERROR] In Image::set_pixel: indices " << x << " " << y << " are out of bounds for an image of size " << _size.x << "x" << _size.y << std::endl;
             return;
         }
 
-        _data.at(i) = color.r;
-        _data.at(i+1) = color.g;
-        _data.at(i+2) = color.b;
-        _data.at(i+3) = color.a;
+        set_pixel(y * _size.x + x, color);
     }
 
     void Image::set_pixel(size_t x, size_t y, HSVA color)
@@ -220,88 +552,77 @@ namespace mousetrap
 
     RGBA Image::get_pixel(size_t x, size_t y) const
     {
-        auto i = to_linear_index(x, y);
-
-        if (i >= _data.size())
+        if (x >= _size.x or y >= _size.y)
         {
             std::cerr << "[ERROR] In Image::get_pixel: indices " << x << " " << y << " are out of bounds for an image of size " << _size.x << "x" << _size.y << std::endl;
             return RGBA(0, 0, 0, 0);
         }
 
-        return RGBA
-        (
-            _data.at(i),
-            _data.at(i+1),
-            _data.at(i+2),
-            _data.at(i+3)
-        );
+        return get_pixel(y * _size.x + x);
     }
 
     void Image::set_pixel(size_t i, RGBA color)
     {
-        i *= 4;
-
-        if (i >= _data.size())
+        if (i >= get_n_pixels())
         {
-            std::cerr << "[ERROR] In Image::set_pixel: index " << i / 4 << " out of bounds for an image of with " << _size.x * _size.y << " pixels" << std::endl;
+            std::cerr << "[ERROR] In Image::set_pixel: index " << i << " out of bounds for an image of with " << _size.x * _size.y << " pixels" << std::endl;
             return;
         }
 
-        _data.at(i) = color.r;
-        _data.at(i+1) = color.g;
-        _data.at(i+2) = color.b;
-        _data.at(i+3) = color.a;
+        if (_format == ImageFormat::RGBA8)
+        {
+            auto* pixel = _data.data() + i * 4;
+            pixel[0] = detail::to_rgba8_component(color.r);
+            pixel[1] = detail::to_rgba8_component(color.g);
+            pixel[2] = detail::to_rgba8_component(color.b);
+            pixel[3] = detail::to_rgba8_component(color.a);
+        }
+        else
+        {
+            auto* pixel = ((float*) _data.data()) + i * 4;
+            pixel[0] = color.r;
+            pixel[1] = color.g;
+            pixel[2] = color.b;
+            pixel[3] = color.a;
+        }
     }
 
     void Image::set_pixel(size_t i, HSVA color_hsva)
     {
-        auto color = color_hsva.operator RGBA();
-
-        i *= 4;
-
-        if (i >= _data.size())
-        {
-            std::cerr << "[ERROR] In Image::set_pixel: index " << i / 4 << " out of bounds for an image of with " << _size.x * _size.y << " pixels" << std::endl;
-            RGBA(0, 0, 0, 0);
-        }
-
-        _data.at(i) = color.r;
-        _data.at(i+1) = color.g;
-        _data.at(i+2) = color.b;
-        _data.at(i+3) = color.a;
+        set_pixel(i, color_hsva.operator RGBA());
     }
 
     RGBA Image::get_pixel(size_t i) const
     {
-        i *= 4;
+        if (i >= get_n_pixels())
+        {
+            std::cerr << "[ERROR] In Image::get_pixel: index " << i << " out of bounds for an image of with " << _size.x * _size.y << " pixels" << std::endl;
+            return RGBA(0, 0, 0, 0);
+        }
 
-        return RGBA
-        (
-            _data.at(i),
-            _data.at(i+1),
-            _data.at(i+2),
-            _data.at(i+3)
-        );
+        if (_format == ImageFormat::RGBA8)
+        {
+            const auto* pixel = _data.data() + i * 4;
+            return RGBA
+            (
+                detail::from_rgba8_component(pixel[0]),
+                detail::from_rgba8_component(pixel[1]),
+                detail::from_rgba8_component(pixel[2]),
+                detail::from_rgba8_component(pixel[3])
+            );
+        }
+        else
+        {
+            const auto* pixel = ((const float*) _data.data()) + i * 4;
+            return RGBA(pixel[0], pixel[1], pixel[2], pixel[3]);
+        }
     }
 
     Image Image::as_cropped(int offset_x, int offset_y, size_t size_x, size_t size_y) const
     {
-        auto out = Image();
-        out.create(size_x, size_y);
-
-        for (size_t y = 0; y < size_y; ++y)
-        {
-            for (size_t x = 0; x < size_x; ++x)
-            {
-                Vector2i pos = {x - offset_x, y - offset_y};
-
-                if (pos.x < 0 or pos.x >= get_size().x or pos.y < 0 or pos.y >= get_size().y)
-                    out.set_pixel(x, y, RGBA(0, 0, 0, 0));
-                else
-                    out.set_pixel(x, y, get_pixel(pos.x, pos.y));
-            }
-        }
-
+        auto out = Image(_format);
+        out.create(size_x, size_y, RGBA(0, 0, 0, 0));
+        out.copy_region(*this, {-offset_x, -offset_y}, {size_x, size_y}, {0, 0});
         return out;
     }
 
@@ -321,6 +642,7 @@ namespace mousetrap
 
         auto out = Image();
         out.create_from_pixbuf(scaled);
+        out.set_format(_format);
 
         g_object_unref(unscaled);
         g_object_unref(scaled);
@@ -330,25 +652,179 @@ namespace mousetrap
 
     Image Image::as_flipped(bool flip_horizontally, bool flip_vertically) const
     {
-        auto out = Image();
-        out.create(_size.x, _size.y);
+        auto out = *this;
+        out.flip_in_place(flip_horizontally, flip_vertically);
+        return out;
+    }
+
+    std::span<uint8_t> Image::get_row(size_t y)
+    {
+        const size_t row_size = _size.x * get_bytes_per_pixel();
+        return std::span<uint8_t>(_data.data() + y * row_size, row_size);
+    }
+
+    std::span<const uint8_t> Image::get_row(size_t y) const
+    {
+        const size_t row_size = _size.x * get_bytes_per_pixel();
+        return std::span<const uint8_t>(_data.data() + y * row_size, row_size);
+    }
+
+    void Image::fill(RGBA color)
+    {
+        if (_format == ImageFormat::RGBA8)
+            detail::fill_row_rgba8(_data.data(), get_n_pixels(), color);
+        else
+            detail::fill_row_rgba32f((float*) _data.data(), get_n_pixels(), color);
+    }
 
-        for (size_t x = 0; x < _size.x; ++x)
+    void Image::fill_region(Vector2i top_left, Vector2ui size, RGBA color)
+    {
+        Vector2i bottom_right = {top_left.x + int64_t(size.x), top_left.y + int64_t(size.y)};
+        if (not detail::clip_region(top_left, bottom_right, _size))
+            return;
+
+        const size_t width = bottom_right.x - top_left.x;
+        const size_t bpp = get_bytes_per_pixel();
+
+        for (int64_t y = top_left.y; y < bottom_right.y; ++y)
+        {
+            auto* row = get_row(y).data() + top_left.x * bpp;
+            if (_format == ImageFormat::RGBA8)
+                detail::fill_row_rgba8(row, width, color);
+            else
+                detail::fill_row_rgba32f((float*) row, width, color);
+        }
+    }
+
+    void Image::copy_region(const Image& source_in, Vector2i source_top_left, Vector2ui size, Vector2i destination_top_left)
+    {
+        if (source_in._format != _format)
+        {
+            auto converted = source_in;
+            converted.set_format(_format);
+            copy_region(converted, source_top_left, size, destination_top_left);
+            return;
+        }
+
+        const auto& source = source_in;
+
+        // clip against source, then translate into destination space and clip again
+
+        Vector2i source_bottom_right = {source_top_left.x + int64_t(size.x), source_top_left.y + int64_t(size.y)};
+        auto source_clipped_top_left = source_top_left;
+        if (not detail::clip_region(source_clipped_top_left, source_bottom_right, source._size))
+            return;
+
+        Vector2i top_left = {
+            destination_top_left.x + (source_clipped_top_left.x - source_top_left.x),
+            destination_top_left.y + (source_clipped_top_left.y - source_top_left.y)
+        };
+        Vector2i bottom_right = {
+            top_left.x + (source_bottom_right.x - source_clipped_top_left.x),
+            top_left.y + (source_bottom_right.y - source_clipped_top_left.y)
+        };
+
+        auto unclipped_top_left = top_left;
+        if (not detail::clip_region(top_left, bottom_right, _size))
+            return;
+
+        source_clipped_top_left.x += top_left.x - unclipped_top_left.x;
+        source_clipped_top_left.y += top_left.y - unclipped_top_left.y;
+
+        const size_t bpp = get_bytes_per_pixel();
+        const size_t n_bytes = (bottom_right.x - top_left.x) * bpp;
+
+        auto copy = [&](int64_t y){
+            detail::copy_row(
+                get_row(y).data() + top_left.x * bpp,
+                source.get_row(source_clipped_top_left.y + (y - top_left.y)).data() + source_clipped_top_left.x * bpp,
+                n_bytes
+            );
+        };
+
+        if (&source == this and source_clipped_top_left.y < top_left.y)
+        {
+            // overlapping copy onto self, iterate bottom to top so rows are read before being overwritten
+            for (int64_t y = bottom_right.y - 1; y >= top_left.y; --y)
+                copy(y);
+        }
+        else
+        {
+            for (int64_t y = top_left.y; y < bottom_right.y; ++y)
+                copy(y);
+        }
+    }
+
+    void Image::flip_in_place(bool flip_horizontally, bool flip_vertically)
+    {
+        if (flip_horizontally)
         {
             for (size_t y = 0; y < _size.y; ++y)
             {
-                Vector2ui pos = {x, y};
-
-                if (flip_horizontally)
-                    pos.x = _size.x - pos.x - 1;
+                if (_format == ImageFormat::RGBA8)
+                    detail::reverse_row_rgba8(get_row(y).data(), _size.x);
+                else
+                    detail::reverse_row_rgba32f((float*) get_row(y).data(), _size.x);
+            }
+        }
 
-                if (flip_vertically)
-                    pos.y = _size.y - pos.y - 1;
+        if (flip_vertically and _size.y > 1)
+        {
+            const size_t row_size = _size.x * get_bytes_per_pixel();
+            auto buffer = std::vector<uint8_t>(row_size);
 
-                out.set_pixel(pos.x, pos.y, get_pixel(x, y));
+            for (size_t top = 0, bottom = _size.y - 1; top < bottom; ++top, --bottom)
+            {
+                detail::copy_row(buffer.data(), get_row(top).data(), row_size);
+                detail::copy_row(get_row(top).data(), get_row(bottom).data(), row_size);
+                detail::copy_row(get_row(bottom).data(), buffer.data(), row_size);
             }
         }
+    }
+
+    void Image::invert_in_place()
+    {
+        if (_format == ImageFormat::RGBA8)
+            detail::invert_row_rgba8(_data.data(), get_n_pixels());
+        else
+            detail::invert_row_rgba32f((float*) _data.data(), get_n_pixels());
+    }
+
+    Image Image::as_rotated_clockwise() const
+    {
+        const size_t w = _size.x;
+        const size_t h = _size.y;
+
+        auto out = Image(_format);
+        out.create(h, w);
+
+        // out(h - 1 - y, x) = in(x, y)
+        auto transform = [&](size_t x, size_t y) { return x * h + (h - 1 - y); };
+
+        if (_format == ImageFormat::RGBA8)
+            detail::rotate((const detail::PixelRGBA8*) _data.data(), w, h, (detail::PixelRGBA8*) out._data.data(), transform);
+        else
+            detail::rotate((const detail::PixelRGBA32F*) _data.data(), w, h, (detail::PixelRGBA32F*) out._data.data(), transform);
+
+        return out;
+    }
+
+    Image Image::as_rotated_counterclockwise() const
+    {
+        const size_t w = _size.x;
+        const size_t h = _size.y;
+
+        auto out = Image(_format);
+        out.create(h, w);
+
+        // out(y, w - 1 - x) = in(x, y)
+        auto transform = [&](size_t x, size_t y) { return (w - 1 - x) * h + y; };
+
+        if (_format == ImageFormat::RGBA8)
+            detail::rotate((const detail::PixelRGBA8*) _data.data(), w, h, (detail::PixelRGBA8*) out._data.data(), transform);
+        else
+            detail::rotate((const detail::PixelRGBA32F*) _data.data(), w, h, (detail::PixelRGBA32F*) out._data.data(), transform);
 
         return out;
     }
-}
\ No newline at end of file
+}
@@ -57,10 +57,28 @@ namespace mousetrap
         : WidgetImplementation<GtkImage>([&]() -> GtkImage* {
 
             _size = image.get_size();
-            return GTK_IMAGE(gtk_image_new_from_pixbuf(image.to_pixbuf()));
+
+            auto* texture = image.to_texture();
+            if (texture == nullptr)
+                return GTK_IMAGE(gtk_image_new());
+
+            auto* out = GTK_IMAGE(gtk_image_new_from_paintable(GDK_PAINTABLE(texture)));
+            g_object_unref(texture);
+            return out;
         }())
     {}
 
+    void ImageDisplay::create_from_image(const Image& image)
+    {
+        auto* texture = image.to_texture();
+        gtk_image_set_from_paintable(get_native(), GDK_PAINTABLE(texture));
+
+        if (texture != nullptr)
+            g_object_unref(texture);
+
+        _size = image.get_size();
+    }
+
     Vector2ui ImageDisplay::get_size() const
     {
         return _size;
@@ -31,37 +31,65 @@ namespace mousetrap
 
         glUseProgram(shader->get_program_id());
 
-        for (auto& pair : _floats)
-            if (pair.second != nullptr)
-                shader->set_uniform_float(pair.first, *pair.second);
-
-        for (auto& pair : _ints)
-            if (pair.second != nullptr)
-                shader->set_uniform_int(pair.first, *pair.second);
-
-        for (auto& pair : _vec2s)
-            if (pair.second != nullptr)
-                shader->set_uniform_vec2(pair.first, *pair.second);
-
-        for (auto& pair : _vec3s)
-            if (pair.second != nullptr)
-                shader->set_uniform_vec3(pair.first, *pair.second);
-
-        for (auto& pair : _vec4s)
-            if (pair.second != nullptr)
-                shader->set_uniform_vec4(pair.first, *pair.second);
-
-        for (auto& pair : _transforms)
-            if (pair.second != nullptr)
-                shader->set_uniform_transform(pair.first, *pair.second);
-
-        for (auto& pair : _colors_rgba)
-            if (pair.second != nullptr)
-                shader->set_uniform_vec4(pair.first, pair.second->operator glm::vec4());
-
-        for (auto& pair : _colors_hsva)
-            if (pair.second != nullptr)
-                shader->set_uniform_vec4(pair.first, pair.second->operator glm::vec4());
+        if (_bindings_dirty or _compiled_program_id != shader->get_program_id())
+            compile();
+
+        for (auto& binding : _bindings)
+        {
+            switch (binding.type)
+            {
+                case UniformBinding::FLOAT:
+                    glUniform1f(binding.location, *((const float*) binding.value));
+                    break;
+
+                case UniformBinding::INT:
+                    glUniform1i(binding.location, *((const int*) binding.value));
+                    break;
+
+                case UniformBinding::UINT:
+                    glUniform1ui(binding.location, *((const glm::uint*) binding.value));
+                    break;
+
+                case UniformBinding::VEC2:
+                {
+                    auto& value = *((const Vector2f*) binding.value);
+                    glUniform2f(binding.location, value.x, value.y);
+                    break;
+                }
+
+                case UniformBinding::VEC3:
+                {
+                    auto& value = *((const Vector3f*) binding.value);
+                    glUniform3f(binding.location, value.x, value.y, value.z);
+                    break;
+                }
+
+                case UniformBinding::VEC4:
+                {
+                    auto& value = *((const Vector4f*) binding.value);
+                    glUniform4f(binding.location, value.x, value.y, value.z, value.w);
+                    break;
+                }
+
+                case UniformBinding::TRANSFORM:
+                    glUniformMatrix4fv(binding.location, 1, GL_FALSE, &(((const GLTransform*) binding.value)->transform[0][0]));
+                    break;
+
+                case UniformBinding::COLOR_RGBA:
+                {
+                    auto value = ((const RGBA*) binding.value)->operator glm::vec4();
+                    glUniform4f(binding.location, value.x, value.y, value.z, value.w);
+                    break;
+                }
+
+                case UniformBinding::COLOR_HSVA:
+                {
+                    auto value = ((const HSVA*) binding.value)->operator glm::vec4();
+                    glUniform4f(binding.location, value.x, value.y, value.z, value.w);
+                    break;
+                }
+            }
+        }
 
         glEnable(GL_BLEND);
         set_current_blend_mode(_blend_mode);
@@ -69,94 +97,146 @@ namespace mousetrap
         set_current_blend_mode(BlendMode::NORMAL);
     }
 
+    void RenderTask::compile()
+    {
+        auto* shader = _shader == nullptr ? noop_shader : _shader;
+
+        _bindings.clear();
+        auto add = [&](const auto& map, UniformBinding::Type type)
+        {
+            for (auto& pair : map)
+            {
+                if (pair.second == nullptr)
+                    continue;
+
+                auto location = shader->get_uniform_location(pair.first);
+                if (location == -1)
+                    continue;
+
+                _bindings.push_back(UniformBinding{type, location, pair.second});
+            }
+        };
+
+        add(_floats, UniformBinding::FLOAT);
+        add(_ints, UniformBinding::INT);
+        add(_uints, UniformBinding::UINT);
+        add(_vec2s, UniformBinding::VEC2);
+        add(_vec3s, UniformBinding::VEC3);
+        add(_vec4s, UniformBinding::VEC4);
+        add(_transforms, UniformBinding::TRANSFORM);
+        add(_colors_rgba, UniformBinding::COLOR_RGBA);
+        add(_colors_hsva, UniformBinding::COLOR_HSVA);
+
+        _compiled_program_id = shader->get_program_id();
+        _bindings_dirty = false;
+    }
+
     void RenderTask::register_float(const std::string& uniform_name, float* value)
     {
         _floats.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_int(const std::string& uniform_name, int* value)
     {
         _ints.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_uint(const std::string& uniform_name, glm::uint* value)
     {
         _uints.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_vec2(const std::string& uniform_name, Vector2f* value)
     {
         _vec2s.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_vec3(const std::string& uniform_name, Vector3f* value)
     {
         _vec3s.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_vec4(const std::string& uniform_name, Vector4f* value)
     {
         _vec4s.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_transform(const std::string& uniform_name, GLTransform* value)
     {
         _transforms.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_color(const std::string& uniform_name, RGBA* value)
     {
         _colors_rgba.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_color(const std::string& uniform_name, HSVA* value)
     {
         _colors_hsva.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_float(const std::string& uniform_name, const float* value)
     {
         _floats.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_int(const std::string& uniform_name, const int* value)
     {
         _ints.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_uint(const std::string& uniform_name, const glm::uint* value)
     {
         _uints.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_vec2(const std::string& uniform_name, const Vector2f* value)
     {
         _vec2s.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_vec3(const std::string& uniform_name, const Vector3f* value)
     {
         _vec3s.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_vec4(const std::string& uniform_name, const Vector4f* value)
     {
         _vec4s.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_transform(const std::string& uniform_name, const GLTransform* value)
     {
         _transforms.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_color(const std::string& uniform_name, const RGBA* value)
     {
         _colors_rgba.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     void RenderTask::register_color(const std::string& uniform_name, const HSVA* value)
     {
         _colors_hsva.insert({uniform_name, value});
+        _bindings_dirty = true;
     }
 
     Shape* RenderTask::get_shape()
@@ -38,6 +38,7 @@ namespace mousetrap
         glFramebufferTexture2D(GL_FRAMEBUFFER, ATTACHMENT, GL_TEXTURE_2D, get_native_handle(), 0);
         GLenum DrawBuffers[1] = {ATTACHMENT};
         glDrawBuffers(1, DrawBuffers);
+        glReadBuffer(ATTACHMENT);
     }
 
     void RenderTexture::unbind_as_rendertarget() const
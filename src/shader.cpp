@@ -8,47 +8,42 @@
 #include <fstream>
 #include <sstream>
 #include <include/shader.hpp>
+#include <include/shader_library.hpp>
 
 namespace mousetrap
 {
     Shader::Shader()
     {
-        if (GL_INITIALIZED and _noop_program_id == 0)
+        if (not GL_INITIALIZED)
         {
-            _noop_fragment_shader_id = compile_shader(_noop_fragment_shader_source, ShaderType::FRAGMENT);
-            _noop_vertex_shader_id = compile_shader(_noop_vertex_shader_source, ShaderType::VERTEX);
-            _noop_program_id = link_program(_noop_fragment_shader_id, _noop_vertex_shader_id);
-        }
-        else if (not GL_INITIALIZED)
             std::cerr
                     << "[WARNING] In Shader::Shader: Trying to initialize the noop shaders, but GL_INITIALIZED is still false."
                     << std::endl;
+            return;
+        }
 
-        _program_id = _noop_program_id;
-        _fragment_shader_id = _noop_fragment_shader_id;
-        _vertex_shader_id = _noop_vertex_shader_id;
+        _program_id = ShaderLibrary::acquire_program(_fragment_source, _vertex_source);
+        update_uniform_locations();
     }
 
     Shader::~Shader()
     {
-        if (_fragment_shader_id != 0 and _fragment_shader_id != _noop_fragment_shader_id)
-            glDeleteShader(_fragment_shader_id);
-
-        if (_vertex_shader_id != 0 and _vertex_shader_id != _noop_vertex_shader_id)
-            glDeleteShader(_vertex_shader_id);
-
-        if (_program_id != 0 and _program_id != _noop_program_id)
-            glDeleteProgram(_program_id);
+        ShaderLibrary::release_program(_program_id);
     }
 
     void Shader::create_from_string(const std::string& code, ShaderType type)
     {
         if (type == ShaderType::FRAGMENT)
-            _fragment_shader_id = compile_shader(code, type);
+            _fragment_source = code;
         else
-            _vertex_shader_id = compile_shader(code, type);
+            _vertex_source = code;
+
+        // acquire before release, so a program used by this shader only is not deleted and compiled again
+        auto program_id = ShaderLibrary::acquire_program(_fragment_source, _vertex_source);
+        ShaderLibrary::release_program(_program_id);
+        _program_id = program_id;
 
-        _program_id = link_program(_fragment_shader_id, _vertex_shader_id);
+        update_uniform_locations();
     }
 
     void Shader::create_from_file(const std::string& path, ShaderType type)
@@ -75,82 +70,12 @@ namespace mousetrap
 
     GLNativeHandle Shader::get_vertex_shader_id() const
     {
-        return _vertex_shader_id;
+        return ShaderLibrary::get_shader(_vertex_source, ShaderType::VERTEX);
     }
 
     GLNativeHandle Shader::get_fragment_shader_id() const
     {
-        return _fragment_shader_id;
-    }
-
-    GLNativeHandle Shader::compile_shader(const std::string& source, ShaderType shader_type)
-    {
-        GLNativeHandle id = glCreateShader(static_cast<GLenum>(shader_type));
-
-        const char* source_ptr = source.c_str();
-        glShaderSource(id, 1, &source_ptr, nullptr);
-        glCompileShader(id);
-
-        GLint compilation_success = GL_FALSE;
-        glGetShaderiv(id, GL_COMPILE_STATUS, &compilation_success);
-        if (compilation_success != GL_TRUE)
-        {
-            std::cerr << "In Shader::compile_shader: compilation failed:\n"
-                      << source << "\n\n";
-
-            int info_length = 0;
-            int max_length = info_length;
-
-            glGetShaderiv(id, GL_INFO_LOG_LENGTH, &max_length);
-
-            auto log = std::vector<char>();
-            log.resize(max_length);
-
-            glGetShaderInfoLog(id, max_length, &info_length, log.data());
-
-            for (auto c: log)
-                std::cerr << c;
-            std::cerr << std::endl;
-
-            glDeleteShader(id);
-            id = 0;
-        }
-
-        return id;
-    }
-
-    GLNativeHandle Shader::link_program(GLNativeHandle fragment_id, GLNativeHandle vertex_id)
-    {
-        GLNativeHandle id = glCreateProgram();
-        glAttachShader(id, fragment_id);
-        glAttachShader(id, vertex_id);
-        glLinkProgram(id);
-
-        GLint link_success = GL_FALSE;
-        glGetProgramiv(id, GL_LINK_STATUS, &link_success);
-        if (link_success != GL_TRUE)
-        {
-            std::cerr << "In Shader::link_program: linking failed:" << std::endl;
-
-            int info_length = 0;
-            int max_length = info_length;
-
-            glGetProgramiv(_program_id, GL_INFO_LOG_LENGTH, &max_length);
-
-            auto log = std::vector<char>();
-            log.resize(max_length);
-
-            glGetProgramInfoLog(_program_id, max_length, &info_length, log.data());
-
-            for (auto c: log)
-                std::cerr << c;
-            std::cerr << std::endl;
-
-            glDeleteProgram(id);
-            id = 0;
-        }
-
-        return id;
+        return ShaderLibrary::get_shader(_fragment_source, ShaderType::FRAGMENT);
     }
 
     void Shader::set_uniform_float(const std::string& uniform_name, float value)
@@ -190,7 +115,38 @@ namespace mousetrap
 
     int Shader::get_uniform_location(const std::string& str) const
     {
-        return glGetUniformLocation(_program_id, str.c_str());
+        auto it = _uniform_locations.find(str);
+        if (it != _uniform_locations.end())
+            return it->second;
+
+        auto location = glGetUniformLocation(_program_id, str.c_str());
+        _uniform_locations.insert({str, location});
+        return location;
+    }
+
+    int Shader::get_transform_location() const
+    {
+        return _transform_location;
+    }
+
+    int Shader::get_texture_set_location() const
+    {
+        return _texture_set_location;
+    }
+
+    void Shader::update_uniform_locations()
+    {
+        _uniform_locations.clear();
+
+        if (_program_id == 0)
+        {
+            _transform_location = -1;
+            _texture_set_location = -1;
+            return;
+        }
+
+        _transform_location = get_uniform_location("_transform");
+        _texture_set_location = get_uniform_location("_texture_set");
     }
 
     int Shader::get_vertex_position_location()
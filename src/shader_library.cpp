@@ -0,0 +1,377 @@
+//
+// Copyright 2023 Clemens Cords
+// Created on 3/28/23 by clem (mail@clemens-cords.com)
+//
+
+#include <include/shader_library.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        // cache file: header, then the binary as returned by glGetProgramBinary
+        struct ProgramBinaryHeader
+        {
+            char magic[4] = {'M', 'T', 'P', 'B'};
+            uint32_t version = 1;
+            uint32_t format;
+            uint64_t driver_hash;
+            uint64_t source_hash;
+            uint64_t size;
+        };
+
+        bool program_binary_header_valid(const ProgramBinaryHeader& header, size_t driver_hash, size_t source_hash)
+        {
+            auto expected = ProgramBinaryHeader();
+            return std::memcmp(header.magic, expected.magic, 4) == 0
+                and header.version == expected.version
+                and header.driver_hash == driver_hash
+                and header.source_hash == source_hash;
+        }
+    }
+
+    size_t ShaderLibrary::hash(const std::string& fragment_source, const std::string& vertex_source)
+    {
+        auto hasher = std::hash<std::string_view>();
+        return hasher(fragment_source) ^ (hasher(vertex_source) * 0x9E3779B97F4A7C15ull);
+    }
+
+    GLNativeHandle ShaderLibrary::acquire_program(const std::string& fragment_source, const std::string& vertex_source)
+    {
+        const auto key = hash(fragment_source, vertex_source);
+
+        auto it = _programs.find(key);
+        if (it != _programs.end())
+        {
+            if (it->second.fragment_source == fragment_source and it->second.vertex_source == vertex_source)
+            {
+                it->second.n_users += 1;
+                return it->second.id;
+            }
+
+            // hash collision, link a program of its own that is deleted on release
+            std::cerr << "[WARNING] In ShaderLibrary::acquire_program: Hash collision, program will not be shared" << std::endl;
+
+            auto fragment_id = compile(fragment_source, ShaderType::FRAGMENT);
+            auto vertex_id = compile(vertex_source, ShaderType::VERTEX);
+            auto id = link(fragment_id, vertex_id);
+
+            for (auto shader_id : {fragment_id, vertex_id})
+                if (shader_id != 0)
+                    glDeleteShader(shader_id);
+
+            return id;
+        }
+
+        GLNativeHandle id = load_binary(key);
+        if (id == 0)
+        {
+            auto fragment_id = get_shader(fragment_source, ShaderType::FRAGMENT);
+            auto vertex_id = get_shader(vertex_source, ShaderType::VERTEX);
+            if (fragment_id == 0 or vertex_id == 0)
+                return 0;
+
+            id = link(fragment_id, vertex_id);
+            if (id == 0)
+                return 0;
+
+            store_binary(id, key);
+        }
+
+        _programs.insert({key, {id, 1, fragment_source, vertex_source}});
+        _program_hashes.insert({id, key});
+        return id;
+    }
+
+    void ShaderLibrary::release_program(GLNativeHandle id)
+    {
+        if (id == 0)
+            return;
+
+        auto hash_it = _program_hashes.find(id);
+        if (hash_it == _program_hashes.end())
+        {
+            // not shared, c.f. hash collision in acquire_program
+            glDeleteProgram(id);
+            return;
+        }
+
+        auto it = _programs.find(hash_it->second);
+        it->second.n_users -= 1;
+        if (it->second.n_users > 0)
+            return;
+
+        glDeleteProgram(id);
+        _programs.erase(it);
+        _program_hashes.erase(hash_it);
+    }
+
+    GLNativeHandle ShaderLibrary::get_shader(const std::string& source, ShaderType type)
+    {
+        const auto key = std::hash<std::string_view>()(source) ^ static_cast<size_t>(type);
+
+        auto it = _shaders.find(key);
+        if (it != _shaders.end() and it->second.source == source)
+            return it->second.id;
+
+        // not cached on hash collision, so the cached shader stays valid for the programs using it
+        auto id = compile(source, type);
+        if (id == 0 or it != _shaders.end())
+            return id;
+
+        _shaders.insert({key, {id, source}});
+        return id;
+    }
+
+    GLNativeHandle ShaderLibrary::compile(const std::string& source, ShaderType shader_type)
+    {
+        GLNativeHandle id = glCreateShader(static_cast<GLenum>(shader_type));
+
+        const char* source_ptr = source.c_str();
+        glShaderSource(id, 1, &source_ptr, nullptr);
+        glCompileShader(id);
+
+        GLint compilation_success = GL_FALSE;
+        glGetShaderiv(id, GL_COMPILE_STATUS, &compilation_success);
+        if (compilation_success != GL_TRUE)
+        {
+            std::cerr << "In ShaderLibrary::compile: compilation failed:\n"
+                      << source << "\n\n";
+
+            int info_length = 0;
+            int max_length = info_length;
+
+            glGetShaderiv(id, GL_INFO_LOG_LENGTH, &max_length);
+
+            auto log = std::vector<char>();
+            log.resize(max_length);
+
+            glGetShaderInfoLog(id, max_length, &info_length, log.data());
+
+            for (auto c: log)
+                std::cerr << c;
+            std::cerr << std::endl;
+
+            glDeleteShader(id);
+            id = 0;
+        }
+
+        return id;
+    }
+
+    GLNativeHandle ShaderLibrary::link(GLNativeHandle fragment_id, GLNativeHandle vertex_id)
+    {
+        if (fragment_id == 0 or vertex_id == 0)
+            return 0;
+
+        GLNativeHandle id = glCreateProgram();
+
+        if (get_program_binaries_supported())
+            glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+        glAttachShader(id, fragment_id);
+        glAttachShader(id, vertex_id);
+        glLinkProgram(id);
+
+        // shader objects are shared between programs, the linked program does not need them attached
+        glDetachShader(id, fragment_id);
+        glDetachShader(id, vertex_id);
+
+        GLint link_success = GL_FALSE;
+        glGetProgramiv(id, GL_LINK_STATUS, &link_success);
+        if (link_success != GL_TRUE)
+        {
+            std::cerr << "In ShaderLibrary::link: linking failed:" << std::endl;
+
+            int info_length = 0;
+            int max_length = info_length;
+
+            glGetProgramiv(id, GL_INFO_LOG_LENGTH, &max_length);
+
+            auto log = std::vector<char>();
+            log.resize(max_length);
+
+            glGetProgramInfoLog(id, max_length, &info_length, log.data());
+
+            for (auto c: log)
+                std::cerr << c;
+            std::cerr << std::endl;
+
+            glDeleteProgram(id);
+            id = 0;
+        }
+
+        return id;
+    }
+
+    void ShaderLibrary::set_binary_cache_directory(const std::string& directory)
+    {
+        _binary_cache_directory = directory;
+        if (directory.empty())
+            return;
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error)
+        {
+            std::cerr << "[WARNING] In ShaderLibrary::set_binary_cache_directory: Unable to create `" << directory << "`: " << error.message() << ". Program binaries will not be cached" << std::endl;
+            _binary_cache_directory.clear();
+        }
+    }
+
+    const std::string& ShaderLibrary::get_binary_cache_directory()
+    {
+        return _binary_cache_directory;
+    }
+
+    bool ShaderLibrary::get_program_binaries_supported()
+    {
+        // some drivers expose the extension but no formats, which means binaries can not be loaded
+        static const bool supported = [](){
+            if (not (GLEW_VERSION_4_1 or GLEW_ARB_get_program_binary))
+                return false;
+
+            GLint n_formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+            return n_formats > 0;
+        }();
+
+        return supported;
+    }
+
+    size_t ShaderLibrary::get_driver_hash()
+    {
+        static const size_t driver_hash = [](){
+            std::string driver;
+            for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+            {
+                auto* value = reinterpret_cast<const char*>(glGetString(name));
+                driver.append(value != nullptr ? value : "");
+                driver.push_back('\n');
+            }
+
+            return std::hash<std::string>()(driver);
+        }();
+
+        return driver_hash;
+    }
+
+    std::string ShaderLibrary::get_binary_path(size_t hash)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016zx.bin", hash);
+        return (std::filesystem::path(_binary_cache_directory) / name).string();
+    }
+
+    GLNativeHandle ShaderLibrary::load_binary(size_t hash)
+    {
+        if (_binary_cache_directory.empty() or not get_program_binaries_supported())
+            return 0;
+
+        const auto path = get_binary_path(hash);
+        auto file = std::ifstream(path, std::ios::binary);
+        if (not file.is_open())
+            return 0;
+
+        auto header = detail::ProgramBinaryHeader();
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        std::vector<char> binary;
+        if (file and detail::program_binary_header_valid(header, get_driver_hash(), hash))
+        {
+            // size is read from disk, only allocate if the binary takes up exactly the rest of the file
+            const auto begin = file.tellg();
+            file.seekg(0, std::ios::end);
+            const auto end = file.tellg();
+            file.seekg(begin);
+
+            const bool size_valid = begin >= 0 and end >= begin
+                and header.size == uint64_t(end - begin)
+                and header.size <= uint64_t(std::numeric_limits<GLsizei>::max());
+
+            if (size_valid)
+            {
+                binary.resize(header.size);
+                file.read(binary.data(), binary.size());
+            }
+        }
+
+        if (not file or binary.empty())
+        {
+            // driver was updated or the file is corrupt, it is rewritten once the program is compiled
+            return 0;
+        }
+
+        GLNativeHandle id = glCreateProgram();
+        glProgramBinary(id, header.format, binary.data(), binary.size());
+
+        GLint link_success = GL_FALSE;
+        glGetProgramiv(id, GL_LINK_STATUS, &link_success);
+        if (link_success != GL_TRUE)
+        {
+            // drivers may reject binaries for reasons the header does not capture, fall back to compiling
+            glDeleteProgram(id);
+            return 0;
+        }
+
+        return id;
+    }
+
+    void ShaderLibrary::store_binary(GLNativeHandle program, size_t hash)
+    {
+        if (_binary_cache_directory.empty() or not get_program_binaries_supported())
+            return;
+
+        GLint size = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+        if (size <= 0)
+            return;
+
+        auto header = detail::ProgramBinaryHeader();
+        std::vector<char> binary(size);
+
+        GLenum format = 0;
+        GLsizei n_written = 0;
+        glGetProgramBinary(program, size, &n_written, &format, binary.data());
+        if (n_written <= 0)
+            return;
+
+        header.format = format;
+        header.driver_hash = get_driver_hash();
+        header.source_hash = hash;
+        header.size = n_written;
+
+        // written next to the target and renamed, so other instances never read a partial file
+        const auto path = get_binary_path(hash);
+        const auto temporary_path = path + ".tmp";
+
+        {
+            auto file = std::ofstream(temporary_path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(binary.data(), n_written);
+
+            if (not file)
+            {
+                std::cerr << "[WARNING] In ShaderLibrary::store_binary: Unable to write `" << temporary_path << "`" << std::endl;
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporary_path, path, error);
+        if (error)
+        {
+            std::cerr << "[WARNING] In ShaderLibrary::store_binary: Unable to move `" << temporary_path << "` to `" << path << "`: " << error.message() << std::endl;
+            std::filesystem::remove(temporary_path, error);
+        }
+    }
+}
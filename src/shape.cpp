@@ -13,137 +13,152 @@ namespace mousetrap
     {
         glGenVertexArrays(1, &_vertex_array_id);
         glGenBuffers(1, &_vertex_buffer_id);
+        glGenBuffers(1, &_element_buffer_id);
     }
 
     Shape::~Shape()
     {
         glDeleteVertexArrays(1, &_vertex_array_id);
         glDeleteBuffers(1, &_vertex_buffer_id);
+        glDeleteBuffers(1, &_element_buffer_id);
     }
 
-    void Shape::initialize()
+    void Shape::write_vertex_info(const Vertex& v, VertexInfo& data)
     {
-        _vertex_data.clear();
-        _vertex_data.reserve(_vertices.size());
-
-        for (auto &v: _vertices)
-        {
-            _vertex_data.emplace_back();
-            auto &data = _vertex_data.back();
+        auto as_gl_position = to_gl_position(v.position);
 
-            auto as_gl_position = to_gl_position(v.position);
+        data._position[0] = as_gl_position[0];
+        data._position[1] = as_gl_position[1];
+        data._position[2] = as_gl_position[2];
 
-            data._position[0] = as_gl_position[0];
-            data._position[1] = as_gl_position[1];
-            data._position[2] = as_gl_position[2];
+        data._color[0] = v.color.r;
+        data._color[1] = v.color.g;
+        data._color[2] = v.color.b;
+        data._color[3] = v.color.a;
 
-            data._color[0] = v.color.r;
-            data._color[1] = v.color.g;
-            data._color[2] = v.color.b;
-            data._color[3] = v.color.a;
+        data._texture_coordinates[0] = v.texture_coordinates[0];
+        data._texture_coordinates[1] = v.texture_coordinates[1];
+    }
 
-            data._texture_coordinates[0] = v.texture_coordinates[0];
-            data._texture_coordinates[1] = v.texture_coordinates[1];
-        }
+    void Shape::initialize()
+    {
+        _vertex_data.resize(_vertices.size());
+        _dirty_begin = _vertices.size();
+        _dirty_end = 0;
+        update_vertex_data(0, _vertices.size());
 
-        update_data(true, true, true);
+        _indices_dirty = true;
     }
 
-    void Shape::update_data(bool update_position, bool update_color, bool update_tex_coords)
+    void Shape::update_vertex_data(size_t first, size_t last)
     {
-        glBindVertexArray(_vertex_array_id);
-        glBindBuffer(GL_ARRAY_BUFFER, _vertex_buffer_id);
-        glBufferData(GL_ARRAY_BUFFER, _vertex_data.size() * sizeof(VertexInfo), _vertex_data.data(), GL_STATIC_DRAW);
+        last = std::min(last, _vertices.size());
+        if (first >= last)
+            return;
 
-        if (update_position)
+        for (size_t i = first; i < last; ++i)
+            write_vertex_info(_vertices[i], _vertex_data[i]);
+
+        if (_dirty_begin >= _dirty_end)
         {
-            auto position_location = Shader::get_vertex_position_location();
-            glEnableVertexAttribArray(position_location);
-            glVertexAttribPointer(position_location,
-                                  3,
-                                  GL_FLOAT,
-                                  GL_FALSE,
-                                  sizeof(struct VertexInfo),
-                                  (GLvoid *) (G_STRUCT_OFFSET(struct VertexInfo, _position))
-            );
+            _dirty_begin = first;
+            _dirty_end = last;
         }
+        else
+        {
+            _dirty_begin = std::min(_dirty_begin, first);
+            _dirty_end = std::max(_dirty_end, last);
+        }
+    }
+
+    void Shape::update_data()
+    {
+        const bool vertices_dirty = _dirty_begin < _dirty_end;
+        if (not vertices_dirty and not _indices_dirty)
+            return;
+
+        glBindVertexArray(_vertex_array_id);
 
-        if (update_color)
+        if (vertices_dirty)
         {
-            auto color_location = Shader::get_vertex_color_location();
-            glEnableVertexAttribArray(color_location);
-            glVertexAttribPointer(color_location,
-                                  4,
-                                  GL_FLOAT,
-                                  GL_FALSE,
-                                  sizeof(struct VertexInfo),
-                                  (GLvoid *) (G_STRUCT_OFFSET(struct VertexInfo, _color))
-            );
+            glBindBuffer(GL_ARRAY_BUFFER, _vertex_buffer_id);
+
+            if (_vertex_data.size() > _vertex_buffer_capacity)
+            {
+                // storage only grows, shapes that shrink keep their buffer and upload into the front of it
+                glBufferData(GL_ARRAY_BUFFER, _vertex_data.size() * sizeof(VertexInfo), _vertex_data.data(), GL_DYNAMIC_DRAW);
+                _vertex_buffer_capacity = _vertex_data.size();
+
+                auto position_location = Shader::get_vertex_position_location();
+                glEnableVertexAttribArray(position_location);
+                glVertexAttribPointer(position_location,
+                                      3,
+                                      GL_FLOAT,
+                                      GL_FALSE,
+                                      sizeof(struct VertexInfo),
+                                      (GLvoid *) (G_STRUCT_OFFSET(struct VertexInfo, _position))
+                );
+
+                auto color_location = Shader::get_vertex_color_location();
+                glEnableVertexAttribArray(color_location);
+                glVertexAttribPointer(color_location,
+                                      4,
+                                      GL_FLOAT,
+                                      GL_FALSE,
+                                      sizeof(struct VertexInfo),
+                                      (GLvoid *) (G_STRUCT_OFFSET(struct VertexInfo, _color))
+                );
+
+                auto texture_coordinate_location = Shader::get_vertex_texture_coordinate_location();
+                glEnableVertexAttribArray(texture_coordinate_location);
+                glVertexAttribPointer(texture_coordinate_location,
+                                      2,
+                                      GL_FLOAT,
+                                      GL_FALSE,
+                                      sizeof(struct VertexInfo),
+                                      (GLvoid *) (G_STRUCT_OFFSET(struct VertexInfo, _texture_coordinates))
+                );
+            }
+            else
+            {
+                glBufferSubData(
+                    GL_ARRAY_BUFFER,
+                    _dirty_begin * sizeof(VertexInfo),
+                    (_dirty_end - _dirty_begin) * sizeof(VertexInfo),
+                    _vertex_data.data() + _dirty_begin
+                );
+            }
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            _dirty_begin = 0;
+            _dirty_end = 0;
         }
 
-        if (update_tex_coords)
+        if (_indices_dirty)
         {
-            auto texture_coordinate_location = Shader::get_vertex_texture_coordinate_location();
-            glEnableVertexAttribArray(texture_coordinate_location);
-            glVertexAttribPointer(texture_coordinate_location,
-                                  2,
-                                  GL_FLOAT,
-                                  GL_FALSE,
-                                  sizeof(struct VertexInfo),
-                                  (GLvoid *) (G_STRUCT_OFFSET(struct VertexInfo, _texture_coordinates))
-            );
+            // element buffer binding is part of the vertex array state, so it stays bound after this
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _element_buffer_id);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indices.size() * sizeof(int), _indices.data(), GL_STATIC_DRAW);
+            _n_indices = _indices.size();
+            _indices_dirty = false;
         }
 
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
     }
 
     void Shape::update_position()
     {
-        for (size_t i = 0; i < _vertices.size(); ++i)
-        {
-            auto& v = _vertices.at(i);
-            auto& data = _vertex_data.at(i);
-
-            auto as_gl_position = to_gl_position(v.position);
-
-            data._position[0] = as_gl_position[0];
-            data._position[1] = as_gl_position[1];
-            data._position[2] = as_gl_position[2];
-        }
-
-        update_data(true, false, false);
+        update_vertex_data(0, _vertices.size());
     }
 
     void Shape::update_color()
     {
-        for (size_t i = 0; i < _vertices.size(); ++i)
-        {
-            auto& v = _vertices.at(i);
-            auto& data = _vertex_data.at(i);
-
-            data._color[0] = v.color.r;
-            data._color[1] = v.color.g;
-            data._color[2] = v.color.b;
-            data._color[3] = v.color.a;
-        }
-
-        update_data(false, true, false);
+        update_vertex_data(0, _vertices.size());
     }
 
     void Shape::update_texture_coordinate()
     {
-        for (size_t i = 0; i < _vertices.size(); ++i)
-        {
-            auto& v = _vertices.at(i);
-            auto& data = _vertex_data.at(i);
-
-            data._texture_coordinates[0] = v.texture_coordinates[0];
-            data._texture_coordinates[1] = v.texture_coordinates[1];
-        }
-
-        update_data(false, false, true);
+        update_vertex_data(0, _vertices.size());
     }
 
     void Shape::render(Shader& shader, GLTransform transform)
@@ -151,18 +166,21 @@ namespace mousetrap
         if (not _visible)
             return;
 
-        update_data(false, true, false); // TODO: optimize this away
+        update_data();
+
+        if (_n_indices == 0)
+            return;
 
         glUseProgram(shader.get_program_id());
-        glUniformMatrix4fv(shader.get_uniform_location("_transform"), 1, GL_FALSE, &(transform.transform[0][0]));
+        glUniformMatrix4fv(shader.get_transform_location(), 1, GL_FALSE, &(transform.transform[0][0]));
 
-        glUniform1i(shader.get_uniform_location("_texture_set"), _texture != nullptr ? GL_TRUE : GL_FALSE);
+        glUniform1i(shader.get_texture_set_location(), _texture != nullptr ? GL_TRUE : GL_FALSE);
 
         if (_texture != nullptr)
             _texture->bind();
 
         glBindVertexArray(_vertex_array_id);
-        glDrawElements(_render_type, _indices.size(), GL_UNSIGNED_INT, _indices.data());
+        glDrawElements(_render_type, _n_indices, GL_UNSIGNED_INT, nullptr);
 
         if (_texture != nullptr)
             _texture->unbind();
@@ -200,7 +218,7 @@ namespace mousetrap
 
     void Shape::as_point(Vector2f a)
     {
-        _vertices = {};
+        _vertices = {Vertex(a.x, a.y, _color)};
         _indices = {0};
         _render_type = GL_POINTS;
         initialize();
@@ -530,8 +548,7 @@ namespace mousetrap
     void Shape::set_vertex_color(size_t i, RGBA color)
     {
         _vertices.at(i).color = color;
-        update_color();
-        update_data(false, true, false);
+        update_vertex_data(i, i + 1);
     }
 
     RGBA Shape::get_vertex_color(size_t index) const
@@ -542,8 +559,7 @@ namespace mousetrap
     void Shape::set_vertex_position(size_t i, Vector3f position)
     {
         _vertices.at(i).position = position;
-        update_position();
-        update_data(true, false, false);
+        update_vertex_data(i, i + 1);
     }
 
     Vector3f Shape::get_vertex_position(size_t i) const
@@ -555,8 +571,7 @@ namespace mousetrap
     void Shape::set_vertex_texture_coordinate(size_t i, Vector2f coordinates)
     {
         _vertices.at(i).texture_coordinates = coordinates;
-        update_texture_coordinate();
-        update_data(false, false, true);
+        update_vertex_data(i, i + 1);
     }
 
     Vector2f Shape::get_vertex_texture_coordinate(size_t i) const
@@ -624,7 +639,6 @@ namespace mousetrap
         }
 
         update_position();
-        update_data(true, false, false);
     }
 
     Rectangle Shape::get_bounding_box() const
@@ -674,7 +688,6 @@ namespace mousetrap
         }
 
         update_position();
-        update_data(true, false, false);
     }
 
     void Shape::rotate(Angle angle)
@@ -692,7 +705,6 @@ namespace mousetrap
         }
 
         update_position();
-        update_data(true, false, false);
     }
 
     const TextureObject* Shape::get_texture()
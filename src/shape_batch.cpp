@@ -0,0 +1,112 @@
+// 
+// Copyright 2022 Clemens Cords
+// Created on 3/19/23 by clem (mail@clemens-cords.com)
+//
+
+#include <include/shape_batch.hpp>
+
+#include <iostream>
+
+namespace mousetrap
+{
+    ShapeBatch::ShapeBatch(ShapeBatchType type)
+        : Shape(), _type(type)
+    {
+        _render_type = _type == ShapeBatchType::LINES ? GL_LINES : GL_TRIANGLES;
+    }
+
+    void ShapeBatch::clear()
+    {
+        _vertices.clear();
+        _indices.clear();
+    }
+
+    void ShapeBatch::add_line(Vector2f a, Vector2f b, RGBA color)
+    {
+        if (_type != ShapeBatchType::LINES)
+        {
+            std::cerr << "[ERROR] In ShapeBatch::add_line: Batch does not render lines" << std::endl;
+            return;
+        }
+
+        _indices.push_back(_vertices.size());
+        _vertices.emplace_back(a.x, a.y, color);
+
+        _indices.push_back(_vertices.size());
+        _vertices.emplace_back(b.x, b.y, color);
+    }
+
+    void ShapeBatch::add_lines(const std::vector<std::pair<Vector2f, Vector2f>>& lines, RGBA color)
+    {
+        _vertices.reserve(_vertices.size() + 2 * lines.size());
+        _indices.reserve(_indices.size() + 2 * lines.size());
+
+        for (const auto& pair : lines)
+            add_line(pair.first, pair.second, color);
+    }
+
+    void ShapeBatch::add_line_loop(const std::vector<Vector2f>& points, RGBA color)
+    {
+        if (_type != ShapeBatchType::LINES)
+        {
+            std::cerr << "[ERROR] In ShapeBatch::add_line_loop: Batch does not render lines" << std::endl;
+            return;
+        }
+
+        if (points.size() < 2)
+            return;
+
+        // vertices are shared between the two lines that meet at them
+        const size_t first = _vertices.size();
+        for (const auto& point : points)
+            _vertices.emplace_back(point.x, point.y, color);
+
+        for (size_t i = 0; i < points.size(); ++i)
+        {
+            _indices.push_back(first + i);
+            _indices.push_back(first + (i + 1) % points.size());
+        }
+    }
+
+    void ShapeBatch::add_rectangle(Vector2f top_left, Vector2f size, RGBA color, Vector2f texture_top_left, Vector2f texture_size)
+    {
+        if (_type != ShapeBatchType::RECTANGLES)
+        {
+            std::cerr << "[ERROR] In ShapeBatch::add_rectangle: Batch does not render rectangles" << std::endl;
+            return;
+        }
+
+        const size_t first = _vertices.size();
+
+        _vertices.emplace_back(top_left.x, top_left.y, color);
+        _vertices.back().texture_coordinates = texture_top_left;
+
+        _vertices.emplace_back(top_left.x + size.x, top_left.y, color);
+        _vertices.back().texture_coordinates = texture_top_left + Vector2f(texture_size.x, 0);
+
+        _vertices.emplace_back(top_left.x + size.x, top_left.y + size.y, color);
+        _vertices.back().texture_coordinates = texture_top_left + texture_size;
+
+        _vertices.emplace_back(top_left.x, top_left.y + size.y, color);
+        _vertices.back().texture_coordinates = texture_top_left + Vector2f(0, texture_size.y);
+
+        for (size_t i : {0, 1, 2, 0, 2, 3})
+            _indices.push_back(first + i);
+    }
+
+    void ShapeBatch::flush()
+    {
+        _render_type = _type == ShapeBatchType::LINES ? GL_LINES : GL_TRIANGLES;
+        initialize();
+    }
+
+    size_t ShapeBatch::get_n_lines() const
+    {
+        return _type == ShapeBatchType::LINES ? _indices.size() / 2 : 0;
+    }
+
+    size_t ShapeBatch::get_n_rectangles() const
+    {
+        return _type == ShapeBatchType::RECTANGLES ? _indices.size() / 6 : 0;
+    }
+}
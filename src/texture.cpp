@@ -39,6 +39,27 @@ namespace mousetrap
         _size = {width, height};
     }
 
+    void Texture::create(size_t width, size_t height, ImageFormat format)
+    {
+        glActiveTexture(GL_TEXTURE0 + 0);
+        glBindTexture(GL_TEXTURE_2D, _native_handle);
+
+        const bool is_rgba8 = format == ImageFormat::RGBA8;
+
+        glTexImage2D(GL_TEXTURE_2D,
+                     0,
+                     is_rgba8 ? GL_RGBA8 : GL_RGBA32F,
+                     width,
+                     height,
+                     0,
+                     GL_RGBA,
+                     is_rgba8 ? GL_UNSIGNED_BYTE : GL_FLOAT,
+                     nullptr
+        );
+
+        _size = {width, height};
+    }
+
     void Texture::create_from_file(const std::string& path)
     {
         auto image = Image();
@@ -74,21 +95,55 @@ namespace mousetrap
         glActiveTexture(GL_TEXTURE0 + 0);
         glBindTexture(GL_TEXTURE_2D, _native_handle);
 
+        const bool is_rgba8 = image.get_format() == ImageFormat::RGBA8;
+
         glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         glTexImage2D(GL_TEXTURE_2D,
                      0,
-                     GL_RGBA32F,
+                     is_rgba8 ? GL_RGBA8 : GL_RGBA32F,
                      image.get_size().x,
                      image.get_size().y,
                      0,
                      GL_RGBA,
-                     GL_FLOAT,
+                     is_rgba8 ? GL_UNSIGNED_BYTE : GL_FLOAT,
                      image.data()
         );
 
         _size = image.get_size();
     }
 
+    void Texture::update_from_image(const Image& image, Vector2i image_top_left, Vector2ui size, Vector2i texture_top_left)
+    {
+        if (size.x == 0 or size.y == 0)
+            return;
+
+        glActiveTexture(GL_TEXTURE0 + 0);
+        glBindTexture(GL_TEXTURE_2D, _native_handle);
+
+        const bool is_rgba8 = image.get_format() == ImageFormat::RGBA8;
+
+        // read sub-rectangle straight out of the images buffer
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, image.get_size().x);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, image_top_left.x);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, image_top_left.y);
+
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        0,
+                        texture_top_left.x,
+                        texture_top_left.y,
+                        size.x,
+                        size.y,
+                        GL_RGBA,
+                        is_rgba8 ? GL_UNSIGNED_BYTE : GL_FLOAT,
+                        image.data()
+        );
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    }
+
     void Texture::bind(size_t texture_unit) const
     {
         glActiveTexture(GL_TEXTURE0 + texture_unit);
@@ -161,11 +216,12 @@ namespace mousetrap
 
     Image Texture::download() const
     {
-        auto out = Image();
+        auto out = Image(ImageFormat::RGBA8);
         out.create(_size.x, _size.y);
 
         glBindTexture(GL_TEXTURE_2D, _native_handle);
-        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, out.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, out.data());
         glBindTexture(GL_TEXTURE_2D, 0);
 
         return out;